@@ -34,7 +34,7 @@ uint64_t __llvm_profile_get_magic(void) {
 
 uint64_t __llvm_profile_get_version(void) {
   /* This should be bumped any time the output format changes. */
-  return 1;
+  return 2;
 }
 
 void __llvm_profile_reset_counters(void) {
@@ -42,4 +42,8 @@ void __llvm_profile_reset_counters(void) {
   uint64_t *E = __llvm_profile_counters_end();
 
   memset(I, 0, sizeof(uint64_t)*(E - I));
+
+  I = __llvm_profile_values_begin();
+  E = __llvm_profile_values_end();
+  memset(I, 0, sizeof(uint64_t)*(E - I));
 }
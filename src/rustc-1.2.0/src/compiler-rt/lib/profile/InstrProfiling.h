@@ -27,7 +27,7 @@ typedef uint32_t uintptr_t;
 
 #endif /* defined(__FreeBSD__) && defined(__i386__) */
 
-#define PROFILE_HEADER_SIZE 7
+#define PROFILE_HEADER_SIZE 9
 
 typedef struct __llvm_profile_data {
   const uint32_t NameSize;
@@ -35,8 +35,14 @@ typedef struct __llvm_profile_data {
   const uint64_t FuncHash;
   const char *const Name;
   uint64_t *const Counters;
+  const void *const FunctionPointer;
+  uint64_t *const Values;
+  const uint32_t NumValueSites;
 } __llvm_profile_data;
 
+/*! \brief Number of targets recorded for each value profiling site. */
+#define PROFILE_VALUES_PER_SITE 4
+
 /*!
  * \brief Get required size for profile buffer.
  */
@@ -56,10 +62,24 @@ const char *__llvm_profile_names_begin(void);
 const char *__llvm_profile_names_end(void);
 uint64_t *__llvm_profile_counters_begin(void);
 uint64_t *__llvm_profile_counters_end(void);
+uint64_t *__llvm_profile_values_begin(void);
+uint64_t *__llvm_profile_values_end(void);
 
 #define PROFILE_RANGE_SIZE(Range) \
   (__llvm_profile_ ## Range ## _end() - __llvm_profile_ ## Range ## _begin())
 
+/*!
+ * \brief Record the target of an indirect call.
+ *
+ * Calls to this are emitted by the compiler before each profiled indirect
+ * call.  \c Data is the \a __llvm_profile_data of the calling function, and
+ * \c SiteIndex the number of the call site in it.  The most frequent targets
+ * of each site are kept in the function's value counters, as pairs of the
+ * target address and its count.
+ */
+void __llvm_profile_instrument_target(uint64_t Target, void *Data,
+                                      uint32_t SiteIndex);
+
 /*!
  * \brief Write instrumentation data to the current file.
  *
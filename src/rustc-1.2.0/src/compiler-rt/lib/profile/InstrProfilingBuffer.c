@@ -15,6 +15,7 @@ uint64_t __llvm_profile_get_size_for_buffer(void) {
   return sizeof(uint64_t) * PROFILE_HEADER_SIZE +
      PROFILE_RANGE_SIZE(data) * sizeof(__llvm_profile_data) +
      PROFILE_RANGE_SIZE(counters) * sizeof(uint64_t) +
+     PROFILE_RANGE_SIZE(values) * sizeof(uint64_t) +
      PROFILE_RANGE_SIZE(names) * sizeof(char);
 }
 
@@ -26,12 +27,15 @@ int __llvm_profile_write_buffer(char *Buffer) {
   const __llvm_profile_data *DataEnd = __llvm_profile_data_end();
   const uint64_t *CountersBegin = __llvm_profile_counters_begin();
   const uint64_t *CountersEnd   = __llvm_profile_counters_end();
+  const uint64_t *ValuesBegin = __llvm_profile_values_begin();
+  const uint64_t *ValuesEnd   = __llvm_profile_values_end();
   const char *NamesBegin = __llvm_profile_names_begin();
   const char *NamesEnd   = __llvm_profile_names_end();
 
   /* Calculate size of sections. */
   const uint64_t DataSize = DataEnd - DataBegin;
   const uint64_t CountersSize = CountersEnd - CountersBegin;
+  const uint64_t ValuesSize = ValuesEnd - ValuesBegin;
   const uint64_t NamesSize = NamesEnd - NamesBegin;
 
   /* Create the header. */
@@ -43,6 +47,8 @@ int __llvm_profile_write_buffer(char *Buffer) {
   Header[4] = NamesSize;
   Header[5] = (uintptr_t)CountersBegin;
   Header[6] = (uintptr_t)NamesBegin;
+  Header[7] = ValuesSize;
+  Header[8] = (uintptr_t)ValuesBegin;
 
   /* Write the data. */
 #define UPDATE_memcpy(Data, Size) \
@@ -53,6 +59,7 @@ int __llvm_profile_write_buffer(char *Buffer) {
   UPDATE_memcpy(Header,  PROFILE_HEADER_SIZE * sizeof(uint64_t));
   UPDATE_memcpy(DataBegin,     DataSize      * sizeof(__llvm_profile_data));
   UPDATE_memcpy(CountersBegin, CountersSize  * sizeof(uint64_t));
+  UPDATE_memcpy(ValuesBegin,   ValuesSize    * sizeof(uint64_t));
   UPDATE_memcpy(NamesBegin,    NamesSize     * sizeof(char));
 #undef UPDATE_memcpy
 
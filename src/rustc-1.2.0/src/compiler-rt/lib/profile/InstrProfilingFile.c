@@ -18,12 +18,15 @@ static int writeFile(FILE *File) {
   const __llvm_profile_data *DataEnd = __llvm_profile_data_end();
   const uint64_t *CountersBegin = __llvm_profile_counters_begin();
   const uint64_t *CountersEnd   = __llvm_profile_counters_end();
+  const uint64_t *ValuesBegin = __llvm_profile_values_begin();
+  const uint64_t *ValuesEnd   = __llvm_profile_values_end();
   const char *NamesBegin = __llvm_profile_names_begin();
   const char *NamesEnd   = __llvm_profile_names_end();
 
   /* Calculate size of sections. */
   const uint64_t DataSize = DataEnd - DataBegin;
   const uint64_t CountersSize = CountersEnd - CountersBegin;
+  const uint64_t ValuesSize = ValuesEnd - ValuesBegin;
   const uint64_t NamesSize = NamesEnd - NamesBegin;
 
   /* Create the header. */
@@ -35,6 +38,8 @@ static int writeFile(FILE *File) {
   Header[4] = NamesSize;
   Header[5] = (uintptr_t)CountersBegin;
   Header[6] = (uintptr_t)NamesBegin;
+  Header[7] = ValuesSize;
+  Header[8] = (uintptr_t)ValuesBegin;
 
   /* Write the data. */
 #define CHECK_fwrite(Data, Size, Length, File) \
@@ -42,6 +47,7 @@ static int writeFile(FILE *File) {
   CHECK_fwrite(Header,        sizeof(uint64_t), PROFILE_HEADER_SIZE, File);
   CHECK_fwrite(DataBegin,     sizeof(__llvm_profile_data), DataSize, File);
   CHECK_fwrite(CountersBegin, sizeof(uint64_t), CountersSize, File);
+  CHECK_fwrite(ValuesBegin,   sizeof(uint64_t), ValuesSize, File);
   CHECK_fwrite(NamesBegin,    sizeof(char), NamesSize, File);
 #undef CHECK_fwrite
 
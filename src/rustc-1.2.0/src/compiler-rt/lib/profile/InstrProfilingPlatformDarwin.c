@@ -17,6 +17,8 @@ extern char NamesStart __asm("section$start$__DATA$__llvm_prf_names");
 extern char NamesEnd   __asm("section$end$__DATA$__llvm_prf_names");
 extern uint64_t CountersStart __asm("section$start$__DATA$__llvm_prf_cnts");
 extern uint64_t CountersEnd   __asm("section$end$__DATA$__llvm_prf_cnts");
+extern uint64_t ValuesStart __asm("section$start$__DATA$__llvm_prf_vals");
+extern uint64_t ValuesEnd   __asm("section$end$__DATA$__llvm_prf_vals");
 
 const __llvm_profile_data *__llvm_profile_data_begin(void) {
   return &DataStart;
@@ -28,4 +30,6 @@ const char *__llvm_profile_names_begin(void) { return &NamesStart; }
 const char *__llvm_profile_names_end(void) { return &NamesEnd; }
 uint64_t *__llvm_profile_counters_begin(void) { return &CountersStart; }
 uint64_t *__llvm_profile_counters_end(void) { return &CountersEnd; }
+uint64_t *__llvm_profile_values_begin(void) { return &ValuesStart; }
+uint64_t *__llvm_profile_values_end(void) { return &ValuesEnd; }
 #endif
@@ -18,6 +18,8 @@ static const char *NamesFirst = NULL;
 static const char *NamesLast = NULL;
 static uint64_t *CountersFirst = NULL;
 static uint64_t *CountersLast = NULL;
+static uint64_t *ValuesFirst = NULL;
+static uint64_t *ValuesLast = NULL;
 
 /*!
  * \brief Register an instrumented function.
@@ -29,6 +31,17 @@ static uint64_t *CountersLast = NULL;
 void __llvm_profile_register_function(void *Data_) {
   /* TODO: Only emit this function if we can't use linker magic. */
   const __llvm_profile_data *Data = (__llvm_profile_data*)Data_;
+
+  /* Only functions with value profiling sites have values. */
+  if (Data->Values) {
+    uint64_t *ValuesEnd =
+        Data->Values + 2 * PROFILE_VALUES_PER_SITE * Data->NumValueSites;
+    if (!ValuesFirst || Data->Values < ValuesFirst)
+      ValuesFirst = Data->Values;
+    if (ValuesEnd > ValuesLast)
+      ValuesLast = ValuesEnd;
+  }
+
   if (!DataFirst) {
     DataFirst = Data;
     DataLast = Data + 1;
@@ -64,4 +77,6 @@ const char *__llvm_profile_names_begin(void) { return NamesFirst; }
 const char *__llvm_profile_names_end(void) { return NamesLast; }
 uint64_t *__llvm_profile_counters_begin(void) { return CountersFirst; }
 uint64_t *__llvm_profile_counters_end(void) { return CountersLast; }
+uint64_t *__llvm_profile_values_begin(void) { return ValuesFirst; }
+uint64_t *__llvm_profile_values_end(void) { return ValuesLast; }
 #endif
@@ -0,0 +1,42 @@
+/*===- InstrProfilingValue.c - Support library for value profiling --------===*\
+|*
+|*                     The LLVM Compiler Infrastructure
+|*
+|* This file is distributed under the University of Illinois Open Source
+|* License. See LICENSE.TXT for details.
+|*
+\*===----------------------------------------------------------------------===*/
+
+#include "InstrProfiling.h"
+
+void __llvm_profile_instrument_target(uint64_t Target, void *Data_,
+                                      uint32_t SiteIndex) {
+  const __llvm_profile_data *Data = (__llvm_profile_data*)Data_;
+  uint64_t *Site, *Min = 0;
+  unsigned I;
+
+  if (!Data->Values || SiteIndex >= Data->NumValueSites)
+    return;
+
+  /* Each site holds PROFILE_VALUES_PER_SITE pairs of target and count.  A
+   * count of zero marks an empty pair.
+   */
+  Site = Data->Values + 2 * PROFILE_VALUES_PER_SITE * SiteIndex;
+  for (I = 0; I < PROFILE_VALUES_PER_SITE; ++I) {
+    uint64_t *Pair = Site + 2 * I;
+    if (Pair[1] && Pair[0] == Target) {
+      ++Pair[1];
+      return;
+    }
+    if (!Min || Pair[1] < Min[1])
+      Min = Pair;
+  }
+
+  /* Take an empty pair if there is one.  Otherwise, age the least frequent
+   * target, so that one which has become hot eventually takes its place.
+   */
+  if (Min[1] && --Min[1])
+    return;
+  Min[0] = Target;
+  Min[1] = 1;
+}
@@ -162,6 +162,7 @@ const (
 	JumpTableAttribute          Attribute = 1 << 45
 	ConvergentAttribute         Attribute = 1 << 46
 	SafeStackAttribute          Attribute = 1 << 47
+	NoRecurseAttribute          Attribute = 1 << 48
 )
 
 //-------------------------------------------------------------------------
@@ -170,6 +170,7 @@ typedef enum {
     LLVMJumpTableAttribute = 1ULL << 45,
     LLVMConvergentAttribute = 1ULL << 46,
     LLVMSafeStackAttribute = 1ULL << 47,
+    LLVMNoRecurseAttribute = 1ULL << 48,
     */
 } LLVMAttribute;
 
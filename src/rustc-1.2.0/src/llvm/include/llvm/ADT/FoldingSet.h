@@ -148,6 +148,12 @@ public:
   /// clear - Remove all nodes from the folding set.
   void clear();
 
+  /// shrink_and_clear - Remove all nodes from the folding set, and release
+  /// buckets beyond what its current number of nodes needs, so that a set
+  /// which once grew large is not slow to clear ever after.  Returns true if
+  /// the bucket array was shrunk.
+  bool shrink_and_clear();
+
   /// RemoveNode - Remove a node from the folding set, returning true if one
   /// was removed or false if the node was not in the folding set.
   bool RemoveNode(Node *N);
@@ -20,6 +20,7 @@
 #ifndef LLVM_ADT_SETVECTOR_H
 #define LLVM_ADT_SETVECTOR_H
 
+#include "llvm/ADT/ArrayRef.h"
 #include "llvm/ADT/SmallSet.h"
 #include <algorithm>
 #include <cassert>
@@ -65,6 +66,10 @@ public:
     return vector_.size();
   }
 
+  /// \brief Return the contents of the SetVector as an ArrayRef, in insertion
+  /// order.
+  ArrayRef<T> getArrayRef() const { return vector_; }
+
   /// \brief Get an iterator to the beginning of the SetVector.
   iterator begin() {
     return vector_.begin();
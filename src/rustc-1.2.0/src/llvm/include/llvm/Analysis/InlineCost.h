@@ -14,9 +14,13 @@
 #ifndef LLVM_ANALYSIS_INLINECOST_H
 #define LLVM_ANALYSIS_INLINECOST_H
 
+#include "llvm/ADT/DenseMap.h"
 #include "llvm/Analysis/CallGraphSCCPass.h"
+#include "llvm/IR/ValueHandle.h"
 #include <cassert>
 #include <climits>
+#include <map>
+#include <vector>
 
 namespace llvm {
 class AssumptionCacheTracker;
@@ -99,10 +103,60 @@ public:
 };
 
 /// \brief Cost analyzer used by inliner.
+///
+/// The result of analyzing a callee body for a particular call site only
+/// depends on the callee, the threshold and a small signature of the call
+/// site: which arguments are constants (and which constants), which are
+/// constant offsets from a common base or an alloca, and a few flags about
+/// the call itself. Results are cached under that signature so that the
+/// callee body is only walked once for all call sites which look the same to
+/// the analysis. Cached results for a function are dropped when it is
+/// deleted, when the inliner modifies it, and once the SCC containing it has
+/// been fully processed by the call graph pass manager.
 class InlineCostAnalysis : public CallGraphSCCPass {
   TargetTransformInfoWrapperPass *TTIWP;
   AssumptionCacheTracker *ACT;
 
+  /// \brief The outcome of running the call analyzer on one call site.
+  struct CachedCost {
+    int Cost;
+    int Threshold;
+    bool ShouldInline;
+  };
+
+  /// \brief Cached results for one callee, keyed by call site signature.
+  typedef std::map<std::vector<uintptr_t>, CachedCost> CallSiteCostMap;
+
+  /// \brief A callback value handle applied to callees, which we use to drop
+  /// their cached costs when they are deleted.
+  class CalleeCallbackVH : public CallbackVH {
+    InlineCostAnalysis *ICA;
+    void deleted() override;
+
+  public:
+    typedef DenseMapInfo<Value *> DMI;
+
+    CalleeCallbackVH(Value *V, InlineCostAnalysis *ICA = nullptr)
+        : CallbackVH(V), ICA(ICA) {}
+  };
+
+  friend CalleeCallbackVH;
+
+  typedef DenseMap<CalleeCallbackVH, CallSiteCostMap, CalleeCallbackVH::DMI>
+      CalleeCostMap;
+  CalleeCostMap CostCache;
+
+  /// \brief The functions of the SCC visited last. Their bodies may have been
+  /// changed by any pass run on that SCC, so their cached costs are dropped
+  /// when the next SCC is visited.
+  std::vector<WeakVH> LastSCCFunctions;
+
+  /// \brief Compute the signature of \p CS under which the cost of inlining
+  /// \p Callee is cached. Returns false if the call site cannot be
+  /// summarized.
+  bool getCallSiteSignature(CallSite CS, Function *Callee, int Threshold,
+                            std::vector<uintptr_t> &Signature);
+
 public:
   static char ID;
 
@@ -113,6 +167,9 @@ public:
   void getAnalysisUsage(AnalysisUsage &AU) const override;
   bool runOnSCC(CallGraphSCC &SCC) override;
 
+  using llvm::Pass::doFinalization;
+  bool doFinalization(CallGraph &CG) override;
+
   /// \brief Get an InlineCost object representing the cost of inlining this
   /// callsite.
   ///
@@ -136,6 +193,12 @@ public:
 
   /// \brief Minimal filter to detect invalid constructs for inlining.
   bool isInlineViable(Function &Callee);
+
+  /// \brief Drop all cached costs of inlining \p F.
+  ///
+  /// This must be called whenever the body of \p F is changed while costs
+  /// for it may be cached, e.g. when the inliner inlines a call site into it.
+  void invalidateCachedCosts(Function *F);
 };
 
 }
@@ -361,9 +361,9 @@ public:
     bool Need;
     /// Holds the pointers that we need to check.
     SmallVector<TrackingVH<Value>, 2> Pointers;
-    /// Holds the pointer value at the beginning of the loop.
+    /// Holds the lowest address accessed through the pointer.
     SmallVector<const SCEV*, 2> Starts;
-    /// Holds the pointer value at the end of the loop.
+    /// Holds one past the highest address accessed through the pointer.
     SmallVector<const SCEV*, 2> Ends;
     /// Holds the information if this pointer is used for writing to memory.
     SmallVector<bool, 2> IsWritePtr;
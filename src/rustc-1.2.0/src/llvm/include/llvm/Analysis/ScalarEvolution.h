@@ -394,6 +394,49 @@ namespace llvm {
     /// SignedRanges - Memoized results from getRange
     DenseMap<const SCEV *, ConstantRange> SignedRanges;
 
+    /// CacheStats - Hit and miss counts of the caches above for the current
+    /// function, reported by -scev-stats.
+    struct CacheStats {
+      unsigned ValueExprHits, ValueExprMisses;
+      unsigned BackedgeTakenHits, BackedgeTakenMisses;
+      unsigned ValuesAtScopeHits, ValuesAtScopeMisses;
+      unsigned DerivedEvictions, ValueExprEvictions;
+    };
+    CacheStats Stats;
+
+    /// QueryDepth - The number of getSCEV, getSCEVAtScope and
+    /// getBackedgeTakenInfo calls in progress. The caches hold placeholder
+    /// entries while a query is in progress, so they may only be trimmed
+    /// when this is zero.
+    unsigned QueryDepth;
+
+    /// QueryScope - Track one query in QueryDepth, trimming the caches to the
+    /// budget first if it is the outermost one.
+    class QueryScope {
+      ScalarEvolution &SE;
+
+    public:
+      explicit QueryScope(ScalarEvolution &SE) : SE(SE) {
+        if (SE.QueryDepth++ == 0)
+          SE.enforceCacheBudget();
+      }
+      ~QueryScope() { --SE.QueryDepth; }
+    };
+
+    /// getCacheMemoryUsage - Return an estimate of the bytes held by the
+    /// caches that may be evicted. SCEV nodes themselves are not included.
+    size_t getCacheMemoryUsage() const;
+
+    /// enforceCacheBudget - Drop cached results if the caches have grown past
+    /// -scev-cache-budget. The expression caches are dropped first since
+    /// they are cheapest to recompute; ValueExprMap and the backedge-taken
+    /// counts only if that was not enough.
+    void enforceCacheBudget();
+
+    /// printCacheStats - Print the cache sizes and hit rates for the current
+    /// function.
+    void printCacheStats(raw_ostream &OS) const;
+
     /// RangeSignHint - Used to parameterize getRange
     enum RangeSignHint { HINT_RANGE_UNSIGNED, HINT_RANGE_SIGNED };
 
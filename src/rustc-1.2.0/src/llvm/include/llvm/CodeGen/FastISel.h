@@ -521,6 +521,7 @@ protected:
 
 
   bool lowerCall(const CallInst *I);
+  bool lowerCallSite(ImmutableCallSite CS);
   /// \brief Select and emit code for a binary operator instruction, which has
   /// an opcode which directly corresponds to the given ISD opcode.
   bool selectBinaryOp(const User *I, unsigned ISDOpcode);
@@ -534,6 +535,8 @@ protected:
   bool selectCast(const User *I, unsigned Opcode);
   bool selectExtractValue(const User *I);
   bool selectInsertValue(const User *I);
+  bool selectInvoke(const User *I);
+  bool selectLandingPad(const User *I);
 
 private:
   /// \brief Handle PHI nodes in successor blocks.
@@ -22,6 +22,7 @@
 #include "llvm/CodeGen/DAGCombine.h"
 #include "llvm/CodeGen/MachineFunction.h"
 #include "llvm/CodeGen/SelectionDAGNodes.h"
+#include "llvm/Support/ArrayRecycler.h"
 #include "llvm/Support/RecyclingAllocator.h"
 #include "llvm/Target/TargetMachine.h"
 #include <cassert>
@@ -206,9 +207,14 @@ class SelectionDAG {
   /// CSE with existing nodes when a duplicate is requested.
   FoldingSet<SDNode> CSEMap;
 
-  /// Pool allocation for machine-opcode SDNode operands.
+  /// Pool allocation for SDNode operand lists too long to be embedded in the
+  /// node, and for shuffle masks.
   BumpPtrAllocator OperandAllocator;
 
+  /// Recycles operand lists of deleted and morphed nodes, so that a DAG which
+  /// is repeatedly combined and legalized does not grow OperandAllocator.
+  ArrayRecycler<SDUse> OperandRecycler;
+
   /// Pool allocation for misc. objects that are created once per SelectionDAG.
   BumpPtrAllocator Allocator;
 
@@ -1249,6 +1255,13 @@ private:
   void DeleteNodeNotInCSEMaps(SDNode *N);
   void DeallocateNode(SDNode *N);
 
+  /// Give Node an operand list allocated from OperandRecycler, holding Vals.
+  void createOperands(SDNode *Node, ArrayRef<SDValue> Vals);
+
+  /// Return Node's operand list to OperandRecycler if it came from there.
+  /// The operands must already have been dropped.
+  void recycleOperands(SDNode *Node);
+
   void allnodes_clear();
 
   BinarySDNode *GetBinarySDNode(unsigned Opcode, SDLoc DL, SDVTList VTs,
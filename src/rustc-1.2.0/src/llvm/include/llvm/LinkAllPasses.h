@@ -83,6 +83,8 @@ namespace {
       (void) llvm::createDomViewerPass();
       (void) llvm::createGCOVProfilerPass();
       (void) llvm::createInstrProfilingPass();
+      (void) llvm::createIndirectCallProfilingPass();
+      (void) llvm::createIndirectCallPromotionPass();
       (void) llvm::createFunctionInliningPass();
       (void) llvm::createAlwaysInlinerPass();
       (void) llvm::createGlobalDCEPass();
@@ -159,6 +161,8 @@ namespace {
       (void) llvm::createPrintBasicBlockPass(*(llvm::raw_ostream*)nullptr);
       (void) llvm::createModuleDebugInfoPrinterPass();
       (void) llvm::createPartialInliningPass();
+      (void) llvm::createHotColdSplittingPass();
+      (void) llvm::createFunctionOrderingPass();
       (void) llvm::createLintPass();
       (void) llvm::createSinkingPass();
       (void) llvm::createLowerAtomicPass();
@@ -176,9 +180,11 @@ namespace {
       (void) llvm::createStraightLineStrengthReducePass();
       (void) llvm::createMemDerefPrinter();
       (void) llvm::createFloat2IntPass();
+      (void) llvm::createLoopVersioningLICMPass();
 
       // Specific to the rust-lang llvm branch:
       (void) llvm::createNullCheckEliminationPass();
+      (void) llvm::createBoundsCheckEliminationPass();
 
       (void)new llvm::IntervalPartition();
       (void)new llvm::ScalarEvolution();
@@ -56,6 +56,24 @@ public:
   /// still manually register any additional analyses.
   void registerFunctionAnalyses(FunctionAnalysisManager &FAM);
 
+  /// \brief Build the function simplification pipeline for an optimization
+  /// level.
+  ///
+  /// This is the function-level part of the standard -O1/-O2/-O3 pipeline,
+  /// restricted to the passes which have been ported to the new pass manager.
+  /// Passes in it share the dominator tree and assumption cache through the
+  /// \c FunctionAnalysisManager instead of recomputing them. An \p OptLevel
+  /// of zero yields an empty pipeline. It is also available in textual
+  /// pipelines as 'function-simplify<O0>' through 'function-simplify<O3>'.
+  ///
+  /// This is not the pipeline 'opt -O2' runs: there are no loop passes and
+  /// none of the passes which need alias analysis. It grows as passes are
+  /// ported, and until then should not be used in place of the legacy
+  /// \c PassManagerBuilder.
+  FunctionPassManager
+  buildFunctionSimplificationPipeline(unsigned OptLevel,
+                                      bool DebugLogging = false);
+
   /// \brief Parse a textual pass pipeline description into a \c ModulePassManager.
   ///
   /// The format of the textual pass pipeline description looks something like:
@@ -16,6 +16,8 @@
 #ifndef LLVM_PROFILEDATA_INSTRPROF_H_
 #define LLVM_PROFILEDATA_INSTRPROF_H_
 
+#include "llvm/ADT/StringRef.h"
+#include "llvm/Support/DataTypes.h"
 #include <system_error>
 
 namespace llvm {
@@ -41,6 +43,28 @@ inline std::error_code make_error_code(instrprof_error E) {
   return std::error_code(static_cast<int>(E), instrprof_category());
 }
 
+/// The kinds of values recorded by llvm.instrprof.value.profile.
+enum InstrProfValueKind : uint32_t {
+  IPVK_IndirectCallTarget = 0
+};
+
+/// The number of distinct values the runtime keeps for each value profiling
+/// site. This is part of the raw profile format.
+const unsigned InstrProfValuesPerSite = 4;
+
+/// A value observed at a value profiling site and how often it was seen.
+///
+/// For indirect call targets, Value is the hash of the callee's name, as
+/// computed by getInstrProfFuncNameHash().
+struct InstrProfValueData {
+  uint64_t Value;
+  uint64_t Count;
+};
+
+/// Return the hash which identifies the function \p FuncName in value
+/// profiling data.
+uint64_t getInstrProfFuncNameHash(StringRef FuncName);
+
 } // end namespace llvm
 
 namespace std {
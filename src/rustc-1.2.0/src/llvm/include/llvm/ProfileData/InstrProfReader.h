@@ -16,6 +16,7 @@
 #define LLVM_PROFILEDATA_INSTRPROFREADER_H
 
 #include "llvm/ADT/ArrayRef.h"
+#include "llvm/ADT/DenseMap.h"
 #include "llvm/ADT/StringExtras.h"
 #include "llvm/ProfileData/InstrProf.h"
 #include "llvm/Support/EndianStream.h"
@@ -37,6 +38,8 @@ struct InstrProfRecord {
   StringRef Name;
   uint64_t Hash;
   ArrayRef<uint64_t> Counts;
+  /// The profiled targets of each indirect call site, hottest first.
+  std::vector<std::vector<InstrProfValueData>> IndirectCallSites;
 };
 
 /// A file format agnostic iterator over profiling data.
@@ -149,6 +152,9 @@ private:
     const uint64_t FuncHash;
     const IntPtrT NamePtr;
     const IntPtrT CounterPtr;
+    const IntPtrT FunctionPtr;
+    const IntPtrT ValuesPtr;
+    const uint32_t NumValueSites;
   };
   struct RawHeader {
     const uint64_t Magic;
@@ -158,16 +164,23 @@ private:
     const uint64_t NamesSize;
     const uint64_t CountersDelta;
     const uint64_t NamesDelta;
+    const uint64_t ValuesSize;
+    const uint64_t ValuesDelta;
   };
 
   bool ShouldSwapBytes;
   uint64_t CountersDelta;
   uint64_t NamesDelta;
+  uint64_t ValuesDelta;
   const ProfileData *Data;
   const ProfileData *DataEnd;
   const uint64_t *CountersStart;
+  const uint64_t *ValuesStart;
   const char *NamesStart;
   const char *ProfileEnd;
+  /// Maps the address of each profiled function to the hash of its name, so
+  /// that indirect call targets can be recorded by name.
+  DenseMap<IntPtrT, uint64_t> FunctionNameHashes;
 
   RawInstrProfReader(const RawInstrProfReader &) = delete;
   RawInstrProfReader &operator=(const RawInstrProfReader &) = delete;
@@ -182,6 +195,7 @@ public:
 private:
   std::error_code readNextHeader(const char *CurrentPos);
   std::error_code readHeader(const RawHeader &Header);
+  std::error_code readValueData(InstrProfRecord &Record);
   template <class IntT>
   IntT swap(IntT Int) const {
     return ShouldSwapBytes ? sys::getSwappedBytes(Int) : Int;
@@ -194,6 +208,10 @@ private:
     ptrdiff_t Offset = (swap(NamePtr) - NamesDelta) / sizeof(char);
     return NamesStart + Offset;
   }
+  const uint64_t *getValues(IntPtrT ValuesPtr) const {
+    ptrdiff_t Offset = (swap(ValuesPtr) - ValuesDelta) / sizeof(uint64_t);
+    return ValuesStart + Offset;
+  }
 };
 
 typedef RawInstrProfReader<uint32_t> RawInstrProfReader32;
@@ -274,6 +292,11 @@ private:
   /// The maximal execution count among all functions.
   uint64_t MaxFunctionCount;
 
+  /// Decode the data for one function hash starting at \p Offset in \p Data,
+  /// and advance \p Offset past it.
+  std::error_code readRecordData(ArrayRef<uint64_t> Data, size_t &Offset,
+                                 InstrProfRecord &Record);
+
   IndexedInstrProfReader(const IndexedInstrProfReader &) = delete;
   IndexedInstrProfReader &operator=(const IndexedInstrProfReader &) = delete;
 public:
@@ -291,6 +314,10 @@ public:
   /// Fill Counts with the profile data for the given function name.
   std::error_code getFunctionCounts(StringRef FuncName, uint64_t FuncHash,
                                     std::vector<uint64_t> &Counts);
+  /// Fill Record with the profile data, including the indirect call targets,
+  /// for the given function name and hash.
+  std::error_code getFunctionRecord(StringRef FuncName, uint64_t FuncHash,
+                                    InstrProfRecord &Record);
   /// Return the maximum of all known function counts.
   uint64_t getMaximumFunctionCount() { return MaxFunctionCount; }
 
@@ -29,7 +29,12 @@ namespace llvm {
 /// Writer for instrumentation based profile data.
 class InstrProfWriter {
 public:
-  typedef SmallDenseMap<uint64_t, std::vector<uint64_t>, 1> CounterData;
+  /// The counts and indirect call targets recorded for one function hash.
+  struct FunctionCounts {
+    std::vector<uint64_t> Counts;
+    std::vector<std::vector<InstrProfValueData>> IndirectCallSites;
+  };
+  typedef SmallDenseMap<uint64_t, FunctionCounts, 1> CounterData;
 private:
   StringMap<CounterData> FunctionData;
   uint64_t MaxFunctionCount;
@@ -38,10 +43,11 @@ public:
 
   /// Add function counts for the given function. If there are already counts
   /// for this function and the hash and number of counts match, each counter is
-  /// summed.
-  std::error_code addFunctionCounts(StringRef FunctionName,
-                                    uint64_t FunctionHash,
-                                    ArrayRef<uint64_t> Counters);
+  /// summed, as are the counts of matching indirect call targets.
+  std::error_code addFunctionCounts(
+      StringRef FunctionName, uint64_t FunctionHash,
+      ArrayRef<uint64_t> Counters,
+      ArrayRef<std::vector<InstrProfValueData>> IndirectCallSites = None);
   /// Write the profile to \c OS
   void write(raw_fd_ostream &OS);
   /// Write the profile, returning the raw data. For testing.
@@ -0,0 +1,117 @@
+//===-- llvm/Support/ThreadPool.h - A ThreadPool implementation -*- C++ -*-===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This file defines a crude C++11 based thread pool.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef LLVM_SUPPORT_THREADPOOL_H
+#define LLVM_SUPPORT_THREADPOOL_H
+
+#include "llvm/Config/llvm-config.h"
+#include "llvm/Support/Compiler.h"
+
+#include <functional>
+#include <future>
+#include <queue>
+#include <vector>
+
+#if LLVM_ENABLE_THREADS
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#endif
+
+namespace llvm {
+
+/// \brief A ThreadPool for asynchronous parallel execution on a defined number
+/// of threads.
+///
+/// The pool keeps a vector of threads alive, waiting on a condition variable
+/// for some work to become available. Tasks are executed in the order they
+/// were queued, but may complete in any order.
+///
+/// When LLVM is built without thread support, no thread is ever created and
+/// the tasks are run sequentially on the calling thread by wait().
+class ThreadPool {
+public:
+  typedef std::packaged_task<void()> PackagedTaskTy;
+
+  /// \brief Construct a pool with the number of hardware threads available.
+  ThreadPool();
+
+  /// \brief Construct a pool of \p ThreadCount threads. A \p ThreadCount of
+  /// 0 creates one thread per hardware thread.
+  explicit ThreadPool(unsigned ThreadCount);
+
+  /// \brief Blocking destructor: the pool will wait for all the threads to
+  /// complete.
+  ~ThreadPool();
+
+  /// \brief Asynchronous submission of a task to the pool. The returned future
+  /// can be used to wait for the task to finish and is *non-blocking* on
+  /// destruction.
+  template <typename Function, typename... Args>
+  std::shared_future<void> async(Function &&F, Args &&... ArgList) {
+    auto Task =
+        std::bind(std::forward<Function>(F), std::forward<Args>(ArgList)...);
+    return asyncImpl(std::move(Task));
+  }
+
+  /// \brief Asynchronous submission of a task to the pool. The returned future
+  /// can be used to wait for the task to finish and is *non-blocking* on
+  /// destruction.
+  template <typename Function>
+  std::shared_future<void> async(Function &&F) {
+    return asyncImpl(std::forward<Function>(F));
+  }
+
+  /// \brief Blocking wait for all the threads to complete and the queue to be
+  /// empty. It is an error to try to add new tasks while blocking on this
+  /// call.
+  void wait();
+
+  /// \brief Return the number of threads this pool runs tasks on.
+  unsigned getThreadCount() const { return ThreadCount; }
+
+private:
+  /// \brief Asynchronous submission of a task to the pool. The returned future
+  /// can be used to wait for the task to finish and is *non-blocking* on
+  /// destruction.
+  std::shared_future<void> asyncImpl(std::function<void()> F);
+
+  unsigned ThreadCount;
+
+  /// Tasks waiting for execution in the pool.
+  std::queue<PackagedTaskTy> Tasks;
+
+#if LLVM_ENABLE_THREADS
+  /// Threads in flight.
+  std::vector<std::thread> Threads;
+
+  /// Locking and signaling for accessing the Tasks queue.
+  std::mutex QueueLock;
+  std::condition_variable QueueCondition;
+
+  /// Locking and signaling for job completion.
+  std::mutex CompletionLock;
+  std::condition_variable CompletionCondition;
+
+  /// Keep track of the number of thread actually busy.
+  std::atomic<unsigned> ActiveThreads;
+
+  /// Signal for the destruction of the pool, asking thread to exit.
+  bool EnableFlag;
+#endif
+};
+
+} // End namespace llvm
+
+#endif // LLVM_SUPPORT_THREADPOOL_H
@@ -189,6 +189,18 @@ ModulePass *createMergeFunctionsPass();
 ///
 ModulePass *createPartialInliningPass();
 
+//===----------------------------------------------------------------------===//
+/// createHotColdSplittingPass - This pass outlines cold regions of functions
+/// into separate functions.
+///
+ModulePass *createHotColdSplittingPass();
+
+//===----------------------------------------------------------------------===//
+/// createFunctionOrderingPass - This pass orders the functions of a module
+/// using profile data, so that hot callers and callees are adjacent.
+///
+ModulePass *createFunctionOrderingPass();
+
 //===----------------------------------------------------------------------===//
 // createMetaRenamerPass - Rename everything with metasyntatic names.
 //
@@ -15,6 +15,7 @@
 #ifndef LLVM_TRANSFORMS_IPO_PASSMANAGERBUILDER_H
 #define LLVM_TRANSFORMS_IPO_PASSMANAGERBUILDER_H
 
+#include <string>
 #include <vector>
 
 namespace llvm {
@@ -122,6 +123,14 @@ public:
   bool VerifyOutput;
   bool MergeFunctions;
 
+  /// ProfileIndirectCalls - Instrument the module to record the targets of
+  /// its indirect calls.
+  bool ProfileIndirectCalls;
+
+  /// IndirectCallProfile - If non-empty, the indexed profile used to promote
+  /// hot indirect calls to direct calls.
+  std::string IndirectCallProfile;
+
 private:
   /// ExtensionList - This is list of all of the extensions that are registered.
   std::vector<std::pair<ExtensionPointTy, ExtensionFn> > Extensions;
@@ -141,6 +150,7 @@ private:
   void addInitialAliasAnalysisPasses(legacy::PassManagerBase &PM) const;
   void addLTOOptimizationPasses(legacy::PassManagerBase &PM);
   void addLateLTOOptimizationPasses(legacy::PassManagerBase &PM);
+  void addIndirectCallProfilePasses(legacy::PassManagerBase &MPM);
 
 public:
   /// populateFunctionPassManager - This fills in the function pass manager,
@@ -83,6 +83,14 @@ struct InstrProfOptions {
 ModulePass *createInstrProfilingPass(
     const InstrProfOptions &Options = InstrProfOptions());
 
+/// Insert profiling of the targets of indirect calls, and function entry
+/// counters identifying them. Must be followed by createInstrProfilingPass.
+ModulePass *createIndirectCallProfilingPass();
+
+/// Promote the hot targets of indirect calls recorded in the indexed profile
+/// \p ProfileFile to guarded direct calls.
+ModulePass *createIndirectCallPromotionPass(StringRef ProfileFile = "");
+
 // Insert AddressSanitizer (address sanity checking) instrumentation
 FunctionPass *createAddressSanitizerFunctionPass();
 ModulePass *createAddressSanitizerModulePass();
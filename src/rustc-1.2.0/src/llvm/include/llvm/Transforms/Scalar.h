@@ -486,6 +486,13 @@ FunctionPass *createNaryReassociatePass();
 //
 FunctionPass *createLoopDistributePass();
 
+//===----------------------------------------------------------------------===//
+//
+// LoopVersioningLICM - Version loops on run-time alias checks so that LICM
+// can hoist or promote their loop-invariant memory accesses.
+//
+FunctionPass *createLoopVersioningLICMPass();
+
 // Specific to the rust-lang llvm branch:
 //===----------------------------------------------------------------------===//
 //
@@ -493,6 +500,13 @@ FunctionPass *createLoopDistributePass();
 //
 FunctionPass *createNullCheckEliminationPass();
 
+//===----------------------------------------------------------------------===//
+//
+// BoundsCheckElimination - Remove index < length checks which branch to a
+// panic, using SCEV and dominating conditions, versioning loops if needed.
+//
+FunctionPass *createBoundsCheckEliminationPass();
+
 } // End llvm namespace
 
 #endif
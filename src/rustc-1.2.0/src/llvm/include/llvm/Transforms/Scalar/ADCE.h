@@ -0,0 +1,39 @@
+//===- ADCE.h - Aggressive dead code elimination ----------------*- C++ -*-===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+/// \file
+/// This file provides the interface for the Aggressive Dead Code Elimination
+/// pass.
+///
+//===----------------------------------------------------------------------===//
+
+#ifndef LLVM_TRANSFORMS_SCALAR_ADCE_H
+#define LLVM_TRANSFORMS_SCALAR_ADCE_H
+
+#include "llvm/IR/Function.h"
+#include "llvm/IR/PassManager.h"
+
+namespace llvm {
+
+/// \brief A DCE pass that assumes instructions are dead until proven otherwise.
+///
+/// This pass eliminates dead code by optimistically assuming that all
+/// instructions are dead until proven otherwise, allowing it to eliminate
+/// dead computations that other DCE passes do not catch, particularly
+/// involving loop computations.
+class ADCEPass {
+public:
+  static StringRef name() { return "ADCEPass"; }
+
+  /// \brief Run the pass over the function.
+  PreservedAnalyses run(Function &F);
+};
+
+}
+
+#endif
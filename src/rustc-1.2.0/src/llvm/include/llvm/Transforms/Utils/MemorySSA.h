@@ -0,0 +1,333 @@
+//===- MemorySSA.h - Build a use/def graph of memory accesses ---*- C++ -*-===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This file declares the MemorySSA class, an SSA form over the memory state
+// of a function.
+//
+// Every instruction which may write memory gets a MemoryDef, which produces a
+// new version of memory. Every instruction which only reads memory gets a
+// MemoryUse. Where versions of memory from several predecessors meet, a
+// MemoryPhi is placed, exactly like a PHI node for a scalar that is stored in
+// every block with a MemoryDef. A single distinguished MemoryDef, the
+// live-on-entry def, stands for the state of memory on entry to the function.
+//
+// For example:
+//
+//   define void @foo() {
+//   entry:
+//     %p = alloca i32
+//   ; 1 = MemoryDef(liveOnEntry)
+//     store i32 0, i32* %p
+//     br label %loop
+//   loop:
+//   ; 3 = MemoryPhi({entry,1},{loop,2})
+//   ; MemoryUse(3)
+//     %v = load i32, i32* %p
+//   ; 2 = MemoryDef(3)
+//     store i32 %v, i32* %p
+//     br i1 undef, label %loop, label %exit
+//   ...
+//
+// The graph is built once per function and answers "which access is the
+// nearest one that may clobber this location" by walking MemoryDefs, without
+// scanning any of the instructions in between and without a per-block scan
+// limit. The only alias queries performed are against MemoryDefs on the path.
+//
+// The graph does not track the exact memory locations of each def, so
+// queries still go through alias analysis. Clients which delete memory
+// instructions must call removeMemoryAccess() to keep the graph up to date.
+// Newly created memory instructions have no access; clients must handle a
+// null result from getMemoryAccess().
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef LLVM_TRANSFORMS_UTILS_MEMORYSSA_H
+#define LLVM_TRANSFORMS_UTILS_MEMORYSSA_H
+
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/ADT/iterator_range.h"
+#include "llvm/Analysis/MemoryLocation.h"
+#include "llvm/IR/ValueHandle.h"
+#include "llvm/Support/Casting.h"
+#include <memory>
+#include <utility>
+#include <vector>
+
+namespace llvm {
+
+class AliasAnalysis;
+class BasicBlock;
+class DominatorTree;
+class Function;
+class Instruction;
+class LoadInst;
+class MemorySSA;
+class raw_ostream;
+
+/// \brief The base class of all memory accesses.
+class MemoryAccess {
+public:
+  enum AccessKind { MemoryUseKind, MemoryDefKind, MemoryPhiKind };
+
+  virtual ~MemoryAccess() {}
+
+  AccessKind getKind() const { return Kind; }
+
+  /// \brief The block this access is in, or null for the live-on-entry def.
+  BasicBlock *getBlock() const { return Block; }
+
+  typedef SmallVectorImpl<MemoryAccess *>::const_iterator user_iterator;
+
+  /// \brief The MemoryUses, MemoryDefs and MemoryPhis which use the memory
+  /// state defined by this access. Only MemoryDefs and MemoryPhis have users.
+  user_iterator user_begin() const { return Users.begin(); }
+  user_iterator user_end() const { return Users.end(); }
+  iterator_range<user_iterator> users() const {
+    return iterator_range<user_iterator>(user_begin(), user_end());
+  }
+  bool hasUsers() const { return !Users.empty(); }
+
+  virtual void print(raw_ostream &OS) const = 0;
+  void dump() const;
+
+protected:
+  friend class MemorySSA;
+  friend class MemoryUseOrDef;
+  friend class MemoryPhi;
+
+  MemoryAccess(AccessKind Kind, BasicBlock *BB) : Kind(Kind), Block(BB) {}
+
+  void addUser(MemoryAccess *U) { Users.push_back(U); }
+  void removeUser(MemoryAccess *U);
+
+  /// \brief Make every user of this access use \p MA instead.
+  void replaceAllUsesWith(MemoryAccess *MA);
+
+  /// \brief Replace this access' own uses of \p From with \p To.
+  virtual void replaceUseOf(MemoryAccess *From, MemoryAccess *To) = 0;
+
+private:
+  AccessKind Kind;
+  BasicBlock *Block;
+  SmallVector<MemoryAccess *, 4> Users;
+};
+
+inline raw_ostream &operator<<(raw_ostream &OS, const MemoryAccess &MA) {
+  MA.print(OS);
+  return OS;
+}
+
+/// \brief The common base of MemoryUse and MemoryDef: an access which
+/// belongs to an instruction and is defined by exactly one other access.
+class MemoryUseOrDef : public MemoryAccess {
+public:
+  Instruction *getMemoryInst() const { return MemoryInst; }
+  MemoryAccess *getDefiningAccess() const { return DefiningAccess; }
+
+  static bool classof(const MemoryAccess *MA) {
+    return MA->getKind() == MemoryUseKind || MA->getKind() == MemoryDefKind;
+  }
+
+protected:
+  friend class MemorySSA;
+
+  MemoryUseOrDef(AccessKind Kind, Instruction *MI, BasicBlock *BB)
+      : MemoryAccess(Kind, BB), MemoryInst(MI), DefiningAccess(nullptr) {}
+
+  void setDefiningAccess(MemoryAccess *DMA);
+  void replaceUseOf(MemoryAccess *From, MemoryAccess *To) override;
+
+private:
+  Instruction *MemoryInst;
+  MemoryAccess *DefiningAccess;
+};
+
+/// \brief An instruction which reads memory but does not modify it.
+class MemoryUse : public MemoryUseOrDef {
+public:
+  MemoryUse(Instruction *MI, BasicBlock *BB)
+      : MemoryUseOrDef(MemoryUseKind, MI, BB) {}
+
+  void print(raw_ostream &OS) const override;
+
+  static bool classof(const MemoryAccess *MA) {
+    return MA->getKind() == MemoryUseKind;
+  }
+};
+
+/// \brief An instruction which may modify memory, producing a new version of
+/// it. Calls and ordered atomics are MemoryDefs even if they only read memory
+/// in some cases.
+class MemoryDef : public MemoryUseOrDef {
+public:
+  MemoryDef(Instruction *MI, BasicBlock *BB, unsigned ID)
+      : MemoryUseOrDef(MemoryDefKind, MI, BB), ID(ID) {}
+
+  /// \brief A number identifying this def when the graph is printed.
+  unsigned getID() const { return ID; }
+
+  void print(raw_ostream &OS) const override;
+
+  static bool classof(const MemoryAccess *MA) {
+    return MA->getKind() == MemoryDefKind;
+  }
+
+private:
+  unsigned ID;
+};
+
+/// \brief The merge point of the memory states coming from the predecessors
+/// of a block.
+class MemoryPhi : public MemoryAccess {
+public:
+  MemoryPhi(BasicBlock *BB, unsigned ID)
+      : MemoryAccess(MemoryPhiKind, BB), ID(ID) {}
+
+  unsigned getID() const { return ID; }
+
+  unsigned getNumIncomingValues() const { return Incoming.size(); }
+  MemoryAccess *getIncomingValue(unsigned I) const {
+    return Incoming[I].second;
+  }
+  BasicBlock *getIncomingBlock(unsigned I) const { return Incoming[I].first; }
+
+  void print(raw_ostream &OS) const override;
+
+  static bool classof(const MemoryAccess *MA) {
+    return MA->getKind() == MemoryPhiKind;
+  }
+
+protected:
+  friend class MemorySSA;
+
+  void addIncoming(MemoryAccess *MA, BasicBlock *BB);
+  void replaceUseOf(MemoryAccess *From, MemoryAccess *To) override;
+
+private:
+  unsigned ID;
+  SmallVector<std::pair<BasicBlock *, MemoryAccess *>, 4> Incoming;
+};
+
+/// \brief The memory SSA form of a function.
+///
+/// The graph refers to the alias analysis and dominator tree it was built
+/// with, and must not outlive them. Splitting critical edges keeps the graph
+/// valid, but the incoming blocks of MemoryPhis then still name the original
+/// predecessors. Clients that otherwise change the CFG must rebuild it.
+class MemorySSA {
+public:
+  typedef SmallVector<MemoryAccess *, 8> AccessList;
+
+  MemorySSA(Function &F, AliasAnalysis &AA, DominatorTree &DT);
+  ~MemorySSA();
+
+  /// \brief Return the MemoryUse or MemoryDef of \p I, or null if \p I does
+  /// not access memory or was created after the graph was built.
+  MemoryUseOrDef *getMemoryAccess(const Instruction *I) const {
+    return InstructionAccesses.lookup(I);
+  }
+
+  /// \brief Return the MemoryPhi at the start of \p BB, if there is one.
+  MemoryPhi *getMemoryPhi(const BasicBlock *BB) const {
+    return BlockPhis.lookup(BB);
+  }
+
+  /// \brief Return the accesses of \p BB in program order, with its
+  /// MemoryPhi first, or null if the block contains no access.
+  const AccessList *getBlockAccesses(const BasicBlock *BB) const {
+    auto I = BlockAccesses.find(BB);
+    return I == BlockAccesses.end() ? nullptr : &I->second;
+  }
+
+  MemoryDef *getLiveOnEntryDef() const { return LiveOnEntryDef.get(); }
+  bool isLiveOnEntryDef(const MemoryAccess *MA) const {
+    return MA == LiveOnEntryDef.get();
+  }
+
+  /// \brief Return the nearest access, starting at \p Start and walking
+  /// upwards, which may modify \p Loc.
+  ///
+  /// The result is a MemoryDef which may clobber \p Loc, the live-on-entry
+  /// def if nothing in the function does, or a MemoryPhi if different paths
+  /// into it reach different clobbers. A MemoryDef or the live-on-entry def
+  /// is the only clobber on every path to \p Start, and so dominates it.
+  ///
+  /// The walk only looks through a MemoryPhi if the pointer of \p Loc is
+  /// computed before the phi's block, so that it names the same address on
+  /// every path into the phi. Otherwise, as for a pointer computed inside a
+  /// loop, the phi is returned.
+  ///
+  /// A walk which visits more than -memoryssa-walk-limit accesses gives up
+  /// and returns the access it stopped at instead. Such a MemoryDef still
+  /// dominates \p Start and nothing between them clobbers \p Loc, but it has
+  /// not been checked against \p Loc itself, so clients which rely on the
+  /// result writing \p Loc must check that with alias analysis.
+  MemoryAccess *getClobberingMemoryAccess(MemoryAccess *Start,
+                                          const MemoryLocation &Loc);
+
+  /// \brief Return the nearest access which may modify the memory read by the
+  /// load \p LI.
+  MemoryAccess *getClobberingMemoryAccess(const LoadInst *LI);
+
+  /// \brief Remove the access of \p I from the graph before \p I is erased.
+  ///
+  /// Users of a removed MemoryDef are rewired to its defining access, so this
+  /// is only correct for a def whose effect on memory is dead or redundant.
+  void removeMemoryAccess(const Instruction *I);
+
+  void print(raw_ostream &OS) const;
+  void dump() const;
+
+  /// \brief Check that every access is defined by an access which dominates
+  /// it, and that the use lists agree with the definitions.
+  void verifyMemorySSA() const;
+
+private:
+  /// A value handle on a pointer which has results in ClobberCache. The cache
+  /// is keyed on the raw pointer, so it is dropped when the pointer is
+  /// deleted, before a new value can be allocated at the same address.
+  class ClobberCacheVH : public CallbackVH {
+    MemorySSA *MSSA;
+
+    void deleted() override;
+
+  public:
+    ClobberCacheVH(Value *V, MemorySSA *MSSA) : CallbackVH(V), MSSA(MSSA) {}
+  };
+
+  /// Return true if \p Loc is the same location on every path into \p Phi,
+  /// so that a clobber walk may look through it.
+  bool isSameLocationAbove(const MemoryLocation &Loc,
+                           const MemoryPhi *Phi) const;
+
+  MemoryUseOrDef *createAccess(Instruction *I, unsigned &NextID);
+  void buildMemorySSA();
+  void clearClobberCache();
+
+  Function &F;
+  AliasAnalysis &AA;
+  DominatorTree &DT;
+
+  std::unique_ptr<MemoryDef> LiveOnEntryDef;
+  std::vector<std::unique_ptr<MemoryAccess>> Accesses;
+  DenseMap<const Instruction *, MemoryUseOrDef *> InstructionAccesses;
+  DenseMap<const BasicBlock *, MemoryPhi *> BlockPhis;
+  DenseMap<const BasicBlock *, AccessList> BlockAccesses;
+
+  /// Results of getClobberingMemoryAccess(), cleared whenever the graph
+  /// changes or one of the pointers they were computed for is deleted.
+  DenseMap<std::pair<MemoryAccess *, MemoryLocation>, MemoryAccess *>
+      ClobberCache;
+  DenseMap<const Value *, std::unique_ptr<ClobberCacheVH>> ClobberCacheHandles;
+};
+
+} // End llvm namespace
+
+#endif
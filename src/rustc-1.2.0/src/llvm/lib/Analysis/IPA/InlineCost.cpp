@@ -30,6 +30,7 @@
 #include "llvm/IR/InstVisitor.h"
 #include "llvm/IR/IntrinsicInst.h"
 #include "llvm/IR/Operator.h"
+#include "llvm/Support/CommandLine.h"
 #include "llvm/Support/Debug.h"
 #include "llvm/Support/raw_ostream.h"
 
@@ -38,6 +39,12 @@ using namespace llvm;
 #define DEBUG_TYPE "inline-cost"
 
 STATISTIC(NumCallsAnalyzed, "Number of call sites analyzed");
+STATISTIC(NumCachedCosts, "Number of call site costs reused from the cache");
+
+static cl::opt<bool> EnableCostCache(
+    "inline-cost-cache", cl::Hidden, cl::init(true),
+    cl::desc("Reuse the inline cost of call sites with the same callee and "
+             "argument signature"));
 
 namespace {
 
@@ -1288,9 +1295,134 @@ void InlineCostAnalysis::getAnalysisUsage(AnalysisUsage &AU) const {
 bool InlineCostAnalysis::runOnSCC(CallGraphSCC &SCC) {
   TTIWP = &getAnalysis<TargetTransformInfoWrapperPass>();
   ACT = &getAnalysis<AssumptionCacheTracker>();
+
+  // All passes have been run over the previous SCC by now, so the costs of
+  // inlining its functions computed while visiting it may be stale.
+  for (WeakVH &V : LastSCCFunctions)
+    if (Function *F = cast_or_null<Function>(V))
+      invalidateCachedCosts(F);
+  LastSCCFunctions.clear();
+  for (CallGraphNode *Node : SCC)
+    if (Function *F = Node->getFunction())
+      LastSCCFunctions.emplace_back(F);
   return false;
 }
 
+bool InlineCostAnalysis::doFinalization(CallGraph &CG) {
+  CostCache.clear();
+  LastSCCFunctions.clear();
+  return false;
+}
+
+void InlineCostAnalysis::CalleeCallbackVH::deleted() {
+  auto I = ICA->CostCache.find_as(cast<Function>(getValPtr()));
+  if (I != ICA->CostCache.end())
+    ICA->CostCache.erase(I);
+  // 'this' now dangles!
+}
+
+void InlineCostAnalysis::invalidateCachedCosts(Function *F) {
+  auto I = CostCache.find_as(F);
+  if (I != CostCache.end())
+    CostCache.erase(I);
+}
+
+/// \brief Strip the constant in-bounds offsets off of V, the same way the
+/// call analyzer does when it maps pointer arguments to a base and offset.
+/// Returns false if V is not a pointer or has no such base.
+static bool stripInBoundsConstantOffsets(const DataLayout &DL, Value *&V,
+                                         APInt &Offset) {
+  if (!V->getType()->isPointerTy())
+    return false;
+
+  Offset = APInt::getNullValue(DL.getPointerSizeInBits());
+  SmallPtrSet<Value *, 4> Visited;
+  Visited.insert(V);
+  do {
+    if (GEPOperator *GEP = dyn_cast<GEPOperator>(V)) {
+      if (!GEP->isInBounds() || !GEP->accumulateConstantOffset(DL, Offset))
+        return false;
+      V = GEP->getPointerOperand();
+    } else if (Operator::getOpcode(V) == Instruction::BitCast) {
+      V = cast<Operator>(V)->getOperand(0);
+    } else if (GlobalAlias *GA = dyn_cast<GlobalAlias>(V)) {
+      if (GA->mayBeOverridden())
+        break;
+      V = GA->getAliasee();
+    } else {
+      break;
+    }
+  } while (Visited.insert(V).second);
+  return true;
+}
+
+bool InlineCostAnalysis::getCallSiteSignature(
+    CallSite CS, Function *Callee, int Threshold,
+    std::vector<uintptr_t> &Signature) {
+  const DataLayout &DL = Callee->getParent()->getDataLayout();
+  if (DL.getPointerSizeInBits() > 64)
+    return false;
+
+  // Everything the call analyzer derives from the call site rather than from
+  // the callee body.
+  Instruction *Instr = CS.getInstruction();
+  bool OnlyOneCallAndLocalLinkage = Callee->hasLocalLinkage() &&
+                                    Callee->hasOneUse() &&
+                                    Callee == CS.getCalledFunction();
+  bool FollowedByUnreachable;
+  if (InvokeInst *II = dyn_cast<InvokeInst>(Instr))
+    FollowedByUnreachable = isa<UnreachableInst>(II->getNormalDest()->begin());
+  else
+    FollowedByUnreachable = isa<UnreachableInst>(++BasicBlock::iterator(Instr));
+  bool IsCallerRecursive = false;
+  Function *Caller = CS.getCaller();
+  for (User *U : Caller->users()) {
+    CallSite Site(U);
+    if (Site && Site.getInstruction()->getParent()->getParent() == Caller) {
+      IsCallerRecursive = true;
+      break;
+    }
+  }
+
+  Signature.push_back(static_cast<uintptr_t>(Threshold));
+  Signature.push_back(OnlyOneCallAndLocalLinkage);
+  Signature.push_back(FollowedByUnreachable);
+  Signature.push_back(IsCallerRecursive);
+
+  // Then classify every argument. Constants are recorded exactly, since the
+  // analysis folds through them. Pointers are recorded as a constant offset
+  // from a base, where only whether the base is an alloca and which of the
+  // arguments share a base matters to the analysis.
+  SmallVector<Value *, 8> Bases;
+  for (unsigned I = 0, E = CS.arg_size(); I != E; ++I) {
+    Value *Arg = CS.getArgument(I);
+    Signature.push_back(reinterpret_cast<uintptr_t>(Arg->getType()));
+    Signature.push_back(CS.isByValArgument(I));
+    Signature.push_back(reinterpret_cast<uintptr_t>(dyn_cast<Constant>(Arg)));
+
+    // The analyzer accumulates all offsets at the width of address space 0.
+    if (PointerType *PTy = dyn_cast<PointerType>(Arg->getType()))
+      if (DL.getPointerSizeInBits(PTy->getAddressSpace()) !=
+          DL.getPointerSizeInBits())
+        return false;
+
+    APInt Offset;
+    if (!stripInBoundsConstantOffsets(DL, Arg, Offset)) {
+      Signature.push_back(0);
+      continue;
+    }
+    unsigned BaseIdx =
+        std::find(Bases.begin(), Bases.end(), Arg) - Bases.begin();
+    if (BaseIdx == Bases.size())
+      Bases.push_back(Arg);
+    Signature.push_back(1);
+    Signature.push_back(isa<AllocaInst>(Arg));
+    Signature.push_back(BaseIdx);
+    Signature.push_back(static_cast<uintptr_t>(Offset.getZExtValue()));
+  }
+  return true;
+}
+
 InlineCost InlineCostAnalysis::getInlineCost(CallSite CS, int Threshold) {
   return getInlineCost(CS, CS.getCalledFunction(), Threshold);
 }
@@ -1343,21 +1475,49 @@ InlineCost InlineCostAnalysis::getInlineCost(CallSite CS, Function *Callee,
       Callee->hasFnAttribute(Attribute::NoInline) || CS.isNoInline())
     return llvm::InlineCost::getNever();
 
-  DEBUG(llvm::dbgs() << "      Analyzing call of " << Callee->getName()
-        << "...\n");
-
-  CallAnalyzer CA(TTIWP->getTTI(*Callee), ACT, *Callee, Threshold);
-  bool ShouldInline = CA.analyzeCall(CS);
+  // Look for the result of an earlier analysis of a call site which is the
+  // same in all respects the call analyzer cares about.
+  std::vector<uintptr_t> Signature;
+  CallSiteCostMap *Costs = nullptr;
+  if (EnableCostCache &&
+      getCallSiteSignature(CS, Callee, Threshold, Signature)) {
+    auto I = CostCache.find_as(Callee);
+    if (I == CostCache.end())
+      I = CostCache.insert(std::make_pair(CalleeCallbackVH(Callee, this),
+                                          CallSiteCostMap())).first;
+    Costs = &I->second;
+  }
 
-  DEBUG(CA.dump());
+  CachedCost Result;
+  CallSiteCostMap::iterator CachedI;
+  if (Costs && (CachedI = Costs->find(Signature)) != Costs->end()) {
+    DEBUG(llvm::dbgs() << "      Reusing cost of call of " << Callee->getName()
+          << "\n");
+    Result = CachedI->second;
+    ++NumCachedCosts;
+  } else {
+    DEBUG(llvm::dbgs() << "      Analyzing call of " << Callee->getName()
+          << "...\n");
+
+    CallAnalyzer CA(TTIWP->getTTI(*Callee), ACT, *Callee, Threshold);
+    bool ShouldInline = CA.analyzeCall(CS);
+
+    DEBUG(CA.dump());
+
+    Result.Cost = CA.getCost();
+    Result.Threshold = CA.getThreshold();
+    Result.ShouldInline = ShouldInline;
+    if (Costs)
+      Costs->insert(std::make_pair(std::move(Signature), Result));
+  }
 
   // Check if there was a reason to force inlining or no inlining.
-  if (!ShouldInline && CA.getCost() < CA.getThreshold())
+  if (!Result.ShouldInline && Result.Cost < Result.Threshold)
     return InlineCost::getNever();
-  if (ShouldInline && CA.getCost() >= CA.getThreshold())
+  if (Result.ShouldInline && Result.Cost >= Result.Threshold)
     return InlineCost::getAlways();
 
-  return llvm::InlineCost::get(CA.getCost(), CA.getThreshold());
+  return llvm::InlineCost::get(Result.Cost, Result.Threshold);
 }
 
 bool InlineCostAnalysis::isInlineViable(Function &F) {
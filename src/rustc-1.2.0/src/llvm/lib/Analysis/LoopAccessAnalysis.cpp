@@ -117,12 +117,37 @@ void LoopAccessInfo::RuntimePointerCheck::insert(
     unsigned ASId, const ValueToValueMap &Strides) {
   // Get the stride replaced scev.
   const SCEV *Sc = replaceSymbolicStrideSCEV(SE, Strides, Ptr);
-  const SCEVAddRecExpr *AR = dyn_cast<SCEVAddRecExpr>(Sc);
-  assert(AR && "Invalid addrec expression");
-  const SCEV *Ex = SE->getBackedgeTakenCount(Lp);
-  const SCEV *ScEnd = AR->evaluateAtIteration(Ex, *SE);
+  const SCEV *ScStart;
+  const SCEV *ScEnd;
+  if (SE->isLoopInvariant(Sc, Lp)) {
+    // A loop-invariant pointer covers the same address on every iteration.
+    ScStart = ScEnd = Sc;
+  } else {
+    const SCEVAddRecExpr *AR = dyn_cast<SCEVAddRecExpr>(Sc);
+    assert(AR && "Invalid addrec expression");
+    const SCEV *Ex = SE->getBackedgeTakenCount(Lp);
+    ScStart = AR->getStart();
+    ScEnd = AR->evaluateAtIteration(Ex, *SE);
+    // With a negative step the last access is the lowest address. Use min/max
+    // when the sign of the step isn't known.
+    const SCEV *Step = AR->getStepRecurrence(*SE);
+    if (const SCEVConstant *CStep = dyn_cast<SCEVConstant>(Step)) {
+      if (CStep->getValue()->isNegative())
+        std::swap(ScStart, ScEnd);
+    } else {
+      ScStart = SE->getUMinExpr(AR->getStart(), ScEnd);
+      ScEnd = SE->getUMaxExpr(AR->getStart(), ScEnd);
+    }
+  }
+  // ScEnd is the address of the last access; the range ends one past its last
+  // byte. Accesses of different sizes, e.g. an i64 at p and an i8 at p + 4,
+  // would otherwise not be seen to overlap.
+  Type *ElemTy = Ptr->getType()->getPointerElementType();
+  ScEnd = SE->getAddExpr(
+      ScEnd, SE->getSizeOfExpr(SE->getEffectiveSCEVType(ScEnd->getType()),
+                               ElemTy));
   Pointers.push_back(Ptr);
-  Starts.push_back(AR->getStart());
+  Starts.push_back(ScStart);
   Ends.push_back(ScEnd);
   IsWritePtr.push_back(WritePtr);
   DependencySetId.push_back(DepSetId);
@@ -287,8 +312,12 @@ private:
 
 /// \brief Check whether a pointer can participate in a runtime bounds check.
 static bool hasComputableBounds(ScalarEvolution *SE,
-                                const ValueToValueMap &Strides, Value *Ptr) {
+                                const ValueToValueMap &Strides, Value *Ptr,
+                                Loop *L) {
   const SCEV *PtrScev = replaceSymbolicStrideSCEV(SE, Strides, Ptr);
+  if (SE->isLoopInvariant(PtrScev, L))
+    return true;
+
   const SCEVAddRecExpr *AR = dyn_cast<SCEVAddRecExpr>(PtrScev);
   if (!AR)
     return false;
@@ -323,7 +352,7 @@ bool AccessAnalysis::canCheckPtrAtRT(
       bool IsWrite = Accesses.count(MemAccessInfo(Ptr, true));
       MemAccessInfo Access(Ptr, IsWrite);
 
-      if (hasComputableBounds(SE, StridesMap, Ptr) &&
+      if (hasComputableBounds(SE, StridesMap, Ptr, TheLoop) &&
           // When we run after a failing dependency check we have to make sure
           // we don't have wrapping pointers.
           (!ShouldCheckStride ||
@@ -1324,23 +1353,21 @@ std::pair<Instruction *, Instruction *> LoopAccessInfo::addRuntimeCheck(
     Value *Ptr = PtrRtCheck.Pointers[i];
     const SCEV *Sc = SE->getSCEV(Ptr);
 
-    if (SE->isLoopInvariant(Sc, TheLoop)) {
+    if (SE->isLoopInvariant(Sc, TheLoop))
       DEBUG(dbgs() << "LAA: Adding RT check for a loop invariant ptr:" <<
             *Ptr <<"\n");
-      Starts.push_back(Ptr);
-      Ends.push_back(Ptr);
-    } else {
+    else
       DEBUG(dbgs() << "LAA: Adding RT check for range:" << *Ptr << '\n');
-      unsigned AS = Ptr->getType()->getPointerAddressSpace();
+    unsigned AS = Ptr->getType()->getPointerAddressSpace();
 
-      // Use this type for pointer arithmetic.
-      Type *PtrArithTy = Type::getInt8PtrTy(Ctx, AS);
+    // Use this type for pointer arithmetic.
+    Type *PtrArithTy = Type::getInt8PtrTy(Ctx, AS);
 
-      Value *Start = Exp.expandCodeFor(PtrRtCheck.Starts[i], PtrArithTy, Loc);
-      Value *End = Exp.expandCodeFor(PtrRtCheck.Ends[i], PtrArithTy, Loc);
-      Starts.push_back(Start);
-      Ends.push_back(End);
-    }
+    // The end is exclusive, so even an invariant pointer needs expanding.
+    Value *Start = Exp.expandCodeFor(PtrRtCheck.Starts[i], PtrArithTy, Loc);
+    Value *End = Exp.expandCodeFor(PtrRtCheck.Ends[i], PtrArithTy, Loc);
+    Starts.push_back(Start);
+    Ends.push_back(End);
   }
 
   IRBuilder<> ChkBuilder(Loc);
@@ -1366,9 +1393,10 @@ std::pair<Instruction *, Instruction *> LoopAccessInfo::addRuntimeCheck(
       Value *End0 =   ChkBuilder.CreateBitCast(Ends[i],   PtrArithTy1, "bc");
       Value *End1 =   ChkBuilder.CreateBitCast(Ends[j],   PtrArithTy0, "bc");
 
-      Value *Cmp0 = ChkBuilder.CreateICmpULE(Start0, End1, "bound0");
+      // [Start0, End0) and [Start1, End1) overlap.
+      Value *Cmp0 = ChkBuilder.CreateICmpULT(Start0, End1, "bound0");
       FirstInst = getFirstInst(FirstInst, Cmp0, Loc);
-      Value *Cmp1 = ChkBuilder.CreateICmpULE(Start1, End0, "bound1");
+      Value *Cmp1 = ChkBuilder.CreateICmpULT(Start1, End0, "bound1");
       FirstInst = getFirstInst(FirstInst, Cmp1, Loc);
       Value *IsConflict = ChkBuilder.CreateAnd(Cmp0, Cmp1, "found.conflict");
       FirstInst = getFirstInst(FirstInst, IsConflict, Loc);
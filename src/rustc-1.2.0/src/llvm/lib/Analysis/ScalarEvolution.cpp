@@ -86,6 +86,7 @@
 #include "llvm/Support/CommandLine.h"
 #include "llvm/Support/Debug.h"
 #include "llvm/Support/ErrorHandling.h"
+#include "llvm/Support/Format.h"
 #include "llvm/Support/MathExtras.h"
 #include "llvm/Support/raw_ostream.h"
 #include <algorithm>
@@ -101,6 +102,14 @@ STATISTIC(NumTripCountsNotComputed,
           "Number of loops without predictable loop counts");
 STATISTIC(NumBruteForceTripCountsComputed,
           "Number of loops with trip counts computed by force");
+STATISTIC(NumValueExprHits, "Number of getSCEV queries answered by the cache");
+STATISTIC(NumValueExprMisses, "Number of getSCEV queries computed");
+STATISTIC(NumBackedgeTakenHits,
+          "Number of backedge-taken count queries answered by the cache");
+STATISTIC(NumValuesAtScopeHits,
+          "Number of getSCEVAtScope queries answered by the cache");
+STATISTIC(NumCacheEvictions,
+          "Number of times the SCEV caches were trimmed to the budget");
 
 static cl::opt<unsigned>
 MaxBruteForceIterations("scalar-evolution-max-iterations", cl::ReallyHidden,
@@ -114,6 +123,16 @@ static cl::opt<bool>
 VerifySCEV("verify-scev",
            cl::desc("Verify ScalarEvolution's backedge taken counts (slow)"));
 
+static cl::opt<unsigned>
+CacheBudget("scev-cache-budget", cl::Hidden, cl::init(0),
+            cl::desc("Memory budget in kilobytes for the caches of "
+                     "ScalarEvolution, per function (0 = unlimited)"));
+
+static cl::opt<bool>
+PrintCacheStats("scev-stats", cl::Hidden,
+                cl::desc("Print the sizes and hit rates of the caches of "
+                         "ScalarEvolution for each function"));
+
 INITIALIZE_PASS_BEGIN(ScalarEvolution, "scalar-evolution",
                 "Scalar Evolution Analysis", false, true)
 INITIALIZE_PASS_DEPENDENCY(AssumptionCacheTracker)
@@ -3314,15 +3333,20 @@ bool ScalarEvolution::checkValidity(const SCEV *S) const {
 /// expression and create a new one.
 const SCEV *ScalarEvolution::getSCEV(Value *V) {
   assert(isSCEVable(V->getType()) && "Value is not SCEVable!");
+  QueryScope Scope(*this);
 
   ValueExprMapType::iterator I = ValueExprMap.find_as(V);
   if (I != ValueExprMap.end()) {
     const SCEV *S = I->second;
-    if (checkValidity(S))
+    if (checkValidity(S)) {
+      ++Stats.ValueExprHits;
+      ++NumValueExprHits;
       return S;
-    else
-      ValueExprMap.erase(I);
+    }
+    ValueExprMap.erase(I);
   }
+  ++Stats.ValueExprMisses;
+  ++NumValueExprMisses;
   const SCEV *S = createSCEV(V);
 
   // The process of creating a SCEV for V may have caused other SCEVs
@@ -4600,6 +4624,8 @@ PushLoopPHIs(const Loop *L, SmallVectorImpl<Instruction *> &Worklist) {
 
 const ScalarEvolution::BackedgeTakenInfo &
 ScalarEvolution::getBackedgeTakenInfo(const Loop *L) {
+  QueryScope Scope(*this);
+
   // Initially insert an invalid entry for this loop. If the insertion
   // succeeds, proceed to actually compute a backedge-taken count and
   // update the value. The temporary CouldNotCompute value tells SCEV
@@ -4607,8 +4633,12 @@ ScalarEvolution::getBackedgeTakenInfo(const Loop *L) {
   // backedge-taken count, which could result in infinite recursion.
   std::pair<DenseMap<const Loop *, BackedgeTakenInfo>::iterator, bool> Pair =
     BackedgeTakenCounts.insert(std::make_pair(L, BackedgeTakenInfo()));
-  if (!Pair.second)
+  if (!Pair.second) {
+    ++Stats.BackedgeTakenHits;
+    ++NumBackedgeTakenHits;
     return Pair.first->second;
+  }
+  ++Stats.BackedgeTakenMisses;
 
   // ComputeBackedgeTakenCount may allocate memory for its result. Inserting it
   // into the BackedgeTakenCounts map transfers ownership. Otherwise, the result
@@ -5638,12 +5668,18 @@ const SCEV *ScalarEvolution::ComputeExitCountExhaustively(const Loop *L,
 /// In the case that a relevant loop exit value cannot be computed, the
 /// original value V is returned.
 const SCEV *ScalarEvolution::getSCEVAtScope(const SCEV *V, const Loop *L) {
+  QueryScope Scope(*this);
+
   // Check to see if we've folded this expression at this loop before.
   SmallVector<std::pair<const Loop *, const SCEV *>, 2> &Values = ValuesAtScopes[V];
   for (unsigned u = 0; u < Values.size(); u++) {
-    if (Values[u].first == L)
+    if (Values[u].first == L) {
+      ++Stats.ValuesAtScopeHits;
+      ++NumValuesAtScopeHits;
       return Values[u].second ? Values[u].second : V;
+    }
   }
+  ++Stats.ValuesAtScopeMisses;
   Values.push_back(std::make_pair(L, static_cast<const SCEV *>(nullptr)));
   // Otherwise compute it.
   const SCEV *C = computeSCEVAtScope(V, L);
@@ -8057,7 +8093,8 @@ ScalarEvolution::SCEVCallbackVH::SCEVCallbackVH(Value *V, ScalarEvolution *se)
 
 ScalarEvolution::ScalarEvolution()
     : FunctionPass(ID), WalkingBEDominatingConds(false), ValuesAtScopes(64),
-      LoopDispositions(64), BlockDispositions(64), FirstUnknown(nullptr) {
+      LoopDispositions(64), BlockDispositions(64), Stats(), QueryDepth(0),
+      FirstUnknown(nullptr) {
   initializeScalarEvolutionPass(*PassRegistry::getPassRegistry());
 }
 
@@ -8070,7 +8107,81 @@ bool ScalarEvolution::runOnFunction(Function &F) {
   return false;
 }
 
+size_t ScalarEvolution::getCacheMemoryUsage() const {
+  return ValueExprMap.getMemorySize() + BackedgeTakenCounts.getMemorySize() +
+         ConstantEvolutionLoopExitValue.getMemorySize() +
+         ValuesAtScopes.getMemorySize() + LoopDispositions.getMemorySize() +
+         BlockDispositions.getMemorySize() + UnsignedRanges.getMemorySize() +
+         SignedRanges.getMemorySize();
+}
+
+void ScalarEvolution::enforceCacheBudget() {
+  assert(QueryDepth <= 1 && "Trimming the caches in the middle of a query!");
+  if (!CacheBudget)
+    return;
+  size_t Budget = size_t(CacheBudget) * 1024;
+  if (getCacheMemoryUsage() <= Budget)
+    return;
+  ++NumCacheEvictions;
+
+  // Everything here is keyed by SCEV and is recomputed from the expression
+  // on demand, so drop it before the more expensive caches below.
+  ++Stats.DerivedEvictions;
+  ConstantEvolutionLoopExitValue.clear();
+  ValuesAtScopes.clear();
+  LoopDispositions.clear();
+  BlockDispositions.clear();
+  UnsignedRanges.clear();
+  SignedRanges.clear();
+  if (getCacheMemoryUsage() <= Budget)
+    return;
+
+  // Outside of a query the value map and the backedge-taken counts hold no
+  // placeholders, so they can be rebuilt from the IR. The SCEV nodes
+  // themselves stay in UniqueSCEVs; clients may still hold pointers to them.
+  ++Stats.ValueExprEvictions;
+  for (auto &BTC : BackedgeTakenCounts)
+    BTC.second.clear();
+  BackedgeTakenCounts.clear();
+  ValueExprMap.clear();
+}
+
+static void printHitRate(raw_ostream &OS, const char *Name, size_t Size,
+                         unsigned Hits, unsigned Misses) {
+  OS << "  " << Name << ": " << Size << " entries, " << Hits << " hits, "
+     << Misses << " misses";
+  if (Hits + Misses)
+    OS << format(" (%.1f%% hit rate)", 100.0 * Hits / (Hits + Misses));
+  OS << "\n";
+}
+
+void ScalarEvolution::printCacheStats(raw_ostream &OS) const {
+  OS << "ScalarEvolution cache statistics for function '" << F->getName()
+     << "':\n";
+  printHitRate(OS, "ValueExprMap", ValueExprMap.size(), Stats.ValueExprHits,
+               Stats.ValueExprMisses);
+  printHitRate(OS, "BackedgeTakenCounts", BackedgeTakenCounts.size(),
+               Stats.BackedgeTakenHits, Stats.BackedgeTakenMisses);
+  printHitRate(OS, "ValuesAtScopes", ValuesAtScopes.size(),
+               Stats.ValuesAtScopeHits, Stats.ValuesAtScopeMisses);
+  OS << "  LoopDispositions: " << LoopDispositions.size() << " entries\n"
+     << "  BlockDispositions: " << BlockDispositions.size() << " entries\n"
+     << "  Ranges: " << UnsignedRanges.size() + SignedRanges.size()
+     << " entries\n"
+     << "  Cache memory: " << getCacheMemoryUsage() << " bytes";
+  if (CacheBudget)
+    OS << " (budget " << size_t(CacheBudget) * 1024 << " bytes, "
+       << Stats.DerivedEvictions << " expression cache flushes, "
+       << Stats.ValueExprEvictions << " value map flushes)";
+  OS << "\n"
+     << "  SCEV nodes: " << SCEVAllocator.getTotalMemory() << " bytes\n";
+}
+
 void ScalarEvolution::releaseMemory() {
+  if (PrintCacheStats && Stats.ValueExprHits + Stats.ValueExprMisses)
+    printCacheStats(errs());
+  Stats = CacheStats();
+
   // Iterate through all the SCEVUnknown instances and call their
   // destructors, so that they release their references to their values.
   for (SCEVUnknown *U = FirstUnknown; U; U = U->Next)
@@ -2793,6 +2793,17 @@ static bool isSameUnderlyingObjectInLoop(PHINode *PN, LoopInfo *LI) {
   return true;
 }
 
+/// getReturnedArgOperand - If the call always returns one of its pointer
+/// arguments, return that argument.
+static Value *getReturnedArgOperand(CallSite CS) {
+  for (unsigned i = 0, e = CS.arg_size(); i != e; ++i)
+    if (CS.paramHasAttr(i + 1, Attribute::Returned)) {
+      Value *Arg = CS.getArgument(i);
+      return Arg->getType()->isPointerTy() ? Arg : nullptr;
+    }
+  return nullptr;
+}
+
 Value *llvm::GetUnderlyingObject(Value *V, const DataLayout &DL,
                                  unsigned MaxLookup) {
   if (!V->getType()->isPointerTy())
@@ -2809,12 +2820,19 @@ Value *llvm::GetUnderlyingObject(Value *V, const DataLayout &DL,
       V = GA->getAliasee();
     } else {
       // See if InstructionSimplify knows any relevant tricks.
-      if (Instruction *I = dyn_cast<Instruction>(V))
+      if (Instruction *I = dyn_cast<Instruction>(V)) {
         // TODO: Acquire a DominatorTree and AssumptionCache and use them.
         if (Value *Simplified = SimplifyInstruction(I, DL, nullptr)) {
           V = Simplified;
           continue;
         }
+        // A call which returns its argument points into the same object.
+        if (CallSite CS = CallSite(I))
+          if (Value *Arg = getReturnedArgOperand(CS)) {
+            V = Arg;
+            continue;
+          }
+      }
 
       return V;
     }
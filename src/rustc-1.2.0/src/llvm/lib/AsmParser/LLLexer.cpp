@@ -614,6 +614,7 @@ lltok::Kind LLLexer::LexIdentifier() {
   KEYWORD(noinline);
   KEYWORD(nonlazybind);
   KEYWORD(nonnull);
+  KEYWORD(norecurse);
   KEYWORD(noredzone);
   KEYWORD(noreturn);
   KEYWORD(nounwind);
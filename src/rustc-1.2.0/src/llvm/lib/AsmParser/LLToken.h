@@ -122,6 +122,7 @@ namespace lltok {
     kw_noinline,
     kw_nonlazybind,
     kw_nonnull,
+    kw_norecurse,
     kw_noredzone,
     kw_noreturn,
     kw_nounwind,
@@ -36,6 +36,8 @@
 #include "llvm/CodeGen/RegAllocRegistry.h"
 #include "llvm/CodeGen/RegisterClassInfo.h"
 #include "llvm/CodeGen/VirtRegMap.h"
+#include "llvm/IR/DiagnosticInfo.h"
+#include "llvm/IR/Function.h"
 #include "llvm/IR/LLVMContext.h"
 #include "llvm/PassAnalysisSupport.h"
 #include "llvm/Support/BranchProbability.h"
@@ -54,6 +56,10 @@ using namespace llvm;
 STATISTIC(NumGlobalSplits, "Number of split global live ranges");
 STATISTIC(NumLocalSplits,  "Number of split local live ranges");
 STATISTIC(NumEvicted,      "Number of interferences evicted");
+STATISTIC(NumOverSplitBudget,
+          "Number of functions which exhausted their split budget");
+STATISTIC(NumBudgetSpills,
+          "Number of live ranges spilled unsplit because of the split budget");
 
 static cl::opt<SplitEditor::ComplementSpillMode>
 SplitSpillMode("split-spill-mode", cl::Hidden,
@@ -86,6 +92,14 @@ static cl::opt<bool> EnableLocalReassignment(
              "may be compile time intensive"),
     cl::init(false));
 
+static cl::opt<unsigned>
+SplitBudget("regalloc-split-budget", cl::Hidden,
+            cl::desc("Number of blocks that live range splitting may analyze "
+                     "in one function before the greedy allocator gives up "
+                     "region splitting, and at twice that, all splitting "
+                     "(0 = no limit)"),
+            cl::init(0));
+
 // FIXME: Find a good default for this flag and remove the flag.
 static cl::opt<unsigned>
 CSRFirstTimeCost("regalloc-csr-first-time-cost",
@@ -178,6 +192,26 @@ class RAGreedy : public MachineFunctionPass,
 
   uint8_t CutOffInfo;
 
+  // Splitting can be superlinear in the size of huge functions, so the work it
+  // does is budgeted, and the allocator gets cheaper as the budget runs out.
+  enum BudgetStage {
+    // Within budget.
+    BS_Normal,
+
+    // Over budget: no region splitting, and live ranges with no uses in blocks
+    // hotter than the entry block are spilled instead of split.
+    BS_NoRegionSplit,
+
+    // Over twice the budget: no splitting at all. Ranges which can be neither
+    // assigned nor evict their interference are spilled, like RABasic does.
+    BS_NoSplit
+  };
+
+  BudgetStage Budget;
+
+  // Blocks analyzed for global live range splitting in this function.
+  uint64_t SplitWork;
+
 #ifndef NDEBUG
   static const char *const StageName[];
 #endif
@@ -348,6 +382,8 @@ private:
                                   SmallLISet &RecoloringCandidates,
                                   const SmallVirtRegSet &FixedRegisters);
 
+  void chargeSplitWork(unsigned);
+  bool hasOnlyColdUses() const;
   unsigned tryAssign(LiveInterval&, AllocationOrder&,
                      SmallVectorImpl<unsigned>&);
   unsigned tryEvict(LiveInterval&, AllocationOrder&,
@@ -1905,6 +1941,40 @@ unsigned RAGreedy::tryLocalSplit(LiveInterval &VirtReg, AllocationOrder &Order,
 //                          Live Range Splitting
 //===----------------------------------------------------------------------===//
 
+/// chargeSplitWork - Account for Work blocks analyzed for splitting, and step
+/// down to a cheaper allocation strategy when the split budget runs out.
+void RAGreedy::chargeSplitWork(unsigned Work) {
+  SplitWork += Work;
+  if (!SplitBudget || Budget == BS_NoSplit ||
+      SplitWork <= uint64_t(SplitBudget) * (Budget + 1))
+    return;
+
+  const char *Msg;
+  if (Budget == BS_Normal) {
+    ++NumOverSplitBudget;
+    Budget = BS_NoRegionSplit;
+    Msg = "split budget exhausted, region splitting disabled";
+  } else {
+    Budget = BS_NoSplit;
+    Msg = "split budget exhausted twice over, live range splitting disabled";
+  }
+  DEBUG(dbgs() << Msg << " after " << SplitWork << " blocks\n");
+  const Function &F = *MF->getFunction();
+  emitOptimizationRemarkAnalysis(F.getContext(), DEBUG_TYPE, F, DebugLoc(),
+                                 Twine(Msg) + " after analyzing " +
+                                     Twine(SplitWork) + " blocks");
+}
+
+/// hasOnlyColdUses - Return true if the live range analyzed by SA has no uses
+/// in blocks hotter than the entry block, so that spilling it costs little.
+bool RAGreedy::hasOnlyColdUses() const {
+  BlockFrequency EntryFreq = MBFI->getBlockFreq(&MF->front());
+  for (const SplitAnalysis::BlockInfo &BI : SA->getUseBlocks())
+    if (MBFI->getBlockFreq(BI.MBB) > EntryFreq)
+      return false;
+  return true;
+}
+
 /// trySplit - Try to split VirtReg or one of its interferences, making it
 /// assignable.
 /// @return Physreg when VirtReg may be assigned and/or new NewVRegs.
@@ -1914,6 +1984,12 @@ unsigned RAGreedy::trySplit(LiveInterval &VirtReg, AllocationOrder &Order,
   if (getStage(VirtReg) >= RS_Spill)
     return 0;
 
+  // Far over the split budget, leave the range to be spilled.
+  if (Budget == BS_NoSplit) {
+    ++NumBudgetSpills;
+    return 0;
+  }
+
   // Local intervals are handled separately.
   if (LIS->intervalIsInOneMBB(VirtReg)) {
     NamedRegionTimer T("Local Splitting", TimerGroupName, TimePassesIsEnabled);
@@ -1939,10 +2015,16 @@ unsigned RAGreedy::trySplit(LiveInterval &VirtReg, AllocationOrder &Order,
       return PhysReg;
   }
 
+  chargeSplitWork(SA->getUseBlocks().size() + SA->getNumThroughBlocks());
+  if (Budget != BS_Normal && hasOnlyColdUses()) {
+    ++NumBudgetSpills;
+    return 0;
+  }
+
   // First try to split around a region spanning multiple blocks. RS_Split2
   // ranges already made dubious progress with region splitting, so they go
   // straight to single block splitting.
-  if (getStage(VirtReg) < RS_Split2) {
+  if (getStage(VirtReg) < RS_Split2 && Budget == BS_Normal) {
     unsigned PhysReg = tryRegionSplit(VirtReg, Order, NewVRegs);
     if (PhysReg || !NewVRegs.empty())
       return PhysReg;
@@ -2561,6 +2643,8 @@ bool RAGreedy::runOnMachineFunction(MachineFunction &mf) {
   IntfCache.init(MF, Matrix->getLiveUnions(), Indexes, LIS, TRI);
   GlobalCand.resize(32);  // This will grow as needed.
   SetOfBrokenHints.clear();
+  Budget = BS_Normal;
+  SplitWork = 0;
 
   allocatePhysRegs();
   tryHintsRecoloring();
@@ -31,13 +31,19 @@
 #include "llvm/Support/CommandLine.h"
 #include "llvm/Support/Debug.h"
 #include "llvm/Support/ErrorHandling.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/Format.h"
+#include "llvm/Support/ManagedStatic.h"
 #include "llvm/Support/MathExtras.h"
+#include "llvm/Support/Mutex.h"
+#include "llvm/Support/Timer.h"
 #include "llvm/Support/raw_ostream.h"
 #include "llvm/Target/TargetLowering.h"
 #include "llvm/Target/TargetOptions.h"
 #include "llvm/Target/TargetRegisterInfo.h"
 #include "llvm/Target/TargetSubtargetInfo.h"
 #include <algorithm>
+#include <map>
 using namespace llvm;
 
 #define DEBUG_TYPE "dagcombine"
@@ -48,6 +54,10 @@ STATISTIC(PostIndexedNodes, "Number of post-indexed nodes created");
 STATISTIC(OpsNarrowed     , "Number of load/op/store narrowed");
 STATISTIC(LdStFP2Int      , "Number of fp load/store pairs transformed to int");
 STATISTIC(SlicedLoads, "Number of load sliced");
+STATISTIC(NodesVisited    , "Number of dag nodes visited by the combiner");
+STATISTIC(NodesRevisited  , "Number of repeat visits to a dag node in one run");
+STATISTIC(NodesOverVisitLimit,
+          "Number of dag node visits skipped for exceeding the visit limit");
 
 namespace {
   static cl::opt<bool>
@@ -81,6 +91,56 @@ namespace {
     MaySplitLoadIndex("combiner-split-load-index", cl::Hidden, cl::init(true),
                       cl::desc("DAG combiner may split indexing from loads"));
 
+  /// Combines which undo each other put the same nodes back on the worklist
+  /// forever, or for a very long time; this bounds how often one node is
+  /// combined in a single run of the combiner.
+  static cl::opt<unsigned>
+    MaxVisitsPerNode("combiner-max-visits-per-node", cl::Hidden, cl::init(0),
+               cl::desc("Stop combining a node after this many visits in one "
+                        "run of the DAG combiner (0 = no limit)"));
+
+  static cl::opt<std::string>
+    CombinerStatsFile("combiner-stats-json", cl::Hidden,
+               cl::value_desc("filename"),
+               cl::desc("Write the number of visits, successful combines and "
+                        "time of the DAG combiner per opcode to this file as "
+                        "JSON"));
+
+//--------------------------- Combine statistics -----------------------------//
+
+  /// What the combiner did with the nodes of one opcode.
+  struct OpcodeCombineStats {
+    std::string Name;
+    uint64_t Visits;
+    uint64_t Combines;
+    unsigned MaxVisitsOfNode;
+    double Seconds;
+
+    OpcodeCombineStats()
+        : Visits(0), Combines(0), MaxVisitsOfNode(0), Seconds(0) {}
+
+    void merge(const OpcodeCombineStats &Other) {
+      Visits += Other.Visits;
+      Combines += Other.Combines;
+      MaxVisitsOfNode = std::max(MaxVisitsOfNode, Other.MaxVisitsOfNode);
+      Seconds += Other.Seconds;
+    }
+  };
+
+  typedef std::map<unsigned, OpcodeCombineStats> CombineStatsMap;
+
+  /// The combine statistics of all runs of the combiner, which print
+  /// themselves under -stats, and to -combiner-stats-json, at exit.
+  struct CombineStatsTable {
+    sys::SmartMutex<true> Lock;
+    CombineStatsMap Stats;
+
+    ~CombineStatsTable();
+    void merge(const CombineStatsMap &RunStats);
+    void print(raw_ostream &OS) const;
+    void printJSON(raw_ostream &OS) const;
+  };
+
 //------------------------------ DAGCombiner ---------------------------------//
 
   class DAGCombiner {
@@ -114,6 +174,16 @@ namespace {
     /// which have not yet been combined to the worklist.
     SmallPtrSet<SDNode *, 64> CombinedNodes;
 
+    /// \brief The number of times each node has been visited in this run.
+    ///
+    /// Only kept under -combiner-max-visits-per-node and when collecting
+    /// statistics.
+    DenseMap<SDNode *, unsigned> VisitCounts;
+
+    /// \brief Per-opcode statistics of this run, or null when they are not
+    /// being collected.
+    std::unique_ptr<CombineStatsMap> RunStats;
+
     // AA - Used for DAG load/store alias analysis.
     AliasAnalysis &AA;
 
@@ -143,6 +213,7 @@ namespace {
     /// Remove all instances of N from the worklist.
     void removeFromWorklist(SDNode *N) {
       CombinedNodes.erase(N);
+      VisitCounts.erase(N);
 
       auto It = WorklistMap.find(N);
       if (It == WorklistMap.end())
@@ -217,6 +288,17 @@ namespace {
     /// target-specific DAG combines.
     SDValue combine(SDNode *N);
 
+    /// Call combine, counting the visit to N, its Visits'th in this run, and
+    /// the time taken in RunStats.
+    ///
+    /// The statistics are kept per opcode, not per combine rule: a visit is
+    /// attributed to the opcode N has when it is visited, whichever visitXXX
+    /// routine or target hook ends up folding it.  Visit counts are kept per
+    /// node, so a node which was morphed in place into another opcode carries
+    /// its earlier visits along; MaxVisitsOfNode is recorded under the opcode
+    /// of the visit, and includes the visits under the old opcode.
+    SDValue combineAndRecord(SDNode *N, unsigned Visits);
+
     // Visitation implementation - Implement dag node combining for different
     // node types.  The semantics are as follows:
     // Return Value:
@@ -1204,6 +1286,100 @@ bool DAGCombiner::recursivelyDeleteUnusedNodes(SDNode *N) {
   return true;
 }
 
+//===----------------------------------------------------------------------===//
+//  Combine statistics
+//===----------------------------------------------------------------------===//
+
+namespace llvm { extern raw_ostream *CreateInfoOutputFile(); }
+
+static ManagedStatic<CombineStatsTable> CombineStats;
+
+CombineStatsTable::~CombineStatsTable() {
+  if (Stats.empty())
+    return;
+
+  if (AreStatisticsEnabled()) {
+    raw_ostream &OS = *CreateInfoOutputFile();
+    print(OS);
+    delete &OS;
+  }
+
+  if (!CombinerStatsFile.empty()) {
+    std::error_code EC;
+    raw_fd_ostream OS(CombinerStatsFile, EC, sys::fs::F_Text);
+    if (EC)
+      errs() << "warning: could not open '" << CombinerStatsFile
+             << "' for writing: " << EC.message() << '\n';
+    else
+      printJSON(OS);
+  }
+}
+
+void CombineStatsTable::merge(const CombineStatsMap &RunStats) {
+  sys::SmartScopedLock<true> Guard(Lock);
+  for (const auto &I : RunStats) {
+    OpcodeCombineStats &S = Stats[I.first];
+    if (S.Name.empty())
+      S.Name = I.second.Name;
+    S.merge(I.second);
+  }
+}
+
+void CombineStatsTable::print(raw_ostream &OS) const {
+  size_t MaxNameLen = 6;
+  for (const auto &I : Stats)
+    MaxNameLen = std::max(MaxNameLen, I.second.Name.size());
+
+  OS << "===" << std::string(73, '-') << "===\n"
+     << "                       ... DAG Combines By Opcode ...\n"
+     << "===" << std::string(73, '-') << "===\n\n";
+  static const char *const Columns[] = { "Opcode", "Visits", "Combines",
+                                         "Max/Node", "Seconds" };
+  OS << format("%-*s %10s %10s %10s %10s\n", (int)MaxNameLen, Columns[0],
+               Columns[1], Columns[2], Columns[3], Columns[4]);
+  for (const auto &I : Stats) {
+    const OpcodeCombineStats &S = I.second;
+    OS << format("%-*s %10llu %10llu %10u %10.4f\n", (int)MaxNameLen,
+                 S.Name.c_str(), (unsigned long long)S.Visits,
+                 (unsigned long long)S.Combines, S.MaxVisitsOfNode, S.Seconds);
+  }
+  OS << '\n';
+  OS.flush();
+}
+
+void CombineStatsTable::printJSON(raw_ostream &OS) const {
+  OS << "{\n  \"combines\": [";
+  bool First = true;
+  for (const auto &I : Stats) {
+    const OpcodeCombineStats &S = I.second;
+    OS << (First ? "\n" : ",\n") << "    { \"opcode\": \"";
+    OS.write_escaped(S.Name);
+    OS << "\", \"visits\": " << S.Visits << ", \"combines\": " << S.Combines
+       << ", \"max_visits_per_node\": " << S.MaxVisitsOfNode
+       << ", \"seconds\": " << format("%.6f", S.Seconds) << " }";
+    First = false;
+  }
+  OS << "\n  ]\n}\n";
+}
+
+SDValue DAGCombiner::combineAndRecord(SDNode *N, unsigned Visits) {
+  // N may be deleted by the combine, so look at it first.
+  OpcodeCombineStats &S = (*RunStats)[N->getOpcode()];
+  if (S.Name.empty())
+    S.Name = N->getOperationName(&DAG);
+  ++S.Visits;
+  S.MaxVisitsOfNode = std::max(S.MaxVisitsOfNode, Visits);
+
+  TimeRecord Start = TimeRecord::getCurrentTime(true);
+  SDValue RV = combine(N);
+  TimeRecord End = TimeRecord::getCurrentTime(false);
+  S.Seconds += End.getWallTime() - Start.getWallTime();
+
+  if (RV.getNode())
+    ++S.Combines;
+  return RV;
+}
+
 //===----------------------------------------------------------------------===//
 //  Main DAG Combiner implementation
 //===----------------------------------------------------------------------===//
@@ -1214,6 +1390,10 @@ void DAGCombiner::Run(CombineLevel AtLevel) {
   LegalOperations = Level >= AfterLegalizeVectorOps;
   LegalTypes = Level >= AfterLegalizeTypes;
 
+  if (AreStatisticsEnabled() || !CombinerStatsFile.empty())
+    RunStats.reset(new CombineStatsMap());
+  bool TrackVisits = MaxVisitsPerNode || RunStats;
+
   // Add all the dag nodes to the worklist.
   for (SelectionDAG::allnodes_iterator I = DAG.allnodes_begin(),
        E = DAG.allnodes_end(); I != E; ++I)
@@ -1260,6 +1440,22 @@ void DAGCombiner::Run(CombineLevel AtLevel) {
         continue;
     }
 
+    // Count the visit, and stop combining nodes which keep coming back, most
+    // likely because two combines undo each other.
+    ++NodesVisited;
+    unsigned Visits = 0;
+    if (TrackVisits) {
+      Visits = ++VisitCounts[N];
+      if (Visits > 1)
+        ++NodesRevisited;
+      if (MaxVisitsPerNode && Visits > MaxVisitsPerNode) {
+        ++NodesOverVisitLimit;
+        DEBUG(dbgs() << "\nNot combining, visit limit reached: ";
+              N->dump(&DAG));
+        continue;
+      }
+    }
+
     DEBUG(dbgs() << "\nCombining: "; N->dump(&DAG));
 
     // Add any operands of the new node which have not yet been combined to the
@@ -1270,7 +1466,7 @@ void DAGCombiner::Run(CombineLevel AtLevel) {
       if (!CombinedNodes.count(N->getOperand(i).getNode()))
         AddToWorklist(N->getOperand(i).getNode());
 
-    SDValue RV = combine(N);
+    SDValue RV = RunStats ? combineAndRecord(N, Visits) : combine(N);
 
     if (!RV.getNode())
       continue;
@@ -1316,6 +1512,9 @@ void DAGCombiner::Run(CombineLevel AtLevel) {
   // If the root changed (e.g. it was a dead load, update the root).
   DAG.setRoot(Dummy.getValue());
   DAG.RemoveDeadNodes();
+
+  if (RunStats)
+    CombineStats->merge(*RunStats);
 }
 
 SDValue DAGCombiner::visit(SDNode *N) {
@@ -43,6 +43,7 @@
 #include "llvm/ADT/Optional.h"
 #include "llvm/ADT/Statistic.h"
 #include "llvm/Analysis/BranchProbabilityInfo.h"
+#include "llvm/Analysis/LibCallSemantics.h"
 #include "llvm/Analysis/Loads.h"
 #include "llvm/Analysis/TargetLibraryInfo.h"
 #include "llvm/CodeGen/Analysis.h"
@@ -60,6 +61,8 @@
 #include "llvm/IR/Instructions.h"
 #include "llvm/IR/IntrinsicInst.h"
 #include "llvm/IR/Operator.h"
+#include "llvm/MC/MCAsmInfo.h"
+#include "llvm/MC/MCContext.h"
 #include "llvm/Support/Debug.h"
 #include "llvm/Support/ErrorHandling.h"
 #include "llvm/Support/raw_ostream.h"
@@ -156,11 +159,13 @@ bool FastISel::hasTrivialKill(const Value *V) {
       return false;
 
   // Only instructions with a single use in the same basic block are considered
-  // to have trivial kills.
+  // to have trivial kills. An extractvalue shares its register with the
+  // aggregate, which may still be read, e.g. by an insertvalue.
   return I->hasOneUse() &&
          !(I->getOpcode() == Instruction::BitCast ||
            I->getOpcode() == Instruction::PtrToInt ||
-           I->getOpcode() == Instruction::IntToPtr) &&
+           I->getOpcode() == Instruction::IntToPtr ||
+           I->getOpcode() == Instruction::ExtractValue) &&
          cast<Instruction>(*I->user_begin())->getParent() == I->getParent();
 }
 
@@ -342,9 +347,13 @@ void FastISel::recomputeInsertPt() {
   } else
     FuncInfo.InsertPt = FuncInfo.MBB->getFirstNonPHI();
 
-  // Now skip past any EH_LABELs, which must remain at the beginning.
-  while (FuncInfo.InsertPt != FuncInfo.MBB->end() &&
-         FuncInfo.InsertPt->getOpcode() == TargetOpcode::EH_LABEL)
+  // Now skip past the EH_LABEL starting a landing pad, which must remain at the
+  // beginning. Any other labels at the top of the block were emitted for an
+  // invoke, and moving past them would widen the range of its call.
+  if (FuncInfo.MBB->isLandingPad() &&
+      FuncInfo.InsertPt == FuncInfo.MBB->getFirstNonPHI() &&
+      FuncInfo.InsertPt != FuncInfo.MBB->end() &&
+      FuncInfo.InsertPt->getOpcode() == TargetOpcode::EH_LABEL)
     ++FuncInfo.InsertPt;
 }
 
@@ -986,8 +995,10 @@ bool FastISel::lowerCallTo(CallLoweringInfo &CLI) {
 }
 
 bool FastISel::lowerCall(const CallInst *CI) {
-  ImmutableCallSite CS(CI);
+  return lowerCallSite(ImmutableCallSite(CI));
+}
 
+bool FastISel::lowerCallSite(ImmutableCallSite CS) {
   PointerType *PT = cast<PointerType>(CS.getCalledValue()->getType());
   FunctionType *FuncTy = cast<FunctionType>(PT->getElementType());
   Type *RetTy = FuncTy->getReturnType();
@@ -1014,12 +1025,12 @@ bool FastISel::lowerCall(const CallInst *CI) {
 
   // Check if target-independent constraints permit a tail call here.
   // Target-dependent constraints are checked within fastLowerCall.
-  bool IsTailCall = CI->isTailCall();
+  bool IsTailCall = CS.isTailCall();
   if (IsTailCall && !isInTailCallPosition(CS, TM))
     IsTailCall = false;
 
   CallLoweringInfo CLI;
-  CLI.setCallee(RetTy, FuncTy, CI->getCalledValue(), std::move(Args), CS)
+  CLI.setCallee(RetTy, FuncTy, CS.getCalledValue(), std::move(Args), CS)
       .setTailCall(IsTailCall);
 
   return lowerCallTo(CLI);
@@ -1080,6 +1091,8 @@ bool FastISel::selectIntrinsicCall(const IntrinsicInst *II) {
   case Intrinsic::lifetime_end:
   // The donothing intrinsic does, well, nothing.
   case Intrinsic::donothing:
+  // Assumptions are only of use to the optimizers.
+  case Intrinsic::assume:
     return true;
   case Intrinsic::eh_actions: {
     unsigned ResultReg = getRegForValue(UndefValue::get(II->getType()));
@@ -1470,6 +1483,166 @@ bool FastISel::selectExtractValue(const User *U) {
   return true;
 }
 
+bool FastISel::selectInsertValue(const User *U) {
+  const InsertValueInst *IVI = dyn_cast<InsertValueInst>(U);
+  if (!IVI)
+    return false;
+
+  // Only handle aggregates made of legal values, each of which lives in a
+  // single register, so that the value number of each piece is also its
+  // register offset.
+  Type *AggTy = IVI->getType();
+  SmallVector<EVT, 4> AggValueVTs;
+  ComputeValueVTs(TLI, AggTy, AggValueVTs);
+  for (EVT VT : AggValueVTs)
+    if (!TLI.isTypeLegal(VT) ||
+        TLI.getNumRegisters(FuncInfo.Fn->getContext(), VT) != 1)
+      return false;
+
+  // Get the base registers of the aggregate and of the inserted value. Undef
+  // operands have no registers; their pieces are left undefined.
+  auto GetBaseReg = [&](const Value *V, unsigned &Reg) {
+    Reg = 0;
+    if (isa<UndefValue>(V))
+      return true;
+    if (!V->getType()->isAggregateType()) {
+      Reg = getRegForValue(V);
+      return Reg != 0;
+    }
+    DenseMap<const Value *, unsigned>::iterator I = FuncInfo.ValueMap.find(V);
+    if (I != FuncInfo.ValueMap.end())
+      Reg = I->second;
+    else if (isa<Instruction>(V))
+      Reg = FuncInfo.InitializeRegForValue(V);
+    // fast-isel can't handle aggregate constants at the moment.
+    return Reg != 0;
+  };
+  const Value *Agg = IVI->getAggregateOperand();
+  const Value *Val = IVI->getInsertedValueOperand();
+  unsigned AggReg, ValReg;
+  if (!GetBaseReg(Agg, AggReg) || !GetBaseReg(Val, ValReg))
+    return false;
+
+  unsigned ValIndex = ComputeLinearIndex(AggTy, IVI->getIndices());
+  SmallVector<EVT, 4> ValValueVTs;
+  ComputeValueVTs(TLI, Val->getType(), ValValueVTs);
+  unsigned ValEnd = ValIndex + ValValueVTs.size();
+
+  // Copy every piece into a fresh set of registers, taking the pieces in
+  // [ValIndex, ValEnd) from the inserted value and the rest from the aggregate.
+  unsigned ResultReg = FuncInfo.CreateRegs(AggTy);
+  for (unsigned i = 0, e = AggValueVTs.size(); i != e; ++i) {
+    unsigned SrcReg;
+    if (i >= ValIndex && i < ValEnd)
+      SrcReg = ValReg ? ValReg + (i - ValIndex) : 0;
+    else
+      SrcReg = AggReg ? AggReg + i : 0;
+    if (SrcReg)
+      BuildMI(*FuncInfo.MBB, FuncInfo.InsertPt, DbgLoc,
+              TII.get(TargetOpcode::COPY), ResultReg + i).addReg(SrcReg);
+    else
+      BuildMI(*FuncInfo.MBB, FuncInfo.InsertPt, DbgLoc,
+              TII.get(TargetOpcode::IMPLICIT_DEF), ResultReg + i);
+  }
+
+  updateValueMap(IVI, ResultReg, AggValueVTs.size());
+  return true;
+}
+
+bool FastISel::selectInvoke(const User *I) {
+  const InvokeInst *II = cast<InvokeInst>(I);
+  ImmutableCallSite CS(II);
+
+  // Only handle invokes of ordinary functions; inline asm and the intrinsics
+  // which may be invoked need the full SelectionDAG lowering.
+  const Value *Callee = CS.getCalledValue();
+  if (isa<InlineAsm>(Callee))
+    return false;
+  if (const Function *F = dyn_cast<Function>(Callee))
+    if (F->isIntrinsic())
+      return false;
+
+  // SjLj exception handling numbers call sites as it goes and MSVC-style
+  // personalities need their landing pads split; leave both to SelectionDAG.
+  if (TM.getMCAsmInfo()->getExceptionHandlingType() == ExceptionHandling::SjLj)
+    return false;
+  const LandingPadInst *LP = II->getLandingPadInst();
+  if (isMSVCEHPersonality(classifyEHPersonality(LP->getPersonalityFn())))
+    return false;
+
+  MachineBasicBlock *Return = FuncInfo.MBBMap[II->getNormalDest()];
+  MachineBasicBlock *LandingPad = FuncInfo.MBBMap[II->getUnwindDest()];
+
+  // As for calls, don't keep materialized values alive across the call.
+  flushLocalValueMap();
+
+  // Insert labels around the call to mark the try range.
+  MachineModuleInfo &MMI = FuncInfo.MF->getMMI();
+  const MCInstrDesc &EHLabel = TII.get(TargetOpcode::EH_LABEL);
+  MCSymbol *BeginLabel = MMI.getContext().createTempSymbol();
+  BuildMI(*FuncInfo.MBB, FuncInfo.InsertPt, DbgLoc, EHLabel).addSym(BeginLabel);
+
+  if (!lowerCallSite(CS))
+    return false;
+
+  MCSymbol *EndLabel = MMI.getContext().createTempSymbol();
+  BuildMI(*FuncInfo.MBB, FuncInfo.InsertPt, DbgLoc, EHLabel).addSym(EndLabel);
+  MMI.addInvoke(LandingPad, BeginLabel, EndLabel);
+
+  // Drop into the normal successor, and record the edge to the landing pad.
+  fastEmitBranch(Return, DbgLoc);
+  uint32_t BranchWeight = 0;
+  if (FuncInfo.BPI)
+    BranchWeight = FuncInfo.BPI->getEdgeWeight(II->getParent(),
+                                               II->getUnwindDest());
+  FuncInfo.MBB->addSuccessor(LandingPad, BranchWeight);
+  return true;
+}
+
+bool FastISel::selectLandingPad(const User *I) {
+  const LandingPadInst *LP = cast<LandingPadInst>(I);
+  assert(FuncInfo.MBB->isLandingPad() &&
+         "Call to landingpad not in landing pad!");
+  if (isMSVCEHPersonality(classifyEHPersonality(LP->getPersonalityFn())))
+    return false;
+
+  // The values are only available if the exception registers were set up as
+  // live-ins of the landing pad.
+  if (!FuncInfo.ExceptionPointerVirtReg || !FuncInfo.ExceptionSelectorVirtReg)
+    return false;
+
+  SmallVector<EVT, 2> ValueVTs;
+  ComputeValueVTs(TLI, LP->getType(), ValueVTs);
+  assert(ValueVTs.size() == 2 && "Only two-valued landingpads are supported");
+
+  // The exception registers hold pointer-sized values; narrow them to the
+  // types of the landingpad results if needed.
+  MVT PtrVT = TLI.getPointerTy();
+  unsigned Regs[2] = {FuncInfo.ExceptionPointerVirtReg,
+                      FuncInfo.ExceptionSelectorVirtReg};
+  for (unsigned i = 0; i != 2; ++i) {
+    if (!ValueVTs[i].isSimple() || !TLI.isTypeLegal(ValueVTs[i]))
+      return false;
+    MVT VT = ValueVTs[i].getSimpleVT();
+    if (VT == PtrVT)
+      continue;
+    if (VT.bitsGT(PtrVT))
+      return false;
+    Regs[i] = fastEmit_r(PtrVT, VT, ISD::TRUNCATE, Regs[i], /*Kill=*/false);
+    if (!Regs[i])
+      return false;
+  }
+
+  AddLandingPadInfo(*LP, FuncInfo.MF->getMMI(), FuncInfo.MBB);
+
+  unsigned ResultReg = FuncInfo.CreateRegs(LP->getType());
+  for (unsigned i = 0; i != 2; ++i)
+    BuildMI(*FuncInfo.MBB, FuncInfo.InsertPt, DbgLoc,
+            TII.get(TargetOpcode::COPY), ResultReg + i).addReg(Regs[i]);
+  updateValueMap(LP, ResultReg, 2);
+  return true;
+}
+
 bool FastISel::selectOperator(const User *I, unsigned Opcode) {
   switch (Opcode) {
   case Instruction::Add:
@@ -1579,6 +1752,15 @@ bool FastISel::selectOperator(const User *I, unsigned Opcode) {
   case Instruction::ExtractValue:
     return selectExtractValue(I);
 
+  case Instruction::InsertValue:
+    return selectInsertValue(I);
+
+  case Instruction::Invoke:
+    return selectInvoke(I);
+
+  case Instruction::LandingPad:
+    return selectLandingPad(I);
+
   case Instruction::PHI:
     llvm_unreachable("FastISel shouldn't visit PHI nodes!");
 
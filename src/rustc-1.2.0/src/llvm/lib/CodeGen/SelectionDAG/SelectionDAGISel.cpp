@@ -16,6 +16,7 @@
 #include "SelectionDAGBuilder.h"
 #include "llvm/ADT/PostOrderIterator.h"
 #include "llvm/ADT/Statistic.h"
+#include "llvm/ADT/StringMap.h"
 #include "llvm/Analysis/AliasAnalysis.h"
 #include "llvm/Analysis/BranchProbabilityInfo.h"
 #include "llvm/Analysis/CFG.h"
@@ -47,6 +48,7 @@
 #include "llvm/Support/Compiler.h"
 #include "llvm/Support/Debug.h"
 #include "llvm/Support/ErrorHandling.h"
+#include "llvm/Support/Format.h"
 #include "llvm/Support/Timer.h"
 #include "llvm/Support/raw_ostream.h"
 #include "llvm/Target/TargetInstrInfo.h"
@@ -65,6 +67,8 @@ using namespace llvm;
 STATISTIC(NumFastIselFailures, "Number of instructions fast isel failed on");
 STATISTIC(NumFastIselSuccess, "Number of instructions fast isel selected");
 STATISTIC(NumFastIselBlocks, "Number of blocks selected entirely by fast isel");
+STATISTIC(NumFastIselTrivialBlocks,
+          "Number of trivial blocks given to fast isel while optimizing");
 STATISTIC(NumDAGBlocks, "Number of blocks selected using DAG");
 STATISTIC(NumDAGIselRetries,"Number of times dag isel has to try another path");
 STATISTIC(NumEntryBlocks, "Number of entry blocks encountered");
@@ -176,6 +180,17 @@ static cl::opt<int> EnableFastISelAbort(
              "abort but for args, calls and terminators, 2 will also "
              "abort for argument lowering, and 3 will never fallback "
              "to SelectionDAG."));
+static cl::opt<bool>
+EnableFastISelReport("fast-isel-report", cl::Hidden,
+          cl::desc("Report, for each function, the instructions on which "
+                   "\"fast\" instruction selection fell back to "
+                   "SelectionDAG, grouped by opcode"));
+static cl::opt<bool>
+EnableFastISelTrivialBlocks("fast-isel-trivial-blocks", cl::Hidden,
+          cl::desc("When optimizing, select blocks that only branch to "
+                   "their successor with \"fast\" instruction selection "
+                   "instead of building a SelectionDAG for each "
+                   "(experimental)"));
 
 static cl::opt<bool>
 UseMBPI("use-mbpi",
@@ -1105,12 +1120,67 @@ static void collectFailStats(const Instruction *I) {
 }
 #endif
 
+/// Describe an instruction which fast isel failed on for -fast-isel-report:
+/// its opcode, and for calls to intrinsics and inline asm, the callee.
+static std::string getFastISelFailReason(const Instruction *I) {
+  std::string Reason = I->getOpcodeName();
+  ImmutableCallSite CS(I);
+  if (!CS)
+    return Reason;
+  if (isa<InlineAsm>(CS.getCalledValue()))
+    Reason += " asm";
+  else if (const Function *F = CS.getCalledFunction())
+    if (F->isIntrinsic())
+      Reason += " " + Intrinsic::getName(F->getIntrinsicID());
+  return Reason;
+}
+
+/// Print the reasons fast isel fell back to SelectionDAG in a function, most
+/// frequent first.
+static void printFastISelReport(const Function &Fn,
+                                const StringMap<unsigned> &FailReasons) {
+  std::vector<std::pair<unsigned, StringRef>> Sorted;
+  for (const auto &Entry : FailReasons)
+    Sorted.push_back(std::make_pair(Entry.getValue(), Entry.getKey()));
+  std::sort(Sorted.begin(), Sorted.end(),
+            [](const std::pair<unsigned, StringRef> &LHS,
+               const std::pair<unsigned, StringRef> &RHS) {
+              if (LHS.first != RHS.first)
+                return LHS.first > RHS.first;
+              return LHS.second < RHS.second;
+            });
+
+  errs() << "FastISel fallbacks in function '" << Fn.getName() << "':\n";
+  for (const auto &Entry : Sorted)
+    errs() << format("%8u", Entry.first) << "  " << Entry.second << "\n";
+}
+
+/// Return true if BB does nothing but branch unconditionally to its
+/// successor, so that the only work in selecting it is copying the values
+/// flowing into the successor's PHIs.  Such blocks, common after unwinding
+/// and match lowering, cost a whole SelectionDAG build to select otherwise.
+static bool isTrivialBranchBlock(const BasicBlock *BB) {
+  if (BB->isLandingPad() || BB == &BB->getParent()->getEntryBlock())
+    return false;
+  const BranchInst *Br = dyn_cast<BranchInst>(BB->getTerminator());
+  if (!Br || Br->isConditional())
+    return false;
+  for (BasicBlock::const_iterator I = BB->getFirstNonPHI(); &*I != Br; ++I)
+    if (!isa<DbgInfoIntrinsic>(I))
+      return false;
+  return true;
+}
+
 void SelectionDAGISel::SelectAllBasicBlocks(const Function &Fn) {
   // Initialize the Fast-ISel state, if needed.
   FastISel *FastIS = nullptr;
-  if (TM.Options.EnableFastISel)
+  if (TM.Options.EnableFastISel ||
+      (EnableFastISelTrivialBlocks && OptLevel != CodeGenOpt::None))
     FastIS = TLI->createFastISel(*FuncInfo, LibInfo);
 
+  // The instructions fast isel fell back on, for -fast-isel-report.
+  StringMap<unsigned> FastISelFailReasons;
+
   // Iterate over all basic blocks in the function.
   ReversePostOrderTraversal<const Function*> RPOT(&Fn);
   for (ReversePostOrderTraversal<const Function*>::rpo_iterator
@@ -1154,8 +1224,18 @@ void SelectionDAGISel::SelectAllBasicBlocks(const Function &Fn) {
       if (!PrepareEHLandingPad())
         continue;
 
-    // Before doing SelectionDAG ISel, see if FastISel has been requested.
+    // Before doing SelectionDAG ISel, see if FastISel has been requested,
+    // either for the whole function or just for this trivial block.
+    bool UseFastISel = false;
     if (FastIS) {
+      UseFastISel = TM.Options.EnableFastISel;
+      if (!UseFastISel && isTrivialBranchBlock(LLVMBB)) {
+        UseFastISel = true;
+        ++NumFastIselTrivialBlocks;
+      }
+    }
+
+    if (UseFastISel) {
       FastIS->startNewBlock();
 
       // Emit code for any incoming arguments. This must happen before
@@ -1167,6 +1247,8 @@ void SelectionDAGISel::SelectAllBasicBlocks(const Function &Fn) {
         if (!FastIS->lowerArguments()) {
           // Fast isel failed to lower these arguments
           ++NumFastIselFailLowerArguments;
+          if (EnableFastISelReport)
+            ++FastISelFailReasons["arguments"];
           if (EnableFastISelAbort > 1)
             report_fatal_error("FastISel didn't lower all arguments");
 
@@ -1229,6 +1311,8 @@ void SelectionDAGISel::SelectAllBasicBlocks(const Function &Fn) {
         if (EnableFastISelVerbose2)
           collectFailStats(Inst);
 #endif
+        if (EnableFastISelReport)
+          ++FastISelFailReasons[getFastISelFailReason(Inst)];
 
         // Then handle certain instructions as single-LLVM-Instruction blocks.
         if (isa<CallInst>(Inst)) {
@@ -1315,6 +1399,9 @@ void SelectionDAGISel::SelectAllBasicBlocks(const Function &Fn) {
     FuncInfo->PHINodesToUpdate.clear();
   }
 
+  if (EnableFastISelReport && !FastISelFailReasons.empty())
+    printFastISelReport(Fn, FastISelFailReasons);
+
   delete FastIS;
   SDB->clearDanglingDebugInfo();
   SDB->SPDescriptor.resetPerFunctionState();
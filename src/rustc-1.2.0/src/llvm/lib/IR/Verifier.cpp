@@ -1246,6 +1246,7 @@ void Verifier::VerifyAttributeTypes(AttributeSet Attrs, unsigned Idx,
     if (I->getKindAsEnum() == Attribute::NoReturn ||
         I->getKindAsEnum() == Attribute::NoUnwind ||
         I->getKindAsEnum() == Attribute::NoInline ||
+        I->getKindAsEnum() == Attribute::NoRecurse ||
         I->getKindAsEnum() == Attribute::AlwaysInline ||
         I->getKindAsEnum() == Attribute::OptimizeForSize ||
         I->getKindAsEnum() == Attribute::StackProtect ||
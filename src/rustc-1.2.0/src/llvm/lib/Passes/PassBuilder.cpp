@@ -29,9 +29,11 @@
 #include "llvm/Support/Debug.h"
 #include "llvm/Target/TargetMachine.h"
 #include "llvm/Transforms/InstCombine/InstCombine.h"
+#include "llvm/Transforms/Scalar/ADCE.h"
 #include "llvm/Transforms/Scalar/EarlyCSE.h"
 #include "llvm/Transforms/Scalar/LowerExpectIntrinsic.h"
 #include "llvm/Transforms/Scalar/SimplifyCFG.h"
+#include "llvm/Transforms/Utils/Mem2Reg.h"
 
 using namespace llvm;
 
@@ -113,6 +115,42 @@ void PassBuilder::registerFunctionAnalyses(FunctionAnalysisManager &FAM) {
 #include "PassRegistry.def"
 }
 
+FunctionPassManager
+PassBuilder::buildFunctionSimplificationPipeline(unsigned OptLevel,
+                                                bool DebugLogging) {
+  FunctionPassManager FPM(DebugLogging);
+  if (OptLevel == 0)
+    return FPM;
+
+  // Clean up the function as the frontend emitted it, and form SSA values so
+  // that the rest of the pipeline sees registers rather than stack slots.
+  FPM.addPass(LowerExpectIntrinsicPass());
+  FPM.addPass(SimplifyCFGPass());
+  FPM.addPass(PromoteMemoryToRegisterPass());
+  FPM.addPass(EarlyCSEPass());
+
+  // The main simplification loop of the legacy pipeline, minus the passes
+  // which still depend on legacy-only analyses (alias analysis, memory
+  // dependence, loop passes).
+  FPM.addPass(InstCombinePass());
+  FPM.addPass(SimplifyCFGPass());
+  if (OptLevel > 1)
+    FPM.addPass(EarlyCSEPass());
+  FPM.addPass(ADCEPass());
+  FPM.addPass(SimplifyCFGPass());
+  FPM.addPass(InstCombinePass());
+  return FPM;
+}
+
+/// \brief Parse 'function-simplify<ON>' into the optimization level N.
+static bool parseSimplificationPipelineName(StringRef Name,
+                                            unsigned &OptLevel) {
+  if (!Name.startswith("function-simplify<O") || !Name.endswith(">"))
+    return false;
+  StringRef Level = Name.drop_front(strlen("function-simplify<O")).drop_back();
+  return !Level.getAsInteger(10, OptLevel) && OptLevel <= 3;
+}
+
 #ifndef NDEBUG
 static bool isModulePassName(StringRef Name) {
 #define MODULE_PASS(NAME, CREATE_PASS) if (Name == NAME) return true;
@@ -136,6 +174,10 @@ static bool isCGSCCPassName(StringRef Name) {
 }
 
 static bool isFunctionPassName(StringRef Name) {
+  unsigned OptLevel;
+  if (parseSimplificationPipelineName(Name, OptLevel))
+    return true;
+
 #define FUNCTION_PASS(NAME, CREATE_PASS) if (Name == NAME) return true;
 #define FUNCTION_ANALYSIS(NAME, CREATE_PASS)                                   \
   if (Name == "require<" NAME ">" || Name == "invalidate<" NAME ">")           \
@@ -187,6 +229,12 @@ bool PassBuilder::parseCGSCCPassName(CGSCCPassManager &CGPM, StringRef Name) {
 
 bool PassBuilder::parseFunctionPassName(FunctionPassManager &FPM,
                                         StringRef Name) {
+  unsigned OptLevel;
+  if (parseSimplificationPipelineName(Name, OptLevel)) {
+    FPM.addPass(buildFunctionSimplificationPipeline(OptLevel));
+    return true;
+  }
+
 #define FUNCTION_PASS(NAME, CREATE_PASS)                                       \
   if (Name == NAME) {                                                          \
     FPM.addPass(CREATE_PASS);                                                  \
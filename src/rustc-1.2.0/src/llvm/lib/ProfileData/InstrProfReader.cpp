@@ -16,6 +16,7 @@
 #include "InstrProfIndexed.h"
 #include "llvm/ADT/STLExtras.h"
 #include "llvm/ProfileData/InstrProf.h"
+#include <algorithm>
 #include <cassert>
 
 using namespace llvm;
@@ -138,6 +139,8 @@ std::error_code TextInstrProfReader::readNextRecord(InstrProfRecord &Record) {
   }
   // Give the record a reference to our internal counter storage.
   Record.Counts = Counts;
+  // The text format doesn't carry value profiles.
+  Record.IndirectCallSites.clear();
 
   return success();
 }
@@ -221,7 +224,7 @@ RawInstrProfReader<IntPtrT>::readNextHeader(const char *CurrentPos) {
 }
 
 static uint64_t getRawVersion() {
-  return 1;
+  return 2;
 }
 
 template <class IntPtrT>
@@ -232,13 +235,16 @@ RawInstrProfReader<IntPtrT>::readHeader(const RawHeader &Header) {
 
   CountersDelta = swap(Header.CountersDelta);
   NamesDelta = swap(Header.NamesDelta);
+  ValuesDelta = swap(Header.ValuesDelta);
   auto DataSize = swap(Header.DataSize);
   auto CountersSize = swap(Header.CountersSize);
   auto NamesSize = swap(Header.NamesSize);
+  auto ValuesSize = swap(Header.ValuesSize);
 
   ptrdiff_t DataOffset = sizeof(RawHeader);
   ptrdiff_t CountersOffset = DataOffset + sizeof(ProfileData) * DataSize;
-  ptrdiff_t NamesOffset = CountersOffset + sizeof(uint64_t) * CountersSize;
+  ptrdiff_t ValuesOffset = CountersOffset + sizeof(uint64_t) * CountersSize;
+  ptrdiff_t NamesOffset = ValuesOffset + sizeof(uint64_t) * ValuesSize;
   size_t ProfileSize = NamesOffset + sizeof(char) * NamesSize;
 
   auto *Start = reinterpret_cast<const char *>(&Header);
@@ -248,9 +254,57 @@ RawInstrProfReader<IntPtrT>::readHeader(const RawHeader &Header) {
   Data = reinterpret_cast<const ProfileData *>(Start + DataOffset);
   DataEnd = Data + DataSize;
   CountersStart = reinterpret_cast<const uint64_t *>(Start + CountersOffset);
+  ValuesStart = reinterpret_cast<const uint64_t *>(Start + ValuesOffset);
   NamesStart = Start + NamesOffset;
   ProfileEnd = Start + ProfileSize;
 
+  // Value profiles record the addresses of indirect call targets. Map the
+  // addresses of the functions in this profile back to their names.
+  FunctionNameHashes.clear();
+  for (const ProfileData *I = Data; I != DataEnd; ++I) {
+    StringRef Name(getName(I->NamePtr), swap(I->NameSize));
+    if (Name.data() < NamesStart || Name.data() + Name.size() > ProfileEnd)
+      return error(instrprof_error::malformed);
+    if (IntPtrT FunctionPtr = swap(I->FunctionPtr))
+      FunctionNameHashes[FunctionPtr] = getInstrProfFuncNameHash(Name);
+  }
+
+  return success();
+}
+
+template <class IntPtrT>
+std::error_code
+RawInstrProfReader<IntPtrT>::readValueData(InstrProfRecord &Record) {
+  Record.IndirectCallSites.clear();
+  uint32_t NumSites = swap(Data->NumValueSites);
+  if (!NumSites)
+    return success();
+
+  const uint64_t *Values = getValues(Data->ValuesPtr);
+  auto *NamesStartAsValue = reinterpret_cast<const uint64_t *>(NamesStart);
+  if (Values < ValuesStart ||
+      Values + 2 * InstrProfValuesPerSite * NumSites > NamesStartAsValue)
+    return error(instrprof_error::malformed);
+
+  Record.IndirectCallSites.resize(NumSites);
+  for (auto &Site : Record.IndirectCallSites) {
+    for (unsigned I = 0; I < InstrProfValuesPerSite; ++I, Values += 2) {
+      uint64_t Count = swap(Values[1]);
+      if (!Count)
+        continue;
+      // Targets which weren't instrumented themselves have no name we could
+      // record, so they are dropped.
+      auto Target = FunctionNameHashes.find(IntPtrT(swap(Values[0])));
+      if (Target == FunctionNameHashes.end())
+        continue;
+      Site.push_back({Target->second, Count});
+    }
+    std::stable_sort(Site.begin(), Site.end(),
+                     [](const InstrProfValueData &L,
+                        const InstrProfValueData &R) {
+      return L.Count > R.Count;
+    });
+  }
   return success();
 }
 
@@ -269,11 +323,10 @@ RawInstrProfReader<IntPtrT>::readNextRecord(InstrProfRecord &Record) {
   auto RawCounts = makeArrayRef(getCounter(Data->CounterPtr), NumCounters);
 
   // Check bounds.
-  auto *NamesStartAsCounter = reinterpret_cast<const uint64_t *>(NamesStart);
   if (RawName.data() < NamesStart ||
       RawName.data() + RawName.size() > DataBuffer->getBufferEnd() ||
       RawCounts.data() < CountersStart ||
-      RawCounts.data() + RawCounts.size() > NamesStartAsCounter)
+      RawCounts.data() + RawCounts.size() > ValuesStart)
     return error(instrprof_error::malformed);
 
   // Store the data in Record, byte-swapping as necessary.
@@ -288,6 +341,9 @@ RawInstrProfReader<IntPtrT>::readNextRecord(InstrProfRecord &Record) {
   } else
     Record.Counts = RawCounts;
 
+  if (std::error_code EC = readValueData(Record))
+    return EC;
+
   // Iterate.
   ++Data;
   return success();
@@ -350,34 +406,76 @@ std::error_code IndexedInstrProfReader::readHeader() {
   return success();
 }
 
-std::error_code IndexedInstrProfReader::getFunctionCounts(
-    StringRef FuncName, uint64_t FuncHash, std::vector<uint64_t> &Counts) {
+std::error_code
+IndexedInstrProfReader::readRecordData(ArrayRef<uint64_t> Data, size_t &Offset,
+                                       InstrProfRecord &Record) {
+  // Valid data starts with a hash and either a count or the number of counts.
+  if (Offset + 2 > Data.size())
+    return error(instrprof_error::malformed);
+  // First we have a function hash.
+  Record.Hash = Data[Offset++];
+  // In version 1 we knew the number of counters implicitly, but in newer
+  // versions we store the number of counters next.
+  uint64_t NumCounts =
+      FormatVersion == 1 ? Data.size() - Offset : Data[Offset++];
+  if (Offset + NumCounts > Data.size())
+    return error(instrprof_error::malformed);
+  // And then the counts themselves.
+  Record.Counts = Data.slice(Offset, NumCounts);
+  Offset += NumCounts;
+
+  // Since version 3, the counts are followed by the number of indirect call
+  // sites and, for each site, the number of targets and the target/count
+  // pairs.
+  Record.IndirectCallSites.clear();
+  if (FormatVersion < 3)
+    return success();
+  if (Offset + 1 > Data.size())
+    return error(instrprof_error::malformed);
+  uint64_t NumSites = Data[Offset++];
+  if (NumSites > Data.size() - Offset)
+    return error(instrprof_error::malformed);
+  Record.IndirectCallSites.resize(NumSites);
+  for (auto &Site : Record.IndirectCallSites) {
+    if (Offset + 1 > Data.size())
+      return error(instrprof_error::malformed);
+    uint64_t NumTargets = Data[Offset++];
+    if (NumTargets > (Data.size() - Offset) / 2)
+      return error(instrprof_error::malformed);
+    for (uint64_t I = 0; I < NumTargets; ++I, Offset += 2)
+      Site.push_back({Data[Offset], Data[Offset + 1]});
+  }
+  return success();
+}
+
+std::error_code IndexedInstrProfReader::getFunctionRecord(
+    StringRef FuncName, uint64_t FuncHash, InstrProfRecord &Record) {
   auto Iter = Index->find(FuncName);
   if (Iter == Index->end())
     return error(instrprof_error::unknown_function);
 
   // Found it. Look for counters with the right hash.
   ArrayRef<uint64_t> Data = (*Iter).Data;
-  uint64_t NumCounts;
-  for (uint64_t I = 0, E = Data.size(); I != E; I += NumCounts) {
-    // The function hash comes first.
-    uint64_t FoundHash = Data[I++];
-    // In v1, we have at least one count. Later, we have the number of counts.
-    if (I == E)
-      return error(instrprof_error::malformed);
-    NumCounts = FormatVersion == 1 ? E - I : Data[I++];
-    // If we have more counts than data, this is bogus.
-    if (I + NumCounts > E)
-      return error(instrprof_error::malformed);
-    // Check for a match and fill the vector if there is one.
-    if (FoundHash == FuncHash) {
-      Counts = Data.slice(I, NumCounts);
+  for (size_t Offset = 0, E = Data.size(); Offset != E;) {
+    if (std::error_code EC = readRecordData(Data, Offset, Record))
+      return EC;
+    if (Record.Hash == FuncHash) {
+      Record.Name = (*Iter).Name;
       return success();
     }
   }
   return error(instrprof_error::hash_mismatch);
 }
 
+std::error_code IndexedInstrProfReader::getFunctionCounts(
+    StringRef FuncName, uint64_t FuncHash, std::vector<uint64_t> &Counts) {
+  InstrProfRecord Record;
+  if (std::error_code EC = getFunctionRecord(FuncName, FuncHash, Record))
+    return EC;
+  Counts = Record.Counts;
+  return success();
+}
+
 std::error_code
 IndexedInstrProfReader::readNextRecord(InstrProfRecord &Record) {
   // Are we out of records?
@@ -388,22 +486,10 @@ IndexedInstrProfReader::readNextRecord(InstrProfRecord &Record) {
   Record.Name = (*RecordIterator).Name;
 
   ArrayRef<uint64_t> Data = (*RecordIterator).Data;
-  // Valid data starts with a hash and either a count or the number of counts.
-  if (CurrentOffset + 1 > Data.size())
-    return error(instrprof_error::malformed);
-  // First we have a function hash.
-  Record.Hash = Data[CurrentOffset++];
-  // In version 1 we knew the number of counters implicitly, but in newer
-  // versions we store the number of counters next.
-  uint64_t NumCounts =
-      FormatVersion == 1 ? Data.size() - CurrentOffset : Data[CurrentOffset++];
-  if (CurrentOffset + NumCounts > Data.size())
-    return error(instrprof_error::malformed);
-  // And finally the counts themselves.
-  Record.Counts = Data.slice(CurrentOffset, NumCounts);
+  if (std::error_code EC = readRecordData(Data, CurrentOffset, Record))
+    return EC;
 
   // If we've exhausted this function's data, increment the record.
-  CurrentOffset += NumCounts;
   if (CurrentOffset == Data.size()) {
     ++RecordIterator;
     CurrentOffset = 0;
@@ -17,6 +17,7 @@
 #include "llvm/ADT/StringExtras.h"
 #include "llvm/Support/EndianStream.h"
 #include "llvm/Support/OnDiskHashTable.h"
+#include <algorithm>
 
 using namespace llvm;
 
@@ -45,8 +46,11 @@ public:
     LE.write<offset_type>(N);
 
     offset_type M = 0;
-    for (const auto &Counts : *V)
-      M += (2 + Counts.second.size()) * sizeof(uint64_t);
+    for (const auto &Counts : *V) {
+      M += (3 + Counts.second.Counts.size()) * sizeof(uint64_t);
+      for (const auto &Site : Counts.second.IndirectCallSites)
+        M += (1 + 2 * Site.size()) * sizeof(uint64_t);
+    }
     LE.write<offset_type>(M);
 
     return std::make_pair(N, M);
@@ -63,24 +67,61 @@ public:
 
     for (const auto &Counts : *V) {
       LE.write<uint64_t>(Counts.first);
-      LE.write<uint64_t>(Counts.second.size());
-      for (uint64_t I : Counts.second)
+      LE.write<uint64_t>(Counts.second.Counts.size());
+      for (uint64_t I : Counts.second.Counts)
         LE.write<uint64_t>(I);
+      LE.write<uint64_t>(Counts.second.IndirectCallSites.size());
+      for (const auto &Site : Counts.second.IndirectCallSites) {
+        LE.write<uint64_t>(Site.size());
+        for (const InstrProfValueData &Target : Site) {
+          LE.write<uint64_t>(Target.Value);
+          LE.write<uint64_t>(Target.Count);
+        }
+      }
     }
   }
 };
 }
 
-std::error_code
-InstrProfWriter::addFunctionCounts(StringRef FunctionName,
-                                   uint64_t FunctionHash,
-                                   ArrayRef<uint64_t> Counters) {
+/// Add the targets in \p From to the targets of the same call site in \p To,
+/// keeping the hottest targets first.
+static std::error_code mergeCallSite(std::vector<InstrProfValueData> &To,
+                                     ArrayRef<InstrProfValueData> From) {
+  for (const InstrProfValueData &Target : From) {
+    auto Found = std::find_if(To.begin(), To.end(),
+                              [&](const InstrProfValueData &V) {
+      return V.Value == Target.Value;
+    });
+    if (Found == To.end()) {
+      To.push_back(Target);
+      continue;
+    }
+    if (Found->Count + Target.Count < Found->Count)
+      return instrprof_error::counter_overflow;
+    Found->Count += Target.Count;
+  }
+  std::stable_sort(To.begin(), To.end(),
+                   [](const InstrProfValueData &L, const InstrProfValueData &R) {
+    return L.Count > R.Count;
+  });
+  return instrprof_error::success;
+}
+
+std::error_code InstrProfWriter::addFunctionCounts(
+    StringRef FunctionName, uint64_t FunctionHash,
+    ArrayRef<uint64_t> Counters,
+    ArrayRef<std::vector<InstrProfValueData>> IndirectCallSites) {
   auto &CounterData = FunctionData[FunctionName];
 
   auto Where = CounterData.find(FunctionHash);
   if (Where == CounterData.end()) {
     // We've never seen a function with this name and hash, add it.
-    CounterData[FunctionHash] = Counters;
+    auto &Found = CounterData[FunctionHash];
+    Found.Counts = Counters;
+    for (const auto &Site : IndirectCallSites) {
+      Found.IndirectCallSites.emplace_back();
+      mergeCallSite(Found.IndirectCallSites.back(), Site);
+    }
     // We keep track of the max function count as we go for simplicity.
     if (Counters[0] > MaxFunctionCount)
       MaxFunctionCount = Counters[0];
@@ -88,10 +129,12 @@ InstrProfWriter::addFunctionCounts(StringRef FunctionName,
   }
 
   // We're updating a function we've seen before.
-  auto &FoundCounters = Where->second;
+  auto &FoundCounters = Where->second.Counts;
+  auto &FoundSites = Where->second.IndirectCallSites;
   // If the number of counters doesn't match we either have bad data or a hash
   // collision.
-  if (FoundCounters.size() != Counters.size())
+  if (FoundCounters.size() != Counters.size() ||
+      FoundSites.size() != IndirectCallSites.size())
     return instrprof_error::count_mismatch;
 
   for (size_t I = 0, E = Counters.size(); I < E; ++I) {
@@ -99,6 +142,9 @@ InstrProfWriter::addFunctionCounts(StringRef FunctionName,
       return instrprof_error::counter_overflow;
     FoundCounters[I] += Counters[I];
   }
+  for (size_t I = 0, E = FoundSites.size(); I < E; ++I)
+    if (std::error_code EC = mergeCallSite(FoundSites[I], IndirectCallSites[I]))
+      return EC;
   // We keep track of the max function count as we go for simplicity.
   if (FoundCounters[0] > MaxFunctionCount)
     MaxFunctionCount = FoundCounters[0];
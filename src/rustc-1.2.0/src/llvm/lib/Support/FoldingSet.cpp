@@ -18,6 +18,7 @@
 #include "llvm/Support/ErrorHandling.h"
 #include "llvm/Support/Host.h"
 #include "llvm/Support/MathExtras.h"
+#include <algorithm>
 #include <cassert>
 #include <cstring>
 using namespace llvm;
@@ -246,6 +247,22 @@ void FoldingSetImpl::clear() {
   NumNodes = 0;
 }
 
+bool FoldingSetImpl::shrink_and_clear() {
+  // Keep enough buckets for as many nodes again at the current load, and never
+  // fewer than a default-constructed set has.
+  unsigned NewNumBuckets = std::max<uint64_t>(64, NextPowerOf2(NumNodes));
+  if (NewNumBuckets >= NumBuckets) {
+    clear();
+    return false;
+  }
+
+  free(Buckets);
+  NumBuckets = NewNumBuckets;
+  Buckets = AllocateBuckets(NumBuckets);
+  NumNodes = 0;
+  return true;
+}
+
 /// GrowHashTable - Double the size of the hash table and rehash everything.
 ///
 void FoldingSetImpl::GrowHashTable() {
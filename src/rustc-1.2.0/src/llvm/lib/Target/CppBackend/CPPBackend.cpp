@@ -507,6 +507,7 @@ void CppWriter::printAttributes(const AttributeSet &PAL,
       HANDLE_ATTR(ReadNone);
       HANDLE_ATTR(ReadOnly);
       HANDLE_ATTR(NoInline);
+      HANDLE_ATTR(NoRecurse);
       HANDLE_ATTR(AlwaysInline);
       HANDLE_ATTR(OptimizeNone);
       HANDLE_ATTR(OptimizeForSize);
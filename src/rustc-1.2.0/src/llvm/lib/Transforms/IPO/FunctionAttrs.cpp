@@ -11,9 +11,11 @@
 // call-graph, looking for functions which do not access or only read
 // non-local memory, and marking them readnone/readonly.  It does the
 // same with function arguments independently, marking them readonly/
-// readnone/nocapture.  Finally, well-known library call declarations
-// are marked with all attributes that are consistent with the
-// function's standard definition. This pass is implemented as a
+// readnone/nocapture.  Functions which only call functions that are
+// known not to recurse are marked norecurse, and arguments which are
+// always returned are marked returned.  Finally, well-known library call
+// declarations are marked with all attributes that are consistent with
+// the function's standard definition. This pass is implemented as a
 // bottom-up traversal of the call-graph.
 //
 //===----------------------------------------------------------------------===//
@@ -27,10 +29,13 @@
 #include "llvm/Analysis/CallGraph.h"
 #include "llvm/Analysis/CallGraphSCCPass.h"
 #include "llvm/Analysis/CaptureTracking.h"
+#include "llvm/Analysis/ValueTracking.h"
 #include "llvm/IR/GlobalVariable.h"
 #include "llvm/IR/InstIterator.h"
 #include "llvm/IR/IntrinsicInst.h"
 #include "llvm/IR/LLVMContext.h"
+#include "llvm/IR/Operator.h"
+#include "llvm/IR/Statepoint.h"
 #include "llvm/Analysis/TargetLibraryInfo.h"
 using namespace llvm;
 
@@ -42,6 +47,13 @@ STATISTIC(NumNoCapture, "Number of arguments marked nocapture");
 STATISTIC(NumReadNoneArg, "Number of arguments marked readnone");
 STATISTIC(NumReadOnlyArg, "Number of arguments marked readonly");
 STATISTIC(NumNoAlias, "Number of function returns marked noalias");
+STATISTIC(NumNonNullReturn, "Number of function returns marked nonnull");
+STATISTIC(NumDerefReturn,
+          "Number of function returns marked dereferenceable");
+STATISTIC(NumNonNullArg, "Number of arguments marked nonnull");
+STATISTIC(NumDerefArg, "Number of arguments marked dereferenceable");
+STATISTIC(NumNoRecurse, "Number of functions marked norecurse");
+STATISTIC(NumReturnedArg, "Number of arguments marked returned");
 STATISTIC(NumAnnotated, "Number of attributes added to library functions");
 
 namespace {
@@ -67,6 +79,21 @@ namespace {
     // AddNoAliasAttrs - Deduce noalias attributes for the SCC.
     bool AddNoAliasAttrs(const CallGraphSCC &SCC);
 
+    // AddNonNullAttrs - Deduce nonnull and dereferenceable attributes for the
+    // returns of the SCC.
+    bool AddNonNullAttrs(const CallGraphSCC &SCC);
+
+    // AddNonNullArgAttrs - Deduce nonnull and dereferenceable attributes for
+    // the arguments of internal functions in the SCC from their call sites.
+    bool AddNonNullArgAttrs(const CallGraphSCC &SCC);
+
+    // AddNoRecurseAttrs - Deduce norecurse attributes for the SCC.
+    bool AddNoRecurseAttrs(const CallGraphSCC &SCC);
+
+    // AddReturnedArgAttrs - Deduce returned attributes for the arguments of
+    // the SCC.
+    bool AddReturnedArgAttrs(const CallGraphSCC &SCC);
+
     // Utility methods used by inferPrototypeAttributes to add attributes
     // and maintain annotation statistics.
 
@@ -627,15 +654,11 @@ bool FunctionAttrs::AddArgumentAttrs(const CallGraphSCC &SCC) {
     if (ArgumentSCC.size() == 1) {
       if (!ArgumentSCC[0]->Definition) continue;  // synthetic root node
 
-      // eg. "void f(int* x) { if (...) f(x); }"
-      if (ArgumentSCC[0]->Uses.size() == 1 &&
-          ArgumentSCC[0]->Uses[0] == ArgumentSCC[0]) {
-        Argument *A = ArgumentSCC[0]->Definition;
-        A->addAttr(AttributeSet::get(A->getContext(), A->getArgNo() + 1, B));
-        ++NumNoCapture;
-        Changed = true;
-      }
-      continue;
+      // Partial nodes have already been solved.  Otherwise the argument only
+      // flows into itself, eg. "void f(int* x) { if (...) f(x); }", or into
+      // arguments which have already been solved, and is handled below.
+      if (ArgumentSCC[0]->Uses.empty())
+        continue;
     }
 
     bool SCCCaptured = false;
@@ -668,25 +691,22 @@ bool FunctionAttrs::AddArgumentAttrs(const CallGraphSCC &SCC) {
         break;
       }
     }
-    if (SCCCaptured) continue;
 
-    for (unsigned i = 0, e = ArgumentSCC.size(); i != e; ++i) {
-      Argument *A = ArgumentSCC[i]->Definition;
-      A->addAttr(AttributeSet::get(A->getContext(), A->getArgNo() + 1, B));
-      ++NumNoCapture;
-      Changed = true;
+    if (!SCCCaptured) {
+      for (unsigned i = 0, e = ArgumentSCC.size(); i != e; ++i) {
+        Argument *A = ArgumentSCC[i]->Definition;
+        A->addAttr(AttributeSet::get(A->getContext(), A->getArgNo() + 1, B));
+        ++NumNoCapture;
+        Changed = true;
+      }
     }
 
-    // We also want to compute readonly/readnone. With a small number of false
-    // negatives, we can assume that any pointer which is captured isn't going
-    // to be provably readonly or readnone, since by definition we can't
-    // analyze all uses of a captured pointer.
-    //
-    // The false negatives happen when the pointer is captured by a function
-    // that promises readonly/readnone behaviour on the pointer, then the
-    // pointer's lifetime ends before anything that writes to arbitrary memory.
-    // Also, a readonly/readnone pointer may be returned, but returning a
-    // pointer is capturing it.
+    // We also want to compute readonly/readnone.  Every use of the arguments
+    // of the ArgumentSCC is known, as they are only captured by passing them
+    // to other arguments of functions in our SCC.  Those outside the
+    // ArgumentSCC have already been visited, so whether they are readonly or
+    // readnone is settled even if they capture the pointer, and
+    // determinePointerReadAttrs can rely on their attributes.
 
     Attribute::AttrKind ReadAttr = Attribute::ReadNone;
     for (unsigned i = 0, e = ArgumentSCC.size(); i != e; ++i) {
@@ -709,6 +729,9 @@ bool FunctionAttrs::AddArgumentAttrs(const CallGraphSCC &SCC) {
         .addAttribute(Attribute::ReadNone);
       for (unsigned i = 0, e = ArgumentSCC.size(); i != e; ++i) {
         Argument *A = ArgumentSCC[i]->Definition;
+        if (A->getParent()->getAttributes().hasAttribute(A->getArgNo() + 1,
+                                                         ReadAttr))
+          continue;
         // Clear out existing readonly/readnone attributes
         A->removeAttr(AttributeSet::get(A->getContext(), A->getArgNo() + 1, R));
         A->addAttr(AttributeSet::get(A->getContext(), A->getArgNo() + 1, B));
@@ -837,6 +860,357 @@ bool FunctionAttrs::AddNoAliasAttrs(const CallGraphSCC &SCC) {
   return MadeChange;
 }
 
+namespace {
+/// PointerFacts - What is known about a pointer value: whether it is non-null
+/// and how many bytes are dereferenceable through it.
+struct PointerFacts {
+  bool NonNull;
+  uint64_t DerefBytes;
+
+  // The best possible facts, the identity of meet().
+  static PointerFacts top() { return {true, UINT64_MAX}; }
+
+  void meet(const PointerFacts &Other) {
+    NonNull &= Other.NonNull;
+    DerefBytes = std::min(DerefBytes, Other.DerefBytes);
+  }
+
+  bool isUseful() const { return NonNull || DerefBytes; }
+};
+}
+
+/// getPointerFacts - Compute what is known about all the values \p Root may
+/// be, looking through casts, constant-offset GEPs, phis and selects. Calls
+/// to functions in \p SCCNodes are assumed to return \c top(); the caller
+/// must verify that assumption.
+///
+/// If \p IsReturned, the facts must hold after the function holding \p Root
+/// returns. Its allocas and byval arguments are gone by then, so pointers to
+/// them give no facts.
+static PointerFacts
+getPointerFacts(Value *Root, const DataLayout &DL, const TargetLibraryInfo *TLI,
+                const SmallPtrSetImpl<Function *> &SCCNodes, bool IsReturned) {
+  // Each value is visited with the number of bytes its users have already
+  // stepped over with GEPs.
+  typedef std::pair<Value *, uint64_t> Item;
+  SmallVector<Item, 8> Worklist;
+  SmallSet<Item, 8> Visited;
+  Worklist.push_back(std::make_pair(Root, 0));
+
+  PointerFacts Result = PointerFacts::top();
+  while (!Worklist.empty() && Result.isUseful()) {
+    Item Cur = Worklist.pop_back_val();
+    if (!Visited.insert(Cur).second)
+      continue;
+    Value *V = Cur.first;
+    uint64_t Offset = Cur.second;
+
+    PointerFacts Facts = {false, 0};
+    if (isa<UndefValue>(V))
+      continue;
+
+    if (BitCastOperator *BC = dyn_cast<BitCastOperator>(V)) {
+      Worklist.push_back(std::make_pair(BC->getOperand(0), Offset));
+      continue;
+    }
+    if (GEPOperator *GEP = dyn_cast<GEPOperator>(V)) {
+      APInt GEPOffset(DL.getPointerSizeInBits(GEP->getPointerAddressSpace()),
+                      0);
+      if (GEP->isInBounds() && GEP->accumulateConstantOffset(DL, GEPOffset) &&
+          !GEPOffset.isNegative()) {
+        Worklist.push_back(std::make_pair(GEP->getPointerOperand(),
+                                          Offset + GEPOffset.getZExtValue()));
+        continue;
+      }
+    }
+    if (PHINode *PN = dyn_cast<PHINode>(V)) {
+      for (Value *IncValue : PN->incoming_values())
+        Worklist.push_back(std::make_pair(IncValue, Offset));
+      continue;
+    }
+    if (SelectInst *SI = dyn_cast<SelectInst>(V)) {
+      Worklist.push_back(std::make_pair(SI->getTrueValue(), Offset));
+      Worklist.push_back(std::make_pair(SI->getFalseValue(), Offset));
+      continue;
+    }
+
+    if (Argument *A = dyn_cast<Argument>(V)) {
+      if (IsReturned && A->hasByValOrInAllocaAttr())
+        return {false, 0};
+      Facts.DerefBytes = A->getDereferenceableBytes();
+      Facts.NonNull = A->hasNonNullAttr() || Facts.DerefBytes;
+    } else if (AllocaInst *AI = dyn_cast<AllocaInst>(V)) {
+      if (IsReturned)
+        return {false, 0};
+      Facts.NonNull = true;
+      if (!AI->isArrayAllocation() && AI->getAllocatedType()->isSized())
+        Facts.DerefBytes = DL.getTypeStoreSize(AI->getAllocatedType());
+    } else if (GlobalVariable *GV = dyn_cast<GlobalVariable>(V)) {
+      Facts.NonNull = !GV->hasExternalWeakLinkage();
+      if (Facts.NonNull && GV->getType()->getElementType()->isSized())
+        Facts.DerefBytes =
+            DL.getTypeStoreSize(GV->getType()->getElementType());
+    } else if (isa<CallInst>(V) || isa<InvokeInst>(V)) {
+      CallSite CS(V);
+      Function *Callee = CS.getCalledFunction();
+      if (Callee && SCCNodes.count(Callee))
+        continue;
+      // The call site only reports its own attributes for dereferenceable
+      // bytes, so look at the callee's too.
+      Facts.DerefBytes = CS.getDereferenceableBytes(0);
+      if (Callee)
+        Facts.DerefBytes =
+            std::max(Facts.DerefBytes, Callee->getDereferenceableBytes(0));
+      Facts.NonNull = CS.isReturnNonNull() || Facts.DerefBytes;
+    } else {
+      Facts.NonNull = isKnownNonNull(V, TLI);
+    }
+
+    // An inbounds GEP of a non-null pointer is non-null, but the bytes it
+    // stepped over are no longer available.
+    Facts.DerefBytes = Facts.DerefBytes > Offset ? Facts.DerefBytes - Offset
+                                                 : 0;
+    Result.meet(Facts);
+  }
+
+  if (!Result.isUseful())
+    return {false, 0};
+  return Result;
+}
+
+/// AddNonNullAttrs - Deduce nonnull and dereferenceable attributes for the
+/// returns of the SCC.
+bool FunctionAttrs::AddNonNullAttrs(const CallGraphSCC &SCC) {
+  SmallPtrSet<Function*, 8> SCCNodes;
+  for (CallGraphSCC::iterator I = SCC.begin(), E = SCC.end(); I != E; ++I)
+    SCCNodes.insert((*I)->getFunction());
+
+  // Speculate that every function of the SCC returns pointers with the
+  // common facts of all their returned values. Recursive calls then
+  // contribute nothing, and the speculation holds by induction.
+  PointerFacts Common = PointerFacts::top();
+  bool AnyPointerReturn = false;
+  for (CallGraphSCC::iterator I = SCC.begin(), E = SCC.end(); I != E; ++I) {
+    Function *F = (*I)->getFunction();
+
+    if (!F || F->hasFnAttribute(Attribute::OptimizeNone))
+      return false;
+
+    // Only pointers in the default address space are known to be non-null
+    // when they are dereferenceable.
+    PointerType *RetTy = dyn_cast<PointerType>(F->getReturnType());
+    if (!RetTy || RetTy->getAddressSpace() != 0)
+      continue;
+
+    if (F->isDeclaration() || F->mayBeOverridden())
+      return false;
+
+    const DataLayout &DL = F->getParent()->getDataLayout();
+    for (BasicBlock &BB : *F)
+      if (ReturnInst *Ret = dyn_cast<ReturnInst>(BB.getTerminator()))
+        Common.meet(getPointerFacts(Ret->getReturnValue(), DL, TLI, SCCNodes,
+                                    /*IsReturned=*/true));
+    AnyPointerReturn = true;
+    if (!Common.isUseful())
+      return false;
+  }
+  if (!AnyPointerReturn || Common.DerefBytes == UINT64_MAX)
+    return false;
+
+  bool MadeChange = false;
+  for (CallGraphSCC::iterator I = SCC.begin(), E = SCC.end(); I != E; ++I) {
+    Function *F = (*I)->getFunction();
+    PointerType *RetTy = dyn_cast<PointerType>(F->getReturnType());
+    if (!RetTy || RetTy->getAddressSpace() != 0)
+      continue;
+
+    if (Common.NonNull &&
+        !F->getAttributes().hasAttribute(AttributeSet::ReturnIndex,
+                                         Attribute::NonNull)) {
+      F->addAttribute(AttributeSet::ReturnIndex, Attribute::NonNull);
+      ++NumNonNullReturn;
+      MadeChange = true;
+    }
+    if (Common.DerefBytes > F->getDereferenceableBytes(0)) {
+      F->addDereferenceableAttr(AttributeSet::ReturnIndex, Common.DerefBytes);
+      ++NumDerefReturn;
+      MadeChange = true;
+    }
+  }
+
+  return MadeChange;
+}
+
+/// AddNonNullArgAttrs - Deduce nonnull and dereferenceable attributes for the
+/// arguments of internal functions in the SCC, by looking at the values all
+/// of their callers pass.
+bool FunctionAttrs::AddNonNullArgAttrs(const CallGraphSCC &SCC) {
+  SmallPtrSet<Function*, 1> NoSpeculation;
+  bool MadeChange = false;
+
+  for (CallGraphSCC::iterator I = SCC.begin(), E = SCC.end(); I != E; ++I) {
+    Function *F = (*I)->getFunction();
+
+    if (!F || F->isDeclaration() || !F->hasLocalLinkage() ||
+        F->hasFnAttribute(Attribute::OptimizeNone) || F->use_empty())
+      continue;
+
+    // Every use must be a direct call, or some callers are not visible.
+    SmallVector<CallSite, 8> CallSites;
+    for (Use &U : F->uses()) {
+      CallSite CS(U.getUser());
+      if (!CS || !CS.isCallee(&U)) {
+        CallSites.clear();
+        break;
+      }
+      CallSites.push_back(CS);
+    }
+    if (CallSites.empty())
+      continue;
+
+    const DataLayout &DL = F->getParent()->getDataLayout();
+    for (Argument &A : F->args()) {
+      PointerType *ArgTy = dyn_cast<PointerType>(A.getType());
+      if (!ArgTy || ArgTy->getAddressSpace() != 0 || A.hasByValOrInAllocaAttr())
+        continue;
+
+      PointerFacts Facts = PointerFacts::top();
+      for (CallSite CS : CallSites) {
+        Facts.meet(getPointerFacts(CS.getArgument(A.getArgNo()), DL, TLI,
+                                   NoSpeculation, /*IsReturned=*/false));
+        if (!Facts.isUseful())
+          break;
+      }
+      if (!Facts.isUseful() || Facts.DerefBytes == UINT64_MAX)
+        continue;
+
+      unsigned Idx = A.getArgNo() + 1;
+      if (Facts.NonNull && !A.hasNonNullAttr()) {
+        F->addAttribute(Idx, Attribute::NonNull);
+        ++NumNonNullArg;
+        MadeChange = true;
+      }
+      if (Facts.DerefBytes > A.getDereferenceableBytes()) {
+        F->addDereferenceableAttr(Idx, Facts.DerefBytes);
+        ++NumDerefArg;
+        MadeChange = true;
+      }
+    }
+  }
+
+  return MadeChange;
+}
+
+/// mayCallOutOfModule - Return true if F, or a function it calls directly
+/// or indirectly, may call code which is not defined in this module.  That
+/// code may call any externally visible function.
+static bool mayCallOutOfModule(const Function *F,
+                               SmallPtrSetImpl<const Function *> &Visited) {
+  if (!Visited.insert(F).second)
+    return false;
+  if (F->isDeclaration() || F->mayBeOverridden())
+    return true;
+
+  for (const_inst_iterator II = inst_begin(F), E = inst_end(F); II != E;
+       ++II) {
+    ImmutableCallSite CS(&*II);
+    if (!CS)
+      continue;
+    const Function *Callee = CS.getCalledFunction();
+    if (!Callee)
+      return true;
+    if (Callee->isIntrinsic() && !isStatepoint(CS))
+      continue;
+    if (mayCallOutOfModule(Callee, Visited))
+      return true;
+  }
+  return false;
+}
+
+/// AddNoRecurseAttrs - Deduce norecurse attributes for the SCC.
+bool FunctionAttrs::AddNoRecurseAttrs(const CallGraphSCC &SCC) {
+  // Functions of a larger SCC call each other.
+  if (!SCC.isSingular())
+    return false;
+
+  Function *F = (*SCC.begin())->getFunction();
+  if (!F || F->isDeclaration() || F->mayBeOverridden() ||
+      F->hasFnAttribute(Attribute::OptimizeNone) || F->doesNotRecurse())
+    return false;
+
+  // A declaration may call back into F, unless F cannot be named or reached
+  // from outside the module.
+  bool MayBeCalledBack = !F->hasLocalLinkage() || F->hasAddressTaken();
+
+  // The SCC is visited bottom-up, so a function defined outside it which F
+  // calls cannot reach F through direct calls within the module.  It may
+  // still leave the module, through a declaration or an indirect call, even
+  // if it is norecurse itself; the code it reaches there may call F.
+  SmallPtrSet<const Function *, 16> Visited;
+  for (inst_iterator II = inst_begin(F), E = inst_end(F); II != E; ++II) {
+    CallSite CS(&*II);
+    if (!CS)
+      continue;
+    Function *Callee = CS.getCalledFunction();
+    // Calls to F itself are recursion, and F is not norecurse yet.
+    if (!Callee || !Callee->doesNotRecurse()) {
+      // Intrinsics do not call other functions, except for statepoints.
+      if (Callee && Callee->isIntrinsic() && !isStatepoint(CS))
+        continue;
+      return false;
+    }
+    if (MayBeCalledBack && mayCallOutOfModule(Callee, Visited))
+      return false;
+  }
+
+  F->setDoesNotRecurse();
+  ++NumNoRecurse;
+  return true;
+}
+
+/// AddReturnedArgAttrs - Deduce returned attributes for the arguments of the
+/// SCC: a function which always returns the same argument.
+bool FunctionAttrs::AddReturnedArgAttrs(const CallGraphSCC &SCC) {
+  bool MadeChange = false;
+
+  for (CallGraphSCC::iterator I = SCC.begin(), E = SCC.end(); I != E; ++I) {
+    Function *F = (*I)->getFunction();
+
+    if (!F || F->isDeclaration() || F->mayBeOverridden() ||
+        F->hasFnAttribute(Attribute::OptimizeNone) ||
+        F->getReturnType()->isVoidTy())
+      continue;
+
+    // At most one argument may be marked returned.
+    bool HasReturnedArg = false;
+    for (Argument &A : F->args())
+      HasReturnedArg |= A.hasReturnedAttr();
+    if (HasReturnedArg)
+      continue;
+
+    Argument *Returned = nullptr;
+    for (BasicBlock &BB : *F) {
+      ReturnInst *Ret = dyn_cast<ReturnInst>(BB.getTerminator());
+      if (!Ret)
+        continue;
+      Argument *A = dyn_cast<Argument>(Ret->getReturnValue());
+      if (!A || (Returned && A != Returned)) {
+        Returned = nullptr;
+        break;
+      }
+      Returned = A;
+    }
+    if (!Returned)
+      continue;
+
+    F->addAttribute(Returned->getArgNo() + 1, Attribute::Returned);
+    ++NumReturnedArg;
+    MadeChange = true;
+  }
+
+  return MadeChange;
+}
+
 /// inferPrototypeAttributes - Analyze the name and prototype of the
 /// given function and set any applicable attributes.  Returns true
 /// if any attributes were set and false otherwise.
@@ -1712,5 +2086,10 @@ bool FunctionAttrs::runOnSCC(CallGraphSCC &SCC) {
   Changed |= AddReadAttrs(SCC);
   Changed |= AddArgumentAttrs(SCC);
   Changed |= AddNoAliasAttrs(SCC);
+  // Argument facts feed into the facts about returned values.
+  Changed |= AddNonNullArgAttrs(SCC);
+  Changed |= AddNonNullAttrs(SCC);
+  Changed |= AddReturnedArgAttrs(SCC);
+  Changed |= AddNoRecurseAttrs(SCC);
   return Changed;
 }
@@ -0,0 +1,299 @@
+//===- FunctionOrdering.cpp - Lay out functions using profile data --------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This pass uses function entry counts and block frequencies from profile
+// data to choose an order for the functions of a module, so that hot callers
+// and callees end up next to each other in the final binary.
+//
+// Functions are grouped with call-chain clustering: visiting functions from
+// the hottest down, each function's cluster is appended to the cluster of its
+// most frequent caller, as long as the result stays below a size limit.
+// Clusters are then ordered by their density (execution count per
+// instruction). The module's function list is rearranged in that order, and
+// on ELF targets profiled functions are put in .text.hot.* or
+// .text.unlikely.* sections so that the linker groups them. The order can
+// also be written out as a symbol ordering file for the linker.
+//
+//===----------------------------------------------------------------------===//
+
+#include "llvm/Transforms/IPO.h"
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/SmallPtrSet.h"
+#include "llvm/ADT/Statistic.h"
+#include "llvm/ADT/Triple.h"
+#include "llvm/Analysis/BlockFrequencyInfo.h"
+#include "llvm/IR/CallSite.h"
+#include "llvm/IR/Instructions.h"
+#include "llvm/IR/Mangler.h"
+#include "llvm/IR/Module.h"
+#include "llvm/Pass.h"
+#include "llvm/Support/CommandLine.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/raw_ostream.h"
+#include <algorithm>
+using namespace llvm;
+
+#define DEBUG_TYPE "function-order"
+
+STATISTIC(NumClustersMerged, "Number of call-chain clusters merged");
+STATISTIC(NumHotFunctions, "Number of functions placed in hot sections");
+STATISTIC(NumColdFunctions, "Number of functions placed in unlikely sections");
+
+static cl::opt<unsigned>
+MaxClusterSize("function-order-max-cluster-size", cl::init(64 * 1024),
+               cl::Hidden,
+               cl::desc("Maximum number of instructions in a call-chain "
+                        "cluster"));
+
+static cl::opt<unsigned>
+HotPercent("function-order-hot-percent", cl::init(99), cl::Hidden,
+           cl::desc("Percentage of the total entry count covered by the "
+                    "functions put into hot sections"));
+
+static cl::opt<bool>
+AssignSections("function-order-sections", cl::init(true), cl::Hidden,
+               cl::desc("Put profiled functions into .text.hot and "
+                        ".text.unlikely sections on ELF targets"));
+
+static cl::opt<std::string>
+OrderFile("function-order-file", cl::value_desc("filename"), cl::Hidden,
+          cl::desc("Write the chosen function order to a symbol ordering "
+                   "file for the linker"));
+
+namespace {
+/// \brief A group of functions which will be laid out next to each other.
+struct Cluster {
+  std::vector<Function *> Functions;
+  uint64_t Size;
+  uint64_t Count;
+
+  double getDensity() const {
+    return double(Count) / std::max<uint64_t>(Size, 1);
+  }
+};
+
+struct FunctionOrdering : public ModulePass {
+  static char ID; // Pass identification, replacement for typeid
+  FunctionOrdering() : ModulePass(ID) {
+    initializeFunctionOrderingPass(*PassRegistry::getPassRegistry());
+  }
+
+  bool runOnModule(Module &M) override;
+
+  void getAnalysisUsage(AnalysisUsage &AU) const override {
+    AU.addRequired<BlockFrequencyInfo>();
+  }
+
+private:
+  void addCallEdges(Function &F, uint64_t EntryCount);
+  void writeOrderFile(const Module &M, ArrayRef<Function *> Order);
+
+  /// The profiled functions, with their entry counts.
+  DenseMap<Function *, uint64_t> Counts;
+  /// For each function, its most frequent caller and the estimated number of
+  /// calls from it.
+  DenseMap<Function *, std::pair<Function *, uint64_t>> HottestCaller;
+};
+}
+
+char FunctionOrdering::ID = 0;
+INITIALIZE_PASS_BEGIN(FunctionOrdering, "function-order",
+                      "Order functions using profile data", false, false)
+INITIALIZE_PASS_DEPENDENCY(BlockFrequencyInfo)
+INITIALIZE_PASS_END(FunctionOrdering, "function-order",
+                    "Order functions using profile data", false, false)
+
+ModulePass *llvm::createFunctionOrderingPass() {
+  return new FunctionOrdering();
+}
+
+static uint64_t getFunctionSize(const Function &F) {
+  uint64_t Size = 0;
+  for (const BasicBlock &BB : F)
+    Size += BB.size();
+  return Size;
+}
+
+void FunctionOrdering::addCallEdges(Function &F, uint64_t EntryCount) {
+  BlockFrequencyInfo &BFI = getAnalysis<BlockFrequencyInfo>(F);
+  uint64_t EntryFreq = std::max<uint64_t>(BFI.getEntryFreq(), 1);
+  for (BasicBlock &BB : F) {
+    // Scale the entry count by how often the block runs per entry.
+    uint64_t BlockCount =
+        uint64_t(double(EntryCount) * BFI.getBlockFreq(&BB).getFrequency() /
+                 EntryFreq);
+    if (!BlockCount)
+      continue;
+    for (Instruction &I : BB) {
+      CallSite CS(&I);
+      if (!CS)
+        continue;
+      Function *Callee = CS.getCalledFunction();
+      if (!Callee || Callee->isDeclaration() || Callee == &F)
+        continue;
+      auto &Caller = HottestCaller[Callee];
+      if (BlockCount > Caller.second)
+        Caller = std::make_pair(&F, BlockCount);
+    }
+  }
+}
+
+/// \brief Write the symbols of \p Order to OrderFile, one per line.
+///
+/// The linker matches the entries against symbol names, so they are mangled
+/// for the target the way the code generator will emit them: with the
+/// global prefix of the data layout, without the '\1' escape, and with the
+/// suffixes of stdcall and fastcall functions. Private functions have no
+/// symbol in the object file and are left out.
+void FunctionOrdering::writeOrderFile(const Module &M,
+                                      ArrayRef<Function *> Order) {
+  std::error_code EC;
+  raw_fd_ostream OS(OrderFile, EC, sys::fs::F_Text);
+  if (EC) {
+    errs() << "WARNING: couldn't write function order file '" << OrderFile
+           << "': " << EC.message() << "\n";
+    return;
+  }
+  Mangler Mang(&M.getDataLayout());
+  for (Function *F : Order) {
+    if (F->hasPrivateLinkage())
+      continue;
+    Mang.getNameWithPrefix(OS, F, /*CannotUsePrivateLabel=*/false);
+    OS << "\n";
+  }
+}
+
+bool FunctionOrdering::runOnModule(Module &M) {
+  Counts.clear();
+  HottestCaller.clear();
+
+  uint64_t TotalCount = 0;
+  for (Function &F : M) {
+    if (F.isDeclaration())
+      continue;
+    if (Optional<uint64_t> Count = F.getEntryCount()) {
+      Counts[&F] = *Count;
+      TotalCount += *Count;
+    }
+  }
+  if (Counts.empty())
+    return false;
+
+  for (Function &F : M) {
+    auto I = Counts.find(&F);
+    if (I != Counts.end() && I->second)
+      addCallEdges(F, I->second);
+  }
+
+  // Visit the executed functions from the hottest down. Ties are broken by
+  // the position in the module to keep the result deterministic.
+  std::vector<Function *> Hot;
+  for (Function &F : M) {
+    auto I = Counts.find(&F);
+    if (I != Counts.end() && I->second)
+      Hot.push_back(&F);
+  }
+  std::stable_sort(Hot.begin(), Hot.end(), [&](Function *A, Function *B) {
+    return Counts[A] > Counts[B];
+  });
+
+  // Call-chain clustering. Each function starts in a cluster of its own.
+  std::vector<Cluster> Clusters(Hot.size());
+  DenseMap<Function *, unsigned> ClusterOf;
+  for (unsigned I = 0, E = Hot.size(); I != E; ++I) {
+    Clusters[I].Functions.push_back(Hot[I]);
+    Clusters[I].Size = getFunctionSize(*Hot[I]);
+    Clusters[I].Count = Counts[Hot[I]];
+    ClusterOf[Hot[I]] = I;
+  }
+
+  for (Function *F : Hot) {
+    auto CI = HottestCaller.find(F);
+    if (CI == HottestCaller.end())
+      continue;
+    auto CallerCluster = ClusterOf.find(CI->second.first);
+    if (CallerCluster == ClusterOf.end())
+      continue;
+
+    unsigned To = CallerCluster->second, From = ClusterOf[F];
+    if (To == From ||
+        Clusters[To].Size + Clusters[From].Size > MaxClusterSize)
+      continue;
+
+    // Append the callee's cluster after the caller's.
+    for (Function *Moved : Clusters[From].Functions) {
+      Clusters[To].Functions.push_back(Moved);
+      ClusterOf[Moved] = To;
+    }
+    Clusters[To].Size += Clusters[From].Size;
+    Clusters[To].Count += Clusters[From].Count;
+    Clusters[From].Functions.clear();
+    ++NumClustersMerged;
+  }
+
+  std::vector<Cluster *> Sorted;
+  for (Cluster &C : Clusters)
+    if (!C.Functions.empty())
+      Sorted.push_back(&C);
+  std::stable_sort(Sorted.begin(), Sorted.end(), [](Cluster *A, Cluster *B) {
+    return A->getDensity() > B->getDensity();
+  });
+
+  // The final order: the clusters, then the unprofiled functions in their
+  // original order, then the functions which were never executed.
+  std::vector<Function *> Order;
+  for (Cluster *C : Sorted)
+    Order.insert(Order.end(), C->Functions.begin(), C->Functions.end());
+  std::vector<Function *> Cold;
+  for (Function &F : M) {
+    if (F.isDeclaration())
+      continue;
+    auto I = Counts.find(&F);
+    if (I == Counts.end())
+      Order.push_back(&F);
+    else if (!I->second)
+      Cold.push_back(&F);
+  }
+  Order.insert(Order.end(), Cold.begin(), Cold.end());
+
+  if (AssignSections && Triple(M.getTargetTriple()).isOSBinFormatELF()) {
+    // The hot set is the hottest functions which together cover HotPercent
+    // of all calls.
+    SmallPtrSet<Function *, 32> HotSet;
+    uint64_t Covered = 0;
+    for (Function *F : Hot) {
+      if (Covered * 100 >= TotalCount * HotPercent)
+        break;
+      Covered += Counts[F];
+      HotSet.insert(F);
+    }
+
+    for (auto &Entry : Counts) {
+      Function *F = Entry.first;
+      if (F->hasSection())
+        continue;
+      if (HotSet.count(F)) {
+        F->setSection((".text.hot." + F->getName()).str());
+        ++NumHotFunctions;
+      } else if (!Entry.second) {
+        F->setSection((".text.unlikely." + F->getName()).str());
+        ++NumColdFunctions;
+      }
+    }
+  }
+
+  // Rearrange the module so that functions are emitted in the chosen order.
+  Module::FunctionListType &FL = M.getFunctionList();
+  for (Function *F : Order)
+    FL.splice(FL.end(), FL, F);
+
+  if (!OrderFile.empty())
+    writeOrderFile(M, Order);
+  return true;
+}
@@ -32,6 +32,7 @@ using namespace llvm;
 STATISTIC(NumAliases  , "Number of global aliases removed");
 STATISTIC(NumFunctions, "Number of functions removed");
 STATISTIC(NumVariables, "Number of global variables removed");
+STATISTIC(NumAlive    , "Number of global values found to be alive");
 
 namespace {
   struct GlobalDCE : public ModulePass {
@@ -49,11 +50,17 @@ namespace {
     SmallPtrSet<GlobalValue*, 32> AliveGlobals;
     SmallPtrSet<Constant *, 8> SeenConstants;
     std::unordered_multimap<Comdat *, GlobalValue *> ComdatMembers;
+    /// Globals marked as needed whose uses have not been marked yet.  Using a
+    /// worklist rather than recursion keeps long chains of references, as
+    /// found in large LTO modules, from overflowing the stack.
+    SmallVector<GlobalValue *, 32> Worklist;
 
-    /// GlobalIsNeeded - mark the specific global value as needed, and
-    /// recursively mark anything that it uses as also needed.
+    /// GlobalIsNeeded - mark the specific global value as needed, and queue
+    /// it so that anything that it uses is marked as needed too.
     void GlobalIsNeeded(GlobalValue *GV);
     void MarkUsedGlobalsAsNeeded(Constant *C);
+    void MarkUsesAsNeeded(GlobalValue *GV);
+    void ProcessWorklist();
 
     bool RemoveUnusedGlobalValue(GlobalValue &GV);
   };
@@ -121,6 +128,9 @@ bool GlobalDCE::runOnModule(Module &M) {
     }
   }
 
+  // Mark everything the needed globals use as needed.
+  ProcessWorklist();
+
   // Now that all globals which are needed are in the AliveGlobals set, we loop
   // through the program, deleting those which are not alive.
   //
@@ -195,13 +205,24 @@ bool GlobalDCE::runOnModule(Module &M) {
   return Changed;
 }
 
-/// GlobalIsNeeded - the specific global value as needed, and
-/// recursively mark anything that it uses as also needed.
+/// GlobalIsNeeded - mark the specific global value as needed, and queue it so
+/// that anything that it uses is marked as needed too.
 void GlobalDCE::GlobalIsNeeded(GlobalValue *G) {
   // If the global is already in the set, no need to reprocess it.
   if (!AliveGlobals.insert(G).second)
     return;
+  ++NumAlive;
+  Worklist.push_back(G);
+}
+
+void GlobalDCE::ProcessWorklist() {
+  while (!Worklist.empty())
+    MarkUsesAsNeeded(Worklist.pop_back_val());
+}
 
+/// MarkUsesAsNeeded - mark the other members of the comdat of G, and the
+/// global values G uses, as needed.
+void GlobalDCE::MarkUsesAsNeeded(GlobalValue *G) {
   if (Comdat *C = G->getComdat()) {
     for (auto &&CM : make_range(ComdatMembers.equal_range(C)))
       GlobalIsNeeded(CM.second);
@@ -64,8 +64,48 @@ STATISTIC(NumNestRemoved   , "Number of nest attributes removed");
 STATISTIC(NumAliasesResolved, "Number of global aliases resolved");
 STATISTIC(NumAliasesRemoved, "Number of global aliases eliminated");
 STATISTIC(NumCXXDtorsRemoved, "Number of global C++ destructors removed");
+STATISTIC(NumRounds    , "Number of rounds of global optimization");
+STATISTIC(NumRevisited , "Number of globals revisited after their uses changed");
 
 namespace {
+  /// GlobalWorklist - A list of globals to look at, without duplicates, which
+  /// forgets the globals deleted after they were added.
+  class GlobalWorklist {
+    std::vector<WeakVH> List;
+    DenseMap<const GlobalValue *, unsigned> Index;
+
+  public:
+    bool insert(GlobalValue *GV) {
+      auto Inserted = Index.insert(std::make_pair(GV, List.size()));
+      if (!Inserted.second) {
+        if (List[Inserted.first->second] == GV)
+          return false;
+        // The global which was added at this address has been deleted.
+        Inserted.first->second = List.size();
+      }
+      List.push_back(GV);
+      return true;
+    }
+    bool count(const GlobalValue *GV) const {
+      auto I = Index.find(GV);
+      return I != Index.end() && List[I->second] == GV;
+    }
+    /// Return the I'th global added, or null if it has been deleted.
+    GlobalValue *operator[](unsigned I) const {
+      Value *V = List[I];
+      return dyn_cast_or_null<GlobalValue>(V);
+    }
+    unsigned size() const { return List.size(); }
+    void clear() {
+      List.clear();
+      Index.clear();
+    }
+    void swap(GlobalWorklist &Other) {
+      List.swap(Other.List);
+      Index.swap(Other.Index);
+    }
+  };
+
   struct GlobalOpt : public ModulePass {
     void getAnalysisUsage(AnalysisUsage &AU) const override {
       AU.addRequired<TargetLibraryInfoWrapperPass>();
@@ -79,15 +119,45 @@ namespace {
 
   private:
     bool OptimizeFunctions(Module &M);
+    bool OptimizeFunction(Function *F);
     bool OptimizeGlobalVars(Module &M);
+    bool OptimizeGlobalVar(GlobalVariable *GV, Module::global_iterator &GVI);
     bool OptimizeGlobalAliases(Module &M);
     bool ProcessGlobal(GlobalVariable *GV,Module::global_iterator &GVI);
     bool ProcessInternalGlobal(GlobalVariable *GV,Module::global_iterator &GVI,
                                const GlobalStatus &GS);
     bool OptimizeEmptyGlobalCXXDtors(Function *CXAAtExitFn);
+    void updateNotDiscardableComdats(Module &M);
+
+    /// shouldVisit - Return true if GV must be looked at in this round: in the
+    /// first round all globals are, and after it only those whose uses may
+    /// have changed since they were last looked at.
+    bool shouldVisit(const GlobalValue *GV) const {
+      return FirstRound || Visit.count(GV) || Revisit.count(GV);
+    }
+    /// getNumPending/getPending - After the first round, the globals to look
+    /// at: those in Visit, then those in Revisit, including the ones added to
+    /// it while they are being looked at.
+    unsigned getNumPending() const { return Visit.size() + Revisit.size(); }
+    GlobalValue *getPending(unsigned I) const {
+      return I < Visit.size() ? Visit[I] : Revisit[I - Visit.size()];
+    }
+    void markChanged(GlobalValue *GV);
+    void markGlobalsUsedBy(User *U, SmallPtrSetImpl<Constant *> &Seen);
+    void markGlobalsUsedBy(Function *F);
 
     TargetLibraryInfo *TLI;
     SmallSet<const Comdat *, 8> NotDiscardableComdats;
+
+    /// Rather than looking at every global in each round of the fixed-point
+    /// iteration, only the globals whose uses changed in the previous round
+    /// (Visit) or earlier in this one (Revisit) are looked at again.
+    bool FirstRound;
+    GlobalWorklist Visit;
+    GlobalWorklist Revisit;
+    /// Comdats with a member whose uses changed, and whose discardability must
+    /// be recomputed.
+    SmallPtrSet<const Comdat *, 8> DirtyComdats;
   };
 }
 
@@ -1722,6 +1792,35 @@ bool GlobalOpt::ProcessGlobal(GlobalVariable *GV,
   return ProcessInternalGlobal(GV, GVI, GS);
 }
 
+/// isLocalizableTo - Return true if GV, which is only accessed by the function
+/// F, may be replaced by a local variable of F.  This is the case if F is
+/// main, which is only entered once, or if F does not recurse and always
+/// stores to GV before loading it, so that no value survives between calls.
+static bool isLocalizableTo(const GlobalVariable *GV, const Function *F,
+                            const GlobalStatus &GS) {
+  if (F->getName() == "main" && F->hasExternalLinkage())
+    return true;
+  if (!F->doesNotRecurse() || GS.Ordering != NotAtomic)
+    return false;
+
+  SmallPtrSet<const BasicBlock *, 8> LoadBlocks;
+  for (const User *U : GV->users()) {
+    if (const LoadInst *LI = dyn_cast<LoadInst>(U))
+      LoadBlocks.insert(LI->getParent());
+    else if (!isa<StoreInst>(U))
+      return false;
+  }
+  // Each load must follow a store in its block.
+  for (const BasicBlock *BB : LoadBlocks)
+    for (const Instruction &I : *BB) {
+      if (isa<StoreInst>(I) && cast<StoreInst>(I).getPointerOperand() == GV)
+        break;
+      if (isa<LoadInst>(I) && cast<LoadInst>(I).getPointerOperand() == GV)
+        return false;
+    }
+  return true;
+}
+
 /// ProcessInternalGlobal - Analyze the specified global variable and optimize
 /// it if possible.  If we make a change, return true.
 bool GlobalOpt::ProcessInternalGlobal(GlobalVariable *GV,
@@ -1729,8 +1828,9 @@ bool GlobalOpt::ProcessInternalGlobal(GlobalVariable *GV,
                                       const GlobalStatus &GS) {
   auto &DL = GV->getParent()->getDataLayout();
   // If this is a first class global and has only one accessing function
-  // and this function is main (which we know is not recursive), we replace
-  // the global with a local alloca in this function.
+  // and this function is main (which we know is not recursive) or another
+  // function which does not recurse, we replace the global with a local
+  // alloca in this function.
   //
   // NOTE: It doesn't make sense to promote non-single-value types since we
   // are just replacing static memory to stack memory.
@@ -1739,9 +1839,8 @@ bool GlobalOpt::ProcessInternalGlobal(GlobalVariable *GV,
   if (!GS.HasMultipleAccessingFunctions &&
       GS.AccessingFunction && !GS.HasNonInstructionUser &&
       GV->getType()->getElementType()->isSingleValueType() &&
-      GS.AccessingFunction->getName() == "main" &&
-      GS.AccessingFunction->hasExternalLinkage() &&
-      GV->getType()->getAddressSpace() == 0) {
+      GV->getType()->getAddressSpace() == 0 &&
+      isLocalizableTo(GV, GS.AccessingFunction, GS)) {
     DEBUG(dbgs() << "LOCALIZING GLOBAL: " << *GV);
     Instruction &FirstI = const_cast<Instruction&>(*GS.AccessingFunction
                                                    ->getEntryBlock().begin());
@@ -1894,42 +1993,150 @@ static bool isProfitableToMakeFastCC(Function *F) {
   return CC == CallingConv::C || CC == CallingConv::X86_ThisCall;
 }
 
+/// markChanged - Note that the uses of GV have changed, so that it is looked
+/// at again.
+void GlobalOpt::markChanged(GlobalValue *GV) {
+  Revisit.insert(GV);
+  if (const Comdat *C = GV->getComdat())
+    DirtyComdats.insert(C);
+}
+
+/// markGlobalsUsedBy - Mark the globals which U refers to, directly or
+/// through constants, as changed.
+void GlobalOpt::markGlobalsUsedBy(User *U, SmallPtrSetImpl<Constant *> &Seen) {
+  SmallVector<User *, 8> Worklist(1, U);
+  while (!Worklist.empty()) {
+    User *Cur = Worklist.pop_back_val();
+    for (Value *Op : Cur->operands()) {
+      if (GlobalValue *GV = dyn_cast<GlobalValue>(Op))
+        markChanged(GV);
+      else if (Constant *C = dyn_cast<Constant>(Op))
+        if (Seen.insert(C).second)
+          Worklist.push_back(C);
+    }
+  }
+}
+
+/// markGlobalsUsedBy - Mark the globals which the body of F refers to as
+/// changed.
+void GlobalOpt::markGlobalsUsedBy(Function *F) {
+  SmallPtrSet<Constant *, 8> Seen;
+  if (F->hasPrefixData())
+    markGlobalsUsedBy(F->getPrefixData(), Seen);
+  if (F->hasPrologueData())
+    markGlobalsUsedBy(F->getPrologueData(), Seen);
+  for (BasicBlock &BB : *F)
+    for (Instruction &I : BB)
+      markGlobalsUsedBy(&I, Seen);
+}
+
+/// collectGlobalsUsedByUsers - Collect the other globals which the
+/// instructions using GV, directly or through constants, refer to.
+static void collectGlobalsUsedByUsers(GlobalVariable *GV,
+                                      SmallVectorImpl<GlobalValue *> &Used) {
+  SmallPtrSet<const Value *, 8> Seen;
+  SmallVector<const Value *, 8> Worklist(1, GV);
+  while (!Worklist.empty())
+    for (const User *U : Worklist.pop_back_val()->users()) {
+      if (isa<ConstantExpr>(U)) {
+        if (Seen.insert(U).second)
+          Worklist.push_back(U);
+        continue;
+      }
+      if (!isa<Instruction>(U))
+        continue;
+      for (const Value *Op : U->operands()) {
+        auto *OpGV = dyn_cast<GlobalValue>(Op->stripPointerCasts());
+        if (OpGV && OpGV != GV && Seen.insert(OpGV).second)
+          Used.push_back(const_cast<GlobalValue *>(OpGV));
+      }
+    }
+}
+
+/// updateNotDiscardableComdats - Compute which comdats have a member that must
+/// be kept: all of them in the first round, and after it only the comdats
+/// whose members changed.
+void GlobalOpt::updateNotDiscardableComdats(Module &M) {
+  if (!FirstRound && DirtyComdats.empty())
+    return;
+  if (FirstRound)
+    NotDiscardableComdats.clear();
+  for (const Comdat *C : DirtyComdats)
+    NotDiscardableComdats.erase(C);
+  auto NeedsUpdate = [&](const Comdat *C) {
+    return C && (FirstRound || DirtyComdats.count(C));
+  };
+
+  for (const GlobalVariable &GV : M.globals())
+    if (NeedsUpdate(GV.getComdat()))
+      if (!GV.isDiscardableIfUnused() || !GV.use_empty())
+        NotDiscardableComdats.insert(GV.getComdat());
+  for (Function &F : M)
+    if (NeedsUpdate(F.getComdat()))
+      if (!F.isDefTriviallyDead())
+        NotDiscardableComdats.insert(F.getComdat());
+  for (GlobalAlias &GA : M.aliases())
+    if (NeedsUpdate(GA.getComdat()))
+      if (!GA.isDiscardableIfUnused() || !GA.use_empty())
+        NotDiscardableComdats.insert(GA.getComdat());
+  DirtyComdats.clear();
+}
+
 bool GlobalOpt::OptimizeFunctions(Module &M) {
   bool Changed = false;
-  // Optimize functions.
-  for (Module::iterator FI = M.begin(), E = M.end(); FI != E; ) {
-    Function *F = FI++;
-    // Functions without names cannot be referenced outside this module.
-    if (!F->hasName() && !F->isDeclaration() && !F->hasLocalLinkage())
-      F->setLinkage(GlobalValue::InternalLinkage);
-
-    const Comdat *C = F->getComdat();
-    bool inComdat = C && NotDiscardableComdats.count(C);
-    F->removeDeadConstantUsers();
-    if ((!inComdat || F->hasLocalLinkage()) && F->isDefTriviallyDead()) {
-      F->eraseFromParent();
+  if (FirstRound) {
+    for (Module::iterator FI = M.begin(), E = M.end(); FI != E; ) {
+      Function *F = FI++;
+      Changed |= OptimizeFunction(F);
+    }
+    return Changed;
+  }
+
+  for (unsigned I = 0; I != getNumPending(); ++I)
+    if (Function *F = dyn_cast_or_null<Function>(getPending(I))) {
+      ++NumRevisited;
+      Changed |= OptimizeFunction(F);
+    }
+  return Changed;
+}
+
+/// OptimizeFunction - Delete F if it is dead, or improve its calling
+/// convention if all its uses are known.  If we make a change, return true.
+bool GlobalOpt::OptimizeFunction(Function *F) {
+  bool Changed = false;
+  // Functions without names cannot be referenced outside this module.
+  if (!F->hasName() && !F->isDeclaration() && !F->hasLocalLinkage())
+    F->setLinkage(GlobalValue::InternalLinkage);
+
+  const Comdat *C = F->getComdat();
+  bool inComdat = C && NotDiscardableComdats.count(C);
+  F->removeDeadConstantUsers();
+  if ((!inComdat || F->hasLocalLinkage()) && F->isDefTriviallyDead()) {
+    // Whatever the function refers to loses a use.
+    markGlobalsUsedBy(F);
+    markChanged(F);
+    F->eraseFromParent();
+    Changed = true;
+    ++NumFnDeleted;
+  } else if (F->hasLocalLinkage()) {
+    if (isProfitableToMakeFastCC(F) && !F->isVarArg() &&
+        !F->hasAddressTaken()) {
+      // If this function has a calling convention worth changing, is not a
+      // varargs function, and is only called directly, promote it to use the
+      // Fast calling convention.
+      F->setCallingConv(CallingConv::Fast);
+      ChangeCalleesToFastCall(F);
+      ++NumFastCallFns;
       Changed = true;
-      ++NumFnDeleted;
-    } else if (F->hasLocalLinkage()) {
-      if (isProfitableToMakeFastCC(F) && !F->isVarArg() &&
-          !F->hasAddressTaken()) {
-        // If this function has a calling convention worth changing, is not a
-        // varargs function, and is only called directly, promote it to use the
-        // Fast calling convention.
-        F->setCallingConv(CallingConv::Fast);
-        ChangeCalleesToFastCall(F);
-        ++NumFastCallFns;
-        Changed = true;
-      }
+    }
 
-      if (F->getAttributes().hasAttrSomewhere(Attribute::Nest) &&
-          !F->hasAddressTaken()) {
-        // The function is not used by a trampoline intrinsic, so it is safe
-        // to remove the 'nest' attribute.
-        RemoveNestAttribute(F);
-        ++NumNestRemoved;
-        Changed = true;
-      }
+    if (F->getAttributes().hasAttrSomewhere(Attribute::Nest) &&
+        !F->hasAddressTaken()) {
+      // The function is not used by a trampoline intrinsic, so it is safe
+      // to remove the 'nest' attribute.
+      RemoveNestAttribute(F);
+      ++NumNestRemoved;
+      Changed = true;
     }
   }
   return Changed;
@@ -1938,31 +2145,92 @@ bool GlobalOpt::OptimizeFunctions(Module &M) {
 bool GlobalOpt::OptimizeGlobalVars(Module &M) {
   bool Changed = false;
 
-  for (Module::global_iterator GVI = M.global_begin(), E = M.global_end();
-       GVI != E; ) {
-    GlobalVariable *GV = GVI++;
-    // Global variables without names cannot be referenced outside this module.
-    if (!GV->hasName() && !GV->isDeclaration() && !GV->hasLocalLinkage())
-      GV->setLinkage(GlobalValue::InternalLinkage);
-    // Simplify the initializer.
-    if (GV->hasInitializer())
-      if (ConstantExpr *CE = dyn_cast<ConstantExpr>(GV->getInitializer())) {
-        auto &DL = M.getDataLayout();
-        Constant *New = ConstantFoldConstantExpression(CE, DL, TLI);
-        if (New && New != CE)
-          GV->setInitializer(New);
-      }
+  if (FirstRound) {
+    for (Module::global_iterator GVI = M.global_begin(), E = M.global_end();
+         GVI != E; ) {
+      GlobalVariable *GV = GVI++;
+      Changed |= OptimizeGlobalVar(GV, GVI);
+    }
+    return Changed;
+  }
 
-    if (GV->isDiscardableIfUnused()) {
-      if (const Comdat *C = GV->getComdat())
-        if (NotDiscardableComdats.count(C) && !GV->hasLocalLinkage())
-          continue;
-      Changed |= ProcessGlobal(GV, GVI);
+  for (unsigned I = 0; I != getNumPending(); ++I) {
+    GlobalVariable *GV = dyn_cast_or_null<GlobalVariable>(getPending(I));
+    if (!GV)
+      continue;
+    ++NumRevisited;
+    Module::global_iterator GVI = GV, End = std::next(GVI);
+    ++GVI;
+    Changed |= OptimizeGlobalVar(GV, GVI);
+    // Globals which replace GV are inserted before it, and GVI is moved back
+    // to them: look at them in this round too.
+    while (GVI != End) {
+      GlobalVariable *NewGV = GVI++;
+      Changed |= OptimizeGlobalVar(NewGV, GVI);
     }
   }
   return Changed;
 }
 
+/// OptimizeGlobalVar - Simplify and optimize GV, which is followed by GVI.
+/// Record what GV and its users refer to if anything changed.
+bool GlobalOpt::OptimizeGlobalVar(GlobalVariable *GV,
+                                  Module::global_iterator &GVI) {
+  // Global variables without names cannot be referenced outside this module.
+  if (!GV->hasName() && !GV->isDeclaration() && !GV->hasLocalLinkage())
+    GV->setLinkage(GlobalValue::InternalLinkage);
+  // Simplify the initializer.
+  if (GV->hasInitializer())
+    if (ConstantExpr *CE = dyn_cast<ConstantExpr>(GV->getInitializer())) {
+      auto &DL = GV->getParent()->getDataLayout();
+      Constant *New = ConstantFoldConstantExpression(CE, DL, TLI);
+      if (New && New != CE) {
+        SmallPtrSet<Constant *, 8> Seen;
+        markGlobalsUsedBy(CE, Seen);
+        GV->setInitializer(New);
+      }
+    }
+
+  if (GV->isDiscardableIfUnused()) {
+    if (const Comdat *C = GV->getComdat())
+      if (NotDiscardableComdats.count(C) && !GV->hasLocalLinkage())
+        return false;
+
+    // Optimizing GV rewrites its users, which may drop their references to
+    // other globals, and may delete GV or change its initializer, dropping
+    // the references from that.  Remember what these refer to now.
+    SmallVector<GlobalValue *, 8> UsedByUsers;
+    if (GV->hasLocalLinkage() && !GV->isConstant() && GV->hasInitializer())
+      collectGlobalsUsedByUsers(GV, UsedByUsers);
+    WeakVH Init(GV->hasInitializer() ? GV->getInitializer() : nullptr);
+    WeakVH GVHandle(GV);  // Follows GV if it is replaced.
+    const Comdat *GVComdat = GV->getComdat();
+
+    if (!ProcessGlobal(GV, GVI))
+      return false;
+
+    // GV may have been deleted: only look at it again through the handle.
+    GlobalVariable *LiveGV = dyn_cast_or_null<GlobalVariable>(GVHandle);
+    if (LiveGV)
+      Revisit.insert(LiveGV);
+    if (GVComdat)
+      DirtyComdats.insert(GVComdat);
+    for (GlobalValue *Used : UsedByUsers)
+      markChanged(Used);
+    if (Init && (!LiveGV || !LiveGV->hasInitializer() ||
+                 LiveGV->getInitializer() != Init)) {
+      if (GlobalValue *InitGV = dyn_cast<GlobalValue>(Init)) {
+        markChanged(InitGV);
+      } else {
+        SmallPtrSet<Constant *, 8> Seen;
+        markGlobalsUsedBy(cast<Constant>(Init), Seen);
+      }
+    }
+    return true;
+  }
+  return false;
+}
+
 static inline bool
 isSimpleEnoughValueToCommit(Constant *C,
                             SmallPtrSetImpl<Constant *> &SimpleConstants,
@@ -2682,9 +2950,12 @@ bool Evaluator::EvaluateFunction(Function *F, Constant *&RetVal,
 }
 
 /// EvaluateStaticConstructor - Evaluate static constructors in the function, if
-/// we can.  Return true if we can, false otherwise.
-static bool EvaluateStaticConstructor(Function *F, const DataLayout &DL,
-                                      const TargetLibraryInfo *TLI) {
+/// we can.  Return true if we can, false otherwise.  WillChange is called on
+/// each global variable before the result is committed to it.
+static bool
+EvaluateStaticConstructor(Function *F, const DataLayout &DL,
+                          const TargetLibraryInfo *TLI,
+                          function_ref<void(GlobalVariable *)> WillChange) {
   // Call the function.
   Evaluator Eval(DL, TLI);
   Constant *RetValDummy;
@@ -2700,10 +2971,17 @@ static bool EvaluateStaticConstructor(Function *F, const DataLayout &DL,
           << " stores.\n");
     for (DenseMap<Constant*, Constant*>::const_iterator I =
            Eval.getMutatedMemory().begin(), E = Eval.getMutatedMemory().end();
-         I != E; ++I)
+         I != E; ++I) {
+      Constant *Addr = I->first;
+      if (ConstantExpr *CE = dyn_cast<ConstantExpr>(Addr))
+        Addr = CE->getOperand(0);
+      WillChange(cast<GlobalVariable>(Addr));
       CommitValueTo(I->second, I->first);
-    for (GlobalVariable *GV : Eval.getInvariants())
+    }
+    for (GlobalVariable *GV : Eval.getInvariants()) {
+      WillChange(GV);
       GV->setConstant(true);
+    }
   }
 
   return EvalSuccess;
@@ -2878,6 +3156,8 @@ bool GlobalOpt::OptimizeGlobalAliases(Module &M) {
     // TODO: Try to handle non-zero GEPs of local aliasees.
     if (!Target)
       continue;
+    if (!shouldVisit(J) && !shouldVisit(Target))
+      continue;
     Target->removeDeadConstantUsers();
 
     // Make all users of the alias use the aliasee instead.
@@ -2888,6 +3168,8 @@ bool GlobalOpt::OptimizeGlobalAliases(Module &M) {
     J->replaceAllUsesWith(ConstantExpr::getBitCast(Aliasee, J->getType()));
     ++NumAliasesResolved;
     Changed = true;
+    markChanged(J);
+    markChanged(Target);
 
     if (RenameTarget) {
       // Give the aliasee the name, linkage and other attributes of the alias.
@@ -3019,7 +3301,10 @@ bool GlobalOpt::OptimizeEmptyGlobalCXXDtors(Function *CXAAtExitFn) {
     if (!cxxDtorIsEmpty(*DtorFn, CalledFunctions))
       continue;
 
-    // Just remove the call.
+    // Just remove the call, and with it the uses of the destructor and the
+    // object.
+    SmallPtrSet<Constant *, 8> Seen;
+    markGlobalsUsedBy(CI, Seen);
     CI->replaceAllUsesWith(Constant::getNullValue(CI->getType()));
     CI->eraseFromParent();
 
@@ -3037,30 +3322,32 @@ bool GlobalOpt::runOnModule(Module &M) {
   auto &DL = M.getDataLayout();
   TLI = &getAnalysis<TargetLibraryInfoWrapperPass>().getTLI();
 
+  FirstRound = true;
+  Visit.clear();
+  Revisit.clear();
+  DirtyComdats.clear();
+
   bool LocalChange = true;
   while (LocalChange) {
     LocalChange = false;
+    ++NumRounds;
 
-    NotDiscardableComdats.clear();
-    for (const GlobalVariable &GV : M.globals())
-      if (const Comdat *C = GV.getComdat())
-        if (!GV.isDiscardableIfUnused() || !GV.use_empty())
-          NotDiscardableComdats.insert(C);
-    for (Function &F : M)
-      if (const Comdat *C = F.getComdat())
-        if (!F.isDefTriviallyDead())
-          NotDiscardableComdats.insert(C);
-    for (GlobalAlias &GA : M.aliases())
-      if (const Comdat *C = GA.getComdat())
-        if (!GA.isDiscardableIfUnused() || !GA.use_empty())
-          NotDiscardableComdats.insert(C);
+    updateNotDiscardableComdats(M);
 
     // Delete functions that are trivially dead, ccc -> fastcc
     LocalChange |= OptimizeFunctions(M);
 
     // Optimize global_ctors list.
     LocalChange |= optimizeGlobalCtorsList(M, [&](Function *F) {
-      return EvaluateStaticConstructor(F, DL, TLI);
+      SmallPtrSet<Constant *, 8> Seen;
+      if (!EvaluateStaticConstructor(F, DL, TLI, [&](GlobalVariable *GV) {
+            markChanged(GV);
+            markGlobalsUsedBy(GV, Seen);
+          }))
+        return false;
+      // The constructor is removed from the list.
+      markChanged(F);
+      return true;
     });
 
     // Optimize non-address-taken globals.
@@ -3076,6 +3363,11 @@ bool GlobalOpt::runOnModule(Module &M) {
       LocalChange |= OptimizeEmptyGlobalCXXDtors(CXAAtExitFn);
 
     Changed |= LocalChange;
+
+    // Look at the globals changed in this round again in the next one.
+    FirstRound = false;
+    Visit.swap(Revisit);
+    Revisit.clear();
   }
 
   // TODO: Move all global ctors functions to the end of the module for code
@@ -0,0 +1,266 @@
+//===- HotColdSplitting.cpp - Outline cold regions of functions -----------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This pass outlines regions of a function which are unlikely to execute into
+// separate, cold functions, so that the hot part of the function is smaller
+// and packs better into the instruction cache.
+//
+// A block is considered cold if it ends in unreachable, calls a function
+// marked cold, or (with profile data) executes far less often than the entry
+// block. Coldness is then propagated: a block all of whose successors are
+// cold, or all of whose predecessors are cold, is cold too. Each maximal
+// single-entry region of cold blocks is extracted with the CodeExtractor into
+// a function marked cold, noinline and minsize, and placed in .text.unlikely
+// on ELF targets.
+//
+//===----------------------------------------------------------------------===//
+
+#include "llvm/Transforms/IPO.h"
+#include "llvm/ADT/PostOrderIterator.h"
+#include "llvm/ADT/SetVector.h"
+#include "llvm/ADT/SmallPtrSet.h"
+#include "llvm/ADT/Statistic.h"
+#include "llvm/ADT/Triple.h"
+#include "llvm/Analysis/BlockFrequencyInfo.h"
+#include "llvm/IR/CFG.h"
+#include "llvm/IR/CallSite.h"
+#include "llvm/IR/Dominators.h"
+#include "llvm/IR/Instructions.h"
+#include "llvm/IR/IntrinsicInst.h"
+#include "llvm/IR/Module.h"
+#include "llvm/Pass.h"
+#include "llvm/Support/CommandLine.h"
+#include "llvm/Support/Debug.h"
+#include "llvm/Support/raw_ostream.h"
+#include "llvm/Transforms/Utils/CodeExtractor.h"
+using namespace llvm;
+
+#define DEBUG_TYPE "hotcoldsplit"
+
+STATISTIC(NumColdRegionsOutlined, "Number of cold regions outlined");
+STATISTIC(NumColdBlocks, "Number of blocks moved to cold functions");
+
+static cl::opt<unsigned>
+MinColdRegionSize("hotcoldsplit-min-size", cl::init(4), cl::Hidden,
+                  cl::desc("Minimum number of instructions in a cold region "
+                           "for it to be outlined"));
+
+static cl::opt<unsigned>
+ColdFreqRatio("hotcoldsplit-freq-ratio", cl::init(1000), cl::Hidden,
+              cl::desc("With profile data, a block is cold if it runs this "
+                       "many times less often than the function entry"));
+
+namespace {
+struct HotColdSplitting : public ModulePass {
+  static char ID; // Pass identification, replacement for typeid
+  HotColdSplitting() : ModulePass(ID) {
+    initializeHotColdSplittingPass(*PassRegistry::getPassRegistry());
+  }
+
+  bool runOnModule(Module &M) override;
+
+  void getAnalysisUsage(AnalysisUsage &AU) const override {
+    AU.addRequired<BlockFrequencyInfo>();
+  }
+
+private:
+  bool splitFunction(Function &F);
+  void findColdBlocks(Function &F, SmallPtrSetImpl<BasicBlock *> &Cold);
+  bool outlineRegion(Function &F, ArrayRef<BasicBlock *> Region);
+
+  bool IsELF;
+};
+}
+
+char HotColdSplitting::ID = 0;
+INITIALIZE_PASS_BEGIN(HotColdSplitting, "hotcoldsplit",
+                      "Hot Cold Splitting", false, false)
+INITIALIZE_PASS_DEPENDENCY(BlockFrequencyInfo)
+INITIALIZE_PASS_END(HotColdSplitting, "hotcoldsplit",
+                    "Hot Cold Splitting", false, false)
+
+ModulePass *llvm::createHotColdSplittingPass() {
+  return new HotColdSplitting();
+}
+
+/// \brief Return true if \p BB is known to be unlikely to execute by itself.
+static bool isUnlikelyBlock(const BasicBlock &BB) {
+  if (isa<UnreachableInst>(BB.getTerminator()))
+    return true;
+  for (const Instruction &I : BB)
+    if (ImmutableCallSite CS = ImmutableCallSite(&I))
+      if (CS.hasFnAttr(Attribute::Cold))
+        return true;
+  return false;
+}
+
+/// \brief Return true if \p BB can never be part of an outlined region.
+static bool mustStayInFunction(const BasicBlock &BB) {
+  // A return would have to become a return of the outlined function, and
+  // landing pads must stay with their invokes.
+  return isa<ReturnInst>(BB.getTerminator()) || BB.isLandingPad() ||
+         isa<ResumeInst>(BB.getTerminator());
+}
+
+void HotColdSplitting::findColdBlocks(Function &F,
+                                      SmallPtrSetImpl<BasicBlock *> &Cold) {
+  // Blocks which run less often than this are cold. Dividing the entry
+  // frequency, rather than multiplying the block's, cannot overflow: block
+  // frequencies of hot loops use the whole 64-bit range.
+  BlockFrequencyInfo *BFI = nullptr;
+  uint64_t ColdFreq = 0;
+  if (F.getEntryCount() && ColdFreqRatio) {
+    BFI = &getAnalysis<BlockFrequencyInfo>(F);
+    ColdFreq = BFI->getEntryFreq() / ColdFreqRatio;
+  }
+
+  BasicBlock *Entry = &F.getEntryBlock();
+  for (BasicBlock &BB : F) {
+    if (&BB == Entry || mustStayInFunction(BB))
+      continue;
+    if (isUnlikelyBlock(BB) ||
+        (BFI && BFI->getBlockFreq(&BB).getFrequency() < ColdFreq))
+      Cold.insert(&BB);
+  }
+
+  // Propagate coldness until nothing changes: a block is cold if every path
+  // through it leads to a cold block, or if it is only reached from cold
+  // blocks.
+  ReversePostOrderTraversal<Function *> RPOT(&F);
+  bool Changed = true;
+  while (Changed) {
+    Changed = false;
+    for (BasicBlock *BB : RPOT) {
+      if (BB == Entry || Cold.count(BB) || mustStayInFunction(*BB))
+        continue;
+      bool AllSuccsCold = succ_begin(BB) != succ_end(BB);
+      for (BasicBlock *Succ : successors(BB))
+        AllSuccsCold &= Cold.count(Succ) != 0;
+      bool AllPredsCold = pred_begin(BB) != pred_end(BB);
+      for (BasicBlock *Pred : predecessors(BB))
+        AllPredsCold &= Cold.count(Pred) != 0;
+      if (AllSuccsCold || AllPredsCold) {
+        Cold.insert(BB);
+        Changed = true;
+      }
+    }
+  }
+}
+
+bool HotColdSplitting::outlineRegion(Function &F,
+                                     ArrayRef<BasicBlock *> Region) {
+  SmallPtrSet<BasicBlock *, 8> InRegion(Region.begin(), Region.end());
+  bool HasExit = false;
+  for (BasicBlock *BB : Region)
+    for (BasicBlock *Succ : successors(BB))
+      HasExit |= !InRegion.count(Succ);
+
+  DominatorTree DT;
+  DT.recalculate(F);
+  CodeExtractor CE(Region, &DT);
+  if (!CE.isEligible())
+    return false;
+  Function *Outlined = CE.extractCodeRegion();
+  if (!Outlined)
+    return false;
+
+  Outlined->addFnAttr(Attribute::Cold);
+  Outlined->addFnAttr(Attribute::NoInline);
+  Outlined->addFnAttr(Attribute::MinSize);
+  if (IsELF && !F.hasSection())
+    Outlined->setSection(".text.unlikely");
+
+  // If the region never left, control does not come back from the outlined
+  // call either. Say so, rather than keeping the 'ret' the extractor put
+  // after the call.
+  if (!HasExit) {
+    Outlined->setDoesNotReturn();
+    CallInst *Call = cast<CallInst>(Outlined->user_back());
+    Call->setDoesNotReturn();
+    TerminatorInst *Term = Call->getParent()->getTerminator();
+    if (Term == Call->getNextNode()) {
+      new UnreachableInst(F.getContext(), Term);
+      Term->eraseFromParent();
+    }
+  }
+
+  DEBUG(dbgs() << "HotColdSplitting: outlined " << Region.size()
+               << " blocks of " << F.getName() << " into "
+               << Outlined->getName() << "\n");
+  ++NumColdRegionsOutlined;
+  NumColdBlocks += Region.size();
+  return true;
+}
+
+bool HotColdSplitting::splitFunction(Function &F) {
+  SmallPtrSet<BasicBlock *, 16> Cold;
+  findColdBlocks(F, Cold);
+  if (Cold.empty())
+    return false;
+
+  // Carve the cold blocks into single-entry regions, each headed by a cold
+  // block whose immediate dominator is hot. Every block of a region is
+  // dominated by its header, but a hot block inside the dominator subtree
+  // could still branch into it, so such regions are dropped.
+  DominatorTree DT;
+  DT.recalculate(F);
+  std::vector<SmallVector<BasicBlock *, 8>> Regions;
+  for (BasicBlock *BB : ReversePostOrderTraversal<Function *>(&F)) {
+    if (!Cold.count(BB) || Cold.count(DT.getNode(BB)->getIDom()->getBlock()))
+      continue;
+
+    SmallVector<BasicBlock *, 8> Region;
+    SmallVector<DomTreeNode *, 8> Worklist(1, DT.getNode(BB));
+    while (!Worklist.empty()) {
+      DomTreeNode *N = Worklist.pop_back_val();
+      Region.push_back(N->getBlock());
+      for (DomTreeNode *Child : *N)
+        if (Cold.count(Child->getBlock()))
+          Worklist.push_back(Child);
+    }
+
+    SmallPtrSet<BasicBlock *, 8> InRegion(Region.begin(), Region.end());
+    bool SingleEntry = true;
+    unsigned Size = 0;
+    for (BasicBlock *RB : Region) {
+      if (RB != BB)
+        for (BasicBlock *Pred : predecessors(RB))
+          SingleEntry &= InRegion.count(Pred) != 0;
+      for (Instruction &I : *RB)
+        if (!isa<DbgInfoIntrinsic>(I))
+          ++Size;
+    }
+    if (SingleEntry && Size >= MinColdRegionSize)
+      Regions.push_back(std::move(Region));
+  }
+
+  // Regions are disjoint, and outlining one leaves the blocks of the others
+  // alone, so they can be extracted one after another.
+  bool Changed = false;
+  for (auto &Region : Regions)
+    Changed |= outlineRegion(F, Region);
+  return Changed;
+}
+
+bool HotColdSplitting::runOnModule(Module &M) {
+  IsELF = Triple(M.getTargetTriple()).isOSBinFormatELF();
+
+  // Collect the candidates first; outlining adds functions to the module.
+  std::vector<Function *> Worklist;
+  for (Function &F : M)
+    if (!F.isDeclaration() && !F.hasFnAttribute(Attribute::Cold) &&
+        !F.hasFnAttribute(Attribute::OptimizeNone) &&
+        !F.hasFnAttribute(Attribute::MinSize))
+      Worklist.push_back(&F);
+
+  bool Changed = false;
+  for (Function *F : Worklist)
+    Changed |= splitFunction(*F);
+  return Changed;
+}
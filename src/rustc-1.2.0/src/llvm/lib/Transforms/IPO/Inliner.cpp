@@ -435,6 +435,9 @@ bool Inliner::runOnSCC(CallGraphSCC &SCC) {
   auto *TLIP = getAnalysisIfAvailable<TargetLibraryInfoWrapperPass>();
   const TargetLibraryInfo *TLI = TLIP ? &TLIP->getTLI() : nullptr;
   AliasAnalysis *AA = &getAnalysis<AliasAnalysis>();
+  // Costs of inlining a function cached by the cost analysis must be dropped
+  // whenever we change its body.
+  InlineCostAnalysis *ICA = getAnalysisIfAvailable<InlineCostAnalysis>();
 
   SmallPtrSet<Function*, 8> SCCFunctions;
   DEBUG(dbgs() << "Inliner visiting SCC:");
@@ -615,6 +618,8 @@ bool Inliner::runOnSCC(CallGraphSCC &SCC) {
       }
       --CSi;
 
+      if (ICA)
+        ICA->invalidateCachedCosts(Caller);
       Changed = true;
       LocalChange = true;
     }
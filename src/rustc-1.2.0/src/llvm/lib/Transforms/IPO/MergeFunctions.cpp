@@ -28,6 +28,21 @@
 // -- "FunctionPtr" instances are stored in std::set collection, so every
 //    std::set::insert operation will give you result in log(N) time.
 //
+// Full comparison is expensive, so each function also gets a cheap structural
+// hash (see FunctionComparator::functionHash). Functions that are equal in
+// terms of the comparator always have equal hashes, so the tree is ordered by
+// hash first and the comparator only runs for functions within the same hash
+// bucket. Functions whose hash is unique in the module are never inserted at
+// all.
+//
+// Before the first round of merging, the functions of each bucket are sorted
+// with the comparator and every function is given the rank of its equivalence
+// class within its bucket. Buckets are independent, so this is done in
+// parallel (see -mergefunc-threads). The tree then orders two ranked functions
+// by rank alone, and all the merging itself (RAUW, thunk and alias creation)
+// happens in a serial phase in module order, so the output does not depend on
+// the number of threads. A function loses its rank as soon as it is modified.
+//
 // When a match is found the functions are folded. If both functions are
 // overridable, we move the functionality into a new internal function and
 // leave two overridable thunks to it.
@@ -82,14 +97,17 @@
 //===----------------------------------------------------------------------===//
 
 #include "llvm/Transforms/IPO.h"
+#include "llvm/ADT/BitVector.h"
 #include "llvm/ADT/DenseSet.h"
 #include "llvm/ADT/FoldingSet.h"
+#include "llvm/ADT/Hashing.h"
 #include "llvm/ADT/STLExtras.h"
 #include "llvm/ADT/SmallSet.h"
 #include "llvm/ADT/Statistic.h"
 #include "llvm/IR/CallSite.h"
 #include "llvm/IR/Constants.h"
 #include "llvm/IR/DataLayout.h"
+#include "llvm/IR/GetElementPtrTypeIterator.h"
 #include "llvm/IR/IRBuilder.h"
 #include "llvm/IR/InlineAsm.h"
 #include "llvm/IR/Instructions.h"
@@ -101,6 +119,7 @@
 #include "llvm/Support/CommandLine.h"
 #include "llvm/Support/Debug.h"
 #include "llvm/Support/ErrorHandling.h"
+#include "llvm/Support/ThreadPool.h"
 #include "llvm/Support/raw_ostream.h"
 #include <vector>
 using namespace llvm;
@@ -111,6 +130,8 @@ STATISTIC(NumFunctionsMerged, "Number of functions merged");
 STATISTIC(NumThunksWritten, "Number of thunks generated");
 STATISTIC(NumAliasesWritten, "Number of aliases generated");
 STATISTIC(NumDoubleWeak, "Number of new functions created");
+STATISTIC(NumUniqueHashes, "Number of functions skipped due to unique hash");
+STATISTIC(NumHashBuckets, "Number of hash buckets ranked");
 
 static cl::opt<unsigned> NumFunctionsForSanityCheck(
     "mergefunc-sanity",
@@ -119,6 +140,12 @@ static cl::opt<unsigned> NumFunctionsForSanityCheck(
              "'0' disables this check. Works only with '-debug' key."),
     cl::init(0), cl::Hidden);
 
+static cl::opt<unsigned> NumRankingThreads(
+    "mergefunc-threads",
+    cl::desc("Number of threads used to compare the functions of different "
+             "hash buckets. '0' uses all hardware threads."),
+    cl::init(1), cl::Hidden);
+
 namespace {
 
 /// FunctionComparator - Compares two functions to determine whether or not
@@ -133,7 +160,21 @@ public:
   /// Test whether the two functions have equivalent behaviour.
   int compare();
 
+  typedef uint64_t FunctionHash;
+
+  /// Compute a structural hash of F: the function type shape, the CFG shape
+  /// and the sequence of opcodes, visited in the same order as compare()
+  /// walks the blocks. Operands are ignored, so the hash is stable across the
+  /// call target rewriting done while merging. Two functions that compare()
+  /// considers equal always get the same hash.
+  static FunctionHash functionHash(const Function &F);
+
 private:
+  /// Fold the type T into hash H in a way that is consistent with cmpTypes:
+  /// pointers in address space 0 are treated as integers, and only the shape
+  /// of aggregates is considered.
+  static hash_code hashType(hash_code H, Type *T);
+
   /// Test whether two basic blocks have equivalent behaviour.
   int compare(const BasicBlock *BBL, const BasicBlock *BBR);
 
@@ -390,10 +431,17 @@ private:
 
 class FunctionNode {
   mutable AssertingVH<Function> F;
+  FunctionComparator::FunctionHash Hash;
+  /// The rank of F's equivalence class within its hash bucket, or 0 if F has
+  /// not been ranked.
+  unsigned Rank;
 
 public:
-  FunctionNode(Function *F) : F(F) {}
+  FunctionNode(Function *F, unsigned Rank = 0)
+      : F(F), Hash(FunctionComparator::functionHash(*F)), Rank(Rank) {}
   Function *getFunc() const { return F; }
+  FunctionComparator::FunctionHash getHash() const { return Hash; }
+  unsigned getRank() const { return Rank; }
 
   /// Replace the reference to the function F by the function G, assuming their
   /// implementations are equal.
@@ -406,6 +454,14 @@ public:
 
   void release() { F = 0; }
   bool operator<(const FunctionNode &RHS) const {
+    // Order by hash first; the full comparison is only needed within a
+    // bucket of structurally similar functions.
+    if (Hash != RHS.getHash())
+      return Hash < RHS.getHash();
+    // Ranks agree with the comparator as long as both functions are unchanged
+    // since they were ranked.
+    if (Rank && RHS.getRank())
+      return Rank < RHS.getRank();
     return (FunctionComparator(F, RHS.getFunc()).compare()) == -1;
   }
 };
@@ -1073,6 +1129,73 @@ int FunctionComparator::compare() {
   return 0;
 }
 
+hash_code FunctionComparator::hashType(hash_code H, Type *T) {
+  if (PointerType *PTy = dyn_cast<PointerType>(T)) {
+    // cmpTypes coerces pointers in address space 0 to the integer pointer
+    // type, so they have to share a bucket with integers.
+    if (PTy->getAddressSpace() == 0)
+      return hash_combine(H, Type::IntegerTyID);
+    return hash_combine(H, Type::PointerTyID, PTy->getAddressSpace());
+  }
+
+  H = hash_combine(H, T->getTypeID());
+  switch (T->getTypeID()) {
+  case Type::StructTyID:
+    return hash_combine(H, T->getStructNumElements(),
+                        cast<StructType>(T)->isPacked());
+  case Type::ArrayTyID:
+    return hash_combine(H, T->getArrayNumElements());
+  case Type::FunctionTyID: {
+    FunctionType *FTy = cast<FunctionType>(T);
+    H = hash_combine(H, FTy->getNumParams(), FTy->isVarArg());
+    H = hashType(H, FTy->getReturnType());
+    for (Type *ParamTy : FTy->params())
+      H = hashType(H, ParamTy);
+    return H;
+  }
+  default:
+    return H;
+  }
+}
+
+FunctionComparator::FunctionHash
+FunctionComparator::functionHash(const Function &F) {
+  hash_code H = hash_combine(F.getCallingConv(), F.hasGC(), F.hasSection());
+  H = hashType(H, F.getFunctionType());
+
+  // Walk the blocks in the same order as compare() does, accumulating the
+  // block boundaries, the opcodes and the number of successors of each block.
+  SmallVector<const BasicBlock *, 8> BBs;
+  SmallSet<const BasicBlock *, 16> VisitedBBs;
+
+  BBs.push_back(&F.getEntryBlock());
+  VisitedBBs.insert(BBs[0]);
+  while (!BBs.empty()) {
+    const BasicBlock *BB = BBs.pop_back_val();
+    // Block header, so that the partition of opcodes into blocks affects the
+    // hash and not only their order.
+    H = hash_combine(H, BB->size());
+    for (const Instruction &I : *BB) {
+      H = hash_combine(H, I.getOpcode());
+      // cmpGEPs may consider GEPs with a different number of operands and
+      // result types equal, so only their opcode is hashed.
+      if (isa<GetElementPtrInst>(I))
+        continue;
+      H = hash_combine(H, I.getNumOperands());
+      H = hashType(H, I.getType());
+    }
+
+    const TerminatorInst *Term = BB->getTerminator();
+    H = hash_combine(H, Term->getNumSuccessors());
+    for (unsigned i = 0, e = Term->getNumSuccessors(); i != e; ++i) {
+      if (!VisitedBBs.insert(Term->getSuccessor(i)).second)
+        continue;
+      BBs.push_back(Term->getSuccessor(i));
+    }
+  }
+  return H;
+}
+
 namespace {
 
 /// MergeFunctions finds functions which will generate identical machine code,
@@ -1101,6 +1224,10 @@ private:
   /// Returns true, if sanity check has been passed, and false if failed.
   bool doSanityCheck(std::vector<WeakVH> &Worklist);
 
+  /// Sort the functions of each bucket with the comparator and record the
+  /// rank of every function in Ranks. Buckets are ranked concurrently.
+  void rankBuckets(Module &M, std::vector<std::vector<Function *>> &Buckets);
+
   /// Insert a ComparableFunction into the FnTree, or merge it away if it's
   /// equal to one that's already present.
   bool insert(Function *NewFunction);
@@ -1139,6 +1266,10 @@ private:
   /// to modify it.
   FnTreeType FnTree;
 
+  /// The ranks computed by rankBuckets() for functions that have not been
+  /// modified since.
+  DenseMap<Function *, unsigned> Ranks;
+
   /// Whether or not the target supports global aliases.
   bool HasGlobalAliases;
 };
@@ -1227,9 +1358,43 @@ bool MergeFunctions::doSanityCheck(std::vector<WeakVH> &Worklist) {
 bool MergeFunctions::runOnModule(Module &M) {
   bool Changed = false;
 
+  // Hash every candidate once. A function whose hash is unique in the module
+  // cannot be equal to any other function, so it is dropped and never
+  // considered again. The hash ignores operands, so the call rewriting done
+  // by merging cannot make such a function mergeable later on.
+  // Candidates are kept in module order so that the merge order, and hence
+  // the output, does not depend on the hash values.
+  std::vector<Function *> Candidates;
+  std::vector<std::pair<FunctionComparator::FunctionHash, unsigned>> Hashes;
   for (Module::iterator I = M.begin(), E = M.end(); I != E; ++I) {
-    if (!I->isDeclaration() && !I->hasAvailableExternallyLinkage())
-      Deferred.push_back(WeakVH(I));
+    if (!I->isDeclaration() && !I->hasAvailableExternallyLinkage()) {
+      Hashes.push_back(std::make_pair(FunctionComparator::functionHash(*I),
+                                      Candidates.size()));
+      Candidates.push_back(I);
+    }
+  }
+
+  std::sort(Hashes.begin(), Hashes.end());
+  BitVector Shared(Candidates.size());
+  std::vector<std::vector<Function *>> Buckets;
+  for (unsigned i = 0, e = Hashes.size(); i != e; ++i) {
+    bool SameAsPrev = i != 0 && Hashes[i - 1].first == Hashes[i].first;
+    bool SameAsNext = i + 1 != e && Hashes[i + 1].first == Hashes[i].first;
+    if (!SameAsPrev && !SameAsNext) {
+      ++NumUniqueHashes;
+      continue;
+    }
+    if (!SameAsPrev)
+      Buckets.emplace_back();
+    Buckets.back().push_back(Candidates[Hashes[i].second]);
+    Shared.set(Hashes[i].second);
+  }
+
+  rankBuckets(M, Buckets);
+
+  for (unsigned i = 0, e = Candidates.size(); i != e; ++i) {
+    if (Shared.test(i))
+      Deferred.push_back(WeakVH(Candidates[i]));
   }
 
   do {
@@ -1270,10 +1435,69 @@ bool MergeFunctions::runOnModule(Module &M) {
   } while (!Deferred.empty());
 
   FnTree.clear();
+  Ranks.clear();
 
   return Changed;
 }
 
+/// Sort the functions of one bucket with the comparator and store the rank of
+/// each function's equivalence class, starting at 1, in BucketRanks.
+static void rankBucket(ArrayRef<Function *> Bucket,
+                       std::vector<unsigned> &BucketRanks) {
+  std::vector<unsigned> Order(Bucket.size());
+  for (unsigned i = 0, e = Bucket.size(); i != e; ++i)
+    Order[i] = i;
+  std::stable_sort(Order.begin(), Order.end(), [&](unsigned L, unsigned R) {
+    return FunctionComparator(Bucket[L], Bucket[R]).compare() == -1;
+  });
+
+  BucketRanks.resize(Bucket.size());
+  unsigned Rank = 0;
+  for (unsigned i = 0, e = Order.size(); i != e; ++i) {
+    if (i == 0 ||
+        FunctionComparator(Bucket[Order[i - 1]], Bucket[Order[i]]).compare())
+      ++Rank;
+    BucketRanks[Order[i]] = Rank;
+  }
+}
+
+void MergeFunctions::rankBuckets(
+    Module &M, std::vector<std::vector<Function *>> &Buckets) {
+  NumHashBuckets += Buckets.size();
+  std::vector<std::vector<unsigned>> BucketRanks(Buckets.size());
+
+  unsigned NumThreads = NumRankingThreads;
+  if (NumThreads == 1 || Buckets.size() < 2) {
+    for (unsigned i = 0, e = Buckets.size(); i != e; ++i)
+      rankBucket(Buckets[i], BucketRanks[i]);
+  } else {
+    // The comparator only reads the IR, except for the lazily populated
+    // caches of the DataLayout and the context. Fill those in up front: the
+    // integer type pointers are compared as, and the struct layouts used to
+    // compute constant GEP offsets.
+    const DataLayout &DL = M.getDataLayout();
+    DL.getIntPtrType(M.getContext());
+    for (auto &Bucket : Buckets)
+      for (Function *F : Bucket)
+        for (BasicBlock &BB : *F)
+          for (Instruction &I : BB)
+            if (auto *GEP = dyn_cast<GEPOperator>(&I)) {
+              APInt Offset(DL.getPointerSizeInBits(
+                               GEP->getPointerAddressSpace()), 0);
+              GEP->accumulateConstantOffset(DL, Offset);
+            }
+
+    ThreadPool Pool(NumThreads);
+    for (unsigned i = 0, e = Buckets.size(); i != e; ++i)
+      Pool.async([&, i] { rankBucket(Buckets[i], BucketRanks[i]); });
+    Pool.wait();
+  }
+
+  for (unsigned i = 0, e = Buckets.size(); i != e; ++i)
+    for (unsigned j = 0, je = Buckets[i].size(); j != je; ++j)
+      Ranks[Buckets[i][j]] = BucketRanks[i][j];
+}
+
 // Replace direct callers of Old with New.
 void MergeFunctions::replaceDirectCallers(Function *Old, Function *New) {
   Constant *BitcastNew = ConstantExpr::getBitCast(New, Old->getType());
@@ -1340,6 +1564,7 @@ void MergeFunctions::writeThunk(Function *F, Function *G) {
   // If G was internal then we may have replaced all uses of G with F. If so,
   // stop here and delete G. There's no need for a thunk.
   if (G->hasLocalLinkage() && G->use_empty()) {
+    Ranks.erase(G);
     G->eraseFromParent();
     return;
   }
@@ -1371,6 +1596,7 @@ void MergeFunctions::writeThunk(Function *F, Function *G) {
   NewG->takeName(G);
   removeUsers(G);
   G->replaceAllUsesWith(NewG);
+  Ranks.erase(G);
   G->eraseFromParent();
 
   DEBUG(dbgs() << "writeThunk: " << NewG->getName() << '\n');
@@ -1386,6 +1612,7 @@ void MergeFunctions::writeAlias(Function *F, Function *G) {
   GA->setVisibility(G->getVisibility());
   removeUsers(G);
   G->replaceAllUsesWith(GA);
+  Ranks.erase(G);
   G->eraseFromParent();
 
   DEBUG(dbgs() << "writeAlias: " << GA->getName() << '\n');
@@ -1444,7 +1671,7 @@ void MergeFunctions::replaceFunctionInTree(FnTreeType::iterator &IterToF,
 // that was already inserted.
 bool MergeFunctions::insert(Function *NewFunction) {
   std::pair<FnTreeType::iterator, bool> Result =
-      FnTree.insert(FunctionNode(NewFunction));
+      FnTree.insert(FunctionNode(NewFunction, Ranks.lookup(NewFunction)));
 
   if (Result.second) {
     DEBUG(dbgs() << "Inserting as unique: " << NewFunction->getName() << '\n');
@@ -1495,6 +1722,9 @@ bool MergeFunctions::insert(Function *NewFunction) {
 // Remove a function from FnTree. If it was already in FnTree, add
 // it to Deferred so that we'll look at it in the next round.
 void MergeFunctions::remove(Function *F) {
+  // F is about to be modified, so its rank is no longer meaningful.
+  Ranks.erase(F);
+
   // We need to make sure we remove F, not a function "equal" to F per the
   // function equality comparator.
   FnTreeType::iterator found = FnTree.find(FunctionNode(F));
@@ -25,6 +25,7 @@
 #include "llvm/Analysis/TargetLibraryInfo.h"
 #include "llvm/Target/TargetMachine.h"
 #include "llvm/Transforms/IPO.h"
+#include "llvm/Transforms/Instrumentation.h"
 #include "llvm/Transforms/Scalar.h"
 #include "llvm/Transforms/Vectorize.h"
 
@@ -89,6 +90,31 @@ static cl::opt<bool> EnableLoopDistribute(
     "enable-loop-distribute", cl::init(false), cl::Hidden,
     cl::desc("Enable the new, experimental LoopDistribution Pass"));
 
+static cl::opt<bool> EnableLoopVersioningLICM(
+    "enable-loop-versioning-licm", cl::init(false), cl::Hidden,
+    cl::desc("Version loops on alias checks to enable LICM of invariant "
+             "memory accesses"));
+
+static cl::opt<bool> EnableBoundsCheckElim(
+    "enable-bounds-check-elim", cl::init(false), cl::Hidden,
+    cl::desc("Remove bounds checks in loops before vectorization"));
+
+static cl::opt<bool> EnableHotColdSplit(
+    "hot-cold-split", cl::init(false), cl::Hidden,
+    cl::desc("Outline cold regions of functions into separate functions"));
+
+static cl::opt<bool> EnableFunctionOrdering(
+    "enable-function-ordering", cl::init(false), cl::Hidden,
+    cl::desc("Order functions by call-chain clustering of profile data"));
+
+static cl::opt<bool> RunIndirectCallProfiling(
+    "profile-indirect-calls", cl::init(false), cl::Hidden,
+    cl::desc("Instrument the targets of indirect calls"));
+
+static cl::opt<std::string> IndirectCallProfileUse(
+    "icall-profile-use", cl::init(""), cl::Hidden, cl::value_desc("filename"),
+    cl::desc("Promote hot indirect calls using this indexed profile"));
+
 PassManagerBuilder::PassManagerBuilder() {
     OptLevel = 2;
     SizeLevel = 0;
@@ -105,6 +131,8 @@ PassManagerBuilder::PassManagerBuilder() {
     VerifyInput = false;
     VerifyOutput = false;
     MergeFunctions = false;
+    ProfileIndirectCalls = RunIndirectCallProfiling;
+    IndirectCallProfile = IndirectCallProfileUse;
 }
 
 PassManagerBuilder::~PassManagerBuilder() {
@@ -169,8 +197,23 @@ void PassManagerBuilder::populateFunctionPassManager(
   FPM.add(createLowerExpectIntrinsicPass());
 }
 
+void PassManagerBuilder::addIndirectCallProfilePasses(
+    legacy::PassManagerBase &MPM) {
+  // Both passes number the indirect call sites of a function in order, so
+  // they must see the same IR: run them first, on the output of the function
+  // simplification pipeline.
+  if (ProfileIndirectCalls) {
+    MPM.add(createIndirectCallProfilingPass());
+    MPM.add(createInstrProfilingPass());
+  }
+  if (!IndirectCallProfile.empty() && OptLevel > 0)
+    MPM.add(createIndirectCallPromotionPass(IndirectCallProfile));
+}
+
 void PassManagerBuilder::populateModulePassManager(
     legacy::PassManagerBase &MPM) {
+  addIndirectCallProfilePasses(MPM);
+
   // If all optimizations are disabled, just run the always-inline pass and,
   // if enabled, the function merging pass.
   if (OptLevel == 0) {
@@ -331,6 +374,18 @@ void PassManagerBuilder::populateModulePassManager(
   if (EnableLoopDistribute)
     MPM.add(createLoopDistributePass());
 
+  // Version loops whose invariant loads and stores may alias the rest of the
+  // loop, and let LICM promote them in the checked copy.
+  if (EnableLoopVersioningLICM) {
+    MPM.add(createLoopVersioningLICMPass());
+    MPM.add(createLICMPass());
+  }
+
+  // Remove the bounds checks which would keep the vectorizer from handling
+  // a loop, versioning the loop on the checks if necessary.
+  if (EnableBoundsCheckElim)
+    MPM.add(createBoundsCheckEliminationPass());
+
   MPM.add(createLoopVectorizePass(DisableUnrollLoops, LoopVectorize));
   // FIXME: Because of #pragma vectorize enable, the passes below are always
   // inserted in the pipeline, even when the vectorizer doesn't run (ex. when
@@ -413,6 +468,14 @@ void PassManagerBuilder::populateModulePassManager(
   if (MergeFunctions)
     MPM.add(createMergeFunctionsPass());
 
+  // Outline cold code last, once the shape of the hot code is final.
+  if (EnableHotColdSplit && OptLevel > 1)
+    MPM.add(createHotColdSplittingPass());
+
+  // Lay out functions once no more functions are going to be added.
+  if (EnableFunctionOrdering && OptLevel > 1)
+    MPM.add(createFunctionOrderingPass());
+
   addExtensionsToPM(EP_OptimizerLast, MPM);
 }
 
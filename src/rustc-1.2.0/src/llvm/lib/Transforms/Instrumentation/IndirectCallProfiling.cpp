@@ -0,0 +1,450 @@
+//===- IndirectCallProfiling.cpp - Profile and promote indirect calls -----===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This file implements two passes which work together to turn hot indirect
+// calls, such as calls through vtables or trait objects, into direct calls
+// that the inliner can see through.
+//
+// The instrumentation pass gives every function an entry counter and records
+// the target of each of its indirect calls, using the instrprof_increment and
+// instrprof_value_profile intrinsics. The profiling runtime keeps the most
+// frequent targets of each call site, and llvm-profdata merges them into the
+// indexed profile.
+//
+// The promotion pass reads the indexed profile and rewrites call sites whose
+// profile is dominated by one or two targets into guarded direct calls:
+//
+//   if (callee == @target) call @target(...) else call callee(...)
+//
+// Call sites are identified by their position in the function, so both passes
+// must run at the same point of the pipeline.
+//
+//===----------------------------------------------------------------------===//
+
+#include "llvm/Transforms/Instrumentation.h"
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/Statistic.h"
+#include "llvm/IR/CallSite.h"
+#include "llvm/IR/IRBuilder.h"
+#include "llvm/IR/InlineAsm.h"
+#include "llvm/IR/Instructions.h"
+#include "llvm/IR/Intrinsics.h"
+#include "llvm/IR/LLVMContext.h"
+#include "llvm/IR/MDBuilder.h"
+#include "llvm/IR/Module.h"
+#include "llvm/Pass.h"
+#include "llvm/ProfileData/InstrProfReader.h"
+#include "llvm/Support/CommandLine.h"
+#include "llvm/Support/Debug.h"
+#include "llvm/Support/raw_ostream.h"
+#include "llvm/Transforms/Utils/BasicBlockUtils.h"
+using namespace llvm;
+
+#define DEBUG_TYPE "icall-promotion"
+
+static cl::opt<std::string>
+ICPProfileFile("icall-promotion-profile", cl::init(""),
+               cl::value_desc("filename"), cl::Hidden,
+               cl::desc("Indexed profile used to promote indirect calls"));
+
+static cl::opt<unsigned>
+ICPMinCount("icall-promotion-min-count", cl::init(1000), cl::Hidden,
+            cl::desc("Minimum number of calls to a target before it is "
+                     "promoted"));
+
+static cl::opt<unsigned>
+ICPMinPercent("icall-promotion-min-percent", cl::init(30), cl::Hidden,
+              cl::desc("Minimum percentage of a call site's profiled calls "
+                       "which must go to a target for it to be promoted"));
+
+static cl::opt<unsigned>
+ICPMaxTargets("icall-promotion-max-targets", cl::init(2), cl::Hidden,
+              cl::desc("Maximum number of targets promoted at a call site"));
+
+STATISTIC(NumSitesProfiled, "Number of indirect call sites instrumented");
+STATISTIC(NumTargetsPromoted, "Number of indirect call targets promoted");
+STATISTIC(NumSitesPromoted, "Number of indirect call sites promoted");
+
+/// Collect the indirect calls of \p F, in the order which numbers the value
+/// profiling sites.
+static void findIndirectCalls(Function &F,
+                              SmallVectorImpl<Instruction *> &Calls) {
+  for (BasicBlock &BB : F)
+    for (Instruction &I : BB) {
+      CallSite CS(&I);
+      if (!CS || CS.getCalledFunction())
+        continue;
+      // Calls through constants, e.g. bitcast functions, and inline asm
+      // aren't dynamic dispatch.
+      if (isa<Constant>(CS.getCalledValue()->stripPointerCasts()) ||
+          isa<InlineAsm>(CS.getCalledValue()))
+        continue;
+      Calls.push_back(&I);
+    }
+}
+
+/// The hash of the profile records of this instrumentation. It includes the
+/// number of indirect call sites, so that stale profiles are not applied to
+/// the wrong calls.
+static uint64_t getICallProfileHash(unsigned NumSites) {
+  return (uint64_t(0x1ca11) << 32) | NumSites;
+}
+
+namespace {
+class IndirectCallProfiling : public ModulePass {
+public:
+  static char ID;
+  IndirectCallProfiling() : ModulePass(ID) {
+    initializeIndirectCallProfilingPass(*PassRegistry::getPassRegistry());
+  }
+
+  const char *getPassName() const override {
+    return "Indirect call target profiling";
+  }
+
+  bool runOnModule(Module &M) override;
+
+private:
+  void instrumentFunction(Function &F);
+};
+
+class IndirectCallPromotion : public ModulePass {
+public:
+  static char ID;
+  IndirectCallPromotion(StringRef ProfileFile = "")
+      : ModulePass(ID),
+        ProfileFile(ProfileFile.empty() ? ICPProfileFile : ProfileFile) {
+    initializeIndirectCallPromotionPass(*PassRegistry::getPassRegistry());
+  }
+
+  const char *getPassName() const override {
+    return "Indirect call promotion";
+  }
+
+  bool runOnModule(Module &M) override;
+
+private:
+  bool promoteCallSites(Function &F, IndexedInstrProfReader &Reader);
+
+  std::string ProfileFile;
+  /// The functions of the module, by the hash of their name.
+  DenseMap<uint64_t, Function *> FunctionsByHash;
+};
+} // end anonymous namespace
+
+char IndirectCallProfiling::ID = 0;
+INITIALIZE_PASS(IndirectCallProfiling, "icall-profile",
+                "Profile indirect call targets", false, false)
+
+ModulePass *llvm::createIndirectCallProfilingPass() {
+  return new IndirectCallProfiling();
+}
+
+char IndirectCallPromotion::ID = 0;
+INITIALIZE_PASS(IndirectCallPromotion, "icall-promotion",
+                "Promote profiled indirect calls to direct calls", false,
+                false)
+
+ModulePass *llvm::createIndirectCallPromotionPass(StringRef ProfileFile) {
+  return new IndirectCallPromotion(ProfileFile);
+}
+
+//===----------------------------------------------------------------------===//
+// Instrumentation
+//===----------------------------------------------------------------------===//
+
+bool IndirectCallProfiling::runOnModule(Module &M) {
+  bool Changed = false;
+  for (Function &F : M) {
+    if (F.isDeclaration() || F.hasAvailableExternallyLinkage() ||
+        F.getName().startswith("__llvm_profile_"))
+      continue;
+    instrumentFunction(F);
+    Changed = true;
+  }
+  return Changed;
+}
+
+void IndirectCallProfiling::instrumentFunction(Function &F) {
+  SmallVector<Instruction *, 8> Calls;
+  findIndirectCalls(F, Calls);
+
+  Module *M = F.getParent();
+  LLVMContext &Ctx = M->getContext();
+  auto *Int8PtrTy = Type::getInt8PtrTy(Ctx);
+  auto *Int64Ty = Type::getInt64Ty(Ctx);
+
+  // Every function gets a record, even without indirect calls of its own, so
+  // that its address can be mapped back to its name when it is a target.
+  Constant *NameConst = ConstantDataArray::getString(Ctx, F.getName(), false);
+  auto *NameVar =
+      new GlobalVariable(*M, NameConst->getType(), true,
+                         GlobalValue::PrivateLinkage, NameConst,
+                         "__llvm_profile_name_" + F.getName());
+  Constant *Name = ConstantExpr::getBitCast(NameVar, Int8PtrTy);
+  Constant *Hash = ConstantInt::get(Int64Ty, getICallProfileHash(Calls.size()));
+
+  IRBuilder<> Builder(F.getEntryBlock().getFirstInsertionPt());
+  Builder.CreateCall(
+      Intrinsic::getDeclaration(M, Intrinsic::instrprof_increment),
+      {Name, Hash, Builder.getInt32(1), Builder.getInt32(0)});
+
+  Function *ValueProfile =
+      Intrinsic::getDeclaration(M, Intrinsic::instrprof_value_profile);
+  for (unsigned I = 0, E = Calls.size(); I != E; ++I) {
+    Builder.SetInsertPoint(Calls[I]);
+    Value *Callee = CallSite(Calls[I]).getCalledValue();
+    Builder.CreateCall(ValueProfile,
+                       {Name, Hash, Builder.CreatePtrToInt(Callee, Int64Ty),
+                        Builder.getInt32(IPVK_IndirectCallTarget),
+                        Builder.getInt32(I)});
+    ++NumSitesProfiled;
+  }
+}
+
+//===----------------------------------------------------------------------===//
+// Promotion
+//===----------------------------------------------------------------------===//
+
+/// Return true if a call with the signature of \p CS can be redirected to
+/// \p Target. Pointer arguments and results may be cast, since calling
+/// through a function pointer of a different pointer type passes them the
+/// same way.
+static bool isLegalToPromote(CallSite CS, Function *Target) {
+  FunctionType *CallTy = CS.getFunctionType();
+  FunctionType *TargetTy = Target->getFunctionType();
+  if (CallTy == TargetTy)
+    return true;
+  if (CallTy->getNumParams() != TargetTy->getNumParams() ||
+      CallTy->isVarArg() != TargetTy->isVarArg())
+    return false;
+
+  auto IsCompatible = [](Type *From, Type *To) {
+    return From == To || (From->isPointerTy() && To->isPointerTy() &&
+                          From->getPointerAddressSpace() ==
+                              To->getPointerAddressSpace());
+  };
+  Type *RetTy = CallTy->getReturnType();
+  // An invoke's result is only available in its normal destination, where
+  // there is nowhere to cast it.
+  if (RetTy != TargetTy->getReturnType() &&
+      (CS.isInvoke() || !IsCompatible(TargetTy->getReturnType(), RetTy)))
+    return false;
+  for (unsigned I = 0, E = CallTy->getNumParams(); I != E; ++I)
+    if (!IsCompatible(CallTy->getParamType(I), TargetTy->getParamType(I)))
+      return false;
+  return true;
+}
+
+/// Create a direct call to \p Target before \p InsertBefore, with the
+/// arguments, attributes and metadata of \p Inst, casting the arguments as
+/// needed.
+static Instruction *createDirectCall(Instruction *Inst, Function *Target,
+                                     Instruction *InsertBefore) {
+  CallSite CS(Inst);
+  FunctionType *TargetTy = Target->getFunctionType();
+  if (CS.getFunctionType() == TargetTy) {
+    Instruction *Direct = Inst->clone();
+    Direct->insertBefore(InsertBefore);
+    CallSite(Direct).setCalledFunction(Target);
+    return Direct;
+  }
+
+  // The type of a call is that of its callee, so a call of another type has
+  // to be rebuilt.
+  SmallVector<Value *, 8> Args;
+  for (unsigned I = 0, E = TargetTy->getNumParams(); I != E; ++I) {
+    Value *Arg = CS.getArgument(I);
+    if (Arg->getType() != TargetTy->getParamType(I))
+      Arg = new BitCastInst(Arg, TargetTy->getParamType(I), "", InsertBefore);
+    Args.push_back(Arg);
+  }
+  Instruction *Direct;
+  if (auto *CI = dyn_cast<CallInst>(Inst)) {
+    auto *NewCI = CallInst::Create(Target, Args, "", InsertBefore);
+    NewCI->setTailCallKind(CI->getTailCallKind());
+    Direct = NewCI;
+  } else {
+    auto *II = cast<InvokeInst>(Inst);
+    Direct = InvokeInst::Create(Target, II->getNormalDest(),
+                                II->getUnwindDest(), Args, "", InsertBefore);
+  }
+  CallSite NewCS(Direct);
+  NewCS.setCallingConv(CS.getCallingConv());
+  NewCS.setAttributes(CS.getAttributes());
+  SmallVector<std::pair<unsigned, MDNode *>, 4> MDs;
+  Inst->getAllMetadata(MDs);
+  for (const auto &MD : MDs)
+    Direct->setMetadata(MD.first, MD.second);
+  return Direct;
+}
+
+/// Scale \p Taken and \p NotTaken down to fit the 32-bit branch weights.
+static MDNode *createBranchWeights(LLVMContext &Ctx, uint64_t Taken,
+                                   uint64_t NotTaken) {
+  uint64_t Scale = std::max(Taken, NotTaken) / UINT32_MAX + 1;
+  return MDBuilder(Ctx).createBranchWeights(uint32_t(Taken / Scale),
+                                            uint32_t(NotTaken / Scale));
+}
+
+/// Guard \p Inst with a comparison of its callee against \p Target, and call
+/// \p Target directly when they match. \p Inst stays in place as the
+/// fall-back indirect call.
+static void promoteCall(Instruction *Inst, Function *Target, uint64_t Count,
+                        uint64_t Rest) {
+  CallSite CS(Inst);
+  BasicBlock *OrigBB = Inst->getParent();
+  Function *F = OrigBB->getParent();
+  LLVMContext &Ctx = F->getContext();
+
+  Value *Callee = CS.getCalledValue();
+  IRBuilder<> Builder(Inst);
+  Value *Cond = Builder.CreateICmpEQ(
+      Callee, ConstantExpr::getBitCast(Target, Callee->getType()),
+      "icp.cmp");
+  MDNode *Weights = createBranchWeights(Ctx, Count, Rest);
+
+  if (isa<CallInst>(Inst)) {
+    TerminatorInst *ThenTerm, *ElseTerm;
+    SplitBlockAndInsertIfThenElse(Cond, Inst, &ThenTerm, &ElseTerm, Weights);
+    BasicBlock *Tail = Inst->getParent();
+    // Name the blocks like those of a promoted invoke.
+    ThenTerm->getParent()->setName("icp.direct");
+    ElseTerm->getParent()->setName("icp.indirect");
+    Tail->setName("icp.merge");
+    Instruction *Direct = createDirectCall(Inst, Target, ThenTerm);
+    Inst->moveBefore(ElseTerm);
+    if (Inst->getType()->isVoidTy())
+      return;
+    Value *Result = Direct;
+    if (Direct->getType() != Inst->getType())
+      Result = new BitCastInst(Direct, Inst->getType(), "", ThenTerm);
+    PHINode *PN = PHINode::Create(Inst->getType(), 2, "", Tail->begin());
+    Inst->replaceAllUsesWith(PN);
+    PN->addIncoming(Result, ThenTerm->getParent());
+    PN->addIncoming(Inst, ElseTerm->getParent());
+    return;
+  }
+
+  // For an invoke, both versions continue to a new block which merges their
+  // results before the original normal destination:
+  //
+  //   OrigBB: br %icp.cmp, %icp.direct, %icp.indirect
+  //   icp.direct: invoke @target to %icp.merge unwind %lpad
+  //   icp.indirect: invoke %callee to %icp.merge unwind %lpad
+  //   icp.merge: br %normal
+  InvokeInst *II = cast<InvokeInst>(Inst);
+  BasicBlock *NormalDest = II->getNormalDest();
+  BasicBlock *UnwindDest = II->getUnwindDest();
+  BasicBlock *MergeBB =
+      BasicBlock::Create(Ctx, "icp.merge", F, OrigBB->getNextNode());
+  BasicBlock *IndirectBB = BasicBlock::Create(Ctx, "icp.indirect", F, MergeBB);
+  BasicBlock *DirectBB = BasicBlock::Create(Ctx, "icp.direct", F, IndirectBB);
+
+  BranchInst *Br = BranchInst::Create(NormalDest, MergeBB);
+  II->removeFromParent();
+  IndirectBB->getInstList().push_back(II);
+  BranchInst::Create(DirectBB, IndirectBB, Cond, OrigBB)
+      ->setMetadata(LLVMContext::MD_prof, Weights);
+  auto *Direct = cast<InvokeInst>(
+      createDirectCall(II, Target, BranchInst::Create(MergeBB, DirectBB)));
+  DirectBB->getTerminator()->eraseFromParent();
+  II->setNormalDest(MergeBB);
+  Direct->setNormalDest(MergeBB);
+
+  for (auto I = NormalDest->begin(); PHINode *PN = dyn_cast<PHINode>(I); ++I)
+    PN->setIncomingBlock(PN->getBasicBlockIndex(OrigBB), MergeBB);
+  for (auto I = UnwindDest->begin(); PHINode *PN = dyn_cast<PHINode>(I); ++I) {
+    int Idx = PN->getBasicBlockIndex(OrigBB);
+    PN->setIncomingBlock(Idx, IndirectBB);
+    PN->addIncoming(PN->getIncomingValue(Idx), DirectBB);
+  }
+
+  if (II->getType()->isVoidTy())
+    return;
+  PHINode *PN = PHINode::Create(II->getType(), 2, "", Br);
+  II->replaceAllUsesWith(PN);
+  PN->addIncoming(Direct, DirectBB);
+  PN->addIncoming(II, IndirectBB);
+}
+
+bool IndirectCallPromotion::runOnModule(Module &M) {
+  if (ProfileFile.empty())
+    return false;
+
+  auto ReaderOrErr = IndexedInstrProfReader::create(ProfileFile);
+  if (std::error_code EC = ReaderOrErr.getError()) {
+    M.getContext().emitError("could not read profile '" + ProfileFile +
+                             "': " + EC.message());
+    return false;
+  }
+  std::unique_ptr<IndexedInstrProfReader> Reader = std::move(ReaderOrErr.get());
+
+  FunctionsByHash.clear();
+  for (Function &F : M)
+    FunctionsByHash[getInstrProfFuncNameHash(F.getName())] = &F;
+
+  bool Changed = false;
+  for (Function &F : M)
+    if (!F.isDeclaration())
+      Changed |= promoteCallSites(F, *Reader);
+  return Changed;
+}
+
+bool IndirectCallPromotion::promoteCallSites(Function &F,
+                                             IndexedInstrProfReader &Reader) {
+  SmallVector<Instruction *, 8> Calls;
+  findIndirectCalls(F, Calls);
+  if (Calls.empty())
+    return false;
+
+  InstrProfRecord Record;
+  if (Reader.getFunctionRecord(F.getName(), getICallProfileHash(Calls.size()),
+                               Record) ||
+      Record.IndirectCallSites.size() != Calls.size())
+    return false;
+
+  bool Changed = false;
+  for (unsigned I = 0, E = Calls.size(); I != E; ++I) {
+    Instruction *Inst = Calls[I];
+    if (auto *CI = dyn_cast<CallInst>(Inst))
+      if (CI->isMustTailCall())
+        continue;
+
+    const auto &Targets = Record.IndirectCallSites[I];
+    uint64_t Total = 0;
+    for (const InstrProfValueData &Target : Targets)
+      Total += Target.Count;
+
+    unsigned NumPromoted = 0;
+    for (const InstrProfValueData &Target : Targets) {
+      if (NumPromoted == ICPMaxTargets || Target.Count < ICPMinCount ||
+          Target.Count * 100 < Total * ICPMinPercent)
+        break;
+      Function *TargetF = FunctionsByHash.lookup(Target.Value);
+      if (!TargetF || !isLegalToPromote(CallSite(Inst), TargetF)) {
+        DEBUG(dbgs() << "ICP: can't promote target " << Target.Value
+                     << " in " << F.getName() << "\n");
+        continue;
+      }
+      DEBUG(dbgs() << "ICP: promoting call to " << TargetF->getName()
+                   << " in " << F.getName() << " (" << Target.Count << " of "
+                   << Total << " calls)\n");
+      Total -= Target.Count;
+      promoteCall(Inst, TargetF, Target.Count, Total);
+      ++NumPromoted;
+      ++NumTargetsPromoted;
+    }
+    if (NumPromoted) {
+      ++NumSitesPromoted;
+      Changed = true;
+    }
+  }
+  return Changed;
+}
@@ -7,9 +7,10 @@
 //
 //===----------------------------------------------------------------------===//
 //
-// This pass lowers instrprof_increment intrinsics emitted by a frontend for
-// profiling. It also builds the data structures and initialization code needed
-// for updating execution counts and emitting the profile at runtime.
+// This pass lowers instrprof_increment and instrprof_value_profile intrinsics
+// emitted by a frontend for profiling. It also builds the data structures and
+// initialization code needed for updating execution counts and emitting the
+// profile at runtime.
 //
 //===----------------------------------------------------------------------===//
 
@@ -19,6 +20,7 @@
 #include "llvm/IR/IRBuilder.h"
 #include "llvm/IR/IntrinsicInst.h"
 #include "llvm/IR/Module.h"
+#include "llvm/ProfileData/InstrProf.h"
 #include "llvm/Transforms/Utils/ModuleUtils.h"
 
 using namespace llvm;
@@ -50,6 +52,8 @@ private:
   InstrProfOptions Options;
   Module *M;
   DenseMap<GlobalVariable *, GlobalVariable *> RegionCounters;
+  DenseMap<GlobalVariable *, GlobalVariable *> ProfileDataVars;
+  DenseMap<GlobalVariable *, uint32_t> NumValueSites;
   std::vector<Value *> UsedVars;
 
   bool isMachO() const {
@@ -71,14 +75,25 @@ private:
     return isMachO() ? "__DATA,__llvm_prf_data" : "__llvm_prf_data";
   }
 
+  /// Get the section name for the value profiling data.
+  StringRef getValuesSection() const {
+    return isMachO() ? "__DATA,__llvm_prf_vals" : "__llvm_prf_vals";
+  }
+
   /// Get the section name for the coverage mapping data.
   StringRef getCoverageSection() const {
     return isMachO() ? "__DATA,__llvm_covmap" : "__llvm_covmap";
   }
 
+  /// Count the value profiling sites of each name variable.
+  void computeNumValueSites(InstrProfValueProfileInst *Ind);
+
   /// Replace instrprof_increment with an increment of the appropriate value.
   void lowerIncrement(InstrProfIncrementInst *Inc);
 
+  /// Replace instrprof_value_profile with a call to the runtime.
+  void lowerValueProfileInst(InstrProfValueProfileInst *Ind);
+
   /// Set up the section and uses for coverage data and its references.
   void lowerCoverageData(GlobalVariable *CoverageData);
 
@@ -118,8 +133,18 @@ bool InstrProfiling::runOnModule(Module &M) {
 
   this->M = &M;
   RegionCounters.clear();
+  ProfileDataVars.clear();
+  NumValueSites.clear();
   UsedVars.clear();
 
+  // The data variables are created along with the counters, so the number of
+  // value sites must be known before lowering any increment.
+  for (Function &F : M)
+    for (BasicBlock &BB : F)
+      for (Instruction &I : BB)
+        if (auto *Ind = dyn_cast<InstrProfValueProfileInst>(&I))
+          computeNumValueSites(Ind);
+
   for (Function &F : M)
     for (BasicBlock &BB : F)
       for (auto I = BB.begin(), E = BB.end(); I != E;)
@@ -127,6 +152,13 @@ bool InstrProfiling::runOnModule(Module &M) {
           lowerIncrement(Inc);
           MadeChange = true;
         }
+  for (Function &F : M)
+    for (BasicBlock &BB : F)
+      for (auto I = BB.begin(), E = BB.end(); I != E;)
+        if (auto *Ind = dyn_cast<InstrProfValueProfileInst>(I++)) {
+          lowerValueProfileInst(Ind);
+          MadeChange = true;
+        }
   if (GlobalVariable *Coverage = M.getNamedGlobal("__llvm_coverage_mapping")) {
     lowerCoverageData(Coverage);
     MadeChange = true;
@@ -141,6 +173,38 @@ bool InstrProfiling::runOnModule(Module &M) {
   return true;
 }
 
+void InstrProfiling::computeNumValueSites(InstrProfValueProfileInst *Ind) {
+  uint32_t &NumSites = NumValueSites[Ind->getName()];
+  uint32_t Index = Ind->getIndex()->getZExtValue();
+  if (Index >= NumSites)
+    NumSites = Index + 1;
+}
+
+void InstrProfiling::lowerValueProfileInst(InstrProfValueProfileInst *Ind) {
+  auto It = ProfileDataVars.find(Ind->getName());
+  // Value sites are only recorded for names which also have counters.
+  if (It == ProfileDataVars.end()) {
+    Ind->eraseFromParent();
+    return;
+  }
+
+  LLVMContext &Ctx = M->getContext();
+  auto *VoidTy = Type::getVoidTy(Ctx);
+  auto *Int32Ty = Type::getInt32Ty(Ctx);
+  auto *Int64Ty = Type::getInt64Ty(Ctx);
+  auto *Int8PtrTy = Type::getInt8PtrTy(Ctx);
+  Constant *InstrumentF = M->getOrInsertFunction(
+      "__llvm_profile_instrument_target", VoidTy, Int64Ty, Int8PtrTy, Int32Ty,
+      nullptr);
+
+  IRBuilder<> Builder(Ind->getParent(), *Ind);
+  Value *Args[] = {Ind->getTargetValue(),
+                   Builder.CreateBitCast(It->second, Int8PtrTy),
+                   Builder.getInt32(Ind->getIndex()->getZExtValue())};
+  Ind->replaceAllUsesWith(Builder.CreateCall(InstrumentF, Args));
+  Ind->eraseFromParent();
+}
+
 void InstrProfiling::lowerIncrement(InstrProfIncrementInst *Inc) {
   GlobalVariable *Counters = getOrCreateRegionCounters(Inc);
 
@@ -226,14 +290,42 @@ InstrProfiling::getOrCreateRegionCounters(InstrProfIncrementInst *Inc) {
   auto *Int8PtrTy = Type::getInt8PtrTy(Ctx);
   auto *Int64PtrTy = Type::getInt64PtrTy(Ctx);
 
-  Type *DataTypes[] = {Int32Ty, Int32Ty, Int64Ty, Int8PtrTy, Int64PtrTy};
+  // Create the value profiling counters, if there are any value sites.
+  uint32_t NumSites = NumValueSites.lookup(Name);
+  Constant *Values = ConstantPointerNull::get(Int64PtrTy);
+  if (NumSites) {
+    ArrayType *ValuesTy = ArrayType::get(
+        Int64Ty, uint64_t(NumSites) * InstrProfValuesPerSite * 2);
+    auto *ValuesVar = new GlobalVariable(
+        *M, ValuesTy, false, Name->getLinkage(),
+        Constant::getNullValue(ValuesTy), getVarName(Inc, "values"));
+    ValuesVar->setVisibility(Name->getVisibility());
+    ValuesVar->setSection(getValuesSection());
+    ValuesVar->setAlignment(8);
+    ValuesVar->setComdat(Fn->getComdat());
+    Values = ConstantExpr::getBitCast(ValuesVar, Int64PtrTy);
+  }
+
+  // Record the function's address, so that indirect call targets can be
+  // mapped back to their names. Referring to a local function whose address
+  // isn't taken would keep it alive for nothing, as it can't be a target.
+  Constant *FunctionAddr = ConstantPointerNull::get(Int8PtrTy);
+  if (!Fn->hasAvailableExternallyLinkage() &&
+      (!Fn->hasLocalLinkage() || Fn->hasAddressTaken()))
+    FunctionAddr = ConstantExpr::getBitCast(Fn, Int8PtrTy);
+
+  Type *DataTypes[] = {Int32Ty,   Int32Ty,    Int64Ty,   Int8PtrTy,
+                       Int64PtrTy, Int8PtrTy, Int64PtrTy, Int32Ty};
   auto *DataTy = StructType::get(Ctx, makeArrayRef(DataTypes));
   Constant *DataVals[] = {
       ConstantInt::get(Int32Ty, NameArrayTy->getArrayNumElements()),
       ConstantInt::get(Int32Ty, NumCounters),
       ConstantInt::get(Int64Ty, Inc->getHash()->getZExtValue()),
       ConstantExpr::getBitCast(Name, Int8PtrTy),
-      ConstantExpr::getBitCast(Counters, Int64PtrTy)};
+      ConstantExpr::getBitCast(Counters, Int64PtrTy),
+      FunctionAddr,
+      Values,
+      ConstantInt::get(Int32Ty, NumSites)};
   auto *Data = new GlobalVariable(*M, DataTy, true, Name->getLinkage(),
                                   ConstantStruct::get(DataTy, DataVals),
                                   getVarName(Inc, "data"));
@@ -242,6 +334,8 @@ InstrProfiling::getOrCreateRegionCounters(InstrProfIncrementInst *Inc) {
   Data->setAlignment(8);
   Data->setComdat(Fn->getComdat());
 
+  ProfileDataVars[Name] = Data;
+
   // Mark the data variable as used so that it isn't stripped out.
   UsedVars.push_back(Data);
 
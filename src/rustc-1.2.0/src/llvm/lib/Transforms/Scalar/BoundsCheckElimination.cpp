@@ -0,0 +1,503 @@
+//===- BoundsCheckElimination.cpp - Remove index < length checks ----------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This pass removes bounds checks of the form
+//
+//   %ok = icmp ult i64 %idx, %len
+//   br i1 %ok, label %in.bounds, label %panic
+//
+// where %panic does not return, as emitted for slice indexing by Rust and
+// other languages with checked array accesses.
+//
+// A check is removed outright if ScalarEvolution proves %idx <u %len, or if
+// it is implied by a condition on a dominating edge, such as an earlier check
+// of the same index or a loop guard against a value no larger than %len.
+//
+// Within an innermost loop, a check whose index is an affine recurrence with
+// unit step, or which is loop invariant, reduces to a few loop-invariant
+// conditions on the first and last index of the loop. When those cannot be
+// proven statically, the loop is versioned: the conditions are tested in the
+// preheader, and the loop runs either a copy with the checks removed or the
+// original loop with the checks intact. This also lets the loop vectorizer
+// handle loops which were only blocked by their bounds checks.
+//
+//===----------------------------------------------------------------------===//
+
+#include "llvm/Transforms/Scalar.h"
+#include "llvm/ADT/MapVector.h"
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/ADT/Statistic.h"
+#include "llvm/Analysis/LoopInfo.h"
+#include "llvm/Analysis/ScalarEvolution.h"
+#include "llvm/Analysis/ScalarEvolutionExpander.h"
+#include "llvm/Analysis/ScalarEvolutionExpressions.h"
+#include "llvm/IR/CallSite.h"
+#include "llvm/IR/Dominators.h"
+#include "llvm/IR/IRBuilder.h"
+#include "llvm/IR/Instructions.h"
+#include "llvm/IR/Module.h"
+#include "llvm/Pass.h"
+#include "llvm/Support/CommandLine.h"
+#include "llvm/Support/Debug.h"
+#include "llvm/Support/raw_ostream.h"
+#include "llvm/Transforms/Utils/BasicBlockUtils.h"
+#include "llvm/Transforms/Utils/Cloning.h"
+#include "llvm/Transforms/Utils/Local.h"
+using namespace llvm;
+
+#define DEBUG_TYPE "bounds-check-elim"
+
+STATISTIC(NumChecksRemoved, "Number of bounds checks removed statically");
+STATISTIC(NumChecksVersioned, "Number of bounds checks removed by versioning");
+STATISTIC(NumLoopsVersioned, "Number of loops versioned");
+
+static cl::opt<bool>
+EnableVersioning("bce-versioning", cl::init(true), cl::Hidden,
+                 cl::desc("Version loops on bounds checks which can't be "
+                          "removed statically"));
+
+static cl::opt<unsigned>
+MaxVersioningChecks("bce-max-versioning-checks", cl::init(8), cl::Hidden,
+                    cl::desc("Maximum number of runtime conditions tested "
+                             "before a versioned loop"));
+
+static cl::opt<unsigned>
+MaxVersionedLoopSize("bce-max-loop-size", cl::init(256), cl::Hidden,
+                     cl::desc("Maximum number of instructions in a loop "
+                              "that is duplicated for versioning"));
+
+static cl::opt<unsigned>
+MaxDominatorDepth("bce-dom-depth", cl::init(16), cl::Hidden,
+                  cl::desc("Number of dominating blocks searched for a "
+                           "condition implying a bounds check"));
+
+namespace {
+/// \brief A conditional branch which continues on Idx <u Len and otherwise
+/// goes to a block which doesn't return.
+struct BoundsCheck {
+  BranchInst *Branch;
+  unsigned InBoundsSucc;
+  const SCEV *Idx;
+  const SCEV *Len;
+};
+
+/// \brief A loop-invariant condition LHS Pred RHS which, if it holds on
+/// entry to a loop, makes a bounds check in the loop redundant.
+struct RangeCondition {
+  ICmpInst::Predicate Pred;
+  const SCEV *LHS;
+  const SCEV *RHS;
+};
+
+/// \brief The bounds checks of one loop which are removed by versioning it.
+struct VersioningInfo {
+  SmallVector<BoundsCheck *, 4> Checks;
+  SmallVector<RangeCondition, 8> Conditions;
+};
+
+struct BoundsCheckElimination : public FunctionPass {
+  static char ID; // Pass identification, replacement for typeid
+  BoundsCheckElimination() : FunctionPass(ID) {
+    initializeBoundsCheckEliminationPass(*PassRegistry::getPassRegistry());
+  }
+
+  bool runOnFunction(Function &F) override;
+
+  void getAnalysisUsage(AnalysisUsage &AU) const override {
+    AU.addRequiredID(LoopSimplifyID);
+    AU.addRequiredID(LCSSAID);
+    AU.addRequired<DominatorTreeWrapperPass>();
+    AU.addRequired<LoopInfoWrapperPass>();
+    AU.addRequired<ScalarEvolution>();
+    AU.addPreserved<DominatorTreeWrapperPass>();
+    AU.addPreserved<LoopInfoWrapperPass>();
+  }
+
+private:
+  bool matchBoundsCheck(BranchInst *BI, BoundsCheck &Check);
+  bool isImpliedByDominatingCondition(const BoundsCheck &Check);
+  const SCEV *getIterationLimit(Loop *L);
+  bool getLoopConditions(const BoundsCheck &Check, Loop *L,
+                         SmallVectorImpl<RangeCondition> &Conditions);
+  bool canVersionLoop(Loop *L);
+  void versionLoop(Loop *L, VersioningInfo &Info);
+
+  DominatorTree *DT;
+  LoopInfo *LI;
+  ScalarEvolution *SE;
+
+  /// Branches whose in-bounds successor is taken unconditionally, paired
+  /// with that successor.
+  SmallVector<std::pair<BranchInst *, unsigned>, 16> ToFold;
+};
+}
+
+char BoundsCheckElimination::ID = 0;
+INITIALIZE_PASS_BEGIN(BoundsCheckElimination, "bounds-check-elim",
+                      "Bounds Check Elimination", false, false)
+INITIALIZE_PASS_DEPENDENCY(DominatorTreeWrapperPass)
+INITIALIZE_PASS_DEPENDENCY(LoopInfoWrapperPass)
+INITIALIZE_PASS_DEPENDENCY(ScalarEvolution)
+INITIALIZE_PASS_DEPENDENCY(LoopSimplify)
+INITIALIZE_PASS_DEPENDENCY(LCSSA)
+INITIALIZE_PASS_END(BoundsCheckElimination, "bounds-check-elim",
+                    "Bounds Check Elimination", false, false)
+
+FunctionPass *llvm::createBoundsCheckEliminationPass() {
+  return new BoundsCheckElimination();
+}
+
+/// \brief Return true if control entering \p BB never comes back, such as
+/// a call to a panic function.
+static bool isPanicBlock(const BasicBlock *BB) {
+  const TerminatorInst *TI = BB->getTerminator();
+  if (isa<UnreachableInst>(TI))
+    return true;
+  // A panic which may unwind through cleanups is an invoke, whose normal
+  // destination is never reached.
+  if (const InvokeInst *II = dyn_cast<InvokeInst>(TI))
+    return II->doesNotReturn();
+  return false;
+}
+
+bool BoundsCheckElimination::matchBoundsCheck(BranchInst *BI,
+                                              BoundsCheck &Check) {
+  if (!BI->isConditional())
+    return false;
+  ICmpInst *Cmp = dyn_cast<ICmpInst>(BI->getCondition());
+  if (!Cmp || !Cmp->getOperand(0)->getType()->isIntegerTy())
+    return false;
+
+  bool TruePanics = isPanicBlock(BI->getSuccessor(0));
+  bool FalsePanics = isPanicBlock(BI->getSuccessor(1));
+  if (TruePanics == FalsePanics)
+    return false;
+
+  // Normalize to the condition under which the in-bounds successor is taken.
+  Check.Branch = BI;
+  Check.InBoundsSucc = TruePanics ? 1 : 0;
+  ICmpInst::Predicate Pred =
+      TruePanics ? Cmp->getInversePredicate() : Cmp->getPredicate();
+  Value *Idx = Cmp->getOperand(0), *Len = Cmp->getOperand(1);
+  if (Pred == ICmpInst::ICMP_UGT) {
+    std::swap(Idx, Len);
+    Pred = ICmpInst::ICMP_ULT;
+  }
+  if (Pred != ICmpInst::ICMP_ULT)
+    return false;
+
+  Check.Idx = SE->getSCEV(Idx);
+  Check.Len = SE->getSCEV(Len);
+  return true;
+}
+
+bool BoundsCheckElimination::isImpliedByDominatingCondition(
+    const BoundsCheck &Check) {
+  BasicBlock *BB = Check.Branch->getParent();
+  Type *Ty = Check.Idx->getType();
+  DomTreeNode *Node = DT->getNode(BB);
+  if (!Node)
+    return false;
+  for (unsigned Depth = 0; Depth != MaxDominatorDepth && Node->getIDom();
+       ++Depth) {
+    Node = Node->getIDom();
+    BasicBlock *Dom = Node->getBlock();
+    BranchInst *BI = dyn_cast<BranchInst>(Dom->getTerminator());
+    if (!BI || !BI->isConditional() ||
+        BI->getSuccessor(0) == BI->getSuccessor(1))
+      continue;
+    ICmpInst *Cmp = dyn_cast<ICmpInst>(BI->getCondition());
+    if (!Cmp || Cmp->getOperand(0)->getType() != Ty)
+      continue;
+
+    for (unsigned Succ = 0; Succ != 2; ++Succ) {
+      if (!DT->dominates(BasicBlockEdge(Dom, BI->getSuccessor(Succ)), BB))
+        continue;
+      // A <pred> B is known to hold in BB.
+      ICmpInst::Predicate Pred =
+          Succ == 0 ? Cmp->getPredicate() : Cmp->getInversePredicate();
+      const SCEV *A = SE->getSCEV(Cmp->getOperand(0));
+      const SCEV *B = SE->getSCEV(Cmp->getOperand(1));
+      if (Pred == ICmpInst::ICMP_UGT || Pred == ICmpInst::ICMP_UGE) {
+        std::swap(A, B);
+        Pred = ICmpInst::getSwappedPredicate(Pred);
+      }
+
+      // Idx <=u A <u B <=u Len, or a variant with A <=u B where one of the
+      // outer comparisons is strict.
+      if (Pred == ICmpInst::ICMP_ULT &&
+          SE->isKnownPredicate(ICmpInst::ICMP_ULE, Check.Idx, A) &&
+          SE->isKnownPredicate(ICmpInst::ICMP_ULE, B, Check.Len))
+        return true;
+      if (Pred == ICmpInst::ICMP_ULE &&
+          ((SE->isKnownPredicate(ICmpInst::ICMP_ULT, Check.Idx, A) &&
+            SE->isKnownPredicate(ICmpInst::ICMP_ULE, B, Check.Len)) ||
+           (SE->isKnownPredicate(ICmpInst::ICMP_ULE, Check.Idx, A) &&
+            SE->isKnownPredicate(ICmpInst::ICMP_ULT, B, Check.Len))))
+        return true;
+    }
+  }
+  return false;
+}
+
+/// \brief Return an upper bound on the number of times the backedge of \p L
+/// is taken, or null if there is none.
+///
+/// Only exits which don't panic are used, since the panicking exits are the
+/// ones being removed.
+const SCEV *BoundsCheckElimination::getIterationLimit(Loop *L) {
+  BasicBlock *Latch = L->getLoopLatch();
+  if (!Latch)
+    return nullptr;
+  SmallVector<BasicBlock *, 8> Exiting;
+  L->getExitingBlocks(Exiting);
+  for (BasicBlock *BB : Exiting) {
+    // An exit which is not taken on every iteration doesn't bound the trip
+    // count.
+    if (!DT->dominates(BB, Latch))
+      continue;
+    bool Panics = false;
+    for (BasicBlock *Succ : successors(BB))
+      Panics |= !L->contains(Succ) && isPanicBlock(Succ);
+    if (Panics)
+      continue;
+    const SCEV *Count = SE->getExitCount(L, BB);
+    if (!isa<SCEVCouldNotCompute>(Count))
+      return Count;
+  }
+  return nullptr;
+}
+
+/// \brief Compute loop-invariant conditions which, if true on entry to \p L,
+/// imply that \p Check passes on every iteration. Conditions which are known
+/// to hold are left out, so an empty result means the check always passes.
+bool BoundsCheckElimination::getLoopConditions(
+    const BoundsCheck &Check, Loop *L,
+    SmallVectorImpl<RangeCondition> &Conditions) {
+  if (!SE->isLoopInvariant(Check.Len, L))
+    return false;
+
+  SmallVector<RangeCondition, 2> Required;
+  if (SE->isLoopInvariant(Check.Idx, L)) {
+    Required.push_back({ICmpInst::ICMP_ULT, Check.Idx, Check.Len});
+  } else {
+    const SCEVAddRecExpr *AR = dyn_cast<SCEVAddRecExpr>(Check.Idx);
+    if (!AR || AR->getLoop() != L || !AR->isAffine())
+      return false;
+    const SCEVConstant *Step =
+        dyn_cast<SCEVConstant>(AR->getStepRecurrence(*SE));
+    if (!Step || (!Step->getValue()->isOne() &&
+                  !Step->getValue()->isAllOnesValue()))
+      return false;
+
+    const SCEV *Count = getIterationLimit(L);
+    if (!Count)
+      return false;
+    Type *Ty = AR->getType();
+    if (SE->getTypeSizeInBits(Count->getType()) > SE->getTypeSizeInBits(Ty))
+      return false;
+    Count = SE->getNoopOrZeroExtend(Count, Ty);
+
+    // The index takes every value between the first and the last one, as
+    // long as it doesn't wrap around on the way.
+    const SCEV *First = AR->getStart();
+    const SCEV *Last = AR->evaluateAtIteration(Count, *SE);
+    if (Step->getValue()->isOne()) {
+      Required.push_back({ICmpInst::ICMP_ULE, First, Last});
+      Required.push_back({ICmpInst::ICMP_ULT, Last, Check.Len});
+    } else {
+      Required.push_back({ICmpInst::ICMP_ULE, Last, First});
+      Required.push_back({ICmpInst::ICMP_ULT, First, Check.Len});
+    }
+  }
+
+  for (const RangeCondition &C : Required)
+    if (!SE->isKnownPredicate(C.Pred, C.LHS, C.RHS) &&
+        !SE->isLoopEntryGuardedByCond(L, C.Pred, C.LHS, C.RHS))
+      Conditions.push_back(C);
+  return true;
+}
+
+bool BoundsCheckElimination::canVersionLoop(Loop *L) {
+  if (!L->isLoopSimplifyForm() || !L->isLCSSAForm(*DT))
+    return false;
+  unsigned Size = 0;
+  for (BasicBlock *BB : L->getBlocks()) {
+    if (isa<IndirectBrInst>(BB->getTerminator()))
+      return false;
+    for (Instruction &I : *BB) {
+      if (CallInst *CI = dyn_cast<CallInst>(&I))
+        if (CI->cannotDuplicate())
+          return false;
+      if (++Size > MaxVersionedLoopSize)
+        return false;
+    }
+  }
+  return true;
+}
+
+/// \brief Version \p L on the runtime conditions in \p Info.
+///
+/// The original loop becomes the fast version, whose checks are folded; the
+/// slow version is a clone which keeps them.
+void BoundsCheckElimination::versionLoop(Loop *L, VersioningInfo &Info) {
+  BasicBlock *CheckBB = L->getLoopPreheader();
+  SmallVector<BasicBlock *, 8> ExitBlocks;
+  L->getUniqueExitBlocks(ExitBlocks);
+
+  // Expand the conditions at the end of the preheader.
+  SCEVExpander Exp(*SE, CheckBB->getModule()->getDataLayout(), "bce");
+  Instruction *Term = CheckBB->getTerminator();
+  IRBuilder<> Builder(Term);
+  Value *Cond = nullptr;
+  for (const RangeCondition &C : Info.Conditions) {
+    Value *LHS = Exp.expandCodeFor(C.LHS, C.LHS->getType(), Term);
+    Value *RHS = Exp.expandCodeFor(C.RHS, C.RHS->getType(), Term);
+    Value *Cmp = Builder.CreateICmp(C.Pred, LHS, RHS, "bce.cond");
+    Cond = Cond ? Builder.CreateAnd(Cond, Cmp, "bce.conds") : Cmp;
+  }
+  CheckBB->setName(L->getHeader()->getName() + ".bce.check");
+
+  // Create an empty preheader for the loop, and clone the loop including it.
+  BasicBlock *PH = SplitBlock(CheckBB, Term, DT, LI);
+  PH->setName(L->getHeader()->getName() + ".ph");
+  ValueToValueMapTy VMap;
+  SmallVector<BasicBlock *, 8> SlowBlocks;
+  Loop *SlowLoop = cloneLoopWithPreheader(PH, CheckBB, L, VMap, ".bce.slow",
+                                          LI, DT, SlowBlocks);
+  remapInstructionsInBlocks(SlowBlocks, VMap);
+
+  // The slow loop keeps the checks removed by versioning, but not the ones
+  // which were proven statically.
+  for (unsigned I = 0, E = ToFold.size(); I != E; ++I)
+    if (L->contains(ToFold[I].first))
+      ToFold.push_back(std::make_pair(cast<BranchInst>(VMap[ToFold[I].first]),
+                                      ToFold[I].second));
+  for (BoundsCheck *Check : Info.Checks)
+    ToFold.push_back(std::make_pair(Check->Branch, Check->InBoundsSucc));
+
+  // Both loops leave through the same exit blocks.
+  for (BasicBlock *Exit : ExitBlocks)
+    for (Instruction &I : *Exit) {
+      PHINode *PN = dyn_cast<PHINode>(&I);
+      if (!PN)
+        break;
+      for (unsigned In = 0, E = PN->getNumIncomingValues(); In != E; ++In) {
+        BasicBlock *Pred = PN->getIncomingBlock(In);
+        if (!L->contains(Pred))
+          continue;
+        Value *V = PN->getIncomingValue(In);
+        auto Mapped = VMap.find(V);
+        if (Mapped != VMap.end())
+          V = Mapped->second;
+        PN->addIncoming(V, cast<BasicBlock>(VMap[Pred]));
+      }
+    }
+
+  // Enter the fast loop if all the conditions hold.
+  Instruction *OrigTerm = CheckBB->getTerminator();
+  BranchInst::Create(PH, SlowLoop->getLoopPreheader(), Cond, OrigTerm);
+  OrigTerm->eraseFromParent();
+
+  DEBUG(dbgs() << "BCE: versioned loop " << L->getHeader()->getName()
+               << " on " << Info.Conditions.size() << " conditions\n");
+  ++NumLoopsVersioned;
+  NumChecksVersioned += Info.Checks.size();
+  SE->forgetLoop(L);
+  DT->recalculate(*CheckBB->getParent());
+}
+
+bool BoundsCheckElimination::runOnFunction(Function &F) {
+  if (skipOptnoneFunction(F))
+    return false;
+
+  DT = &getAnalysis<DominatorTreeWrapperPass>().getDomTree();
+  LI = &getAnalysis<LoopInfoWrapperPass>().getLoopInfo();
+  SE = &getAnalysis<ScalarEvolution>();
+  ToFold.clear();
+
+  // Unreachable blocks have no place in the dominator tree, and nothing is
+  // gained by removing their checks.
+  SmallVector<BoundsCheck, 16> Checks;
+  for (BasicBlock &BB : F) {
+    if (!DT->isReachableFromEntry(&BB))
+      continue;
+    BoundsCheck Check;
+    if (BranchInst *BI = dyn_cast<BranchInst>(BB.getTerminator()))
+      if (matchBoundsCheck(BI, Check))
+        Checks.push_back(Check);
+  }
+  if (Checks.empty())
+    return false;
+
+  // Decide about every check before changing anything, since folding one
+  // check removes the dominating condition another one may rely on.
+  MapVector<Loop *, VersioningInfo> ToVersion;
+  for (BoundsCheck &Check : Checks) {
+    if (SE->isKnownPredicate(ICmpInst::ICMP_ULT, Check.Idx, Check.Len) ||
+        isImpliedByDominatingCondition(Check)) {
+      ToFold.push_back(std::make_pair(Check.Branch, Check.InBoundsSucc));
+      ++NumChecksRemoved;
+      continue;
+    }
+
+    Loop *L = LI->getLoopFor(Check.Branch->getParent());
+    if (!L || !L->empty())
+      continue;
+    SmallVector<RangeCondition, 2> Conditions;
+    if (!getLoopConditions(Check, L, Conditions))
+      continue;
+    if (Conditions.empty()) {
+      ToFold.push_back(std::make_pair(Check.Branch, Check.InBoundsSucc));
+      ++NumChecksRemoved;
+      continue;
+    }
+    VersioningInfo &Info = ToVersion[L];
+    Info.Checks.push_back(&Check);
+    Info.Conditions.append(Conditions.begin(), Conditions.end());
+  }
+
+  bool Changed = false;
+  if (EnableVersioning) {
+    for (auto &Entry : ToVersion) {
+      Loop *L = Entry.first;
+      VersioningInfo &Info = Entry.second;
+      if (Info.Conditions.size() > MaxVersioningChecks || !canVersionLoop(L))
+        continue;
+      bool Safe = true;
+      for (const RangeCondition &C : Info.Conditions)
+        Safe &= isSafeToExpand(C.LHS, *SE) && isSafeToExpand(C.RHS, *SE);
+      if (!Safe)
+        continue;
+      versionLoop(L, Info);
+      Changed = true;
+    }
+  }
+
+  // Now take the in-bounds successor unconditionally, and drop the edges to
+  // the panic blocks.
+  for (auto &Fold : ToFold) {
+    BranchInst *BI = Fold.first;
+    BasicBlock *BB = BI->getParent();
+    Value *Cond = BI->getCondition();
+    BI->setCondition(ConstantInt::get(Cond->getType(), Fold.second == 0));
+    ConstantFoldTerminator(BB);
+    RecursivelyDeleteTriviallyDeadInstructions(Cond);
+    if (Loop *L = LI->getLoopFor(BB)) {
+      while (L->getParentLoop())
+        L = L->getParentLoop();
+      SE->forgetLoop(L);
+    }
+    Changed = true;
+  }
+
+  if (!ToFold.empty())
+    DT->recalculate(F);
+  return Changed;
+}
@@ -33,9 +33,11 @@
 #include "llvm/IR/Instructions.h"
 #include "llvm/IR/IntrinsicInst.h"
 #include "llvm/Pass.h"
+#include "llvm/Support/CommandLine.h"
 #include "llvm/Support/Debug.h"
 #include "llvm/Support/raw_ostream.h"
 #include "llvm/Transforms/Utils/Local.h"
+#include "llvm/Transforms/Utils/MemorySSA.h"
 using namespace llvm;
 
 #define DEBUG_TYPE "dse"
@@ -43,12 +45,23 @@ using namespace llvm;
 STATISTIC(NumFastStores, "Number of stores deleted");
 STATISTIC(NumFastOther , "Number of other instrs removed");
 
+static cl::opt<bool> EnableMemorySSA(
+    "enable-dse-memoryssa", cl::init(false), cl::Hidden,
+    cl::desc("Find the stores killed by a store with memory SSA instead of "
+             "memory dependence queries"));
+
+static cl::opt<unsigned> MemorySSAScanLimit(
+    "dse-memoryssa-scan-limit", cl::init(100), cl::Hidden,
+    cl::desc("The maximum number of memory accesses DSE looks through when "
+             "searching for the dependence of a store in memory SSA"));
+
 namespace {
   struct DSE : public FunctionPass {
     AliasAnalysis *AA;
     MemoryDependenceAnalysis *MD;
     DominatorTree *DT;
     const TargetLibraryInfo *TLI;
+    std::unique_ptr<MemorySSA> MSSA;
 
     static char ID; // Pass identification, replacement for typeid
     DSE() : FunctionPass(ID), AA(nullptr), MD(nullptr), DT(nullptr) {
@@ -63,6 +76,8 @@ namespace {
       MD = &getAnalysis<MemoryDependenceAnalysis>();
       DT = &getAnalysis<DominatorTreeWrapperPass>().getDomTree();
       TLI = AA->getTargetLibraryInfo();
+      if (EnableMemorySSA)
+        MSSA.reset(new MemorySSA(F, *AA, *DT));
 
       bool Changed = false;
       for (Function::iterator I = F.begin(), E = F.end(); I != E; ++I)
@@ -72,10 +87,14 @@ namespace {
           Changed |= runOnBasicBlock(*I);
 
       AA = nullptr; MD = nullptr; DT = nullptr;
+      MSSA.reset();
       return Changed;
     }
 
     bool runOnBasicBlock(BasicBlock &BB);
+    MemDepResult getDependency(Instruction *Inst);
+    MemDepResult getPointerDependencyFrom(const AliasAnalysis::Location &Loc,
+                                          Instruction *ScanFrom);
     bool HandleFree(CallInst *F);
     bool handleEndBlock(BasicBlock &BB);
     void RemoveAccessedObjects(const AliasAnalysis::Location &LoadedLoc,
@@ -115,6 +134,7 @@ FunctionPass *llvm::createDeadStoreEliminationPass() { return new DSE(); }
 ///
 static void DeleteDeadInstruction(Instruction *I,
                                MemoryDependenceAnalysis &MD,
+                               MemorySSA *MSSA,
                                const TargetLibraryInfo *TLI,
                                SmallSetVector<Value*, 16> *ValueSet = nullptr) {
   SmallVector<Instruction*, 32> NowDeadInsts;
@@ -131,6 +151,8 @@ static void DeleteDeadInstruction(Instruction *I,
     // MemDep, which needs to know the operands and needs it to be in the
     // function.
     MD.removeInstruction(DeadInst);
+    if (MSSA)
+      MSSA->removeMemoryAccess(DeadInst);
 
     for (unsigned op = 0, e = DeadInst->getNumOperands(); op != e; ++op) {
       Value *Op = DeadInst->getOperand(op);
@@ -491,7 +513,7 @@ bool DSE::runOnBasicBlock(BasicBlock &BB) {
     if (!hasMemoryWrite(Inst, TLI))
       continue;
 
-    MemDepResult InstDep = MD->getDependency(Inst);
+    MemDepResult InstDep = getDependency(Inst);
 
     // Ignore any store where we can't find a local dependence.
     // FIXME: cross-block DSE would be fun. :)
@@ -511,7 +533,7 @@ bool DSE::runOnBasicBlock(BasicBlock &BB) {
           // in case we need it.
           WeakVH NextInst(BBI);
 
-          DeleteDeadInstruction(SI, *MD, TLI);
+          DeleteDeadInstruction(SI, *MD, MSSA.get(), TLI);
 
           if (!NextInst)  // Next instruction deleted.
             BBI = BB.begin();
@@ -560,7 +582,7 @@ bool DSE::runOnBasicBlock(BasicBlock &BB) {
                 << *DepWrite << "\n  KILLER: " << *Inst << '\n');
 
           // Delete the store and now-dead instructions that feed it.
-          DeleteDeadInstruction(DepWrite, *MD, TLI);
+          DeleteDeadInstruction(DepWrite, *MD, MSSA.get(), TLI);
           ++NumFastStores;
           MadeChange = true;
 
@@ -612,7 +634,7 @@ bool DSE::runOnBasicBlock(BasicBlock &BB) {
       if (AA->getModRefInfo(DepWrite, Loc) & AliasAnalysis::Ref)
         break;
 
-      InstDep = MD->getPointerDependencyFrom(Loc, false, DepWrite, &BB);
+      InstDep = getPointerDependencyFrom(Loc, DepWrite);
     }
   }
 
@@ -624,6 +646,61 @@ bool DSE::runOnBasicBlock(BasicBlock &BB) {
   return MadeChange;
 }
 
+/// getDependency - Return the local dependency of the memory write Inst, like
+/// MemoryDependenceAnalysis::getDependency(), using memory SSA if enabled.
+MemDepResult DSE::getDependency(Instruction *Inst) {
+  if (!MSSA)
+    return MD->getDependency(Inst);
+
+  AliasAnalysis::Location Loc = getLocForWrite(Inst, *AA);
+  if (!Loc.Ptr)
+    return MemDepResult::getUnknown();
+  return getPointerDependencyFrom(Loc, Inst);
+}
+
+/// getPointerDependencyFrom - Return the nearest instruction before ScanFrom
+/// in its block that may read or write Loc. With memory SSA this only visits
+/// the memory accesses of the block instead of every instruction.
+MemDepResult DSE::getPointerDependencyFrom(const AliasAnalysis::Location &Loc,
+                                           Instruction *ScanFrom) {
+  BasicBlock *BB = ScanFrom->getParent();
+  if (!MSSA)
+    return MD->getPointerDependencyFrom(Loc, false, ScanFrom, BB);
+
+  MemoryUseOrDef *MA = MSSA->getMemoryAccess(ScanFrom);
+  if (!MA)
+    return MemDepResult::getUnknown();
+
+  // Only the MemoryDefs are chained together. The reads between a def and the
+  // next one in the block are its MemoryUse users, in program order, so look
+  // at those first.
+  unsigned Limit = MemorySSAScanLimit;
+  MemoryAccess *Cur = MA->getDefiningAccess();
+  while (true) {
+    MemoryDef *Def = dyn_cast<MemoryDef>(Cur);
+    if (!Def || Def->getBlock() != BB)
+      return MemDepResult::getNonLocal();
+
+    for (auto UI = Def->user_end(), UE = Def->user_begin(); UI != UE;) {
+      MemoryUse *Use = dyn_cast<MemoryUse>(*--UI);
+      if (!Use)
+        continue;
+      if (!Limit--)
+        return MemDepResult::getUnknown();
+      if (AA->getModRefInfo(Use->getMemoryInst(), Loc) !=
+          AliasAnalysis::NoModRef)
+        return MemDepResult::getClobber(Use->getMemoryInst());
+    }
+
+    if (!Limit--)
+      return MemDepResult::getUnknown();
+    if (AA->getModRefInfo(Def->getMemoryInst(), Loc) !=
+        AliasAnalysis::NoModRef)
+      return MemDepResult::getClobber(Def->getMemoryInst());
+    Cur = Def->getDefiningAccess();
+  }
+}
+
 /// Find all blocks that will unconditionally lead to the block BB and append
 /// them to F.
 static void FindUnconditionalPreds(SmallVectorImpl<BasicBlock *> &Blocks,
@@ -671,7 +748,7 @@ bool DSE::HandleFree(CallInst *F) {
       Instruction *Next = std::next(BasicBlock::iterator(Dependency));
 
       // DCE instructions only used to calculate that store
-      DeleteDeadInstruction(Dependency, *MD, TLI);
+      DeleteDeadInstruction(Dependency, *MD, MSSA.get(), TLI);
       ++NumFastStores;
       MadeChange = true;
 
@@ -757,7 +834,7 @@ bool DSE::handleEndBlock(BasicBlock &BB) {
               dbgs() << '\n');
 
         // DCE instructions only used to calculate that store.
-        DeleteDeadInstruction(Dead, *MD, TLI, &DeadStackObjects);
+        DeleteDeadInstruction(Dead, *MD, MSSA.get(), TLI, &DeadStackObjects);
         ++NumFastStores;
         MadeChange = true;
         continue;
@@ -767,7 +844,7 @@ bool DSE::handleEndBlock(BasicBlock &BB) {
     // Remove any dead non-memory-mutating instructions.
     if (isInstructionTriviallyDead(BBI, TLI)) {
       Instruction *Inst = BBI++;
-      DeleteDeadInstruction(Inst, *MD, TLI, &DeadStackObjects);
+      DeleteDeadInstruction(Inst, *MD, MSSA.get(), TLI, &DeadStackObjects);
       ++NumFastOther;
       MadeChange = true;
       continue;
@@ -49,6 +49,7 @@
 #include "llvm/Support/raw_ostream.h"
 #include "llvm/Transforms/Utils/BasicBlockUtils.h"
 #include "llvm/Transforms/Utils/Local.h"
+#include "llvm/Transforms/Utils/MemorySSA.h"
 #include "llvm/Transforms/Utils/SSAUpdater.h"
 #include <vector>
 using namespace llvm;
@@ -67,6 +68,10 @@ STATISTIC(NumPRELoad,   "Number of loads PRE'd");
 static cl::opt<bool> EnablePRE("enable-pre",
                                cl::init(true), cl::Hidden);
 static cl::opt<bool> EnableLoadPRE("enable-load-pre", cl::init(true));
+static cl::opt<bool> EnableMemorySSA(
+    "enable-gvn-memoryssa", cl::init(false), cl::Hidden,
+    cl::desc("Look for the store feeding a load in memory SSA before "
+             "querying memory dependence analysis"));
 
 // Maximum allowed recursion depth.
 static cl::opt<uint32_t>
@@ -591,6 +596,7 @@ namespace {
   class GVN : public FunctionPass {
     bool NoLoads;
     MemoryDependenceAnalysis *MD;
+    std::unique_ptr<MemorySSA> MSSA;
     DominatorTree *DT;
     const TargetLibraryInfo *TLI;
     AssumptionCache *AC;
@@ -695,6 +701,7 @@ namespace {
 
     // Helper fuctions of redundant load elimination 
     bool processLoad(LoadInst *L);
+    bool processLoadWithMemorySSA(LoadInst *L);
     bool processNonLocalLoad(LoadInst *L);
     void AnalyzeLoadAvailability(LoadInst *LI, LoadDepVect &Deps, 
                                  AvailValInBlkVect &ValuesPerBlock,
@@ -1817,6 +1824,71 @@ static void patchAndReplaceAllUsesWith(Instruction *I, Value *Repl) {
   I->replaceAllUsesWith(Repl);
 }
 
+/// Follow the defining accesses of the load L upwards and return the first
+/// MemoryPhi on the way, or the live-on-entry def if there is none.
+static MemoryAccess *findFirstPhiOrEntry(MemorySSA &MSSA, LoadInst *L) {
+  MemoryAccess *MA = MSSA.getMemoryAccess(L)->getDefiningAccess();
+  while (!MSSA.isLiveOnEntryDef(MA) && !isa<MemoryPhi>(MA))
+    MA = cast<MemoryDef>(MA)->getDefiningAccess();
+  return MA;
+}
+
+/// Try to replace the load L with the value stored by the access which
+/// clobbers it in memory SSA. Unlike a memory dependence query this finds
+/// stores and memory intrinsics in dominating blocks without scanning the
+/// instructions in between.
+bool GVN::processLoadWithMemorySSA(LoadInst *L) {
+  MemoryAccess *Clobber = MSSA->getClobberingMemoryAccess(L);
+  if (!Clobber)
+    return false;
+
+  const DataLayout &DL = L->getModule()->getDataLayout();
+  Value *AvailVal = nullptr;
+  if (MSSA->isLiveOnEntryDef(Clobber)) {
+    // Nothing has been stored to a local allocation yet: the load is undef.
+    // Only trust this on a straight chain of defs from the entry, though. A
+    // walk through a MemoryPhi reasons about the address of L in a single
+    // execution, which is weaker than needed to assume it is never written.
+    if (isa<AllocaInst>(GetUnderlyingObject(L->getPointerOperand(), DL)) &&
+        !isa<MemoryPhi>(findFirstPhiOrEntry(*MSSA, L)))
+      AvailVal = UndefValue::get(L->getType());
+  } else if (MemoryDef *Def = dyn_cast<MemoryDef>(Clobber)) {
+    // The clobber is the only one on every path to L, so it dominates L. A
+    // walk which hit its limit returns a def it hasn't checked, though.
+    Instruction *DepInst = Def->getMemoryInst();
+    AliasAnalysis *AA = VN.getAliasAnalysis();
+    if (!(AA->getModRefInfo(DepInst, MemoryLocation::get(L)) &
+          AliasAnalysis::Mod))
+      return false;
+    if (StoreInst *DepSI = dyn_cast<StoreInst>(DepInst)) {
+      Value *StoredVal = DepSI->getValueOperand();
+      int Offset = AnalyzeLoadFromClobberingStore(
+          L->getType(), L->getPointerOperand(), DepSI);
+      if (Offset == 0 && StoredVal->getType() == L->getType())
+        AvailVal = StoredVal;
+      else if (Offset != -1)
+        AvailVal = GetStoreValueForLoad(StoredVal, Offset, L->getType(), L, DL);
+    } else if (MemIntrinsic *DepMI = dyn_cast<MemIntrinsic>(DepInst)) {
+      int Offset = AnalyzeLoadFromClobberingMemInst(
+          L->getType(), L->getPointerOperand(), DepMI, DL);
+      if (Offset != -1)
+        AvailVal = GetMemInstValueForLoad(DepMI, Offset, L->getType(), L, DL);
+    }
+  }
+
+  if (!AvailVal)
+    return false;
+
+  DEBUG(dbgs() << "GVN MEMORYSSA LOAD:\n" << *Clobber << '\n' << *AvailVal
+               << '\n' << *L << "\n\n\n");
+  L->replaceAllUsesWith(AvailVal);
+  if (AvailVal->getType()->getScalarType()->isPointerTy())
+    MD->invalidateCachedPointerInfo(AvailVal);
+  markInstructionForDeletion(L);
+  ++NumGVNLoad;
+  return true;
+}
+
 /// Attempt to eliminate a load, first by eliminating it
 /// locally, and then attempting non-local elimination if that fails.
 bool GVN::processLoad(LoadInst *L) {
@@ -1831,6 +1903,9 @@ bool GVN::processLoad(LoadInst *L) {
     return true;
   }
 
+  if (MSSA && processLoadWithMemorySSA(L))
+    return true;
+
   // ... to a pointer that has been loaded from before...
   MemDepResult Dep = MD->getDependency(L);
   const DataLayout &DL = L->getModule()->getDataLayout();
@@ -2417,6 +2492,7 @@ bool GVN::processBlock(BasicBlock *BB) {
          E = InstrsToErase.end(); I != E; ++I) {
       DEBUG(dbgs() << "GVN removed: " << **I << '\n');
       if (MD) MD->removeInstruction(*I);
+      if (MSSA) MSSA->removeMemoryAccess(*I);
       DEBUG(verifyRemoved(*I));
       (*I)->eraseFromParent();
     }
@@ -2666,6 +2742,11 @@ bool GVN::splitCriticalEdges() {
 bool GVN::iterateOnFunction(Function &F) {
   cleanupGlobalSets();
 
+  // Memory SSA doesn't survive the edge splitting and PRE between iterations,
+  // so it is rebuilt for each one.
+  if (MD && EnableMemorySSA)
+    MSSA.reset(new MemorySSA(F, *VN.getAliasAnalysis(), *DT));
+
   // Top-down walk of the dominator tree
   bool Changed = false;
   // Save the blocks this function have before transformation begins. GVN may
@@ -2684,6 +2765,7 @@ bool GVN::iterateOnFunction(Function &F) {
        I != E; I++)
     Changed |= processBlock(*I);
 
+  MSSA.reset();
   return Changed;
 }
 
@@ -0,0 +1,249 @@
+//===- LoopVersioningLICM.cpp - Version loops to enable LICM --------------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This pass versions inner loops whose loop-invariant memory accesses LICM
+// can't hoist or promote because they may alias other accesses in the loop.
+// E.g.:
+//
+//   for (i = 0; i < n; i++)
+//     *sum += a[i];
+//
+// Using the run-time pointer checks computed by LoopAccessAnalysis, the loop
+// is duplicated: the original loop runs if the checked pointers don't
+// overlap, and a clone runs otherwise.  The memory accesses of the original
+// loop are annotated with alias.scope/noalias metadata describing the checks,
+// so that a subsequent run of LICM can promote *sum to a register there.
+//
+// Both copies are marked with llvm.loop.licm_versioning.disable so that they
+// are not versioned again.
+//
+//===----------------------------------------------------------------------===//
+
+#include "llvm/ADT/DepthFirstIterator.h"
+#include "llvm/ADT/Statistic.h"
+#include "llvm/Analysis/LoopAccessAnalysis.h"
+#include "llvm/Analysis/LoopInfo.h"
+#include "llvm/Analysis/ScalarEvolution.h"
+#include "llvm/IR/Dominators.h"
+#include "llvm/IR/Instructions.h"
+#include "llvm/IR/LLVMContext.h"
+#include "llvm/IR/Metadata.h"
+#include "llvm/Pass.h"
+#include "llvm/Support/CommandLine.h"
+#include "llvm/Support/Debug.h"
+#include "llvm/Transforms/Scalar.h"
+#include "llvm/Transforms/Utils/BasicBlockUtils.h"
+#include "llvm/Transforms/Utils/LoopUtils.h"
+#include "llvm/Transforms/Utils/LoopVersioning.h"
+using namespace llvm;
+
+#define LVLICM_NAME "loop-versioning-licm"
+#define DEBUG_TYPE LVLICM_NAME
+
+static const char *const LICMVersioningDisable =
+    "llvm.loop.licm_versioning.disable";
+
+static cl::opt<unsigned> LVLICMMaxChecks(
+    "licm-versioning-max-checks", cl::init(8), cl::Hidden,
+    cl::desc("Maximum number of run-time pointer comparisons emitted when "
+             "versioning a loop for LICM"));
+
+static cl::opt<unsigned> LVLICMMaxLoopSize(
+    "licm-versioning-max-loop-size", cl::init(128), cl::Hidden,
+    cl::desc("Maximum number of instructions in a loop versioned for LICM"));
+
+STATISTIC(NumLoopsVersioned, "Number of loops versioned for LICM");
+
+/// \brief Returns true if the loop ID of \p L contains the node \p Name.
+static bool hasLoopMetadata(const Loop *L, StringRef Name) {
+  MDNode *LoopID = L->getLoopID();
+  if (!LoopID)
+    return false;
+  // First operand should refer to the loop id itself.
+  for (unsigned i = 1, ie = LoopID->getNumOperands(); i < ie; ++i) {
+    MDNode *MD = dyn_cast<MDNode>(LoopID->getOperand(i));
+    if (!MD || !MD->getNumOperands())
+      continue;
+    const MDString *S = dyn_cast<MDString>(MD->getOperand(0));
+    if (S && S->getString() == Name)
+      return true;
+  }
+  return false;
+}
+
+/// \brief Adds the node \p Name to the loop ID of \p L, creating the loop ID
+/// if needed.
+static void addLoopMetadata(Loop *L, StringRef Name) {
+  LLVMContext &Context = L->getHeader()->getContext();
+  SmallVector<Metadata *, 4> MDs;
+  // Reserve first location for self reference to the LoopID metadata node.
+  MDs.push_back(nullptr);
+  if (MDNode *LoopID = L->getLoopID())
+    for (unsigned i = 1, ie = LoopID->getNumOperands(); i < ie; ++i)
+      MDs.push_back(LoopID->getOperand(i));
+  MDs.push_back(MDNode::get(Context, MDString::get(Context, Name)));
+
+  MDNode *NewLoopID = MDNode::get(Context, MDs);
+  // Set operand 0 to refer to the loop id itself.
+  NewLoopID->replaceOperandWith(0, NewLoopID);
+  L->setLoopID(NewLoopID);
+}
+
+namespace {
+class LoopVersioningLICM : public FunctionPass {
+public:
+  LoopVersioningLICM() : FunctionPass(ID) {
+    initializeLoopVersioningLICMPass(*PassRegistry::getPassRegistry());
+  }
+
+  bool runOnFunction(Function &F) override {
+    LI = &getAnalysis<LoopInfoWrapperPass>().getLoopInfo();
+    LAA = &getAnalysis<LoopAccessAnalysis>();
+    DT = &getAnalysis<DominatorTreeWrapperPass>().getDomTree();
+    SE = &getAnalysis<ScalarEvolution>();
+
+    // Versioning creates new loops, so collect the inner-most loops first.
+    SmallVector<Loop *, 8> Worklist;
+    for (Loop *TopLevelLoop : *LI)
+      for (Loop *L : depth_first(TopLevelLoop))
+        if (L->empty())
+          Worklist.push_back(L);
+
+    bool Changed = false;
+    for (Loop *L : Worklist)
+      Changed |= processLoop(L);
+    return Changed;
+  }
+
+  void getAnalysisUsage(AnalysisUsage &AU) const override {
+    AU.addRequiredID(LoopSimplifyID);
+    AU.addPreservedID(LoopSimplifyID);
+    AU.addRequired<LoopInfoWrapperPass>();
+    AU.addPreserved<LoopInfoWrapperPass>();
+    AU.addRequired<LoopAccessAnalysis>();
+    AU.addRequired<DominatorTreeWrapperPass>();
+    AU.addPreserved<DominatorTreeWrapperPass>();
+    AU.addRequired<ScalarEvolution>();
+  }
+
+  static char ID;
+
+private:
+  /// \brief Returns true if \p L has a loop-invariant memory access which
+  /// LICM could hoist or promote, and is small enough to duplicate.
+  bool isProfitable(Loop *L) {
+    bool HasStore = false, HasInvariantAccess = false;
+    unsigned Size = 0;
+    for (BasicBlock *BB : L->getBlocks())
+      for (Instruction &I : *BB) {
+        ++Size;
+        Value *Ptr;
+        if (LoadInst *Load = dyn_cast<LoadInst>(&I)) {
+          Ptr = Load->getPointerOperand();
+        } else if (StoreInst *Store = dyn_cast<StoreInst>(&I)) {
+          Ptr = Store->getPointerOperand();
+          HasStore = true;
+        } else
+          continue;
+        if (SE->isLoopInvariant(SE->getSCEV(Ptr), L))
+          HasInvariantAccess = true;
+      }
+    // Without a store in the loop, invariant loads are already hoisted unless
+    // they are conditional, which versioning wouldn't change.
+    return HasStore && HasInvariantAccess && Size <= LVLICMMaxLoopSize;
+  }
+
+  bool processLoop(Loop *L) {
+    assert(L->empty() && "Only process inner loops.");
+
+    DEBUG(dbgs() << "\nLVLICM: In \""
+                 << L->getHeader()->getParent()->getName() << "\" checking "
+                 << *L << "\n");
+
+    BasicBlock *PH = L->getLoopPreheader();
+    if (!PH || !L->getExitBlock() || !L->getExitingBlock()) {
+      DEBUG(dbgs() << "Skipping; not a single-exit loop with a preheader\n");
+      return false;
+    }
+    if (hasLoopMetadata(L, LICMVersioningDisable)) {
+      DEBUG(dbgs() << "Skipping; versioning disabled by metadata\n");
+      return false;
+    }
+    if (!isProfitable(L)) {
+      DEBUG(dbgs() << "Skipping; no invariant accesses to expose to LICM\n");
+      return false;
+    }
+
+    const LoopAccessInfo &LAI = LAA->getInfo(L, ValueToValueMap());
+    // The run-time check is only populated when LAA managed to bound all the
+    // may-aliasing pointers, so whatever it checks can be assumed disjoint in
+    // the versioned loop.  Dependences between accesses of the same
+    // dependence set are left alone.
+    LoopVersioning LVer(LAI, L, LI, DT);
+    if (!LVer.needsRuntimeChecks()) {
+      DEBUG(dbgs() << "Skipping; no run-time checks would help\n");
+      return false;
+    }
+    unsigned NumChecks = LAI.getNumRuntimePointerChecks();
+    if (NumChecks > LVLICMMaxChecks) {
+      DEBUG(dbgs() << "Skipping; too many run-time checks (" << NumChecks
+                   << ")\n");
+      return false;
+    }
+
+    DEBUG(dbgs() << "\nVersioning loop: " << *L << "\n");
+    // To keep things simple have an empty preheader before we version the
+    // loop.  (Also split if this has no predecessor, i.e. entry, because we
+    // rely on PH having a predecessor.)
+    if (!PH->getSinglePredecessor() || &*PH->begin() != PH->getTerminator())
+      SplitBlock(PH, PH->getTerminator(), DT, LI);
+
+    BasicBlock *Exit = L->getExitBlock();
+    LVer.versionLoop(this);
+    LVer.addPHINodes(findDefsUsedOutsideOfLoop(L));
+    LVer.annotateLoopWithNoAlias();
+
+    // Both copies exit to the block the original loop exited to. Give each
+    // one a dedicated exit again, so that they stay in loop-simplify form.
+    SplitEdge(LVer.getVersionedLoop()->getExitingBlock(), Exit, DT, LI);
+    SplitEdge(LVer.getNonVersionedLoop()->getExitingBlock(), Exit, DT, LI);
+
+    addLoopMetadata(LVer.getVersionedLoop(), LICMVersioningDisable);
+    addLoopMetadata(LVer.getNonVersionedLoop(), LICMVersioningDisable);
+
+    ++NumLoopsVersioned;
+    return true;
+  }
+
+  // Analyses used.
+  LoopInfo *LI;
+  LoopAccessAnalysis *LAA;
+  DominatorTree *DT;
+  ScalarEvolution *SE;
+};
+} // anonymous namespace
+
+char LoopVersioningLICM::ID;
+static const char lvlicm_name[] = "Loop Versioning For LICM";
+
+INITIALIZE_PASS_BEGIN(LoopVersioningLICM, LVLICM_NAME, lvlicm_name, false,
+                      false)
+INITIALIZE_PASS_DEPENDENCY(LoopSimplify)
+INITIALIZE_PASS_DEPENDENCY(LoopInfoWrapperPass)
+INITIALIZE_PASS_DEPENDENCY(LoopAccessAnalysis)
+INITIALIZE_PASS_DEPENDENCY(DominatorTreeWrapperPass)
+INITIALIZE_PASS_DEPENDENCY(ScalarEvolution)
+INITIALIZE_PASS_END(LoopVersioningLICM, LVLICM_NAME, lvlicm_name, false,
+                    false)
+
+namespace llvm {
+FunctionPass *createLoopVersioningLICMPass() {
+  return new LoopVersioningLICM();
+}
+}
@@ -52,6 +52,7 @@
 #include "llvm/Support/ErrorHandling.h"
 #include "llvm/Support/MathExtras.h"
 #include "llvm/Support/TimeValue.h"
+#include "llvm/Support/Timer.h"
 #include "llvm/Support/raw_ostream.h"
 #include "llvm/Transforms/Utils/Local.h"
 #include "llvm/Transforms/Utils/PromoteMemToReg.h"
@@ -76,6 +77,8 @@ STATISTIC(NumPromoted, "Number of allocas promoted to SSA values");
 STATISTIC(NumLoadsSpeculated, "Number of loads speculated to allow promotion");
 STATISTIC(NumDeleted, "Number of instructions deleted");
 STATISTIC(NumVectorized, "Number of vectorized aggregates");
+STATISTIC(NumAllocasOverSliceLimit,
+          "Number of allocas left alone for having too many slices");
 
 /// Hidden option to force the pass to not use DomTree and mem2reg, instead
 /// forming SSA values through the SSAUpdater infrastructure.
@@ -92,6 +95,18 @@ static cl::opt<bool> SROARandomShuffleSlices("sroa-random-shuffle-slices",
 static cl::opt<bool> SROAStrictInbounds("sroa-strict-inbounds", cl::init(false),
                                         cl::Hidden);
 
+/// Limit on the number of slices of a single alloca which we are willing to
+/// split and rewrite. Huge aggregates with a use per element cost time and
+/// memory proportional to the number of slices in every phase below, and are
+/// rarely all profitable to scalarize; zero means no limit.
+static cl::opt<unsigned> SROAMaxAllocaSlices(
+    "sroa-max-alloca-slices", cl::init(0), cl::Hidden,
+    cl::desc("Maximum number of slices of an alloca to split (0 = no limit)"));
+
+/// Name of the group of timers reported for the phases of SROA under
+/// -time-passes.
+static const char TimerGroupName[] = "Scalar Replacement Of Aggregates";
+
 namespace {
 /// \brief A custom IRBuilder inserter which prefixes all names if they are
 /// preserved.
@@ -1002,6 +1017,7 @@ AllocaSlices::AllocaSlices(const DataLayout &DL, AllocaInst &AI)
       AI(AI),
 #endif
       PointerEscapingInstr(nullptr) {
+  NamedRegionTimer T("Slice Building", TimerGroupName, TimePassesIsEnabled);
   SliceBuilder PB(DL, AI, *this);
   SliceBuilder::PtrInfo PtrI = PB.visitPtr(AI);
   if (PtrI.isEscaped() || PtrI.isAborted()) {
@@ -1226,7 +1242,10 @@ class SROA : public FunctionPass {
   SetVector<AllocaInst *, SmallVector<AllocaInst *, 16>> PostPromotionWorklist;
 
   /// \brief A collection of alloca instructions we can directly promote.
-  std::vector<AllocaInst *> PromotableAllocas;
+  ///
+  /// This is a set so that dropping an alloca which gets deleted or needs to be
+  /// re-split doesn't require scanning every alloca queued so far.
+  SetVector<AllocaInst *, SmallVector<AllocaInst *, 16>> PromotableAllocas;
 
   /// \brief A worklist of PHIs to speculate prior to promoting allocas.
   ///
@@ -3506,6 +3525,8 @@ static Type *getTypePartition(const DataLayout &DL, Type *Ty, uint64_t Offset,
 /// \returns true if any changes are made.
 bool SROA::presplitLoadsAndStores(AllocaInst &AI, AllocaSlices &AS) {
   DEBUG(dbgs() << "Pre-splitting loads and stores\n");
+  NamedRegionTimer T("Load and Store Pre-splitting", TimerGroupName,
+                     TimePassesIsEnabled);
 
   // Track the loads and stores which are candidates for pre-splitting here, in
   // the order they first appear during the partition scan. These give stable
@@ -3954,11 +3975,8 @@ bool SROA::presplitLoadsAndStores(AllocaInst &AI, AllocaSlices &AS) {
 
   // Finally, don't try to promote any allocas that new require re-splitting.
   // They have already been added to the worklist above.
-  PromotableAllocas.erase(
-      std::remove_if(
-          PromotableAllocas.begin(), PromotableAllocas.end(),
-          [&](AllocaInst *AI) { return ResplitPromotableAllocas.count(AI); }),
-      PromotableAllocas.end());
+  for (AllocaInst *ResplitAI : ResplitPromotableAllocas)
+    PromotableAllocas.remove(ResplitAI);
 
   return true;
 }
@@ -4086,7 +4104,7 @@ AllocaInst *SROA::rewritePartition(AllocaInst &AI, AllocaSlices &AS,
   if (Promotable) {
     if (PHIUsers.empty() && SelectUsers.empty()) {
       // Promote the alloca.
-      PromotableAllocas.push_back(NewAI);
+      PromotableAllocas.insert(NewAI);
     } else {
       // If we have either PHIs or Selects to speculate, add them to those
       // worklists and re-queue the new alloca so that we promote in on the
@@ -4161,18 +4179,23 @@ bool SROA::splitAlloca(AllocaInst &AI, AllocaSlices &AS) {
   SmallVector<Piece, 4> Pieces;
 
   // Rewrite each partition.
-  for (auto &P : AS.partitions()) {
-    if (AllocaInst *NewAI = rewritePartition(AI, AS, P)) {
-      Changed = true;
-      if (NewAI != &AI) {
-        uint64_t SizeOfByte = 8;
-        uint64_t AllocaSize = DL.getTypeSizeInBits(NewAI->getAllocatedType());
-        // Don't include any padding.
-        uint64_t Size = std::min(AllocaSize, P.size() * SizeOfByte);
-        Pieces.push_back(Piece(NewAI, P.beginOffset() * SizeOfByte, Size));
+  {
+    NamedRegionTimer T("Partition Rewriting", TimerGroupName,
+                       TimePassesIsEnabled);
+    for (auto &P : AS.partitions()) {
+      if (AllocaInst *NewAI = rewritePartition(AI, AS, P)) {
+        Changed = true;
+        if (NewAI != &AI) {
+          uint64_t SizeOfByte = 8;
+          uint64_t AllocaSize =
+              DL.getTypeSizeInBits(NewAI->getAllocatedType());
+          // Don't include any padding.
+          uint64_t Size = std::min(AllocaSize, P.size() * SizeOfByte);
+          Pieces.push_back(Piece(NewAI, P.beginOffset() * SizeOfByte, Size));
+        }
       }
+      ++NumPartitions;
     }
-    ++NumPartitions;
   }
 
   NumAllocaPartitions += NumPartitions;
@@ -4258,8 +4281,12 @@ bool SROA::runOnAlloca(AllocaInst &AI) {
 
   // First, split any FCA loads and stores touching this alloca to promote
   // better splitting and promotion opportunities.
-  AggLoadStoreRewriter AggRewriter(DL);
-  Changed |= AggRewriter.rewrite(AI);
+  {
+    NamedRegionTimer T("Aggregate Load and Store Splitting", TimerGroupName,
+                       TimePassesIsEnabled);
+    AggLoadStoreRewriter AggRewriter(DL);
+    Changed |= AggRewriter.rewrite(AI);
+  }
 
   // Build the slices using a recursive instruction-visiting builder.
   AllocaSlices AS(DL, AI);
@@ -4267,6 +4294,15 @@ bool SROA::runOnAlloca(AllocaInst &AI) {
   if (AS.isEscaped())
     return Changed;
 
+  // Leave aggregates with more slices than we are willing to work through
+  // as they are; nothing has been rewritten in terms of the slices yet.
+  if (SROAMaxAllocaSlices &&
+      (unsigned)(AS.end() - AS.begin()) > SROAMaxAllocaSlices) {
+    DEBUG(dbgs() << "  Too many slices, skipping alloca\n");
+    ++NumAllocasOverSliceLimit;
+    return Changed;
+  }
+
   // Delete all the dead users of this alloca before splitting and rewriting it.
   for (Instruction *DeadUser : AS.getDeadUsers()) {
     // Free up everything used by this instruction.
@@ -4313,6 +4349,8 @@ bool SROA::runOnAlloca(AllocaInst &AI) {
 /// subsequently handed to mem2reg to promote.
 void SROA::deleteDeadInstructions(
     SmallPtrSetImpl<AllocaInst *> &DeletedAllocas) {
+  NamedRegionTimer T("Dead Instruction Deletion", TimerGroupName,
+                     TimePassesIsEnabled);
   while (!DeadInsts.empty()) {
     Instruction *I = DeadInsts.pop_back_val();
     DEBUG(dbgs() << "Deleting dead instruction: " << *I << "\n");
@@ -4358,11 +4396,12 @@ bool SROA::promoteAllocas(Function &F) {
   if (PromotableAllocas.empty())
     return false;
 
+  NamedRegionTimer T("Promotion", TimerGroupName, TimePassesIsEnabled);
   NumPromoted += PromotableAllocas.size();
 
   if (DT && !ForceSSAUpdater) {
     DEBUG(dbgs() << "Promoting allocas with mem2reg...\n");
-    PromoteMemToReg(PromotableAllocas, *DT, nullptr, AC);
+    PromoteMemToReg(PromotableAllocas.getArrayRef(), *DT, nullptr, AC);
     PromotableAllocas.clear();
     return true;
   }
@@ -4458,17 +4497,15 @@ bool SROA::runOnFunction(Function &F) {
       deleteDeadInstructions(DeletedAllocas);
 
       // Remove the deleted allocas from various lists so that we don't try to
-      // continue processing them.
-      if (!DeletedAllocas.empty()) {
-        auto IsInSet = [&](AllocaInst *AI) { return DeletedAllocas.count(AI); };
-        Worklist.remove_if(IsInSet);
-        PostPromotionWorklist.remove_if(IsInSet);
-        PromotableAllocas.erase(std::remove_if(PromotableAllocas.begin(),
-                                               PromotableAllocas.end(),
-                                               IsInSet),
-                                PromotableAllocas.end());
-        DeletedAllocas.clear();
+      // continue processing them. Usually the only deleted alloca is the one
+      // just split, which is on none of them, so look each one up rather than
+      // rescanning the lists after every alloca.
+      for (AllocaInst *AI : DeletedAllocas) {
+        Worklist.remove(AI);
+        PostPromotionWorklist.remove(AI);
+        PromotableAllocas.remove(AI);
       }
+      DeletedAllocas.clear();
     }
 
     Changed |= promoteAllocas(F);
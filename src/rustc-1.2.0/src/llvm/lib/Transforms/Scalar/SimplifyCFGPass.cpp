@@ -184,9 +184,9 @@ PreservedAnalyses SimplifyCFGPass::run(Function &F,
   auto &AC = AM->getResult<AssumptionAnalysis>(F);
 
   if (!simplifyFunctionCFG(F, TTI, &AC, BonusInstThreshold))
-    return PreservedAnalyses::none();
+    return PreservedAnalyses::all();
 
-  return PreservedAnalyses::all();
+  return PreservedAnalyses::none();
 }
 
 namespace {
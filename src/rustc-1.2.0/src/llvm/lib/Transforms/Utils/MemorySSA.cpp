@@ -0,0 +1,494 @@
+//===-- MemorySSA.cpp - Build a use/def graph of memory accesses ----------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This file implements the MemorySSA class and a pass which prints it.
+//
+// MemoryDefs and MemoryUses are created for the memory instructions of every
+// block, MemoryPhis are placed at the iterated dominance frontier of the
+// blocks containing MemoryDefs, and the accesses are then renamed in a walk
+// over the dominator tree, like the scalar SSA construction in mem2reg.
+//
+//===----------------------------------------------------------------------===//
+
+#include "llvm/Transforms/Utils/MemorySSA.h"
+#include "llvm/ADT/DepthFirstIterator.h"
+#include "llvm/ADT/STLExtras.h"
+#include "llvm/ADT/SmallPtrSet.h"
+#include "llvm/Analysis/AliasAnalysis.h"
+#include "llvm/Analysis/IteratedDominanceFrontier.h"
+#include "llvm/IR/CFG.h"
+#include "llvm/IR/CallSite.h"
+#include "llvm/IR/Dominators.h"
+#include "llvm/IR/Function.h"
+#include "llvm/IR/Instructions.h"
+#include "llvm/Pass.h"
+#include "llvm/Support/CommandLine.h"
+#include "llvm/Support/Debug.h"
+#include "llvm/Support/raw_ostream.h"
+#include <algorithm>
+using namespace llvm;
+
+#define DEBUG_TYPE "memoryssa"
+
+static cl::opt<unsigned> MaxWalkSteps(
+    "memoryssa-walk-limit", cl::Hidden, cl::init(1000),
+    cl::desc("The maximum number of memory accesses a single clobber query "
+             "visits before it gives a conservative answer"));
+
+//===----------------------------------------------------------------------===//
+// Memory accesses
+//===----------------------------------------------------------------------===//
+
+void MemoryAccess::dump() const {
+  print(dbgs());
+  dbgs() << "\n";
+}
+
+void MemoryAccess::removeUser(MemoryAccess *U) {
+  auto I = std::find(Users.begin(), Users.end(), U);
+  assert(I != Users.end() && "Not a user of this access!");
+  Users.erase(I);
+}
+
+void MemoryAccess::replaceAllUsesWith(MemoryAccess *MA) {
+  // replaceUseOf() removes the user from our list.
+  while (!Users.empty())
+    Users.back()->replaceUseOf(this, MA);
+}
+
+void MemoryUseOrDef::setDefiningAccess(MemoryAccess *DMA) {
+  if (DefiningAccess)
+    DefiningAccess->removeUser(this);
+  DefiningAccess = DMA;
+  if (DMA)
+    DMA->addUser(this);
+}
+
+void MemoryUseOrDef::replaceUseOf(MemoryAccess *From, MemoryAccess *To) {
+  assert(DefiningAccess == From && "Not a use of this access!");
+  (void)From;
+  setDefiningAccess(To);
+}
+
+void MemoryPhi::addIncoming(MemoryAccess *MA, BasicBlock *BB) {
+  Incoming.push_back(std::make_pair(BB, MA));
+  MA->addUser(this);
+}
+
+void MemoryPhi::replaceUseOf(MemoryAccess *From, MemoryAccess *To) {
+  for (auto &In : Incoming)
+    if (In.second == From) {
+      From->removeUser(this);
+      In.second = To;
+      To->addUser(this);
+    }
+}
+
+/// Print the name by which \p MA is referred to by other accesses.
+static void printAccessID(raw_ostream &OS, const MemoryAccess *MA) {
+  if (const MemoryPhi *Phi = dyn_cast<MemoryPhi>(MA)) {
+    OS << Phi->getID();
+    return;
+  }
+  const MemoryDef *Def = cast<MemoryDef>(MA);
+  if (!Def->getMemoryInst())
+    OS << "liveOnEntry";
+  else
+    OS << Def->getID();
+}
+
+void MemoryUse::print(raw_ostream &OS) const {
+  OS << "MemoryUse(";
+  printAccessID(OS, getDefiningAccess());
+  OS << ")";
+}
+
+void MemoryDef::print(raw_ostream &OS) const {
+  OS << getID() << " = MemoryDef(";
+  if (getDefiningAccess())
+    printAccessID(OS, getDefiningAccess());
+  OS << ")";
+}
+
+void MemoryPhi::print(raw_ostream &OS) const {
+  OS << getID() << " = MemoryPhi(";
+  for (unsigned I = 0, E = getNumIncomingValues(); I != E; ++I) {
+    if (I)
+      OS << ",";
+    OS << "{";
+    BasicBlock *BB = getIncomingBlock(I);
+    if (BB->hasName())
+      OS << BB->getName();
+    else
+      BB->printAsOperand(OS, false);
+    OS << ",";
+    printAccessID(OS, getIncomingValue(I));
+    OS << "}";
+  }
+  OS << ")";
+}
+
+//===----------------------------------------------------------------------===//
+// MemorySSA construction
+//===----------------------------------------------------------------------===//
+
+MemorySSA::MemorySSA(Function &F, AliasAnalysis &AA, DominatorTree &DT)
+    : F(F), AA(AA), DT(DT) {
+  buildMemorySSA();
+}
+
+MemorySSA::~MemorySSA() {}
+
+/// Create the MemoryUse or MemoryDef for \p I, or return null if \p I does
+/// not touch memory.
+MemoryUseOrDef *MemorySSA::createAccess(Instruction *I, unsigned &NextID) {
+  bool Def = I->mayWriteToMemory();
+  bool Use = I->mayReadFromMemory();
+
+  // Alias analysis knows more than the attributes about what calls do.
+  if (ImmutableCallSite CS = ImmutableCallSite(I)) {
+    AliasAnalysis::ModRefBehavior MRB = AA.getModRefBehavior(CS);
+    if (MRB == AliasAnalysis::DoesNotAccessMemory)
+      return nullptr;
+    if (AliasAnalysis::onlyReadsMemory(MRB))
+      Def = false;
+  }
+
+  if (Def)
+    return new MemoryDef(I, I->getParent(), NextID++);
+  if (Use)
+    return new MemoryUse(I, I->getParent());
+  return nullptr;
+}
+
+void MemorySSA::buildMemorySSA() {
+  LiveOnEntryDef.reset(new MemoryDef(nullptr, nullptr, 0));
+  unsigned NextID = 1;
+
+  // Create the accesses of every block, remembering which blocks define a new
+  // version of memory.
+  SmallPtrSet<BasicBlock *, 32> DefiningBlocks;
+  for (BasicBlock &BB : F) {
+    AccessList *BBAccesses = nullptr;
+    for (Instruction &I : BB) {
+      MemoryUseOrDef *MA = createAccess(&I, NextID);
+      if (!MA)
+        continue;
+      Accesses.emplace_back(MA);
+      InstructionAccesses[&I] = MA;
+      if (!BBAccesses)
+        BBAccesses = &BlockAccesses[&BB];
+      BBAccesses->push_back(MA);
+      if (isa<MemoryDef>(MA))
+        DefiningBlocks.insert(&BB);
+    }
+  }
+
+  // Place MemoryPhis at the iterated dominance frontier of those blocks. The
+  // phis are created in function order so that their IDs are deterministic.
+  IDFCalculator IDFs(DT);
+  IDFs.setDefiningBlocks(DefiningBlocks);
+  SmallVector<BasicBlock *, 32> IDFBlocks;
+  IDFs.calculate(IDFBlocks);
+  SmallPtrSet<BasicBlock *, 32> PhiBlocks(IDFBlocks.begin(), IDFBlocks.end());
+  for (BasicBlock &BB : F) {
+    if (!PhiBlocks.count(&BB))
+      continue;
+    MemoryPhi *Phi = new MemoryPhi(&BB, NextID++);
+    Accesses.emplace_back(Phi);
+    BlockPhis[&BB] = Phi;
+    AccessList &BBAccesses = BlockAccesses[&BB];
+    BBAccesses.insert(BBAccesses.begin(), Phi);
+  }
+
+  // Rename. Walking the dominator tree in preorder, a block without a
+  // MemoryPhi sees the memory state its immediate dominator ends with.
+  DenseMap<const BasicBlock *, MemoryAccess *> OutgoingAccess;
+  auto RenameBlock = [&](BasicBlock *BB, MemoryAccess *Current) {
+    auto AI = BlockAccesses.find(BB);
+    if (AI != BlockAccesses.end())
+      for (MemoryAccess *MA : AI->second) {
+        MemoryUseOrDef *UseOrDef = dyn_cast<MemoryUseOrDef>(MA);
+        if (!UseOrDef)
+          continue;
+        UseOrDef->setDefiningAccess(Current);
+        if (isa<MemoryDef>(UseOrDef))
+          Current = UseOrDef;
+      }
+    OutgoingAccess[BB] = Current;
+  };
+
+  for (DomTreeNode *Node : depth_first(DT.getRootNode())) {
+    BasicBlock *BB = Node->getBlock();
+    MemoryAccess *Current;
+    if (MemoryPhi *Phi = BlockPhis.lookup(BB))
+      Current = Phi;
+    else if (DomTreeNode *IDom = Node->getIDom())
+      Current = OutgoingAccess[IDom->getBlock()];
+    else
+      Current = LiveOnEntryDef.get();
+    RenameBlock(BB, Current);
+  }
+
+  // Nothing is known about the memory state in unreachable code.
+  for (BasicBlock &BB : F)
+    if (!DT.isReachableFromEntry(&BB))
+      RenameBlock(&BB, LiveOnEntryDef.get());
+
+  // Fill in the MemoryPhis. Edges from unreachable blocks are ignored, as no
+  // memory state flows along them.
+  for (BasicBlock &BB : F) {
+    if (!DT.isReachableFromEntry(&BB))
+      continue;
+    for (BasicBlock *Succ : successors(&BB))
+      if (MemoryPhi *Phi = BlockPhis.lookup(Succ))
+        Phi->addIncoming(OutgoingAccess[&BB], &BB);
+  }
+}
+
+//===----------------------------------------------------------------------===//
+// Queries and updates
+//===----------------------------------------------------------------------===//
+
+MemoryAccess *MemorySSA::getClobberingMemoryAccess(MemoryAccess *Start,
+                                                   const MemoryLocation &Loc) {
+  if (MemoryUse *Use = dyn_cast<MemoryUse>(Start))
+    Start = Use->getDefiningAccess();
+
+  auto CacheKey = std::make_pair(Start, Loc);
+  auto CacheI = ClobberCache.find(CacheKey);
+  if (CacheI != ClobberCache.end())
+    return CacheI->second;
+
+  // Walk upwards from Start, looking through MemoryPhis, and collect the
+  // first clobber on every path. If all paths reach the same clobber it is
+  // the answer. Otherwise the first MemoryPhi on the way is the nearest
+  // access we can name. So is a MemoryPhi the walk can't look through.
+  MemoryAccess *Result = nullptr;
+  MemoryAccess *FirstPhi = nullptr;
+  MemoryAccess *Clobber = nullptr;
+  SmallPtrSet<MemoryAccess *, 16> Visited;
+  SmallVector<MemoryAccess *, 8> Worklist;
+  Worklist.push_back(Start);
+  unsigned Steps = 0;
+  while (!Result && !Worklist.empty()) {
+    MemoryAccess *MA = Worklist.pop_back_val();
+    while (Visited.insert(MA).second) {
+      if (++Steps > MaxWalkSteps) {
+        // MA is on every path from Start when no phi has been seen yet.
+        Result = FirstPhi ? FirstPhi : MA;
+        break;
+      }
+
+      if (MemoryPhi *Phi = dyn_cast<MemoryPhi>(MA)) {
+        if (!FirstPhi)
+          FirstPhi = Phi;
+        if (!isSameLocationAbove(Loc, Phi)) {
+          Result = FirstPhi;
+          break;
+        }
+        for (unsigned I = 0, E = Phi->getNumIncomingValues(); I != E; ++I)
+          Worklist.push_back(Phi->getIncomingValue(I));
+        break;
+      }
+
+      MemoryDef *Def = cast<MemoryDef>(MA);
+      if (isLiveOnEntryDef(Def) ||
+          (AA.getModRefInfo(Def->getMemoryInst(), Loc) & AliasAnalysis::Mod)) {
+        if (Clobber) {
+          // Two different clobbers can only be reached through a phi.
+          assert(FirstPhi && "Different clobbers on a single path?");
+          Result = FirstPhi;
+        }
+        Clobber = Def;
+        break;
+      }
+      MA = Def->getDefiningAccess();
+    }
+  }
+
+  if (!Result)
+    Result = Clobber ? Clobber : FirstPhi;
+  ClobberCache[CacheKey] = Result;
+  if (Loc.Ptr) {
+    std::unique_ptr<ClobberCacheVH> &VH = ClobberCacheHandles[Loc.Ptr];
+    if (!VH)
+      VH = llvm::make_unique<ClobberCacheVH>(const_cast<Value *>(Loc.Ptr),
+                                             this);
+  }
+  return Result;
+}
+
+bool MemorySSA::isSameLocationAbove(const MemoryLocation &Loc,
+                                    const MemoryPhi *Phi) const {
+  // Alias queries compare the values the pointers have in one execution. On
+  // a path around a loop, the accesses above the phi belong to an earlier
+  // iteration, in which a pointer computed inside the loop may have pointed
+  // elsewhere. A pointer computed before the phi's block has one value on
+  // every path through it.
+  if (!Loc.Ptr)
+    return false;
+  const Instruction *I = dyn_cast<Instruction>(Loc.Ptr);
+  return !I || DT.properlyDominates(I->getParent(), Phi->getBlock());
+}
+
+MemoryAccess *MemorySSA::getClobberingMemoryAccess(const LoadInst *LI) {
+  MemoryUseOrDef *MA = getMemoryAccess(LI);
+  if (!MA)
+    return nullptr;
+  return getClobberingMemoryAccess(MA->getDefiningAccess(),
+                                   MemoryLocation::get(LI));
+}
+
+void MemorySSA::removeMemoryAccess(const Instruction *I) {
+  // Even an instruction without an access may be the pointer of a cached
+  // query.
+  clearClobberCache();
+
+  auto It = InstructionAccesses.find(I);
+  if (It == InstructionAccesses.end())
+    return;
+  MemoryUseOrDef *MA = It->second;
+  InstructionAccesses.erase(It);
+
+  MA->replaceAllUsesWith(MA->getDefiningAccess());
+  MA->setDefiningAccess(nullptr);
+
+  auto AI = BlockAccesses.find(MA->getBlock());
+  AccessList &BBAccesses = AI->second;
+  BBAccesses.erase(std::find(BBAccesses.begin(), BBAccesses.end(), MA));
+  if (BBAccesses.empty())
+    BlockAccesses.erase(AI);
+}
+
+void MemorySSA::clearClobberCache() {
+  ClobberCache.clear();
+  ClobberCacheHandles.clear();
+}
+
+void MemorySSA::ClobberCacheVH::deleted() {
+  // This destroys the handle itself, which ValueHandleBase allows.
+  MSSA->clearClobberCache();
+}
+
+void MemorySSA::print(raw_ostream &OS) const {
+  for (BasicBlock &BB : F) {
+    if (BB.hasName())
+      OS << BB.getName();
+    else
+      BB.printAsOperand(OS, false);
+    OS << ":\n";
+    if (MemoryPhi *Phi = getMemoryPhi(&BB))
+      OS << "; " << *Phi << "\n";
+    for (Instruction &I : BB) {
+      if (MemoryUseOrDef *MA = getMemoryAccess(&I))
+        OS << "; " << *MA << "\n";
+      OS << I << "\n";
+    }
+  }
+}
+
+void MemorySSA::dump() const { print(dbgs()); }
+
+void MemorySSA::verifyMemorySSA() const {
+#ifndef NDEBUG
+  // Return true if the definition DefMA is available at the end of BB, or
+  // at UseMA if UseMA is in BB.
+  auto IsAvailable = [&](const MemoryAccess *DefMA, const BasicBlock *BB,
+                         const MemoryAccess *UseMA) {
+    if (isLiveOnEntryDef(DefMA))
+      return true;
+    if (DefMA->getBlock() != BB)
+      return DT.dominates(DefMA->getBlock(), BB);
+    if (!UseMA)
+      return true;
+    const AccessList &BBAccesses = BlockAccesses.find(BB)->second;
+    auto DefI = std::find(BBAccesses.begin(), BBAccesses.end(), DefMA);
+    auto UseI = std::find(BBAccesses.begin(), BBAccesses.end(), UseMA);
+    return DefI < UseI;
+  };
+  auto IsUserOf = [](const MemoryAccess *U, const MemoryAccess *DefMA) {
+    return std::find(DefMA->user_begin(), DefMA->user_end(), U) !=
+           DefMA->user_end();
+  };
+
+  for (const auto &Entry : BlockAccesses) {
+    const BasicBlock *BB = Entry.first;
+    for (MemoryAccess *MA : Entry.second) {
+      assert(MA->getBlock() == BB && "Access is in the wrong block list!");
+      if (MemoryUseOrDef *UseOrDef = dyn_cast<MemoryUseOrDef>(MA)) {
+        MemoryAccess *DefMA = UseOrDef->getDefiningAccess();
+        assert(DefMA && "Access without a definition!");
+        assert(InstructionAccesses.lookup(UseOrDef->getMemoryInst()) == MA &&
+               "Access is not mapped from its instruction!");
+        assert((!DT.isReachableFromEntry(BB) || IsAvailable(DefMA, BB, MA)) &&
+               "Access is not dominated by its definition!");
+        assert(IsUserOf(MA, DefMA) && "Use list is missing a use!");
+        continue;
+      }
+      MemoryPhi *Phi = cast<MemoryPhi>(MA);
+      for (unsigned I = 0, E = Phi->getNumIncomingValues(); I != E; ++I) {
+        MemoryAccess *DefMA = Phi->getIncomingValue(I);
+        assert(IsAvailable(DefMA, Phi->getIncomingBlock(I), nullptr) &&
+               "Phi operand is not available in its predecessor!");
+        assert(IsUserOf(MA, DefMA) && "Use list is missing a phi!");
+      }
+    }
+  }
+  (void)IsAvailable;
+  (void)IsUserOf;
+#endif
+}
+
+//===----------------------------------------------------------------------===//
+// MemorySSAPrinterPass
+//===----------------------------------------------------------------------===//
+
+namespace {
+/// MemorySSAPrinterPass - Build, verify and print the memory SSA form of each
+/// function. Use with -analyze.
+class MemorySSAPrinterPass : public FunctionPass {
+  std::unique_ptr<MemorySSA> MSSA;
+
+public:
+  static char ID; // Pass identification, replacement for typeid
+  MemorySSAPrinterPass() : FunctionPass(ID) {
+    initializeMemorySSAPrinterPassPass(*PassRegistry::getPassRegistry());
+  }
+
+  bool runOnFunction(Function &F) override {
+    MSSA.reset(new MemorySSA(F, getAnalysis<AliasAnalysis>(),
+                             getAnalysis<DominatorTreeWrapperPass>()
+                                 .getDomTree()));
+    MSSA->verifyMemorySSA();
+    return false;
+  }
+
+  void print(raw_ostream &OS, const Module *) const override {
+    if (MSSA)
+      MSSA->print(OS);
+  }
+
+  void releaseMemory() override { MSSA.reset(); }
+
+  void getAnalysisUsage(AnalysisUsage &AU) const override {
+    AU.setPreservesAll();
+    AU.addRequired<AliasAnalysis>();
+    AU.addRequired<DominatorTreeWrapperPass>();
+  }
+};
+}
+
+char MemorySSAPrinterPass::ID = 0;
+INITIALIZE_PASS_BEGIN(MemorySSAPrinterPass, "print-memoryssa",
+                      "Print Memory SSA", false, true)
+INITIALIZE_PASS_DEPENDENCY(DominatorTreeWrapperPass)
+INITIALIZE_AG_DEPENDENCY(AliasAnalysis)
+INITIALIZE_PASS_END(MemorySSAPrinterPass, "print-memoryssa",
+                    "Print Memory SSA", false, true)
@@ -736,14 +736,16 @@ private:
 
   /// \brief The descriptor for a strided memory access.
   struct StrideDescriptor {
-    StrideDescriptor(int Stride, const SCEV *Scev, unsigned Size,
-                     unsigned Align)
-        : Stride(Stride), Scev(Scev), Size(Size), Align(Align) {}
+    StrideDescriptor(int Stride, const SCEV *Scev, const SCEV *Base,
+                     unsigned Size, unsigned Align)
+        : Stride(Stride), Scev(Scev), Base(Base), Size(Size), Align(Align) {}
 
-    StrideDescriptor() : Stride(0), Scev(nullptr), Size(0), Align(0) {}
+    StrideDescriptor()
+        : Stride(0), Scev(nullptr), Base(nullptr), Size(0), Align(0) {}
 
     int Stride; // The access's stride. It is negative for a reverse access.
     const SCEV *Scev; // The scalar expression of this access
+    const SCEV *Base; // The pointer base of Scev.
     unsigned Size;    // The size of the memory object.
     unsigned Align;   // The alignment of this access.
   };
@@ -1132,9 +1134,13 @@ private:
   unsigned expectedCost(unsigned VF);
 
   /// Returns the execution time cost of an instruction for a given vector
-  /// width. Vector width of one means scalar.
+  /// width. Vector width of one means scalar. The result is memoized, and
+  /// shared between all widths for instructions which stay uniform.
   unsigned getInstructionCost(Instruction *I, unsigned VF);
 
+  /// Computes the cost returned by getInstructionCost.
+  unsigned computeInstructionCost(Instruction *I, unsigned VF);
+
   /// Returns whether the instruction is a load or store and will be a emitted
   /// as a vector operation.
   bool isConsecutiveLoadOrStore(Instruction *I);
@@ -1165,6 +1171,12 @@ private:
   const Function *TheFunction;
   // Loop Vectorize Hint.
   const LoopVectorizeHints *Hints;
+
+  /// Memoized results of expectedCost, by vector width.
+  DenseMap<unsigned, unsigned> LoopCosts;
+  /// Memoized results of getInstructionCost, by instruction and the vector
+  /// width it is actually costed at.
+  DenseMap<std::pair<Instruction *, unsigned>, unsigned> InstructionCosts;
 };
 
 /// Utility class for getting and setting loop vectorizer hints in the form
@@ -4467,7 +4479,8 @@ void InterleavedAccessInfo::collectConstStridedAccesses(
     if (!Align)
       Align = DL.getABITypeAlignment(PtrTy->getElementType());
 
-    StrideAccesses[I] = StrideDescriptor(Stride, Scev, Size, Align);
+    StrideAccesses[I] = StrideDescriptor(Stride, Scev, SE->getPointerBase(Scev),
+                                         Size, Align);
   }
 }
 
@@ -4544,6 +4557,11 @@ void InterleavedAccessInfo::analyzeInterleaving(
       if (DesB.Stride != DesA.Stride || DesB.Size != DesA.Size)
         continue;
 
+      // Accesses off different bases can't be a constant distance apart, so
+      // don't bother building the difference of their expressions.
+      if (DesB.Base != DesA.Base)
+        continue;
+
       // Calculate the distance and prepare for the rule 3.
       const SCEVConstant *DistToA =
           dyn_cast<SCEVConstant>(SE->getMinusSCEV(DesB.Scev, DesA.Scev));
@@ -5020,6 +5038,12 @@ LoopVectorizationCostModel::calculateRegisterUsage() {
 }
 
 unsigned LoopVectorizationCostModel::expectedCost(unsigned VF) {
+  // The cost of a width is asked for again when it is forced, and when the
+  // unroll factor is chosen.
+  auto Cached = LoopCosts.find(VF);
+  if (Cached != LoopCosts.end())
+    return Cached->second;
+
   unsigned Cost = 0;
 
   // For each block.
@@ -5058,6 +5082,7 @@ unsigned LoopVectorizationCostModel::expectedCost(unsigned VF) {
     Cost += BlockCost;
   }
 
+  LoopCosts[VF] = Cost;
   return Cost;
 }
 
@@ -5122,6 +5147,22 @@ static bool isStrideMul(Instruction *I, LoopVectorizationLegality *Legal) {
 
 unsigned
 LoopVectorizationCostModel::getInstructionCost(Instruction *I, unsigned VF) {
+  if (Legal->isUniformAfterVectorization(I))
+    VF = 1;
+
+  auto Key = std::make_pair(I, VF);
+  auto Cached = InstructionCosts.find(Key);
+  if (Cached != InstructionCosts.end())
+    return Cached->second;
+
+  unsigned Cost = computeInstructionCost(I, VF);
+  InstructionCosts[Key] = Cost;
+  return Cost;
+}
+
+unsigned
+LoopVectorizationCostModel::computeInstructionCost(Instruction *I,
+                                                   unsigned VF) {
   // If we know that this instruction will remain uniform, check the cost of
   // the scalar version.
   if (Legal->isUniformAfterVectorization(I))
@@ -42,6 +42,7 @@
 #include "llvm/Pass.h"
 #include "llvm/Support/CommandLine.h"
 #include "llvm/Support/Debug.h"
+#include "llvm/Support/MathExtras.h"
 #include "llvm/Support/raw_ostream.h"
 #include "llvm/Transforms/Utils/VectorUtils.h"
 #include <algorithm>
@@ -54,6 +55,8 @@ using namespace llvm;
 #define DEBUG_TYPE "SLP"
 
 STATISTIC(NumVectorInstructions, "Number of vector instructions generated");
+STATISTIC(NumBudgetExhausted,
+          "Number of functions which ran out of SLP tree budget");
 
 static cl::opt<int>
     SLPCostThreshold("slp-threshold", cl::init(0), cl::Hidden,
@@ -69,6 +72,20 @@ static cl::opt<bool> ShouldStartVectorizeHorAtStore(
     cl::desc(
         "Attempt to vectorize horizontal reductions feeding into a store"));
 
+static cl::opt<unsigned>
+MaxVecRegSize("slp-max-reg-size", cl::init(128), cl::Hidden,
+              cl::desc("Attempt to vectorize for this register size in bits"));
+
+static cl::opt<unsigned>
+MaxStoreLookup("slp-max-store-lookup", cl::init(16), cl::Hidden,
+               cl::desc("Maximum number of stores searched at once for "
+                        "consecutive chains"));
+
+static cl::opt<unsigned>
+TreeBudget("slp-tree-budget", cl::init(10000), cl::Hidden,
+           cl::desc("Maximum number of trees built per function, to bound "
+                    "compile time (0 = unlimited)"));
+
 namespace {
 
 static const unsigned MinVecRegSize = 128;
@@ -345,9 +362,9 @@ public:
   BoUpSLP(Function *Func, ScalarEvolution *Se, TargetTransformInfo *Tti,
           TargetLibraryInfo *TLi, AliasAnalysis *Aa, LoopInfo *Li,
           DominatorTree *Dt, AssumptionCache *AC)
-      : NumLoadsWantToKeepOrder(0), NumLoadsWantToChangeOrder(0), F(Func),
-        SE(Se), TTI(Tti), TLI(TLi), AA(Aa), LI(Li), DT(Dt),
-        Builder(Se->getContext()) {
+      : NumLoadsWantToKeepOrder(0), NumLoadsWantToChangeOrder(0),
+        NumTreesBuilt(0), F(Func), SE(Se), TTI(Tti), TLI(TLi), AA(Aa), LI(Li),
+        DT(Dt), Builder(Se->getContext()) {
     CodeMetrics::collectEphemeralValues(F, AC, EphValues);
   }
 
@@ -365,6 +382,8 @@ public:
 
   /// Construct a vectorizable tree that starts at \p Roots, ignoring users for
   /// the purpose of scheduling and extraction in the \p UserIgnoreLst.
+  /// Once -slp-tree-budget trees have been built for the function, the tree
+  /// is left empty, which getTreeCost() rates as not profitable.
   void buildTree(ArrayRef<Value *> Roots,
                  ArrayRef<Value *> UserIgnoreLst = None);
 
@@ -874,6 +893,9 @@ private:
   // Number of load-bundles of size 2, which are consecutive loads if reversed.
   int NumLoadsWantToChangeOrder;
 
+  /// The number of calls to buildTree() so far, for -slp-tree-budget.
+  unsigned NumTreesBuilt;
+
   // Analysis and block reference.
   Function *F;
   ScalarEvolution *SE;
@@ -899,6 +921,13 @@ void BoUpSLP::buildTree(ArrayRef<Value *> Roots,
   UserIgnoreList = UserIgnoreLst;
   if (!getSameType(Roots))
     return;
+  if (TreeBudget && NumTreesBuilt++ >= TreeBudget) {
+    if (NumTreesBuilt == TreeBudget + 1) {
+      DEBUG(dbgs() << "SLP: Out of tree budget in " << F->getName() << ".\n");
+      ++NumBudgetExhausted;
+    }
+    return;
+  }
   buildTree_rec(Roots, 0);
 
   // Collect the values that we need to extract from the tree.
@@ -1633,6 +1662,11 @@ bool BoUpSLP::isFullyVectorizableTinyTree() {
   DEBUG(dbgs() << "SLP: Check whether the tree with height " <<
         VectorizableTree.size() << " is fully vectorizable .\n");
 
+  // A single bundle which feeds a horizontal reduction, such as the loads of
+  // a checksum, is fully vectorizable unless it has to be gathered.
+  if (VectorizableTree.size() == 1 && !UserIgnoreList.empty())
+    return !VectorizableTree[0].NeedToGather;
+
   // We only handle trees of height 2.
   if (VectorizableTree.size() != 2)
     return false;
@@ -3191,40 +3225,45 @@ bool SLPVectorizer::vectorizeStoreChain(ArrayRef<Value *> Chain,
   Type *StoreTy = cast<StoreInst>(Chain[0])->getValueOperand()->getType();
   auto &DL = cast<StoreInst>(Chain[0])->getModule()->getDataLayout();
   unsigned Sz = DL.getTypeSizeInBits(StoreTy);
-  unsigned VF = MinVecRegSize / Sz;
+  unsigned MinVF = MinVecRegSize / Sz;
 
-  if (!isPowerOf2_32(Sz) || VF < 2)
+  if (!isPowerOf2_32(Sz) || MinVF < 2)
     return false;
 
   // Keep track of values that were deleted by vectorizing in the loop below.
   SmallVector<WeakVH, 8> TrackValues(Chain.begin(), Chain.end());
 
   bool Changed = false;
-  // Look for profitable vectorizable trees at all offsets, starting at zero.
-  for (unsigned i = 0, e = ChainLen; i < e; ++i) {
-    if (i + VF > e)
-      break;
+  // Try the widest vectors first, and leave what they could not vectorize to
+  // the narrower ones.
+  for (unsigned VF = std::max(MaxVecRegSize / Sz, MinVF); VF >= MinVF;
+       VF /= 2) {
+    // Look for profitable vectorizable trees at all offsets, starting at zero.
+    for (unsigned i = 0, e = ChainLen; i < e; ++i) {
+      if (i + VF > e)
+        break;
 
-    // Check that a previous iteration of this loop did not delete the Value.
-    if (hasValueBeenRAUWed(Chain, TrackValues, i, VF))
-      continue;
+      // Check that a previous iteration of this loop did not delete the Value.
+      if (hasValueBeenRAUWed(Chain, TrackValues, i, VF))
+        continue;
 
-    DEBUG(dbgs() << "SLP: Analyzing " << VF << " stores at offset " << i
-          << "\n");
-    ArrayRef<Value *> Operands = Chain.slice(i, VF);
+      DEBUG(dbgs() << "SLP: Analyzing " << VF << " stores at offset " << i
+            << "\n");
+      ArrayRef<Value *> Operands = Chain.slice(i, VF);
 
-    R.buildTree(Operands);
+      R.buildTree(Operands);
 
-    int Cost = R.getTreeCost();
+      int Cost = R.getTreeCost();
 
-    DEBUG(dbgs() << "SLP: Found cost=" << Cost << " for VF=" << VF << "\n");
-    if (Cost < CostThreshold) {
-      DEBUG(dbgs() << "SLP: Decided to vectorize cost=" << Cost << "\n");
-      R.vectorizeTree();
+      DEBUG(dbgs() << "SLP: Found cost=" << Cost << " for VF=" << VF << "\n");
+      if (Cost < CostThreshold) {
+        DEBUG(dbgs() << "SLP: Decided to vectorize cost=" << Cost << "\n");
+        R.vectorizeTree();
 
-      // Move to the next bundle.
-      i += VF - 1;
-      Changed = true;
+        // Move to the next bundle.
+        i += VF - 1;
+        Changed = true;
+      }
     }
   }
 
@@ -3569,17 +3608,28 @@ public:
     const DataLayout &DL = B->getModule()->getDataLayout();
     ReductionOpcode = B->getOpcode();
     ReducedValueOpcode = 0;
-    ReduxWidth = MinVecRegSize / DL.getTypeSizeInBits(Ty);
+    ReduxWidth = std::max<unsigned>(MaxVecRegSize, MinVecRegSize) /
+                 DL.getTypeSizeInBits(Ty);
     ReductionRoot = B;
     ReductionPHI = Phi;
 
-    if (ReduxWidth < 4)
+    if (ReduxWidth < 2)
       return false;
 
-    // We currently only support adds.
-    if (ReductionOpcode != Instruction::Add &&
-        ReductionOpcode != Instruction::FAdd)
+    // Floating point operations are only associative with unsafe algebra,
+    // which is checked for each operation below.
+    switch (ReductionOpcode) {
+    case Instruction::Add:
+    case Instruction::FAdd:
+    case Instruction::Mul:
+    case Instruction::FMul:
+    case Instruction::And:
+    case Instruction::Or:
+    case Instruction::Xor:
+      break;
+    default:
       return false;
+    }
 
     // Post order traverse the reduction tree starting at B. We only handle true
     // trees containing only binary operators.
@@ -3625,7 +3675,7 @@ public:
       BinaryOperator *Next = dyn_cast<BinaryOperator>(NextV);
       if (Next)
         Stack.push_back(std::make_pair(Next, 0));
-      else if (NextV != Phi)
+      else if (NextV != Phi && !addReducedLeaf(NextV, B->getParent()))
         return false;
     }
     return true;
@@ -3638,7 +3688,7 @@ public:
       return false;
 
     unsigned NumReducedVals = ReducedVals.size();
-    if (NumReducedVals < ReduxWidth)
+    if (NumReducedVals < 2)
       return false;
 
     Value *VectorizedTree = nullptr;
@@ -3648,29 +3698,40 @@ public:
     Builder.SetFastMathFlags(Unsafe);
     unsigned i = 0;
 
-    for (; i < NumReducedVals - ReduxWidth + 1; i += ReduxWidth) {
-      V.buildTree(makeArrayRef(&ReducedVals[i], ReduxWidth), ReductionOps);
-
-      // Estimate cost.
-      int Cost = V.getTreeCost() + getReductionCost(TTI, ReducedVals[i]);
-      if (Cost >= -SLPCostThreshold)
-        break;
-
-      DEBUG(dbgs() << "SLP: Vectorizing horizontal reduction at cost:" << Cost
-                   << ". (HorRdx)\n");
-
-      // Vectorize a tree.
-      DebugLoc Loc = cast<Instruction>(ReducedVals[i])->getDebugLoc();
-      Value *VectorizedRoot = V.vectorizeTree();
+    // Reduce the values in chunks of the widest vector that fits, then try
+    // narrower vectors on what is left.
+    unsigned Width = std::min<unsigned>(ReduxWidth,
+                                        PowerOf2Floor(NumReducedVals));
+    for (; Width >= 2; Width /= 2) {
+      ReduxWidth = Width;
+      for (; i + ReduxWidth <= NumReducedVals; i += ReduxWidth) {
+        V.buildTree(makeArrayRef(&ReducedVals[i], ReduxWidth), ReductionOps);
+
+        // Estimate cost.
+        int TreeCost = V.getTreeCost();
+        if (TreeCost == INT_MAX)
+          break;
+        int Cost = TreeCost + getReductionCost(TTI, ReducedVals[i]);
+        if (Cost >= -SLPCostThreshold)
+          break;
 
-      // Emit a reduction.
-      Value *ReducedSubTree = emitReduction(VectorizedRoot, Builder);
-      if (VectorizedTree) {
-        Builder.SetCurrentDebugLocation(Loc);
-        VectorizedTree = createBinOp(Builder, ReductionOpcode, VectorizedTree,
-                                     ReducedSubTree, "bin.rdx");
-      } else
-        VectorizedTree = ReducedSubTree;
+        DEBUG(dbgs() << "SLP: Vectorizing horizontal reduction at cost:"
+                     << Cost << ". (HorRdx)\n");
+
+        // Vectorize a tree.
+        DebugLoc Loc = cast<Instruction>(ReducedVals[i])->getDebugLoc();
+        Value *VectorizedRoot = V.vectorizeTree();
+
+        // Emit a reduction.
+        Value *ReducedSubTree = emitReduction(VectorizedRoot, Builder);
+        if (VectorizedTree) {
+          Builder.SetCurrentDebugLocation(Loc);
+          VectorizedTree = createBinOp(Builder, ReductionOpcode,
+                                       VectorizedTree, ReducedSubTree,
+                                       "bin.rdx");
+        } else
+          VectorizedTree = ReducedSubTree;
+      }
     }
 
     if (VectorizedTree) {
@@ -3694,6 +3755,20 @@ public:
 
 private:
 
+  /// \brief Add an operand of the reduction tree which is not a binary
+  /// operator, such as the loads of a checksum, as a value to reduce.
+  bool addReducedLeaf(Value *V, BasicBlock *BB) {
+    Instruction *I = dyn_cast<Instruction>(V);
+    if (!I || I->getParent() != BB || !I->hasOneUse())
+      return false;
+    if (!ReducedValueOpcode)
+      ReducedValueOpcode = I->getOpcode();
+    else if (ReducedValueOpcode != I->getOpcode())
+      return false;
+    ReducedVals.push_back(I);
+    return true;
+  }
+
   /// \brief Calcuate the cost of a reduction.
   int getReductionCost(TargetTransformInfo *TTI, Value *FirstReducedVal) {
     Type *ScalarTy = FirstReducedVal->getType();
@@ -3994,9 +4069,11 @@ bool SLPVectorizer::vectorizeStoreChains(BoUpSLP &R) {
     DEBUG(dbgs() << "SLP: Analyzing a store chain of length "
           << it->second.size() << ".\n");
 
-    // Process the stores in chunks of 16.
-    for (unsigned CI = 0, CE = it->second.size(); CI < CE; CI+=16) {
-      unsigned Len = std::min<unsigned>(CE - CI, 16);
+    // Process the stores in chunks of MaxStoreLookup, since the search for
+    // consecutive pairs is quadratic.
+    unsigned ChunkSize = std::max(2U, (unsigned)MaxStoreLookup);
+    for (unsigned CI = 0, CE = it->second.size(); CI < CE; CI += ChunkSize) {
+      unsigned Len = std::min<unsigned>(CE - CI, ChunkSize);
       Changed |= vectorizeStores(makeArrayRef(&it->second[CI], Len),
                                  -SLPCostThreshold, R);
     }
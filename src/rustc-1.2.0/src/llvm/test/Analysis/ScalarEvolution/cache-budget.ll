@@ -0,0 +1,51 @@
+; Trimming the caches to a tiny budget must not change any result.
+; RUN: opt -analyze -scalar-evolution < %s | FileCheck %s
+; RUN: opt -analyze -scalar-evolution -scev-cache-budget=1 < %s | FileCheck %s
+; RUN: opt -analyze -scalar-evolution -scev-cache-budget=1 -scev-stats < %s \
+; RUN:     2>&1 >/dev/null | FileCheck %s --check-prefix=STATS
+
+; CHECK-LABEL: Determining loop execution counts for: @nest
+; CHECK-NEXT: Loop %second: backedge-taken count is 30
+; CHECK-NEXT: Loop %second: max backedge-taken count is 30
+; CHECK-NEXT: Loop %inner: backedge-taken count is (-1 + (1 smax %m))
+; CHECK-NEXT: Loop %inner: max backedge-taken count is 9223372036854775806
+; CHECK-NEXT: Loop %outer: backedge-taken count is ((-1 + (2 smax %n)) /u 2)
+; CHECK-NEXT: Loop %outer: max backedge-taken count is 4611686018427387902
+
+; The budget was exceeded, and both cache tiers were flushed.
+; STATS-LABEL: ScalarEvolution cache statistics for function 'nest':
+; STATS: Cache memory: {{[0-9]+}} bytes (budget 1024 bytes, {{[1-9][0-9]*}} expression cache flushes, {{[1-9][0-9]*}} value map flushes)
+
+target datalayout = "e-m:e-i64:64-f80:128-n8:16:32:64-S128"
+
+define void @nest(i32* %a, i64 %n, i64 %m) {
+entry:
+  br label %outer
+
+outer:
+  %i = phi i64 [ 0, %entry ], [ %i.next, %outer.latch ]
+  br label %inner
+
+inner:
+  %j = phi i64 [ 0, %outer ], [ %j.next, %inner ]
+  %k = add i64 %i, %j
+  %p = getelementptr i32, i32* %a, i64 %k
+  store i32 0, i32* %p
+  %j.next = add nuw nsw i64 %j, 1
+  %jc = icmp slt i64 %j.next, %m
+  br i1 %jc, label %inner, label %outer.latch
+
+outer.latch:
+  %i.next = add nuw nsw i64 %i, 2
+  %ic = icmp slt i64 %i.next, %n
+  br i1 %ic, label %outer, label %second
+
+second:
+  %x = phi i32 [ 100, %outer.latch ], [ %x.next, %second ]
+  %x.next = add nsw i32 %x, -3
+  %xc = icmp sgt i32 %x.next, 7
+  br i1 %xc, label %second, label %exit
+
+exit:
+  ret void
+}
@@ -0,0 +1,103 @@
+; RUN: llc -O2 -combiner-max-visits-per-node=1 -verify-machineinstrs < %s | FileCheck %s
+; RUN: llc -O2 -combiner-max-visits-per-node=2 -verify-machineinstrs < %s | FileCheck %s
+; RUN: llc -O2 -filetype=obj < %s > %t.default.o
+; RUN: llc -O2 -combiner-max-visits-per-node=1 -filetype=obj < %s > %t.limit.o
+; RUN: cmp %t.default.o %t.limit.o
+; RUN: llc -O2 -combiner-max-visits-per-node=1 -stats -o /dev/null < %s 2>&1 | FileCheck %s --check-prefix=STATS
+; RUN: llc -O2 -stats -o /dev/null < %s 2>&1 | FileCheck %s --check-prefix=NOLIMIT
+; RUN: llc -O2 -combiner-stats-json=%t.json -o /dev/null < %s
+; RUN: FileCheck %s --check-prefix=JSON < %t.json
+; REQUIRES: asserts
+
+; Nodes which come back to the combiner more often than the limit are left as
+; they are. The code must still be valid, and here the nodes which are
+; revisited have nothing left to fold, so the code doesn't change.
+
+; STATS: ... DAG Combines By Opcode ...
+; STATS: Opcode Visits Combines Max/Node Seconds
+; STATS: shl {{[0-9]+}} {{[1-9][0-9]*}} 1 {{[0-9]+\.[0-9]+}}
+; STATS: ... Statistics Collected ...
+; STATS: dagcombine - Number of dag node visits skipped for exceeding the visit limit
+; STATS: dagcombine - Number of dag nodes visited by the combiner
+; STATS: dagcombine - Number of repeat visits to a dag node in one run
+
+; NOLIMIT: ... DAG Combines By Opcode ...
+; NOLIMIT-NOT: visits skipped for exceeding the visit limit
+; NOLIMIT: dagcombine - Number of repeat visits to a dag node in one run
+; NOLIMIT-NOT: visits skipped for exceeding the visit limit
+
+; JSON: {
+; JSON-NEXT: "combines": [
+; JSON-DAG: { "opcode": "CopyToReg", "visits": {{[0-9]+}}, "combines": 0, "max_visits_per_node": {{[2-9]|[1-9][0-9]+}}, "seconds": {{[0-9]+\.[0-9]+}} },
+; JSON-DAG: { "opcode": "shl", "visits": {{[0-9]+}}, "combines": {{[1-9][0-9]*}}, "max_visits_per_node": {{[0-9]+}}, "seconds": {{[0-9]+\.[0-9]+}} },
+; JSON-DAG: { "opcode": "vector_shuffle", "visits": {{[0-9]+}}, "combines": {{[1-9][0-9]*}}, "max_visits_per_node": {{[0-9]+}}, "seconds": {{[0-9]+\.[0-9]+}} }
+; JSON: ]
+; JSON-NEXT: }
+
+target triple = "x86_64-unknown-linux-gnu"
+
+; CHECK-LABEL: shuf:
+; CHECK: punpckldq
+; CHECK-NEXT: pslld $2, %xmm0
+; CHECK-NEXT: paddd
+; CHECK-NEXT: pand
+; CHECK-NEXT: retq
+define <4 x i32> @shuf(<4 x i32> %a, <4 x i32> %b) {
+  %s = shufflevector <4 x i32> %a, <4 x i32> %b, <4 x i32> <i32 0, i32 5, i32 2, i32 7>
+  %t = shufflevector <4 x i32> %s, <4 x i32> %a, <4 x i32> <i32 1, i32 0, i32 3, i32 2>
+  %u = add <4 x i32> %t, <i32 1, i32 1, i32 1, i32 1>
+  %v = shl <4 x i32> %u, <i32 2, i32 2, i32 2, i32 2>
+  %w = and <4 x i32> %v, <i32 255, i32 255, i32 255, i32 255>
+  ret <4 x i32> %w
+}
+
+; CHECK-LABEL: arith:
+; CHECK: movzwl %di, %eax
+; CHECK-NEXT: shlq $8, %rax
+; CHECK-NEXT: shrq $4, %rax
+; CHECK-NEXT: orq %rsi, %rax
+; CHECK-NEXT: notq %rax
+; CHECK: cmovaq %rax, %rdi
+; CHECK-NEXT: movswq %di, %rax
+; CHECK: imulq
+; CHECK: retq
+define i64 @arith(i64 %x, i64 %y, i32* %p) {
+  %a = and i64 %x, 65535
+  %b = shl i64 %a, 8
+  %c = lshr i64 %b, 4
+  %d = or i64 %c, %y
+  %e = xor i64 %d, -1
+  %f = mul i64 %e, 12
+  %l = load i32, i32* %p
+  %lz = zext i32 %l to i64
+  %g = add i64 %f, %lz
+  %cmp = icmp ugt i64 %g, 100
+  %s = select i1 %cmp, i64 %g, i64 %x
+  %tr = trunc i64 %s to i16
+  %se = sext i16 %tr to i64
+  %h = sdiv i64 %se, 7
+  store i32 %l, i32* %p
+  ret i64 %h
+}
+
+; CHECK-LABEL: bits:
+; CHECK: roll %cl, %edi
+; CHECK-NEXT: bswapl %edi
+; CHECK: imull $16843009
+; CHECK-NEXT: shrl $24, %eax
+; CHECK-NEXT: andl $15, %eax
+; CHECK-NEXT: retq
+define i32 @bits(i32 %x, i8 %y) {
+  %ext = zext i8 %y to i32
+  %r1 = shl i32 %x, %ext
+  %r2 = sub i32 32, %ext
+  %r3 = lshr i32 %x, %r2
+  %rot = or i32 %r1, %r3
+  %bs = call i32 @llvm.bswap.i32(i32 %rot)
+  %ct = call i32 @llvm.ctpop.i32(i32 %bs)
+  %m = urem i32 %ct, 16
+  ret i32 %m
+}
+
+declare i32 @llvm.bswap.i32(i32)
+declare i32 @llvm.ctpop.i32(i32)
@@ -0,0 +1,49 @@
+; RUN: llc < %s | FileCheck %s
+; RUN: llc < %s | grep paddq | count 32
+; RUN: llc -stats < %s 2>&1 >/dev/null | FileCheck %s --check-prefix=STATS
+; REQUIRES: asserts
+
+; The DAG of %entry has hundreds of nodes once the vector operations are
+; split, so the CSE map grows. The much smaller DAGs after it shrink the map
+; back when they clear it, and reuse the operand lists of the nodes deleted
+; while legalizing %entry. Code generation is the same either way.
+
+target triple = "x86_64-unknown-linux-gnu"
+
+declare void @many(i64, i64, i64, i64, i64, i64, i64, i64)
+
+; CHECK-LABEL: big:
+; CHECK: paddq
+; CHECK: movq $7, 8(%rsp)
+; CHECK-NEXT: movq $6, (%rsp)
+; CHECK-NEXT: movl $1, %esi
+; CHECK-NEXT: movl $2, %edx
+; CHECK-NEXT: movl $3, %ecx
+; CHECK-NEXT: movl $4, %r8d
+; CHECK-NEXT: movl $5, %r9d
+; CHECK-NEXT: movq %rax, %rdi
+; CHECK-NEXT: callq many
+define void @big(<64 x i64>* %p, <64 x i64>* %q, i64 %x) {
+entry:
+  %a = load <64 x i64>, <64 x i64>* %p
+  %b = load <64 x i64>, <64 x i64>* %q
+  %s = add <64 x i64> %a, %b
+  store <64 x i64> %s, <64 x i64>* %p
+  br label %small
+
+small:
+  call void @many(i64 %x, i64 1, i64 2, i64 3, i64 4, i64 5, i64 6, i64 7)
+  ret void
+}
+
+; CHECK-LABEL: after:
+; CHECK: movq $9, 8(%rsp)
+; CHECK-NEXT: movq $8, (%rsp)
+; CHECK: callq many
+define void @after(i64 %x) {
+  call void @many(i64 %x, i64 %x, i64 %x, i64 %x, i64 %x, i64 %x, i64 8, i64 9)
+  ret void
+}
+
+; STATS: selectiondag - Number of SelectionDAG operand lists allocated
+; STATS: 1 selectiondag - Number of times the DAG CSE map was shrunk
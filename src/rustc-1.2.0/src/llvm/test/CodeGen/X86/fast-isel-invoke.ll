@@ -0,0 +1,119 @@
+; RUN: llc -O0 -fast-isel -fast-isel-abort=3 -verify-machineinstrs < %s \
+; RUN:   | FileCheck %s
+
+; Fast isel selects invokes, landing pads, insertvalue and the intrinsics
+; below without falling back to SelectionDAG, which -fast-isel-abort=3 turns
+; into an error.
+
+target datalayout = "e-m:e-i64:64-f80:128-n8:16:32:64-S128"
+target triple = "x86_64-unknown-linux-gnu"
+
+declare i32 @__gxx_personality_v0(...)
+declare void @may_throw(i32)
+declare void @cleanup()
+declare void @_Unwind_Resume(i8*)
+declare void @llvm.assume(i1)
+declare void @llvm.memmove.p0i8.p0i8.i64(i8*, i8*, i64, i32, i1)
+
+; Both invokes are in the call site table and unwind to the landing pad,
+; which takes the exception pointer out of %rax.
+; CHECK-LABEL: invoke_cleanup:
+; CHECK: .cfi_def_cfa_offset
+; CHECK-NEXT: [[BEGIN1:.Ltmp[0-9]+]]:
+; CHECK-NEXT: callq may_throw
+; CHECK: movl $1, %edi
+; CHECK-NEXT: [[BEGIN2:.Ltmp[0-9]+]]:
+; CHECK-NEXT: callq may_throw
+; CHECK-NEXT: [[END2:.Ltmp[0-9]+]]:
+; CHECK: # %lpad
+; CHECK-NEXT: [[LPAD:.Ltmp[0-9]+]]:
+; CHECK: movq %rax, [[EXN:[0-9]+]](%rsp)
+; CHECK: callq cleanup
+; CHECK: movq [[EXN]](%rsp), %rdi
+; CHECK-NEXT: callq _Unwind_Resume
+; CHECK: .long [[BEGIN1]]-.Lfunc_begin0
+; CHECK-NEXT: .long [[END2]]-[[BEGIN1]]
+; CHECK-NEXT: .long [[LPAD]]-.Lfunc_begin0
+define i32 @invoke_cleanup(i32 %x) {
+entry:
+  invoke void @may_throw(i32 %x)
+          to label %cont unwind label %lpad
+
+cont:
+  invoke void @may_throw(i32 1)
+          to label %done unwind label %lpad
+
+done:
+  ret i32 0
+
+lpad:
+  %lp = landingpad { i8*, i32 } personality i32 (...)* @__gxx_personality_v0
+          cleanup
+  call void @cleanup()
+  %exn = extractvalue { i8*, i32 } %lp, 0
+  call void @_Unwind_Resume(i8* %exn)
+  unreachable
+}
+
+; The PHI in the normal destination gets its value from before the invoke,
+; and the selector comes out of %edx.
+; CHECK-LABEL: phi_after_invoke:
+; CHECK: addl $1, %edi
+; CHECK: callq may_throw
+; CHECK: # %lpad
+; CHECK: movl %edx, %ecx
+; CHECK: movl %ecx, %eax
+; CHECK: retq
+
+define i32 @phi_after_invoke(i32 %x) {
+entry:
+  %a = add i32 %x, 1
+  invoke void @may_throw(i32 %a)
+          to label %cont unwind label %lpad
+
+cont:
+  %r = phi i32 [ %a, %entry ]
+  ret i32 %r
+
+lpad:
+  %lp = landingpad { i8*, i32 } personality i32 (...)* @__gxx_personality_v0
+          cleanup
+  %sel = extractvalue { i8*, i32 } %lp, 1
+  ret i32 %sel
+}
+
+; Values inserted into an aggregate can be extracted and inserted again.
+; CHECK-LABEL: insert:
+; CHECK: movq %rsi, %rdx
+; CHECK: movq %rdx, %r8
+; CHECK-NEXT: addq %rdi, %r8
+; CHECK: movq %r8, %rdi
+; CHECK: callq sink
+
+define i64 @insert(i64 %a, i64 %b) {
+  %p = insertvalue { i64, i64 } undef, i64 %a, 0
+  %q = insertvalue { i64, i64 } %p, i64 %b, 1
+  %r = extractvalue { i64, i64 } %q, 1
+  %s = insertvalue { i64, i64 } %q, i64 %r, 0
+  %t = extractvalue { i64, i64 } %s, 0
+  %u = add i64 %t, %a
+  %v = insertvalue { i64, i64 } %s, i64 %u, 1
+  %w = extractvalue { i64, i64 } %v, 1
+  %z = insertvalue { i64, i64 } undef, i64 %w, 0
+  %zz = extractvalue { i64, i64 } %z, 0
+  call void @sink(i64 %zz)
+  ret i64 %zz
+}
+declare void @sink(i64)
+
+; llvm.assume is dropped, and memmove becomes a libcall.
+; CHECK-LABEL: intrinsics:
+; CHECK-NOT: cmp
+; CHECK: callq memmove
+
+define void @intrinsics(i8* %d, i8* %s, i64 %n) {
+  %c = icmp ne i64 %n, 0
+  call void @llvm.assume(i1 %c)
+  call void @llvm.memmove.p0i8.p0i8.i64(i8* %d, i8* %s, i64 %n, i32 1, i1 false)
+  ret void
+}
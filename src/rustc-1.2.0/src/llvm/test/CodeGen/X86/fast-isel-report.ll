@@ -0,0 +1,39 @@
+; RUN: llc -O0 -fast-isel -fast-isel-report < %s -o /dev/null 2>&1 \
+; RUN:   | FileCheck %s
+; RUN: llc -O0 -fast-isel < %s -o /dev/null 2>&1 \
+; RUN:   | FileCheck %s --check-prefix=NOREPORT --allow-empty
+
+; Functions which fall back to SelectionDAG are listed with the instructions
+; they fell back on, most frequent first. Calls to intrinsics and inline asm
+; are grouped by callee.
+
+; NOREPORT-NOT: FastISel fallbacks
+
+target triple = "x86_64-unknown-linux-gnu"
+
+declare i32 @llvm.bswap.i32(i32)
+
+; CHECK: FastISel fallbacks in function 'agg_ret':
+; CHECK-NEXT: {{^ +}}1  ret{{$}}
+define { i64, i64 } @agg_ret(i64 %a, i64 %b) {
+  %p = insertvalue { i64, i64 } undef, i64 %a, 0
+  %q = insertvalue { i64, i64 } %p, i64 %b, 1
+  ret { i64, i64 } %q
+}
+
+; Nothing is reported for a function selected entirely by fast isel.
+; CHECK-NOT: 'selected'
+define i64 @selected(i64 %a) {
+  ret i64 %a
+}
+
+; CHECK: FastISel fallbacks in function 'mixed':
+; CHECK-NEXT: {{^ +}}2  call asm{{$}}
+; CHECK-NEXT: {{^ +}}1  call llvm.bswap{{$}}
+; CHECK-NOT: {{^ +}}[0-9]
+define i32 @mixed(i32 %a) {
+  %r = call i32 asm "bswap $0", "=r,0"(i32 %a)
+  %s = call i32 @llvm.bswap.i32(i32 %r)
+  %t = call i32 asm "bswap $0", "=r,0"(i32 %s)
+  ret i32 %t
+}
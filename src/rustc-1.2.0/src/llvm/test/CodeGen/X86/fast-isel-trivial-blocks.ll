@@ -0,0 +1,93 @@
+; RUN: llc -O2 -verify-machineinstrs -fast-isel-trivial-blocks < %s | FileCheck %s
+; RUN: llc -O2 -filetype=obj < %s > %t.dag.o
+; RUN: llc -O2 -fast-isel-trivial-blocks -filetype=obj < %s > %t.fast.o
+; RUN: cmp %t.dag.o %t.fast.o
+; RUN: llc -O2 -fast-isel-trivial-blocks -stats -o /dev/null < %s 2>&1 | FileCheck %s --check-prefix=STATS
+; RUN: llc -O2 -stats -o /dev/null < %s 2>&1 | FileCheck %s --check-prefix=NOFLAG
+; RUN: llc -O0 -fast-isel-trivial-blocks -stats -o /dev/null < %s 2>&1 | FileCheck %s --check-prefix=NOFLAG
+; REQUIRES: asserts
+
+; Blocks which only branch to a join are handed to fast isel when optimizing.
+; The code must match what the DAG selector produces for them.
+
+; Of @match's cases, %a is folded into the jump table by CodeGenPrepare and
+; %default does real work. %b, %c and %d remain. @eh's %cont is folded too and
+; its landing pad is left to the DAG.
+; STATS: 3 isel - Number of trivial blocks given to fast isel while optimizing
+; NOFLAG-NOT: trivial blocks given to fast isel
+
+target triple = "x86_64-unknown-linux-gnu"
+
+declare i32 @__gxx_personality_v0(...)
+declare void @may_throw()
+
+; CHECK-LABEL: match:
+; CHECK: jmpq *.LJTI0_0(,%rax,8)
+; CHECK: # %b
+; CHECK-NEXT: movl $7, %esi
+; CHECK: # %c
+; CHECK-NEXT: movl %edi, %esi
+; CHECK: # %d
+; CHECK-NEXT: movl $4294967295, %esi
+define i32 @match(i32 %x, i32 %y) {
+entry:
+  switch i32 %x, label %default [
+    i32 0, label %a
+    i32 1, label %b
+    i32 2, label %c
+    i32 3, label %d
+  ]
+
+a:
+  br label %join
+
+b:
+  br label %join
+
+c:
+  br label %join
+
+d:
+  br label %join
+
+default:
+  %z = mul i32 %y, 3
+  br label %join
+
+join:
+  %r = phi i32 [ %y, %a ], [ 7, %b ], [ %x, %c ], [ -1, %d ], [ %z, %default ]
+  ret i32 %r
+}
+
+; CHECK-LABEL: entry_only:
+; CHECK-NEXT: .cfi_startproc
+; CHECK-NEXT: # BB#0:
+; CHECK-NEXT: retq
+define void @entry_only() {
+entry:
+  br label %next
+
+next:
+  ret void
+}
+
+; CHECK-LABEL: eh:
+; CHECK: callq may_throw
+; CHECK: retq
+define i32 @eh(i32 %x) {
+entry:
+  invoke void @may_throw()
+          to label %cont unwind label %lpad
+
+cont:
+  br label %join
+
+lpad:
+  %lp = landingpad { i8*, i32 } personality i32 (...)* @__gxx_personality_v0
+          cleanup
+  br label %join
+
+join:
+  %r = phi i32 [ %x, %cont ], [ 0, %lpad ]
+  ret i32 %r
+}
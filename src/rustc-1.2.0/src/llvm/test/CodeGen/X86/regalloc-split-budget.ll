@@ -0,0 +1,108 @@
+; RUN: llc -O2 -verify-machineinstrs -regalloc-split-budget=2 < %s | FileCheck %s
+; RUN: llc -O2 -verify-machineinstrs -regalloc-split-budget=32 < %s | FileCheck %s
+; RUN: llc -O2 -regalloc-split-budget=2 -stats -pass-remarks-analysis=regalloc -o /dev/null < %s 2>&1 | FileCheck %s --check-prefix=NOSPLIT
+; RUN: llc -O2 -regalloc-split-budget=32 -stats -pass-remarks-analysis=regalloc -o /dev/null < %s 2>&1 | FileCheck %s --check-prefix=NOREGION
+; RUN: llc -O2 -stats -pass-remarks-analysis=regalloc -o /dev/null < %s 2>&1 | FileCheck %s --check-prefix=NOLIMIT
+; REQUIRES: asserts
+
+; Ten loads are live through a loop and across the calls after it, more than
+; there are registers for. With a small budget the allocator first gives up
+; region splitting and then all splitting, spilling what it can't assign.
+
+; NOSPLIT: remark: {{.*}} split budget exhausted, region splitting disabled after analyzing {{[0-9]+}} blocks
+; NOSPLIT-NEXT: remark: {{.*}} split budget exhausted twice over, live range splitting disabled after analyzing {{[0-9]+}} blocks
+; NOSPLIT: 1 regalloc - Number of functions which exhausted their split budget
+; NOSPLIT: {{[1-9][0-9]*}} regalloc - Number of live ranges spilled unsplit because of the split budget
+
+; NOREGION: remark: {{.*}} split budget exhausted, region splitting disabled after analyzing {{[0-9]+}} blocks
+; NOREGION-NOT: twice over
+; NOREGION: 1 regalloc - Number of functions which exhausted their split budget
+; NOREGION-NOT: spilled unsplit because of the split budget
+
+; NOLIMIT-NOT: split budget
+
+target triple = "x86_64-unknown-linux-gnu"
+
+declare void @ext(i64)
+
+; CHECK-LABEL: pressure:
+; CHECK: 8-byte Spill
+; CHECK: callq ext
+; CHECK: 8-byte {{Reload|Folded Reload}}
+; CHECK: retq
+define i64 @pressure(i64* %p, i64 %n) {
+entry:
+  %g0 = getelementptr i64, i64* %p, i64 0
+  %v0 = load i64, i64* %g0
+  %g1 = getelementptr i64, i64* %p, i64 1
+  %v1 = load i64, i64* %g1
+  %g2 = getelementptr i64, i64* %p, i64 2
+  %v2 = load i64, i64* %g2
+  %g3 = getelementptr i64, i64* %p, i64 3
+  %v3 = load i64, i64* %g3
+  %g4 = getelementptr i64, i64* %p, i64 4
+  %v4 = load i64, i64* %g4
+  %g5 = getelementptr i64, i64* %p, i64 5
+  %v5 = load i64, i64* %g5
+  %g6 = getelementptr i64, i64* %p, i64 6
+  %v6 = load i64, i64* %g6
+  %g7 = getelementptr i64, i64* %p, i64 7
+  %v7 = load i64, i64* %g7
+  %g8 = getelementptr i64, i64* %p, i64 8
+  %v8 = load i64, i64* %g8
+  %g9 = getelementptr i64, i64* %p, i64 9
+  %v9 = load i64, i64* %g9
+  br label %loop
+
+loop:
+  %i = phi i64 [ 0, %entry ], [ %i.next, %latch ]
+  %acc = phi i64 [ 0, %entry ], [ %acc.next, %latch ]
+  %c = icmp slt i64 %i, 7
+  br i1 %c, label %cold, label %hot
+
+cold:
+  call void @ext(i64 %i)
+  br label %latch
+
+hot:
+  %h0 = mul i64 %acc, %v0
+  %h1 = mul i64 %h0, %v1
+  %h2 = mul i64 %h1, %v2
+  %h3 = mul i64 %h2, %v3
+  %h4 = mul i64 %h3, %v4
+  %h5 = mul i64 %h4, %v5
+  %h6 = mul i64 %h5, %v6
+  %h7 = mul i64 %h6, %v7
+  %h8 = mul i64 %h7, %v8
+  %h9 = mul i64 %h8, %v9
+  br label %latch
+
+latch:
+  %acc.next = phi i64 [ %acc, %cold ], [ %h9, %hot ]
+  %i.next = add i64 %i, 1
+  %done = icmp eq i64 %i.next, %n
+  br i1 %done, label %exit, label %loop
+
+exit:
+  call void @ext(i64 %v0)
+  %s0 = add i64 %acc.next, %v0
+  call void @ext(i64 %v1)
+  %s1 = add i64 %s0, %v1
+  call void @ext(i64 %v2)
+  %s2 = add i64 %s1, %v2
+  call void @ext(i64 %v3)
+  %s3 = add i64 %s2, %v3
+  call void @ext(i64 %v4)
+  %s4 = add i64 %s3, %v4
+  call void @ext(i64 %v5)
+  %s5 = add i64 %s4, %v5
+  call void @ext(i64 %v6)
+  %s6 = add i64 %s5, %v6
+  call void @ext(i64 %v7)
+  %s7 = add i64 %s6, %v7
+  call void @ext(i64 %v8)
+  %s8 = add i64 %s7, %v8
+  call void @ext(i64 %v9)
+  %s9 = add i64 %s8, %v9
+  ret i64 %s9
+}
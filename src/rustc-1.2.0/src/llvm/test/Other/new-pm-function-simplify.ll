@@ -0,0 +1,50 @@
+; The function simplification pipeline can be run by name at each level, at
+; the top level or nested in a function pass manager.
+; RUN: opt -S -passes='function-simplify<O0>' %s | FileCheck %s --check-prefix=O0
+; RUN: opt -S -passes='function-simplify<O1>' %s | FileCheck %s --check-prefix=OPT
+; RUN: opt -S -passes='function-simplify<O2>' %s | FileCheck %s --check-prefix=OPT
+; RUN: opt -S -passes='function-simplify<O3>' %s | FileCheck %s --check-prefix=OPT
+; RUN: opt -S -passes='no-op-module,function(function-simplify<O2>)' %s \
+; RUN:     | FileCheck %s --check-prefix=OPT
+;
+; The dominator tree is computed once and shared by the passes which use it.
+; RUN: opt -disable-output -debug-pass-manager \
+; RUN:     -passes='function-simplify<O2>' %s 2>&1 \
+; RUN:     | FileCheck %s --check-prefix=ANALYSES
+;
+; 'default<ON>' is left for the standard pipeline, which this is not.
+; RUN: not opt -disable-output -passes='default<O2>' %s 2>&1 \
+; RUN:     | FileCheck %s --check-prefix=BAD
+; RUN: not opt -disable-output -passes='function-simplify<O4>' %s 2>&1 \
+; RUN:     | FileCheck %s --check-prefix=BAD
+; RUN: not opt -disable-output -passes='function-simplify<Os>' %s 2>&1 \
+; RUN:     | FileCheck %s --check-prefix=BAD
+; RUN: not opt -disable-output -passes='function-simplify<2>' %s 2>&1 \
+; RUN:     | FileCheck %s --check-prefix=BAD
+; RUN: not opt -disable-output -passes='function-simplify<O2' %s 2>&1 \
+; RUN:     | FileCheck %s --check-prefix=BAD
+; RUN: not opt -disable-output -passes='function-simplify' %s 2>&1 \
+; RUN:     | FileCheck %s --check-prefix=BAD
+
+; O0-LABEL: define i32 @f(
+; O0: alloca
+; O0: add i32 %v, 0
+
+; OPT-LABEL: define i32 @f(
+; OPT-NEXT: entry:
+; OPT-NEXT: ret i32 %x
+
+; ANALYSES: Running analysis: DominatorTreeAnalysis
+; ANALYSES-NOT: Running analysis: DominatorTreeAnalysis
+; ANALYSES: Finished pass manager run.
+
+; BAD: unable to parse pass pipeline description
+
+define i32 @f(i32 %x) {
+entry:
+  %slot = alloca i32
+  store i32 %x, i32* %slot
+  %v = load i32, i32* %slot
+  %r = add i32 %v, 0
+  ret i32 %r
+}
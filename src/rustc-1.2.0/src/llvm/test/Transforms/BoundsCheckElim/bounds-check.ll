@@ -0,0 +1,98 @@
+; RUN: opt -S -bounds-check-elim < %s | FileCheck %s
+; RUN: opt -S -bounds-check-elim -bce-versioning=false < %s \
+; RUN:   | FileCheck %s --check-prefix=NOVERSION
+
+declare void @panic() noreturn
+
+; The check in %unreachable has no node in the dominator tree. It is left
+; alone.
+; CHECK-LABEL: define void @dead(
+; CHECK: unreachable:
+; CHECK-NEXT: %c = icmp ult i64 %i, %n
+; CHECK-NEXT: br i1 %c, label %ok, label %panic
+define void @dead(i64 %i, i64 %n) {
+entry:
+  ret void
+
+unreachable:
+  %c = icmp ult i64 %i, %n
+  br i1 %c, label %ok, label %panic
+
+ok:
+  ret void
+
+panic:
+  unreachable
+}
+
+; The second check of %i is implied by the first one, which dominates it.
+; CHECK-LABEL: define void @dominated(
+; CHECK: br i1 %c1, label %first, label %panic
+; CHECK: first:
+; CHECK-NOT: icmp
+; CHECK: br label %second
+define void @dominated(i32* %a, i64 %i, i64 %len) {
+entry:
+  %c1 = icmp ult i64 %i, %len
+  br i1 %c1, label %first, label %panic
+
+first:
+  %p = getelementptr inbounds i32, i32* %a, i64 %i
+  store i32 0, i32* %p
+  %c2 = icmp ult i64 %i, %len
+  br i1 %c2, label %second, label %panic
+
+second:
+  store i32 1, i32* %p
+  ret void
+
+panic:
+  call void @panic()
+  unreachable
+}
+
+; The index runs from 0 to %n - 1, and %len is unknown. The loop is
+; versioned on %n - 1 <u %len; the fast copy has no check and the slow copy
+; keeps it.
+; CHECK-LABEL: define void @loop(
+; CHECK: br i1 %z, label %exit, label %loop.bce.check
+; CHECK: loop.bce.check:
+; CHECK-NEXT: [[LAST:%.*]] = add i64 %n, -1
+; CHECK-NEXT: %bce.cond = icmp ult i64 [[LAST]], %len
+; CHECK-NEXT: br i1 %bce.cond, label %loop.ph, label %loop.ph.bce.slow
+; CHECK: loop.bce.slow:
+; CHECK: br i1 %c.bce.slow, label %cont.bce.slow, label %panic
+; CHECK: loop:
+; CHECK-NEXT: %i = phi
+; CHECK-NEXT: br label %cont
+
+; Without versioning the check stays where it is.
+; NOVERSION-LABEL: define void @loop(
+; NOVERSION-NOT: bce
+; NOVERSION: br i1 %c, label %cont, label %panic
+; NOVERSION-NOT: bce
+; NOVERSION: ret void
+define void @loop(i32* %a, i64 %len, i64 %n) {
+entry:
+  %z = icmp eq i64 %n, 0
+  br i1 %z, label %exit, label %loop
+
+loop:
+  %i = phi i64 [ 0, %entry ], [ %i.next, %cont ]
+  %c = icmp ult i64 %i, %len
+  br i1 %c, label %cont, label %panic
+
+cont:
+  %p = getelementptr inbounds i32, i32* %a, i64 %i
+  store i32 0, i32* %p
+  %i.next = add i64 %i, 1
+  %done = icmp eq i64 %i.next, %n
+  br i1 %done, label %exit, label %loop
+
+panic:
+  call void @panic()
+  unreachable
+
+exit:
+  ret void
+}
@@ -0,0 +1,98 @@
+; RUN: opt < %s -basicaa -dse -enable-dse-memoryssa -S | FileCheck %s
+; RUN: opt < %s -basicaa -dse -enable-dse-memoryssa -dse-memoryssa-scan-limit=1 -S | FileCheck %s --check-prefix=LIMIT
+
+target datalayout = "e-m:e-i64:64-f80:128-n8:16:32:64-S128"
+
+declare void @use(i32)
+
+; The second store overwrites the first before anything reads it.
+define void @overwritten(i32* %p, i32* noalias %q) {
+; CHECK-LABEL: @overwritten(
+; CHECK-NEXT: store i32 2, i32* %q
+; CHECK-NEXT: store i32 3, i32* %p
+; CHECK-NEXT: ret void
+  store i32 1, i32* %p
+  store i32 2, i32* %q
+  store i32 3, i32* %p
+  ret void
+}
+
+; The load between the stores reads the first one.
+define void @read_in_between(i32* %p) {
+; CHECK-LABEL: @read_in_between(
+; CHECK-NEXT: store i32 1, i32* %p
+; CHECK-NEXT: %v = load i32, i32* %p
+; CHECK-NEXT: call void @use(i32 %v)
+; CHECK-NEXT: store i32 3, i32* %p
+  store i32 1, i32* %p
+  %v = load i32, i32* %p
+  call void @use(i32 %v)
+  store i32 3, i32* %p
+  ret void
+}
+
+; The search stays within the block. The store in %entry is only
+; overwritten on one path.
+define void @other_block(i32* %p, i1 %c) {
+; CHECK-LABEL: @other_block(
+; CHECK: entry:
+; CHECK-NEXT: store i32 1, i32* %p
+; CHECK: then:
+; CHECK-NEXT: store i32 2, i32* %p
+entry:
+  store i32 1, i32* %p
+  br i1 %c, label %then, label %exit
+
+then:
+  store i32 2, i32* %p
+  br label %exit
+
+exit:
+  ret void
+}
+
+; %p is computed in the loop, so the store at the end of one iteration and
+; the store at the start of the next write different elements. The search
+; from the store of 0 must stop at the block's MemoryPhi. Comparing it with
+; the store of the previous iteration as if both were in the same iteration
+; would find the same pointer and delete the store of %v.
+define i32 @loop_carried(i64 %n) {
+; CHECK-LABEL: @loop_carried(
+; CHECK: loop:
+; CHECK: store i32 0, i32* %p
+; CHECK-NEXT: %v = load i32, i32* %p
+; CHECK-NEXT: %v.inc = add i32 %v, 1
+; CHECK-NEXT: store i32 %v.inc, i32* %p
+entry:
+  %a = alloca [16 x i32]
+  br label %loop
+
+loop:
+  %i = phi i64 [ 0, %entry ], [ %i.next, %loop ]
+  %p = getelementptr inbounds [16 x i32], [16 x i32]* %a, i64 0, i64 %i
+  store i32 0, i32* %p
+  %v = load i32, i32* %p
+  %v.inc = add i32 %v, 1
+  store i32 %v.inc, i32* %p
+  %i.next = add i64 %i, 1
+  %done = icmp eq i64 %i.next, %n
+  br i1 %done, label %exit, label %loop
+
+exit:
+  %q = getelementptr inbounds [16 x i32], [16 x i32]* %a, i64 0, i64 0
+  %r = load i32, i32* %q
+  ret i32 %r
+}
+
+; With a scan limit of one access, the store of 2 to %q uses up the budget
+; and the first store to %p is kept.
+define void @scan_limit(i32* %p, i32* noalias %q) {
+; LIMIT-LABEL: @scan_limit(
+; LIMIT-NEXT: store i32 1, i32* %p
+; LIMIT-NEXT: store i32 2, i32* %q
+; LIMIT-NEXT: store i32 3, i32* %p
+  store i32 1, i32* %p
+  store i32 2, i32* %q
+  store i32 3, i32* %p
+  ret void
+}
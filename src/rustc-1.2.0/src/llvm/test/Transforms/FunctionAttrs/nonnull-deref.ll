@@ -0,0 +1,68 @@
+; RUN: opt -S -functionattrs < %s | FileCheck %s
+
+@G = global i64 0
+
+; A pointer to a local is dangling once the function returns, so neither
+; @ret_alloca nor its caller returns anything nonnull or dereferenceable.
+; CHECK: define internal noalias i32* @ret_alloca()
+define internal i32* @ret_alloca() {
+  %a = alloca i32
+  ret i32* %a
+}
+
+; CHECK: define noalias i32* @call_ret_alloca()
+define i32* @call_ret_alloca() {
+  %p = call i32* @ret_alloca()
+  ret i32* %p
+}
+
+; CHECK: define internal i32* @ret_byval(i32* byval %x)
+define internal i32* @ret_byval(i32* byval %x) {
+  ret i32* %x
+}
+
+; A global outlives every function, and the facts of @ret_global's return
+; reach the return of its caller.
+; CHECK: define internal nonnull dereferenceable(8) i64* @ret_global()
+define internal i64* @ret_global() {
+  ret i64* @G
+}
+
+; CHECK: define nonnull dereferenceable(8) i64* @call_ret_global()
+define i64* @call_ret_global() {
+  %p = call i64* @ret_global()
+  ret i64* %p
+}
+
+; The arguments of an internal function get the facts common to all of its
+; callers. @b passes an unknown pointer for %q.
+; CHECK: define internal void @use(i32* nocapture nonnull dereferenceable(8) %p, i32* nocapture %q)
+define internal void @use(i32* %p, i32* %q) {
+  store i32 0, i32* %p
+  store i32 0, i32* %q
+  ret void
+}
+
+define void @a(i32* dereferenceable(16) %x) {
+  %l = alloca i32
+  call void @use(i32* %x, i32* %l)
+  ret void
+}
+
+define void @b(i32* dereferenceable(8) %x, i32* %y) {
+  call void @use(i32* %x, i32* %y)
+  ret void
+}
+
+; A caller's alloca is live for the whole call.
+; CHECK: define internal void @use_alloca(i32* nocapture nonnull dereferenceable(4) %p)
+define internal void @use_alloca(i32* %p) {
+  store i32 0, i32* %p
+  ret void
+}
+
+define void @c() {
+  %l = alloca i32
+  call void @use_alloca(i32* %l)
+  ret void
+}
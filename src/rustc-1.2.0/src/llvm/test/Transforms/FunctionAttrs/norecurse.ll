@@ -0,0 +1,82 @@
+; RUN: opt -S -functionattrs < %s | FileCheck %s
+
+declare void @ext() norecurse
+declare void @llvm.assume(i1)
+
+; @ext is norecurse itself, but may call any externally visible function,
+; such as @calls_out. @calls_out_inner can't be named from outside the module
+; and is norecurse.
+; CHECK: define internal void @calls_out_inner() [[NORECURSE:#[0-9]+]]
+define internal void @calls_out_inner() {
+  call void @ext()
+  ret void
+}
+
+; CHECK: define void @calls_out() {
+define void @calls_out() {
+  call void @calls_out_inner()
+  ret void
+}
+
+; Nothing @within reaches leaves the module, so it is norecurse although it
+; is externally visible. Intrinsics don't call back into the module.
+; CHECK: define internal void @leaf() [[NORECURSE_RN:#[0-9]+]]
+define internal void @leaf() {
+  ret void
+}
+
+; CHECK: define internal void @within_inner() [[NORECURSE]]
+define internal void @within_inner() {
+  call void @leaf()
+  call void @llvm.assume(i1 true)
+  ret void
+}
+
+; CHECK: define void @within() [[NORECURSE]]
+define void @within() {
+  call void @within_inner()
+  ret void
+}
+
+; @self calls itself.
+; CHECK: define void @self(i32 %n) [[READNONE:#[0-9]+]]
+define void @self(i32 %n) {
+  %c = icmp eq i32 %n, 0
+  br i1 %c, label %done, label %rec
+
+rec:
+  %m = sub i32 %n, 1
+  call void @self(i32 %m)
+  br label %done
+
+done:
+  ret void
+}
+
+; Every return gives back %x.
+; CHECK: define i32* @ret_arg(i32* readnone returned %x, i1 %c)
+define i32* @ret_arg(i32* %x, i1 %c) {
+  br i1 %c, label %a, label %b
+
+a:
+  ret i32* %x
+
+b:
+  ret i32* %x
+}
+
+; Two different arguments are returned.
+; CHECK: define i32* @ret_either(i32* readnone %x, i32* readnone %y, i1 %c)
+define i32* @ret_either(i32* %x, i32* %y, i1 %c) {
+  br i1 %c, label %a, label %b
+
+a:
+  ret i32* %x
+
+b:
+  ret i32* %y
+}
+
+; CHECK: attributes [[NORECURSE]] = { norecurse }
+; CHECK: attributes [[NORECURSE_RN]] = { norecurse readnone }
+; CHECK: attributes [[READNONE]] = { readnone }
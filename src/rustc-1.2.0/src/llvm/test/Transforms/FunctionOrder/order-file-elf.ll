@@ -0,0 +1,50 @@
+; RUN: opt -S -function-order -function-order-file=%t < %s | FileCheck %s
+; RUN: FileCheck %s --check-prefix=ORDER < %t
+
+target datalayout = "e-m:e-i64:64"
+target triple = "x86_64-unknown-linux"
+
+; @main calls the mangled hot function and @rare, which are clustered after
+; it. @never was never executed and goes last. @helper is private and has no
+; symbol to order. The order file holds symbol names as the linker sees them.
+; ORDER: {{^}}main{{$}}
+; ORDER-NEXT: {{^}}_ZN4core3fmt5write17h0123456789abcdefE{{$}}
+; ORDER-NEXT: {{^}}rare{{$}}
+; ORDER-NEXT: {{^}}never{{$}}
+; ORDER-NOT: helper
+
+; The module is reordered the same way, and on ELF hot and never-executed
+; functions get their own sections.
+; CHECK: define void @main()
+; CHECK: define void @_ZN4core3fmt5write17h0123456789abcdefE() section ".text.hot._ZN4core3fmt5write17h0123456789abcdefE"
+; CHECK: define void @"\01rare"() !prof
+; CHECK: define private void @helper() !prof
+; CHECK: define void @never() section ".text.unlikely.never"
+
+define void @main() !prof !0 {
+  call void @_ZN4core3fmt5write17h0123456789abcdefE()
+  call void @"\01rare"()
+  call void @helper()
+  ret void
+}
+
+define void @never() !prof !1 {
+  ret void
+}
+
+define void @"\01rare"() !prof !2 {
+  ret void
+}
+
+define void @_ZN4core3fmt5write17h0123456789abcdefE() !prof !3 {
+  ret void
+}
+
+define private void @helper() !prof !2 {
+  ret void
+}
+
+!0 = !{!"function_entry_count", i64 1}
+!1 = !{!"function_entry_count", i64 0}
+!2 = !{!"function_entry_count", i64 1}
+!3 = !{!"function_entry_count", i64 1000}
@@ -0,0 +1,49 @@
+; RUN: opt -S -function-order -function-order-file=%t < %s \
+; RUN:     | FileCheck %s --implicit-check-not=section
+; RUN: FileCheck %s --check-prefix=ORDER < %t
+
+target datalayout = "e-m:o-i64:64"
+target triple = "x86_64-apple-macosx"
+
+; Mach-O symbols carry a leading underscore, except for names which were
+; escaped with '\1' to be emitted as written.
+; ORDER: {{^}}_main{{$}}
+; ORDER-NEXT: {{^}}__ZN4core3fmt5write17h0123456789abcdefE{{$}}
+; ORDER-NEXT: {{^}}rare{{$}}
+; ORDER-NEXT: {{^}}_never{{$}}
+; ORDER-NOT: helper
+
+; No sections are assigned outside ELF.
+; CHECK: define void @main()
+; CHECK: define void @_ZN4core3fmt5write17h0123456789abcdefE()
+; CHECK: define void @"\01rare"()
+; CHECK: define private void @helper()
+; CHECK: define void @never()
+
+define void @main() !prof !0 {
+  call void @_ZN4core3fmt5write17h0123456789abcdefE()
+  call void @"\01rare"()
+  call void @helper()
+  ret void
+}
+
+define void @never() !prof !1 {
+  ret void
+}
+
+define void @"\01rare"() !prof !2 {
+  ret void
+}
+
+define void @_ZN4core3fmt5write17h0123456789abcdefE() !prof !3 {
+  ret void
+}
+
+define private void @helper() !prof !2 {
+  ret void
+}
+
+!0 = !{!"function_entry_count", i64 1}
+!1 = !{!"function_entry_count", i64 0}
+!2 = !{!"function_entry_count", i64 1}
+!3 = !{!"function_entry_count", i64 1000}
@@ -0,0 +1,134 @@
+; RUN: opt < %s -basicaa -gvn -enable-gvn-memoryssa -S | FileCheck %s
+; RUN: opt < %s -basicaa -gvn -enable-gvn-memoryssa -memoryssa-walk-limit=1 -S | FileCheck %s --check-prefix=LIMIT
+
+target datalayout = "e-m:e-i64:64-f80:128-n8:16:32:64-S128"
+
+; The store dominates the load across the diamond, and neither arm writes
+; %p.
+define i32 @forward_across_blocks(i32* noalias %p, i32* noalias %q, i1 %c) {
+; CHECK-LABEL: @forward_across_blocks(
+; CHECK-NOT: load
+; CHECK: ret i32 7
+entry:
+  store i32 7, i32* %p
+  br i1 %c, label %left, label %right
+
+left:
+  store i32 1, i32* %q
+  br label %join
+
+right:
+  store i32 2, i32* %q
+  br label %join
+
+join:
+  %v = load i32, i32* %p
+  ret i32 %v
+}
+
+; One arm writes %p, so the nearest clobber is the MemoryPhi at %join.
+; GVN falls back to memory dependence analysis, which builds a phi.
+define i32 @clobbered_in_one_arm(i32* %p, i1 %c) {
+; CHECK-LABEL: @clobbered_in_one_arm(
+; CHECK: join:
+; CHECK-NEXT: %v = phi i32 [ 1, %left ], [ 7, %entry ]
+; CHECK-NEXT: ret i32 %v
+entry:
+  store i32 7, i32* %p
+  br i1 %c, label %left, label %join
+
+left:
+  store i32 1, i32* %p
+  br label %join
+
+join:
+  %v = load i32, i32* %p
+  ret i32 %v
+}
+
+; Nothing has been stored to the alloca when it is loaded.
+define i32 @uninitialized_alloca() {
+; CHECK-LABEL: @uninitialized_alloca(
+; CHECK-NOT: load
+; CHECK: ret i32 undef
+  %a = alloca i32
+  %v = load i32, i32* %a
+  ret i32 %v
+}
+
+; %p is computed inside the loop, so the store to %q in one iteration is a
+; store to %p in the next. Walking through the MemoryPhi at %loop must not
+; compare the store with the load as if they were in the same iteration,
+; which would find no clobber and fold the load to undef.
+define i32 @loop_carried() {
+; CHECK-LABEL: @loop_carried(
+; CHECK: body:
+; CHECK-NEXT: %v = load i32, i32* %p
+entry:
+  %a = alloca [16 x i32]
+  br label %loop
+
+loop:
+  %i = phi i64 [ 0, %entry ], [ %i.next, %latch ]
+  %sum = phi i32 [ 0, %entry ], [ %sum.next, %latch ]
+  %p = getelementptr inbounds [16 x i32], [16 x i32]* %a, i64 0, i64 %i
+  %first = icmp eq i64 %i, 0
+  br i1 %first, label %latch, label %body
+
+body:
+  %v = load i32, i32* %p
+  br label %latch
+
+latch:
+  %x = phi i32 [ 0, %loop ], [ %v, %body ]
+  %sum.next = add i32 %sum, %x
+  %i.next = add i64 %i, 1
+  %q = getelementptr inbounds [16 x i32], [16 x i32]* %a, i64 0, i64 %i.next
+  store i32 1, i32* %q
+  %done = icmp eq i64 %i.next, 10
+  br i1 %done, label %exit, label %loop
+
+exit:
+  ret i32 %sum.next
+}
+
+; %p is computed before the loop and names the same address in every
+; iteration, so the walk looks through the MemoryPhi at %loop and finds the
+; store in %entry.
+define i32 @invariant_through_loop(i32* noalias %p, i32* noalias %q, i64 %n) {
+; CHECK-LABEL: @invariant_through_loop(
+; CHECK: loop:
+; CHECK-NOT: load
+; CHECK: add i32 %sum, 5
+entry:
+  store i32 5, i32* %p
+  br label %loop
+
+loop:
+  %i = phi i64 [ 0, %entry ], [ %i.next, %loop ]
+  %sum = phi i32 [ 0, %entry ], [ %sum.next, %loop ]
+  %v = load i32, i32* %p
+  %sum.next = add i32 %sum, %v
+  %qi = getelementptr inbounds i32, i32* %q, i64 %i
+  store i32 %sum.next, i32* %qi
+  %i.next = add i64 %i, 1
+  %done = icmp eq i64 %i.next, %n
+  br i1 %done, label %exit, label %loop
+
+exit:
+  ret i32 %sum.next
+}
+
+; With a walk limit of one access, the walk stops at the store to %q
+; without checking it against %p. GVN checks it itself and does not forward
+; 1; memory dependence analysis then finds the store of 0.
+define i32 @walk_limit(i32* noalias %p, i32* noalias %q) {
+; LIMIT-LABEL: @walk_limit(
+; LIMIT-NOT: load
+; LIMIT: ret i32 0
+entry:
+  store i32 0, i32* %p
+  store i32 1, i32* %q
+  %v = load i32, i32* %p
+  ret i32 %v
+}
@@ -0,0 +1,112 @@
+; RUN: opt -S -hotcoldsplit < %s | FileCheck %s
+
+target triple = "x86_64-unknown-linux-gnu"
+
+declare void @fail(i32) cold noreturn
+declare void @log(i32)
+declare void @sink(i32)
+
+; The error path calls a cold function and never comes back. It is outlined
+; into a cold, noinline, minsize function in .text.unlikely, and the call to
+; it is the last thing the error block does.
+; CHECK-LABEL: define i32 @cold_call(
+; CHECK: br i1 %bad, label %[[REPL:.*]], label %ok
+; CHECK: [[REPL]]:
+; CHECK-NEXT: call void @cold_call_error(i32 %x) [[NORETURN:#[0-9]+]]
+; CHECK-NEXT: unreachable
+define i32 @cold_call(i32 %x) {
+entry:
+  %bad = icmp slt i32 %x, 0
+  br i1 %bad, label %error, label %ok
+
+error:
+  %a = mul i32 %x, 3
+  %b = add i32 %a, 7
+  %c = xor i32 %b, 5
+  call void @fail(i32 %c)
+  unreachable
+
+ok:
+  ret i32 %x
+}
+
+; The error path is too small to be worth a call.
+; CHECK-LABEL: define i32 @small_cold_call(
+; CHECK: error:
+; CHECK-NEXT: call void @fail(i32 %x)
+define i32 @small_cold_call(i32 %x) {
+entry:
+  %bad = icmp slt i32 %x, 0
+  br i1 %bad, label %error, label %ok
+
+error:
+  call void @fail(i32 %x)
+  unreachable
+
+ok:
+  ret i32 %x
+}
+
+; With profile data, a block which runs far less often than the entry is
+; cold even though nothing in it says so.
+; CHECK-LABEL: define void @profile_cold(
+; CHECK: call void @profile_cold_rare(i32 %x){{$}}
+; CHECK-NEXT: br label %exit
+define void @profile_cold(i32 %x, i1 %b) !prof !0 {
+entry:
+  br i1 %b, label %rare, label %exit, !prof !1
+
+rare:
+  %a = mul i32 %x, 3
+  %c = add i32 %a, 7
+  call void @log(i32 %c)
+  br label %exit
+
+exit:
+  ret void
+}
+
+; The loop runs about a billion times per call, so its block frequency is
+; close to 2^64. The frequency times the default ratio of 1000 used to wrap
+; around to a value below the entry frequency, and the hot loop was outlined
+; as cold. The rarely taken branch spreads the frequencies over the whole
+; 64-bit range; the weights are chosen to hit the wrap-around.
+; CHECK-LABEL: define void @hot_loop(
+; CHECK: loop:
+; CHECK-NEXT: %j = phi
+; CHECK-NOT: define
+; CHECK: ret void
+define void @hot_loop(i32 %n, i32* %p, i1 %b) !prof !2 {
+entry:
+  br i1 %b, label %rare, label %loop, !prof !4
+
+rare:
+  call void @sink(i32 0)
+  br label %exit
+
+loop:
+  %j = phi i32 [ 0, %entry ], [ %j.next, %loop ]
+  %v = load i32, i32* %p
+  %w = add i32 %v, %j
+  %x = mul i32 %w, 3
+  store i32 %x, i32* %p
+  %j.next = add i32 %j, 1
+  %c = icmp slt i32 %j.next, %n
+  br i1 %c, label %loop, label %exit, !prof !3
+
+exit:
+  ret void
+}
+
+; CHECK: define internal void @cold_call_error(i32 %x) [[COLDNR:#[0-9]+]] section ".text.unlikely"
+; CHECK: define internal void @profile_cold_rare(i32 %x) [[COLD:#[0-9]+]] section ".text.unlikely"
+; CHECK-NOT: define
+; CHECK: attributes [[COLDNR]] = { cold minsize noinline noreturn }
+; CHECK: attributes [[COLD]] = { cold minsize noinline }
+; CHECK: attributes [[NORETURN]] = { noreturn }
+
+!0 = !{!"function_entry_count", i64 100}
+!1 = !{!"branch_weights", i32 1, i32 100000}
+!2 = !{!"function_entry_count", i64 1}
+!3 = !{!"branch_weights", i32 1050311490, i32 1}
+!4 = !{!"branch_weights", i32 1, i32 2000000000}
@@ -0,0 +1,79 @@
+; Call sites with the same callee and argument shape share a cached inline
+; cost, but only when constant arguments the callee depends on are equal too.
+; RUN: opt -S -inline -inline-threshold=20 < %s | FileCheck %s
+; RUN: opt -S -inline -inline-threshold=20 -inline-cost-cache=false < %s \
+; RUN:     | FileCheck %s
+; RUN: opt -disable-output -inline -inline-threshold=20 -stats < %s 2>&1 \
+; RUN:     | FileCheck %s --check-prefix=STATS
+; RUN: opt -disable-output -inline -inline-threshold=20 -inline-cost-cache=false \
+; RUN:     -stats < %s 2>&1 | FileCheck %s --check-prefix=NOCACHE
+; REQUIRES: asserts
+
+target datalayout = "e-m:e-i64:64-f80:128-n8:16:32:64-S128"
+
+; With %mode == 0 the call folds to %x. Any other mode runs the long path,
+; which is over the threshold.
+define i32 @callee(i32 %mode, i32 %x) {
+entry:
+  %cheap = icmp eq i32 %mode, 0
+  br i1 %cheap, label %done, label %slow
+
+slow:
+  %h0 = mul i32 %x, %x
+  %h1 = mul i32 %h0, %x
+  %h2 = mul i32 %h1, %x
+  %h3 = mul i32 %h2, %x
+  %h4 = mul i32 %h3, %x
+  %h5 = mul i32 %h4, %x
+  %h6 = mul i32 %h5, %x
+  %h7 = mul i32 %h6, %x
+  %h8 = mul i32 %h7, %x
+  %h9 = mul i32 %h8, %x
+  %h10 = mul i32 %h9, %x
+  %h11 = mul i32 %h10, %x
+  %h12 = mul i32 %h11, %x
+  %h13 = mul i32 %h12, %x
+  %h14 = mul i32 %h13, %x
+  %h15 = mul i32 %h14, %x
+  %h16 = mul i32 %h15, %x
+  %h17 = mul i32 %h16, %x
+  %h18 = mul i32 %h17, %x
+  %h19 = mul i32 %h18, %x
+  %h20 = mul i32 %h19, %x
+  %h21 = mul i32 %h20, %x
+  %h22 = mul i32 %h21, %x
+  %h23 = mul i32 %h22, %x
+  br label %done
+
+done:
+  %r = phi i32 [ %x, %entry ], [ %h23, %slow ]
+  ret i32 %r
+}
+
+; CHECK-LABEL: define i32 @caller(
+; CHECK-NEXT: entry:
+; CHECK-NEXT: %b = call i32 @callee(i32 1, i32 %y)
+; CHECK-NEXT: %s = add i32 %y, %b
+; CHECK-NEXT: %d = call i32 @callee(i32 2, i32 %y)
+; CHECK-NEXT: %t = add i32 %s, %d
+; CHECK-NEXT: %u = add i32 %t, %y
+; CHECK-NEXT: ret i32 %u
+define i32 @caller(i32 %y) {
+entry:
+  %a = call i32 @callee(i32 0, i32 %y)
+  %b = call i32 @callee(i32 1, i32 %y)
+  %s = add i32 %a, %b
+  %d = call i32 @callee(i32 2, i32 %y)
+  %t = add i32 %s, %d
+  %c = call i32 @callee(i32 0, i32 %y)
+  %u = add i32 %t, %c
+  ret i32 %u
+}
+
+; Each of the three signatures is analyzed once. The second call with mode 0
+; reuses the first one's cost, and so do the calls with modes 1 and 2 when
+; the inliner revisits them after changing @caller.
+; STATS: 3 inline-cost - Number of call site costs reused from the cache
+; STATS-NEXT: 3 inline-cost - Number of call sites analyzed
+; NOCACHE-NOT: reused from the cache
+; NOCACHE: 6 inline-cost - Number of call sites analyzed
@@ -0,0 +1,119 @@
+; The cost model caches its results per loop. The costs of each width, the
+; chosen VF and the interleave count must be what they were without caching.
+; RUN: opt -S -basicaa -loop-vectorize -mcpu=corei7 \
+; RUN:     -enable-interleaved-mem-accesses -debug-only=loop-vectorize < %s \
+; RUN:     2>&1 >/dev/null | FileCheck %s --check-prefix=SSE
+; RUN: opt -S -basicaa -loop-vectorize -mcpu=core-avx2 \
+; RUN:     -enable-interleaved-mem-accesses -debug-only=loop-vectorize < %s \
+; RUN:     2>&1 >/dev/null | FileCheck %s --check-prefix=AVX2
+; REQUIRES: asserts
+
+target datalayout = "e-m:e-i64:64-f80:128-n8:16:32:64-S128"
+target triple = "x86_64-unknown-linux-gnu"
+
+; SSE-LABEL: LV: Checking a loop in "saxpy"
+; SSE: LV: Vector loop of width 2 costs: 4.
+; SSE: LV: Vector loop of width 4 costs: 2.
+; SSE: LV: Selecting VF: 4.
+; SSE: LV: Unroll Factor is 2
+; AVX2-LABEL: LV: Checking a loop in "saxpy"
+; AVX2: LV: Vector loop of width 2 costs: 4.
+; AVX2: LV: Vector loop of width 4 costs: 2.
+; AVX2: LV: Vector loop of width 8 costs: 1.
+; AVX2: LV: Selecting VF: 8.
+; AVX2: LV: Unroll Factor is 4
+
+define void @saxpy(float* noalias %x, float* noalias %y, float %a, i64 %n) {
+entry:
+  br label %loop
+
+loop:
+  %i = phi i64 [ 0, %entry ], [ %i.next, %loop ]
+  %px = getelementptr inbounds float, float* %x, i64 %i
+  %vx = load float, float* %px
+  %py = getelementptr inbounds float, float* %y, i64 %i
+  %vy = load float, float* %py
+  %m = fmul float %vx, %a
+  %s = fadd float %m, %vy
+  store float %s, float* %py
+  %i.next = add nuw nsw i64 %i, 1
+  %done = icmp eq i64 %i.next, %n
+  br i1 %done, label %exit, label %loop
+
+exit:
+  ret void
+}
+
+; Strided loads from two different bases. Only pairs with the same base are
+; candidates for an interleave group.
+; SSE-LABEL: LV: Checking a loop in "pairs"
+; SSE: LV: Vector loop of width 2 costs: 60.
+; SSE: LV: Vector loop of width 4 costs: 55.
+; SSE: LV: Selecting VF: 1.
+; SSE: LV: Unroll Factor is 1
+; AVX2-LABEL: LV: Checking a loop in "pairs"
+; AVX2: LV: Vector loop of width 2 costs: 60.
+; AVX2: LV: Vector loop of width 4 costs: 54.
+; AVX2: LV: Vector loop of width 8 costs: 53.
+; AVX2: LV: Selecting VF: 1.
+; AVX2: LV: Unroll Factor is 1
+define void @pairs(i32* noalias %a, i32* noalias %b, i32* noalias %c, i64 %n) {
+entry:
+  br label %loop
+
+loop:
+  %i = phi i64 [ 0, %entry ], [ %i.next, %loop ]
+  %i2 = shl nsw i64 %i, 1
+  %i21 = or i64 %i2, 1
+  %pa0 = getelementptr inbounds i32, i32* %a, i64 %i2
+  %pa1 = getelementptr inbounds i32, i32* %a, i64 %i21
+  %pb0 = getelementptr inbounds i32, i32* %b, i64 %i2
+  %pb1 = getelementptr inbounds i32, i32* %b, i64 %i21
+  %v0 = load i32, i32* %pa0
+  %v1 = load i32, i32* %pa1
+  %w0 = load i32, i32* %pb0
+  %w1 = load i32, i32* %pb1
+  %s0 = add i32 %v0, %w1
+  %s1 = add i32 %v1, %w0
+  %s = mul i32 %s0, %s1
+  %pc = getelementptr inbounds i32, i32* %c, i64 %i
+  store i32 %s, i32* %pc
+  %i.next = add nuw nsw i64 %i, 1
+  %done = icmp eq i64 %i.next, %n
+  br i1 %done, label %exit, label %loop
+
+exit:
+  ret void
+}
+
+; Mixed element types, with a reduction.
+; SSE-LABEL: LV: Checking a loop in "mixed"
+; SSE: LV: Vector loop of width 2 costs: 7.
+; SSE: LV: Selecting VF: 1.
+; SSE: LV: Unroll Factor is 1
+; AVX2-LABEL: LV: Checking a loop in "mixed"
+; AVX2: LV: Vector loop of width 2 costs: 7.
+; AVX2: LV: Vector loop of width 4 costs: 4.
+; AVX2: LV: Selecting VF: 4.
+; AVX2: LV: Unroll Factor is 4
+define i64 @mixed(i8* noalias %p, i64* noalias %q, i64 %n) {
+entry:
+  br label %loop
+
+loop:
+  %i = phi i64 [ 0, %entry ], [ %i.next, %loop ]
+  %acc = phi i64 [ 0, %entry ], [ %acc.next, %loop ]
+  %pp = getelementptr inbounds i8, i8* %p, i64 %i
+  %v = load i8, i8* %pp
+  %e = zext i8 %v to i64
+  %pq = getelementptr inbounds i64, i64* %q, i64 %i
+  %w = load i64, i64* %pq
+  %m = mul i64 %e, %w
+  %acc.next = add i64 %acc, %m
+  %i.next = add nuw nsw i64 %i, 1
+  %done = icmp eq i64 %i.next, %n
+  br i1 %done, label %exit, label %loop
+
+exit:
+  ret i64 %acc.next
+}
@@ -0,0 +1,91 @@
+; RUN: opt < %s -basicaa -loop-vectorize -force-vector-width=4 -force-vector-interleave=1 -S | FileCheck %s
+
+target datalayout = "e-m:e-i64:64-f80:128-n8:16:32:64-S128"
+
+; The load of *p is loop invariant and may alias the stores to a[i]. It is
+; checked at run time as the range [p, p + 4) instead of rejecting the loop.
+; CHECK-LABEL: @f(
+; CHECK: %[[AEND:.*]] = getelementptr i32, i32* %a, i64 %n
+; CHECK: %[[AEND8:.*]] = bitcast i32* %[[AEND]] to i8*
+; CHECK: %[[PEND:.*]] = getelementptr i32, i32* %p, i64 1
+; CHECK: %[[PEND8:.*]] = bitcast i32* %[[PEND]] to i8*
+; CHECK: vector.memcheck:
+; CHECK: icmp ult i8* %{{.*}}, %[[PEND8]]
+; CHECK: icmp ult i8* %{{.*}}, %[[AEND8]]
+; CHECK: vector.body:
+define void @f(i32* %a, i32* %b, i32* %p, i64 %n) {
+entry:
+  br label %loop
+
+loop:
+  %i = phi i64 [ 0, %entry ], [ %i.next, %loop ]
+  %bi = getelementptr inbounds i32, i32* %b, i64 %i
+  %vb = load i32, i32* %bi
+  %vp = load i32, i32* %p
+  %s = add i32 %vb, %vp
+  %ai = getelementptr inbounds i32, i32* %a, i64 %i
+  store i32 %s, i32* %ai
+  %i.next = add i64 %i, 1
+  %done = icmp eq i64 %i.next, %n
+  br i1 %done, label %exit, label %loop
+
+exit:
+  ret void
+}
+
+; The invariant access is wider than the stores. The range of *p covers all
+; 8 bytes, so a store to a[i] with p < a + i < p + 8 is seen to overlap it.
+; CHECK-LABEL: @g(
+; CHECK: %[[AEND:.*]] = getelementptr i8, i8* %a, i64 %n
+; CHECK: %[[PEND:.*]] = getelementptr i64, i64* %p, i64 1
+; CHECK: %[[PEND8:.*]] = bitcast i64* %[[PEND]] to i8*
+; CHECK: vector.memcheck:
+; CHECK: %bound0 = icmp ult i8* %a, %[[PEND8]]
+; CHECK: %bound1 = icmp ult i8* %{{.*}}, %[[AEND]]
+; CHECK: vector.body:
+define void @g(i8* %a, i64* %p, i64 %n) {
+entry:
+  br label %loop
+
+loop:
+  %i = phi i64 [ 0, %entry ], [ %i.next, %loop ]
+  %vp = load i64, i64* %p
+  %t = trunc i64 %vp to i8
+  %ai = getelementptr inbounds i8, i8* %a, i64 %i
+  store i8 %t, i8* %ai
+  %i.next = add i64 %i, 1
+  %done = icmp eq i64 %i.next, %n
+  br i1 %done, label %exit, label %loop
+
+exit:
+  ret void
+}
+
+; With a negative stride the ranges still run from the lowest address
+; accessed to one past the highest: [a, a + 4n) and [b, b + 4n).
+; CHECK-LABEL: @rev(
+; CHECK: %[[AEND:.*]] = getelementptr i32, i32* %a, i64 %n
+; CHECK: %[[AEND8:.*]] = bitcast i32* %[[AEND]] to i8*
+; CHECK: %[[BEND:.*]] = getelementptr i32, i32* %b, i64 %n
+; CHECK: %[[BEND8:.*]] = bitcast i32* %[[BEND]] to i8*
+; CHECK: vector.memcheck:
+; CHECK: %bound0 = icmp ult i8* %a1, %[[BEND8]]
+; CHECK: %bound1 = icmp ult i8* %b3, %[[AEND8]]
+; CHECK: vector.body:
+define void @rev(i32* %a, i32* %b, i64 %n) {
+entry:
+  br label %loop
+
+loop:
+  %i = phi i64 [ %n, %entry ], [ %i.next, %loop ]
+  %i.next = add i64 %i, -1
+  %bi = getelementptr inbounds i32, i32* %b, i64 %i.next
+  %vb = load i32, i32* %bi
+  %ai = getelementptr inbounds i32, i32* %a, i64 %i.next
+  store i32 %vb, i32* %ai
+  %done = icmp eq i64 %i.next, 0
+  br i1 %done, label %exit, label %loop
+
+exit:
+  ret void
+}
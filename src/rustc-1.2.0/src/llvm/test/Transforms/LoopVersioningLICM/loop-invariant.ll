@@ -0,0 +1,108 @@
+; RUN: opt < %s -basicaa -scoped-noalias -loop-versioning-licm -S | FileCheck %s
+; RUN: opt < %s -basicaa -scoped-noalias -loop-versioning-licm -licm -S | FileCheck %s --check-prefix=LICM
+
+target datalayout = "e-m:e-i64:64-f80:128-n8:16:32:64-S128"
+
+; *sum is loop invariant but may alias buf[i]. The run-time check has to cover
+; all 8 bytes of *sum, not just its address: with sum = st and buf = st + 4 the
+; ranges overlap even though buf lies above sum.
+; CHECK-LABEL: @sum(
+; CHECK: loop.lver.memcheck:
+; CHECK: %[[SUMEND:.*]] = getelementptr i64, i64* %sum, i64 1
+; CHECK: %[[SUMEND8:.*]] = bitcast i64* %[[SUMEND]] to i8*
+; CHECK: %[[BUFEND:.*]] = getelementptr i8, i8* %buf, i64 %n
+; CHECK: %bound0 = icmp ult i8* %{{.*}}, %[[BUFEND]]
+; CHECK: %bound1 = icmp ult i8* %buf, %[[SUMEND8]]
+; CHECK: br i1 %memcheck.conflict, label %loop.ph.lver.orig, label %loop.ph
+; Both copies are in loop-simplify form.
+; CHECK: loop.ph.lver.orig:
+; CHECK-NEXT: br label %loop.lver.orig
+; CHECK: br i1 %done.lver.orig, label %{{.*}}, label %loop.lver.orig, !llvm.loop ![[ORIG:[0-9]+]]
+; CHECK: loop.ph:
+; CHECK-NEXT: br label %loop
+; CHECK: load i8, i8* %p, !alias.scope
+; CHECK: br i1 %done, label %{{.*}}, label %loop, !llvm.loop ![[VER:[0-9]+]]
+; CHECK: exit:
+
+; LICM promotes *sum in the checked copy only.
+; LICM-LABEL: @sum(
+; LICM: loop.lver.orig:
+; LICM: store i64 %add.lver.orig, i64* %sum
+; LICM: loop:
+; LICM-NOT: store
+; LICM: br i1 %done
+; LICM: store i64 %{{.*}}, i64* %sum
+define void @sum(i64* %sum, i8* %buf, i64 %n) {
+entry:
+  %z = icmp eq i64 %n, 0
+  br i1 %z, label %exit, label %loop
+
+loop:
+  %i = phi i64 [ 0, %entry ], [ %i.next, %loop ]
+  %p = getelementptr inbounds i8, i8* %buf, i64 %i
+  %v = load i8, i8* %p
+  %v.ext = zext i8 %v to i64
+  %s = load i64, i64* %sum
+  %add = add i64 %s, %v.ext
+  store i64 %add, i64* %sum
+  %i.next = add i64 %i, 1
+  %done = icmp eq i64 %i.next, %n
+  br i1 %done, label %exit, label %loop
+
+exit:
+  ret void
+}
+
+; The pointers can't alias, so there is nothing to check.
+; CHECK-LABEL: @no_alias(
+; CHECK-NOT: lver
+; CHECK: ret void
+define void @no_alias(i32* noalias %sum, i32* noalias %a, i64 %n) {
+entry:
+  br label %loop
+
+loop:
+  %i = phi i64 [ 0, %entry ], [ %i.next, %loop ]
+  %p = getelementptr inbounds i32, i32* %a, i64 %i
+  %v = load i32, i32* %p
+  %s = load i32, i32* %sum
+  %add = add i32 %s, %v
+  store i32 %add, i32* %sum
+  %i.next = add i64 %i, 1
+  %done = icmp eq i64 %i.next, %n
+  br i1 %done, label %exit, label %loop
+
+exit:
+  ret void
+}
+
+; Versioning is disabled by metadata.
+; CHECK-LABEL: @disabled(
+; CHECK-NOT: lver
+; CHECK: ret void
+define void @disabled(i32* %sum, i32* %a, i64 %n) {
+entry:
+  br label %loop
+
+loop:
+  %i = phi i64 [ 0, %entry ], [ %i.next, %loop ]
+  %p = getelementptr inbounds i32, i32* %a, i64 %i
+  %v = load i32, i32* %p
+  %s = load i32, i32* %sum
+  %add = add i32 %s, %v
+  store i32 %add, i32* %sum
+  %i.next = add i64 %i, 1
+  %done = icmp eq i64 %i.next, %n
+  br i1 %done, label %exit, label %loop, !llvm.loop !0
+
+exit:
+  ret void
+}
+
+; Both copies of @sum are marked so they aren't versioned again.
+; CHECK: ![[ORIG]] = distinct !{![[ORIG]], ![[DISABLE:[0-9]+]]}
+; CHECK: ![[DISABLE]] = !{!"llvm.loop.licm_versioning.disable"}
+; CHECK: ![[VER]] = distinct !{![[VER]], ![[DISABLE]]}
+
+!0 = distinct !{!0, !1}
+!1 = !{!"llvm.loop.licm_versioning.disable"}
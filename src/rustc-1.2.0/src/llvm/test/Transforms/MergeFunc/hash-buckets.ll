@@ -0,0 +1,58 @@
+; RUN: opt -S -mergefunc < %s | FileCheck %s
+; RUN: opt -disable-output -mergefunc -stats -debug-only=mergefunc < %s 2>&1 \
+; RUN:     | FileCheck %s --check-prefix=STATS
+; REQUIRES: asserts
+
+target datalayout = "e-m:e-i64:64-f80:128-n8:16:32:64-S128"
+
+; @a, @b and @c hash the same: the hash only looks at the shape of the code,
+; not at the constant operands. @a and @b are equal and merged. @c differs
+; from them in a constant only, and must be compared and kept.
+; @d differs in an opcode. Its hash is unique, so it is never compared with
+; the other functions, i.e. never inserted into the function tree.
+
+; STATS-NOT: Inserting as unique: d
+; STATS: Inserting as unique: a
+; STATS-NEXT: Inserting as unique: c
+; STATS-NEXT: a == b
+; STATS-NOT: Inserting as unique: d
+; STATS: 1 mergefunc - Number of functions merged
+; STATS: 1 mergefunc - Number of functions skipped due to unique hash
+; STATS: 1 mergefunc - Number of hash buckets ranked
+
+; CHECK-LABEL: define i32 @a(
+; CHECK: add i32 %x, 1
+define i32 @a(i32 %x, i32 %y) {
+  %s = add i32 %x, 1
+  %t = xor i32 %s, %y
+  %u = sub i32 %t, %x
+  ret i32 %u
+}
+
+; CHECK-LABEL: define i32 @c(
+; CHECK: add i32 %x, 2
+define i32 @c(i32 %x, i32 %y) {
+  %s = add i32 %x, 2
+  %t = xor i32 %s, %y
+  %u = sub i32 %t, %x
+  ret i32 %u
+}
+
+; CHECK-LABEL: define i32 @d(
+; CHECK: mul i32 %x, 1
+define i32 @d(i32 %x, i32 %y) {
+  %s = mul i32 %x, 1
+  %t = xor i32 %s, %y
+  %u = sub i32 %t, %x
+  ret i32 %u
+}
+
+; CHECK-LABEL: define i32 @b(
+; CHECK-NEXT: tail call i32 @a(
+; CHECK-NEXT: ret
+define i32 @b(i32 %x, i32 %y) {
+  %s = add i32 %x, 1
+  %t = xor i32 %s, %y
+  %u = sub i32 %t, %x
+  ret i32 %u
+}
@@ -0,0 +1,236 @@
+; The ranking of hash buckets runs on a thread pool, but merging is serial and
+; in module order, so the output must not depend on the number of threads.
+; RUN: opt -S -mergefunc -mergefunc-threads=1 < %s > %t.1
+; RUN: opt -S -mergefunc -mergefunc-threads=4 < %s > %t.4
+; RUN: diff %t.1 %t.4
+; RUN: FileCheck %s < %t.4
+
+target datalayout = "e-m:e-i64:64-f80:128-n8:16:32:64-S128"
+
+; Each opcode gives a hash bucket of five functions: two equal pairs, one of
+; them weak, and one function which differs from both in a constant.
+
+; CHECK-LABEL: define i32 @add1(
+; CHECK-LABEL: define i32 @add3(
+; CHECK-LABEL: define i32 @add5(
+; CHECK-LABEL: define i32 @shl1(
+; CHECK-LABEL: define i32 @shl3(
+; CHECK-LABEL: define i32 @shl5(
+; CHECK-LABEL: define i32 @add2(
+; CHECK-NEXT: tail call i32 @add1(
+; CHECK-LABEL: define i32 @shl2(
+; CHECK-NEXT: tail call i32 @shl1(
+; CHECK-LABEL: define weak i32 @add4(
+; CHECK-NEXT: tail call i32 @add3(
+; CHECK-LABEL: define weak i32 @shl4(
+; CHECK-NEXT: tail call i32 @shl3(
+
+define i32 @add1(i32 %x, i32 %y) {
+  %s = add i32 %x, 1
+  %t = sub i32 %s, %y
+  %u = add i32 %t, %x
+  ret i32 %u
+}
+
+define i32 @add2(i32 %x, i32 %y) {
+  %s = add i32 %x, 1
+  %t = sub i32 %s, %y
+  %u = add i32 %t, %x
+  ret i32 %u
+}
+
+define i32 @add3(i32 %x, i32 %y) {
+  %s = add i32 %x, 7
+  %t = sub i32 %s, %y
+  %u = add i32 %t, %x
+  ret i32 %u
+}
+
+define weak i32 @add4(i32 %x, i32 %y) {
+  %s = add i32 %x, 7
+  %t = sub i32 %s, %y
+  %u = add i32 %t, %x
+  ret i32 %u
+}
+
+define i32 @add5(i32 %x, i32 %y) {
+  %s = add i32 %x, 3
+  %t = sub i32 %s, %y
+  %u = add i32 %t, %x
+  ret i32 %u
+}
+
+define i32 @mul1(i32 %x, i32 %y) {
+  %s = mul i32 %x, 1
+  %t = sub i32 %s, %y
+  %u = add i32 %t, %x
+  ret i32 %u
+}
+
+define i32 @mul2(i32 %x, i32 %y) {
+  %s = mul i32 %x, 1
+  %t = sub i32 %s, %y
+  %u = add i32 %t, %x
+  ret i32 %u
+}
+
+define i32 @mul3(i32 %x, i32 %y) {
+  %s = mul i32 %x, 7
+  %t = sub i32 %s, %y
+  %u = add i32 %t, %x
+  ret i32 %u
+}
+
+define weak i32 @mul4(i32 %x, i32 %y) {
+  %s = mul i32 %x, 7
+  %t = sub i32 %s, %y
+  %u = add i32 %t, %x
+  ret i32 %u
+}
+
+define i32 @mul5(i32 %x, i32 %y) {
+  %s = mul i32 %x, 3
+  %t = sub i32 %s, %y
+  %u = add i32 %t, %x
+  ret i32 %u
+}
+
+define i32 @xor1(i32 %x, i32 %y) {
+  %s = xor i32 %x, 1
+  %t = sub i32 %s, %y
+  %u = add i32 %t, %x
+  ret i32 %u
+}
+
+define i32 @xor2(i32 %x, i32 %y) {
+  %s = xor i32 %x, 1
+  %t = sub i32 %s, %y
+  %u = add i32 %t, %x
+  ret i32 %u
+}
+
+define i32 @xor3(i32 %x, i32 %y) {
+  %s = xor i32 %x, 7
+  %t = sub i32 %s, %y
+  %u = add i32 %t, %x
+  ret i32 %u
+}
+
+define weak i32 @xor4(i32 %x, i32 %y) {
+  %s = xor i32 %x, 7
+  %t = sub i32 %s, %y
+  %u = add i32 %t, %x
+  ret i32 %u
+}
+
+define i32 @xor5(i32 %x, i32 %y) {
+  %s = xor i32 %x, 3
+  %t = sub i32 %s, %y
+  %u = add i32 %t, %x
+  ret i32 %u
+}
+
+define i32 @and1(i32 %x, i32 %y) {
+  %s = and i32 %x, 1
+  %t = sub i32 %s, %y
+  %u = add i32 %t, %x
+  ret i32 %u
+}
+
+define i32 @and2(i32 %x, i32 %y) {
+  %s = and i32 %x, 1
+  %t = sub i32 %s, %y
+  %u = add i32 %t, %x
+  ret i32 %u
+}
+
+define i32 @and3(i32 %x, i32 %y) {
+  %s = and i32 %x, 7
+  %t = sub i32 %s, %y
+  %u = add i32 %t, %x
+  ret i32 %u
+}
+
+define weak i32 @and4(i32 %x, i32 %y) {
+  %s = and i32 %x, 7
+  %t = sub i32 %s, %y
+  %u = add i32 %t, %x
+  ret i32 %u
+}
+
+define i32 @and5(i32 %x, i32 %y) {
+  %s = and i32 %x, 3
+  %t = sub i32 %s, %y
+  %u = add i32 %t, %x
+  ret i32 %u
+}
+
+define i32 @or1(i32 %x, i32 %y) {
+  %s = or i32 %x, 1
+  %t = sub i32 %s, %y
+  %u = add i32 %t, %x
+  ret i32 %u
+}
+
+define i32 @or2(i32 %x, i32 %y) {
+  %s = or i32 %x, 1
+  %t = sub i32 %s, %y
+  %u = add i32 %t, %x
+  ret i32 %u
+}
+
+define i32 @or3(i32 %x, i32 %y) {
+  %s = or i32 %x, 7
+  %t = sub i32 %s, %y
+  %u = add i32 %t, %x
+  ret i32 %u
+}
+
+define weak i32 @or4(i32 %x, i32 %y) {
+  %s = or i32 %x, 7
+  %t = sub i32 %s, %y
+  %u = add i32 %t, %x
+  ret i32 %u
+}
+
+define i32 @or5(i32 %x, i32 %y) {
+  %s = or i32 %x, 3
+  %t = sub i32 %s, %y
+  %u = add i32 %t, %x
+  ret i32 %u
+}
+
+define i32 @shl1(i32 %x, i32 %y) {
+  %s = shl i32 %x, 1
+  %t = sub i32 %s, %y
+  %u = add i32 %t, %x
+  ret i32 %u
+}
+
+define i32 @shl2(i32 %x, i32 %y) {
+  %s = shl i32 %x, 1
+  %t = sub i32 %s, %y
+  %u = add i32 %t, %x
+  ret i32 %u
+}
+
+define i32 @shl3(i32 %x, i32 %y) {
+  %s = shl i32 %x, 7
+  %t = sub i32 %s, %y
+  %u = add i32 %t, %x
+  ret i32 %u
+}
+
+define weak i32 @shl4(i32 %x, i32 %y) {
+  %s = shl i32 %x, 7
+  %t = sub i32 %s, %y
+  %u = add i32 %t, %x
+  ret i32 %u
+}
+
+define i32 @shl5(i32 %x, i32 %y) {
+  %s = shl i32 %x, 3
+  %t = sub i32 %s, %y
+  %u = add i32 %t, %x
+  ret i32 %u
+}
@@ -0,0 +1,60 @@
+; RUN: opt -S -icall-profile < %s | FileCheck %s
+; RUN: opt -S -icall-profile -instrprof < %s | FileCheck %s --check-prefix=LOWER
+
+target triple = "x86_64-unknown-linux-gnu"
+
+@fp = global i32 (i32)* null
+
+; Declarations have no record.
+; CHECK-NOT: @__llvm_profile_name_ext
+; CHECK: @__llvm_profile_name_calls = private constant [5 x i8] c"calls"
+; CHECK: @__llvm_profile_name_leaf = private constant [4 x i8] c"leaf"
+declare void @ext(i32)
+declare void @target(i64)
+
+; Each indirect call is a value site, numbered in order. Direct calls, calls
+; through a cast function and inline asm are not. The record hash encodes the
+; number of sites: 0x1ca1100000002.
+; CHECK-LABEL: define void @calls(
+; CHECK-NEXT: entry:
+; CHECK-NEXT: call void @llvm.instrprof.increment(i8* getelementptr inbounds ([5 x i8], [5 x i8]* @__llvm_profile_name_calls, i32 0, i32 0), i64 503649339965442, i32 1, i32 0)
+; CHECK-NEXT: call void @ext(i32 0)
+; CHECK-NEXT: [[F:%.*]] = ptrtoint void (i32)* %f to i64
+; CHECK-NEXT: call void @llvm.instrprof.value.profile(i8* getelementptr inbounds ([5 x i8], [5 x i8]* @__llvm_profile_name_calls, i32 0, i32 0), i64 503649339965442, i64 [[F]], i32 0, i32 0)
+; CHECK-NEXT: call void %f(i32 1)
+; CHECK-NEXT: call void bitcast
+; CHECK-NEXT: call void asm sideeffect
+; CHECK-NEXT: %g = load
+; CHECK-NEXT: [[G:%.*]] = ptrtoint i32 (i32)* %g to i64
+; CHECK-NEXT: call void @llvm.instrprof.value.profile(i8* getelementptr inbounds ([5 x i8], [5 x i8]* @__llvm_profile_name_calls, i32 0, i32 0), i64 503649339965442, i64 [[G]], i32 0, i32 1)
+; CHECK-NEXT: %r = call i32 %g(i32 3)
+
+; LOWER: @__llvm_profile_values_calls = private global [16 x i64] zeroinitializer, section "__llvm_prf_vals", align 8
+; LOWER: @__llvm_profile_data_calls = {{.*}} i8* bitcast (void (void (i32)*)* @calls to i8*), i64* getelementptr inbounds ([16 x i64], [16 x i64]* @__llvm_profile_values_calls, i32 0, i32 0), i32 2 }
+; LOWER: @__llvm_profile_data_leaf = {{.*}} i8* bitcast (i32 (i32)* @leaf to i8*), i64* null, i32 0 }
+; LOWER-LABEL: define void @calls(
+; LOWER: [[F:%.*]] = ptrtoint void (i32)* %f to i64
+; LOWER-NEXT: call void @__llvm_profile_instrument_target(i64 [[F]], i8* bitcast ({{.*}}* @__llvm_profile_data_calls to i8*), i32 0)
+; LOWER-NEXT: call void %f(i32 1)
+; LOWER: [[G:%.*]] = ptrtoint i32 (i32)* %g to i64
+; LOWER-NEXT: call void @__llvm_profile_instrument_target(i64 [[G]], i8* bitcast ({{.*}}* @__llvm_profile_data_calls to i8*), i32 1)
+define void @calls(void (i32)* %f) {
+entry:
+  call void @ext(i32 0)
+  call void %f(i32 1)
+  call void bitcast (void (i64)* @target to void (i32)*)(i32 2)
+  call void asm sideeffect "nop", ""()
+  %g = load i32 (i32)*, i32 (i32)** @fp
+  %r = call i32 %g(i32 3)
+  ret void
+}
+
+; A function without indirect calls gets a record all the same, so that it
+; can be named as a target. Its hash is 0x1ca1100000000.
+; CHECK-LABEL: define i32 @leaf(
+; CHECK-NEXT: call void @llvm.instrprof.increment(i8* getelementptr inbounds ([4 x i8], [4 x i8]* @__llvm_profile_name_leaf, i32 0, i32 0), i64 503649339965440, i32 1, i32 0)
+; CHECK-NOT: value.profile
+; CHECK: ret i32 %x
+define i32 @leaf(i32 %x) {
+  ret i32 %x
+}
@@ -0,0 +1,182 @@
+; A raw profile in which the only indirect call of @main went 4500 times to
+; @inc, 500 times to @dec and 100 times to a function with no record, and the
+; indirect invoke of @inv went 2000 times to @inc.
+; RUN: printf '\201rforpl\377' > %t.profraw
+; RUN: printf '\2\0\0\0\0\0\0\0' >> %t.profraw
+; RUN: printf '\4\0\0\0\0\0\0\0' >> %t.profraw
+; RUN: printf '\4\0\0\0\0\0\0\0' >> %t.profraw
+; RUN: printf '\15\0\0\0\0\0\0\0' >> %t.profraw
+; RUN: printf '\0\020\0\0\0\0\0\0' >> %t.profraw
+; RUN: printf '\0\060\0\0\0\0\0\0' >> %t.profraw
+; RUN: printf '\20\0\0\0\0\0\0\0' >> %t.profraw
+; RUN: printf '\0\040\0\0\0\0\0\0' >> %t.profraw
+
+; RUN: printf '\4\0\0\0' >> %t.profraw
+; RUN: printf '\1\0\0\0' >> %t.profraw
+; RUN: printf '\1\0\0\0\021\312\1\0' >> %t.profraw
+; RUN: printf '\0\060\0\0\0\0\0\0' >> %t.profraw
+; RUN: printf '\0\020\0\0\0\0\0\0' >> %t.profraw
+; RUN: printf '\0\140\0\0\0\0\0\0' >> %t.profraw
+; RUN: printf '\0\040\0\0\0\0\0\0' >> %t.profraw
+; RUN: printf '\1\0\0\0\0\0\0\0' >> %t.profraw
+
+; RUN: printf '\3\0\0\0' >> %t.profraw
+; RUN: printf '\1\0\0\0' >> %t.profraw
+; RUN: printf '\0\0\0\0\021\312\1\0' >> %t.profraw
+; RUN: printf '\4\060\0\0\0\0\0\0' >> %t.profraw
+; RUN: printf '\10\020\0\0\0\0\0\0' >> %t.profraw
+; RUN: printf '\0\100\0\0\0\0\0\0' >> %t.profraw
+; RUN: printf '\0\0\0\0\0\0\0\0' >> %t.profraw
+; RUN: printf '\0\0\0\0\0\0\0\0' >> %t.profraw
+
+; RUN: printf '\3\0\0\0' >> %t.profraw
+; RUN: printf '\1\0\0\0' >> %t.profraw
+; RUN: printf '\0\0\0\0\021\312\1\0' >> %t.profraw
+; RUN: printf '\7\060\0\0\0\0\0\0' >> %t.profraw
+; RUN: printf '\20\020\0\0\0\0\0\0' >> %t.profraw
+; RUN: printf '\0\120\0\0\0\0\0\0' >> %t.profraw
+; RUN: printf '\0\0\0\0\0\0\0\0' >> %t.profraw
+; RUN: printf '\0\0\0\0\0\0\0\0' >> %t.profraw
+
+; RUN: printf '\3\0\0\0' >> %t.profraw
+; RUN: printf '\1\0\0\0' >> %t.profraw
+; RUN: printf '\1\0\0\0\021\312\1\0' >> %t.profraw
+; RUN: printf '\12\060\0\0\0\0\0\0' >> %t.profraw
+; RUN: printf '\30\020\0\0\0\0\0\0' >> %t.profraw
+; RUN: printf '\0\200\0\0\0\0\0\0' >> %t.profraw
+; RUN: printf '\100\040\0\0\0\0\0\0' >> %t.profraw
+; RUN: printf '\1\0\0\0\0\0\0\0' >> %t.profraw
+
+; RUN: printf '\1\0\0\0\0\0\0\0' >> %t.profraw
+; RUN: printf '\224\021\0\0\0\0\0\0' >> %t.profraw
+; RUN: printf '\364\1\0\0\0\0\0\0' >> %t.profraw
+; RUN: printf '\320\7\0\0\0\0\0\0' >> %t.profraw
+
+; RUN: printf '\0\100\0\0\0\0\0\0' >> %t.profraw
+; RUN: printf '\224\021\0\0\0\0\0\0' >> %t.profraw
+; RUN: printf '\0\120\0\0\0\0\0\0' >> %t.profraw
+; RUN: printf '\364\1\0\0\0\0\0\0' >> %t.profraw
+; RUN: printf '\0\160\0\0\0\0\0\0' >> %t.profraw
+; RUN: printf '\144\0\0\0\0\0\0\0' >> %t.profraw
+; RUN: printf '\0\0\0\0\0\0\0\0' >> %t.profraw
+; RUN: printf '\0\0\0\0\0\0\0\0' >> %t.profraw
+; RUN: printf '\0\100\0\0\0\0\0\0' >> %t.profraw
+; RUN: printf '\320\7\0\0\0\0\0\0' >> %t.profraw
+; RUN: printf '\0\0\0\0\0\0\0\0' >> %t.profraw
+; RUN: printf '\0\0\0\0\0\0\0\0' >> %t.profraw
+; RUN: printf '\0\0\0\0\0\0\0\0' >> %t.profraw
+; RUN: printf '\0\0\0\0\0\0\0\0' >> %t.profraw
+; RUN: printf '\0\0\0\0\0\0\0\0' >> %t.profraw
+; RUN: printf '\0\0\0\0\0\0\0\0' >> %t.profraw
+
+; RUN: printf 'mainincdecinv' >> %t.profraw
+
+; RUN: llvm-profdata merge %t.profraw -o %t.profdata
+; RUN: llvm-profdata show %t.profdata -function=main -counts \
+; RUN:   | FileCheck %s --check-prefix=PROFDATA
+; RUN: opt -S -icall-promotion -icall-promotion-profile=%t.profdata < %s \
+; RUN:   | FileCheck %s
+; RUN: opt -S -icall-promotion -icall-promotion-profile=%t.profdata \
+; RUN:   -icall-promotion-min-count=100 < %s | FileCheck %s --check-prefix=TWO
+; RUN: opt -S -icall-promotion -icall-promotion-profile=%t.profdata \
+; RUN:   -icall-promotion-min-count=100 -icall-promotion-max-targets=1 < %s \
+; RUN:   | FileCheck %s
+; RUN: opt -S -icall-promotion -icall-promotion-profile=%t.profdata \
+; RUN:   -icall-promotion-min-count=5000 < %s \
+; RUN:   | FileCheck %s --check-prefix=NONE
+
+; The targets are stored by the MD5 hash of their names.
+; PROFDATA: Site 0 targets: [0xd8f12673de3f9fcf: 4500, 0x298295cb5ea2ee1f: 500]
+
+target triple = "x86_64-unknown-linux-gnu"
+
+@fp = global i32 (i32)* null
+
+declare i32 @__gxx_personality_v0(...)
+
+define i32 @inc(i32 %x) {
+  %r = add i32 %x, 1
+  ret i32 %r
+}
+
+define i32 @dec(i32 %x) {
+  %r = sub i32 %x, 1
+  ret i32 %r
+}
+
+; @inc takes 90% of the calls and is promoted. @dec is under the default
+; minimum count, and the unknown target can't be named.
+; CHECK-LABEL: define i32 @main(
+; CHECK: %icp.cmp = icmp eq i32 (i32)* %f, @inc
+; CHECK-NEXT: br i1 %icp.cmp, label %icp.direct, label %icp.indirect, !prof [[W:![0-9]+]]
+; CHECK: icp.direct:
+; CHECK-NEXT: [[R1:%.*]] = call i32 @inc(i32 %x)
+; CHECK-NEXT: br label %icp.merge
+; CHECK: icp.indirect:
+; CHECK-NEXT: %r = call i32 %f(i32 %x)
+; CHECK-NEXT: br label %icp.merge
+; CHECK: icp.merge:
+; CHECK-NEXT: [[PHI:%.*]] = phi i32 [ [[R1]], %icp.direct ], [ %r, %icp.indirect ]
+; CHECK-NEXT: ret i32 [[PHI]]
+; CHECK-NOT: @dec(
+
+; With a lower threshold, @dec takes all of the remaining calls and is
+; promoted as well.
+; TWO-LABEL: define i32 @main(
+; TWO: icmp eq i32 (i32)* %f, @inc
+; TWO: call i32 @inc(i32 %x)
+; TWO: icmp eq i32 (i32)* %f, @dec
+; TWO: call i32 @dec(i32 %x)
+; TWO: %r = call i32 %f(i32 %x)
+
+; NONE-LABEL: define i32 @main(
+; NONE-NOT: icp.cmp
+; NONE: ret i32
+define i32 @main(i32 %x) {
+  %f = load i32 (i32)*, i32 (i32)** @fp
+  %r = call i32 %f(i32 %x)
+  ret i32 %r
+}
+
+; An invoke is duplicated in two blocks which merge their results before the
+; normal destination. Both unwind to the same landing pad.
+; CHECK-LABEL: define i32 @inv(
+; CHECK: br i1 %icp.cmp, label %icp.direct, label %icp.indirect, !prof [[W2:![0-9]+]]
+; CHECK: icp.direct:
+; CHECK-NEXT: [[R1:%.*]] = invoke i32 @inc(i32 %x)
+; CHECK-NEXT: to label %icp.merge unwind label %lpad
+; CHECK: icp.indirect:
+; CHECK-NEXT: %r = invoke i32 %f(i32 %x)
+; CHECK-NEXT: to label %icp.merge unwind label %lpad
+; CHECK: icp.merge:
+; CHECK-NEXT: [[PHI:%.*]] = phi i32 [ [[R1]], %icp.direct ], [ %r, %icp.indirect ]
+; CHECK-NEXT: br label %cont
+; CHECK: cont:
+; CHECK-NEXT: ret i32 [[PHI]]
+define i32 @inv(i32 %x) {
+entry:
+  %f = load i32 (i32)*, i32 (i32)** @fp
+  %r = invoke i32 %f(i32 %x)
+          to label %cont unwind label %lpad
+
+cont:
+  ret i32 %r
+
+lpad:
+  %lp = landingpad { i8*, i32 } personality i32 (...)* @__gxx_personality_v0
+          cleanup
+  ret i32 0
+}
+
+; @other has no profile and is left alone.
+; CHECK-LABEL: define i32 @other(
+; CHECK-NOT: icp.cmp
+; CHECK: ret i32
+define i32 @other(i32 %x) {
+  %f = load i32 (i32)*, i32 (i32)** @fp
+  %r = call i32 %f(i32 %x)
+  ret i32 %r
+}
+
+; CHECK: [[W]] = !{!"branch_weights", i32 4500, i32 500}
+; CHECK: [[W2]] = !{!"branch_weights", i32 2000, i32 0}
@@ -0,0 +1,127 @@
+; Horizontal reductions with xor and mul feeding a store.
+; RUN: opt -S -basicaa -slp-vectorizer -slp-vectorize-hor \
+; RUN:     -slp-vectorize-hor-store -mcpu=corei7 < %s \
+; RUN:     | FileCheck %s --check-prefix=SSE
+; RUN: opt -S -basicaa -slp-vectorizer -slp-vectorize-hor \
+; RUN:     -slp-vectorize-hor-store -mcpu=core-avx2 -slp-max-reg-size=256 < %s \
+; RUN:     | FileCheck %s --check-prefix=AVX
+; RUN: opt -S -basicaa -slp-vectorizer -slp-vectorize-hor -mcpu=corei7 < %s \
+; RUN:     | FileCheck %s --check-prefix=NOSTORE
+;
+; With a budget of two trees only the first half of @mul4 is vectorized, and
+; the rest of the reduction stays scalar.
+; RUN: opt -S -basicaa -slp-vectorizer -slp-vectorize-hor \
+; RUN:     -slp-vectorize-hor-store -mcpu=corei7 -slp-tree-budget=2 < %s \
+; RUN:     | FileCheck %s --check-prefix=BUDGET
+; RUN: opt -disable-output -stats -basicaa -slp-vectorizer -slp-vectorize-hor \
+; RUN:     -slp-vectorize-hor-store -mcpu=corei7 -slp-tree-budget=1 < %s 2>&1 \
+; RUN:     | FileCheck %s --check-prefix=STATS
+; REQUIRES: asserts
+
+target datalayout = "e-m:e-i64:64-f80:128-n8:16:32:64-S128"
+target triple = "x86_64-unknown-linux-gnu"
+
+; Eight lanes only pay off when the whole reduction fits one vector.
+; SSE-LABEL: @xor8(
+; SSE-NOT: <4 x i32>
+; SSE: store i32 %r7, i32* %out
+; AVX-LABEL: @xor8(
+; AVX: %[[V:.*]] = load <8 x i32>
+; AVX: %bin.rdx = xor <8 x i32> %[[V]], %rdx.shuf
+; AVX: %bin.rdx2 = xor <8 x i32>
+; AVX: %bin.rdx4 = xor <8 x i32>
+; AVX: %[[R:.*]] = extractelement <8 x i32> %bin.rdx4, i32 0
+; AVX: store i32 %[[R]], i32* %out
+
+define void @xor8(i32* noalias %p, i32* noalias %out) {
+entry:
+  %p1 = getelementptr inbounds i32, i32* %p, i64 1
+  %p2 = getelementptr inbounds i32, i32* %p, i64 2
+  %p3 = getelementptr inbounds i32, i32* %p, i64 3
+  %p4 = getelementptr inbounds i32, i32* %p, i64 4
+  %p5 = getelementptr inbounds i32, i32* %p, i64 5
+  %p6 = getelementptr inbounds i32, i32* %p, i64 6
+  %p7 = getelementptr inbounds i32, i32* %p, i64 7
+  %a0 = load i32, i32* %p
+  %a1 = load i32, i32* %p1
+  %a2 = load i32, i32* %p2
+  %a3 = load i32, i32* %p3
+  %a4 = load i32, i32* %p4
+  %a5 = load i32, i32* %p5
+  %a6 = load i32, i32* %p6
+  %a7 = load i32, i32* %p7
+  %r1 = xor i32 %a0, %a1
+  %r2 = xor i32 %r1, %a2
+  %r3 = xor i32 %r2, %a3
+  %r4 = xor i32 %r3, %a4
+  %r5 = xor i32 %r4, %a5
+  %r6 = xor i32 %r5, %a6
+  %r7 = xor i32 %r6, %a7
+  store i32 %r7, i32* %out
+  ret void
+}
+
+; A 4-lane pmulld costs too much, so the reduction is done in two halves.
+; SSE-LABEL: @mul4(
+; SSE: %[[LO:.*]] = load <2 x i32>
+; SSE: %[[HI:.*]] = load <2 x i32>
+; SSE: %bin.rdx = mul <2 x i32> %[[LO]], %rdx.shuf
+; SSE: %[[L:.*]] = extractelement <2 x i32> %bin.rdx, i32 0
+; SSE: %bin.rdx2 = mul <2 x i32> %[[HI]], %rdx.shuf1
+; SSE: %[[H:.*]] = extractelement <2 x i32> %bin.rdx2, i32 0
+; SSE: %[[R:.*]] = mul i32 %[[L]], %[[H]]
+; SSE: store i32 %[[R]], i32* %out
+; NOSTORE-LABEL: @mul4(
+; NOSTORE-NOT: <2 x i32>
+; NOSTORE: store i32 %r3, i32* %out
+; BUDGET-LABEL: @mul4(
+; BUDGET: %[[LO:.*]] = load <2 x i32>
+; BUDGET: %a2 = load i32
+; BUDGET: %a3 = load i32
+; BUDGET: %bin.rdx = mul <2 x i32> %[[LO]], %rdx.shuf
+; BUDGET: %[[L:.*]] = extractelement <2 x i32> %bin.rdx, i32 0
+; BUDGET: %[[T:.*]] = mul i32 %[[L]], %a2
+; BUDGET: %[[R:.*]] = mul i32 %[[T]], %a3
+; BUDGET: store i32 %[[R]], i32* %out
+; STATS: 3 SLP - Number of functions which ran out of SLP tree budget
+define void @mul4(i32* noalias %p, i32* noalias %out) {
+entry:
+  %p1 = getelementptr inbounds i32, i32* %p, i64 1
+  %p2 = getelementptr inbounds i32, i32* %p, i64 2
+  %p3 = getelementptr inbounds i32, i32* %p, i64 3
+  %a0 = load i32, i32* %p
+  %a1 = load i32, i32* %p1
+  %a2 = load i32, i32* %p2
+  %a3 = load i32, i32* %p3
+  %r1 = mul i32 %a0, %a1
+  %r2 = mul i32 %r1, %a2
+  %r3 = mul i32 %r2, %a3
+  store i32 %r3, i32* %out
+  ret void
+}
+
+; Neither a 4-lane nor a 2-lane chunk of six values pays off.
+; SSE-LABEL: @xor6(
+; SSE-NOT: <
+; SSE: store i32 %r5, i32* %out
+define void @xor6(i32* noalias %p, i32* noalias %out) {
+entry:
+  %p1 = getelementptr inbounds i32, i32* %p, i64 1
+  %p2 = getelementptr inbounds i32, i32* %p, i64 2
+  %p3 = getelementptr inbounds i32, i32* %p, i64 3
+  %p4 = getelementptr inbounds i32, i32* %p, i64 4
+  %p5 = getelementptr inbounds i32, i32* %p, i64 5
+  %a0 = load i32, i32* %p
+  %a1 = load i32, i32* %p1
+  %a2 = load i32, i32* %p2
+  %a3 = load i32, i32* %p3
+  %a4 = load i32, i32* %p4
+  %a5 = load i32, i32* %p5
+  %r1 = xor i32 %a0, %a1
+  %r2 = xor i32 %r1, %a2
+  %r3 = xor i32 %r2, %a3
+  %r4 = xor i32 %r3, %a4
+  %r5 = xor i32 %r4, %a5
+  store i32 %r5, i32* %out
+  ret void
+}
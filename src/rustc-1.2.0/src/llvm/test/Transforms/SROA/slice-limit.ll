@@ -0,0 +1,93 @@
+; RUN: opt -S -sroa < %s | FileCheck %s
+; RUN: opt -S -sroa -sroa-max-alloca-slices=4 < %s \
+; RUN:   | FileCheck %s --check-prefix=LIMIT
+; RUN: opt -S -sroa -sroa-max-alloca-slices=4 -stats < %s 2>&1 >/dev/null \
+; RUN:   | FileCheck %s --check-prefix=STATS
+; RUN: opt -S -sroa -time-passes < %s 2>&1 >/dev/null \
+; RUN:   | FileCheck %s --check-prefix=TIME
+; REQUIRES: asserts
+
+target datalayout = "e-m:e-i64:64-f80:128-n8:16:32:64-S128"
+
+declare void @llvm.memcpy.p0i8.p0i8.i64(i8* nocapture, i8* nocapture readonly, i64, i32, i1)
+
+; Five slices are over the limit, so the alloca is left as it is.
+; CHECK-LABEL: define i32 @three(
+; CHECK-NOT: alloca
+; CHECK: %r = add i32 %a, %c
+; LIMIT-LABEL: define i32 @three(
+; LIMIT: %s = alloca { i32, i32, i32 }
+; LIMIT: %x = load i32, i32* %p0
+define i32 @three(i32 %a, i32 %b, i32 %c) {
+entry:
+  %s = alloca { i32, i32, i32 }
+  %p0 = getelementptr { i32, i32, i32 }, { i32, i32, i32 }* %s, i64 0, i32 0
+  %p1 = getelementptr { i32, i32, i32 }, { i32, i32, i32 }* %s, i64 0, i32 1
+  %p2 = getelementptr { i32, i32, i32 }, { i32, i32, i32 }* %s, i64 0, i32 2
+  store i32 %a, i32* %p0
+  store i32 %b, i32* %p1
+  store i32 %c, i32* %p2
+  %x = load i32, i32* %p0
+  %y = load i32, i32* %p2
+  %r = add i32 %x, %y
+  ret i32 %r
+}
+
+; One slice is within the limit.
+; CHECK-LABEL: define i32 @one(
+; CHECK-NEXT: entry:
+; CHECK-NEXT: ret i32 %a
+; LIMIT-LABEL: define i32 @one(
+; LIMIT-NEXT: entry:
+; LIMIT-NEXT: ret i32 %a
+define i32 @one(i32 %a) {
+entry:
+  %s = alloca { i32, i32 }
+  %p0 = getelementptr { i32, i32 }, { i32, i32 }* %s, i64 0, i32 0
+  store i32 %a, i32* %p0
+  %x = load i32, i32* %p0
+  ret i32 %x
+}
+
+; A chain of copies between aggregates of up to three slices. Each one is
+; split and deleted while the others are still queued, and all of them end
+; up promoted.
+; CHECK-LABEL: define i64 @copies(
+; CHECK-NOT: alloca
+; CHECK-NOT: memcpy
+; CHECK: %r = add i64 %a, %b
+; CHECK-NEXT: ret i64 %r
+; LIMIT-LABEL: define i64 @copies(
+; LIMIT-NOT: alloca
+; LIMIT: ret i64 %r
+define i64 @copies(i64 %a, i64 %b) {
+entry:
+  %x = alloca [2 x i64]
+  %y = alloca [2 x i64]
+  %z = alloca [2 x i64]
+  %x0 = getelementptr [2 x i64], [2 x i64]* %x, i64 0, i64 0
+  %x1 = getelementptr [2 x i64], [2 x i64]* %x, i64 0, i64 1
+  store i64 %a, i64* %x0
+  store i64 %b, i64* %x1
+  %x8 = bitcast [2 x i64]* %x to i8*
+  %y8 = bitcast [2 x i64]* %y to i8*
+  %z8 = bitcast [2 x i64]* %z to i8*
+  call void @llvm.memcpy.p0i8.p0i8.i64(i8* %y8, i8* %x8, i64 16, i32 8, i1 false)
+  call void @llvm.memcpy.p0i8.p0i8.i64(i8* %z8, i8* %y8, i64 16, i32 8, i1 false)
+  %z0 = getelementptr [2 x i64], [2 x i64]* %z, i64 0, i64 0
+  %z1 = getelementptr [2 x i64], [2 x i64]* %z, i64 0, i64 1
+  %u = load i64, i64* %z0
+  %v = load i64, i64* %z1
+  %r = add i64 %u, %v
+  ret i64 %r
+}
+
+; STATS: 1 sroa {{.*}} Number of allocas left alone for having too many slices
+
+; TIME: Scalar Replacement Of Aggregates
+; TIME-DAG: Aggregate Load and Store Splitting
+; TIME-DAG: Slice Building
+; TIME-DAG: Load and Store Pre-splitting
+; TIME-DAG: Partition Rewriting
+; TIME-DAG: Dead Instruction Deletion
+; TIME-DAG: Promotion
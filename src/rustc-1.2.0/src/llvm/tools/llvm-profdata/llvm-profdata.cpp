@@ -60,7 +60,8 @@ static void mergeInstrProfile(const cl::list<std::string> &Inputs,
     auto Reader = std::move(ReaderOrErr.get());
     for (const auto &I : *Reader)
       if (std::error_code EC =
-              Writer.addFunctionCounts(I.Name, I.Hash, I.Counts))
+              Writer.addFunctionCounts(I.Name, I.Hash, I.Counts,
+                                       I.IndirectCallSites))
         errs() << Filename << ": " << I.Name << ": " << EC.message() << "\n";
     if (Reader->hasError())
       exitWithError(Reader->getError().message(), Filename);
@@ -174,6 +175,19 @@ static int showInstrProfile(std::string Filename, bool ShowCounts,
     }
     if (Show && ShowCounts)
       OS << "]\n";
+
+    if (Show && !Func.IndirectCallSites.empty()) {
+      OS << "    Indirect call sites: " << Func.IndirectCallSites.size() << "\n";
+      if (ShowCounts)
+        for (size_t I = 0, E = Func.IndirectCallSites.size(); I < E; ++I) {
+          OS << "    Site " << I << " targets: [";
+          for (const InstrProfValueData &Target : Func.IndirectCallSites[I])
+            OS << (&Target == &Func.IndirectCallSites[I].front() ? "" : ", ")
+               << format("0x%016" PRIx64, Target.Value) << ": "
+               << Target.Count;
+          OS << "]\n";
+        }
+    }
   }
   if (Reader->hasError())
     exitWithError(Reader->getError().message(), Filename);
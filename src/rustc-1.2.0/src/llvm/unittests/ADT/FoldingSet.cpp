@@ -14,6 +14,7 @@
 #include "gtest/gtest.h"
 #include "llvm/ADT/FoldingSet.h"
 #include <string>
+#include <vector>
 
 using namespace llvm;
 
@@ -35,5 +36,46 @@ TEST(FoldingSetTest, UnalignedStringTest) {
   EXPECT_EQ(a.ComputeHash(), b.ComputeHash());
 }
 
+struct TrivialNode : public FoldingSetNode {
+  unsigned Key;
+  explicit TrivialNode(unsigned K) : Key(K) {}
+  void Profile(FoldingSetNodeID &ID) const { ID.AddInteger(Key); }
+};
+
+TEST(FoldingSetTest, ShrinkAndClear) {
+  std::vector<TrivialNode> Nodes;
+  for (unsigned i = 0; i != 1100; ++i)
+    Nodes.emplace_back(i);
+
+  FoldingSet<TrivialNode> Set;
+  for (unsigned i = 0; i != 1000; ++i)
+    Set.InsertNode(&Nodes[i]);
+  EXPECT_EQ(1000u, Set.size());
+
+  // The set is already sized for this many nodes.
+  EXPECT_FALSE(Set.shrink_and_clear());
+  EXPECT_TRUE(Set.empty());
+
+  for (unsigned i = 1000; i != 1010; ++i)
+    Set.InsertNode(&Nodes[i]);
+  EXPECT_TRUE(Set.shrink_and_clear());
+  EXPECT_TRUE(Set.empty());
+
+  // The shrunk set still works and grows again.
+  for (unsigned i = 1010; i != 1100; ++i)
+    Set.InsertNode(&Nodes[i]);
+  EXPECT_EQ(90u, Set.size());
+  for (unsigned i = 1010; i != 1100; ++i) {
+    FoldingSetNodeID ID;
+    ID.AddInteger(i);
+    void *InsertPos;
+    EXPECT_EQ(&Nodes[i], Set.FindNodeOrInsertPos(ID, InsertPos));
+  }
+  FoldingSetNodeID ID;
+  ID.AddInteger(5u);
+  void *InsertPos;
+  EXPECT_EQ(nullptr, Set.FindNodeOrInsertPos(ID, InsertPos));
+}
+
 }
 
@@ -85,6 +85,36 @@ TEST_F(InstrProfTest, get_function_counts) {
   ASSERT_TRUE(ErrorEquals(instrprof_error::unknown_function, EC));
 }
 
+TEST_F(InstrProfTest, get_indirect_call_targets) {
+  std::vector<std::vector<InstrProfValueData>> Sites = {
+      {{0xaa, 10}, {0xbb, 2}}, {}};
+  Writer.addFunctionCounts("foo", 0x1234, {1, 2}, Sites);
+  // Merging sums matching targets and keeps the hottest target first.
+  Sites = {{{0xbb, 20}, {0xcc, 1}}, {{0xaa, 3}}};
+  Writer.addFunctionCounts("foo", 0x1234, {1, 2}, Sites);
+  auto Profile = Writer.writeBuffer();
+  readProfile(std::move(Profile));
+
+  InstrProfRecord Record;
+  ASSERT_TRUE(NoError(Reader->getFunctionRecord("foo", 0x1234, Record)));
+  ASSERT_EQ(2U, Record.Counts.size());
+  ASSERT_EQ(2U, Record.Counts[0]);
+  ASSERT_EQ(2U, Record.IndirectCallSites.size());
+  ASSERT_EQ(3U, Record.IndirectCallSites[0].size());
+  ASSERT_EQ(0xbbU, Record.IndirectCallSites[0][0].Value);
+  ASSERT_EQ(22U, Record.IndirectCallSites[0][0].Count);
+  ASSERT_EQ(0xaaU, Record.IndirectCallSites[0][1].Value);
+  ASSERT_EQ(10U, Record.IndirectCallSites[0][1].Count);
+  ASSERT_EQ(0xccU, Record.IndirectCallSites[0][2].Value);
+  ASSERT_EQ(1U, Record.IndirectCallSites[1].size());
+  ASSERT_EQ(3U, Record.IndirectCallSites[1][0].Count);
+
+  // A different number of call sites is a mismatch.
+  Sites.pop_back();
+  std::error_code EC = Writer.addFunctionCounts("foo", 0x1234, {1, 2}, Sites);
+  ASSERT_TRUE(ErrorEquals(instrprof_error::count_mismatch, EC));
+}
+
 TEST_F(InstrProfTest, get_max_function_count) {
   Writer.addFunctionCounts("foo", 0x1234, {1ULL << 31, 2});
   Writer.addFunctionCounts("bar", 0, {1ULL << 63});
@@ -0,0 +1,244 @@
+//===- MemorySSA.cpp - Unit tests for MemorySSA ---------------------------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#include "llvm/Transforms/Utils/MemorySSA.h"
+#include "llvm/Analysis/AliasAnalysis.h"
+#include "llvm/Analysis/Passes.h"
+#include "llvm/AsmParser/Parser.h"
+#include "llvm/IR/Dominators.h"
+#include "llvm/IR/Instructions.h"
+#include "llvm/IR/LLVMContext.h"
+#include "llvm/IR/LegacyPassManager.h"
+#include "llvm/IR/Module.h"
+#include "llvm/Support/SourceMgr.h"
+#include "gtest/gtest.h"
+#include <functional>
+
+using namespace llvm;
+
+namespace {
+
+static char TestPassID;
+
+/// Build memory SSA for each function and hand it to a test callback.
+class MemorySSATestPass : public FunctionPass {
+public:
+  typedef std::function<void(Function &, MemorySSA &)> TestFn;
+
+  explicit MemorySSATestPass(TestFn Test)
+      : FunctionPass(TestPassID), Test(std::move(Test)) {}
+
+  static int initialize() {
+    PassInfo *PI = new PassInfo("MemorySSA testing pass", "", &TestPassID,
+                                nullptr, true, true);
+    PassRegistry &Registry = *PassRegistry::getPassRegistry();
+    Registry.registerPass(*PI, false);
+    initializeAliasAnalysisAnalysisGroup(Registry);
+    initializeBasicAliasAnalysisPass(Registry);
+    initializeDominatorTreeWrapperPassPass(Registry);
+    return 0;
+  }
+
+  void getAnalysisUsage(AnalysisUsage &AU) const override {
+    AU.setPreservesAll();
+    AU.addRequired<AliasAnalysis>();
+    AU.addRequired<DominatorTreeWrapperPass>();
+  }
+
+  bool runOnFunction(Function &F) override {
+    MemorySSA MSSA(F, getAnalysis<AliasAnalysis>(),
+                   getAnalysis<DominatorTreeWrapperPass>().getDomTree());
+    MSSA.verifyMemorySSA();
+    Test(F, MSSA);
+    return false;
+  }
+
+private:
+  TestFn Test;
+};
+
+void runWithMemorySSA(const char *Assembly, MemorySSATestPass::TestFn Test) {
+  static int Initialize = MemorySSATestPass::initialize();
+  (void)Initialize;
+
+  LLVMContext Context;
+  SMDiagnostic Error;
+  std::unique_ptr<Module> M = parseAssemblyString(Assembly, Error, Context);
+  ASSERT_TRUE(M.get() != nullptr);
+
+  legacy::PassManager PM;
+  PM.add(createBasicAliasAnalysisPass());
+  PM.add(new MemorySSATestPass(std::move(Test)));
+  PM.run(*M);
+}
+
+Instruction *getInstruction(Function &F, StringRef BBName, unsigned Index) {
+  for (BasicBlock &BB : F)
+    if (BB.getName() == BBName) {
+      BasicBlock::iterator I = BB.begin();
+      std::advance(I, Index);
+      return I;
+    }
+  return nullptr;
+}
+
+// Two stores to %q on either side of a diamond, and one store to %p above it.
+const char *DiamondIR =
+    "define i32 @f(i1 %c) {\n"
+    "entry:\n"
+    "  %p = alloca i32\n"
+    "  %q = alloca i32\n"
+    "  store i32 1, i32* %p\n"
+    "  br i1 %c, label %left, label %right\n"
+    "left:\n"
+    "  store i32 2, i32* %q\n"
+    "  br label %merge\n"
+    "right:\n"
+    "  store i32 3, i32* %q\n"
+    "  br label %merge\n"
+    "merge:\n"
+    "  %v = load i32, i32* %p\n"
+    "  %w = load i32, i32* %q\n"
+    "  ret i32 %v\n"
+    "}\n";
+
+TEST(MemorySSATest, Diamond) {
+  runWithMemorySSA(DiamondIR, [](Function &F, MemorySSA &MSSA) {
+    Instruction *StoreP = getInstruction(F, "entry", 2);
+    Instruction *StoreLeft = getInstruction(F, "left", 0);
+    LoadInst *LoadP = cast<LoadInst>(getInstruction(F, "merge", 0));
+    LoadInst *LoadQ = cast<LoadInst>(getInstruction(F, "merge", 1));
+
+    MemoryPhi *Phi = MSSA.getMemoryPhi(LoadP->getParent());
+    ASSERT_TRUE(Phi != nullptr);
+    EXPECT_EQ(2u, Phi->getNumIncomingValues());
+    EXPECT_EQ(Phi, MSSA.getMemoryAccess(LoadP)->getDefiningAccess());
+    EXPECT_TRUE(isa<MemoryUse>(MSSA.getMemoryAccess(LoadP)));
+    EXPECT_TRUE(isa<MemoryDef>(MSSA.getMemoryAccess(StoreP)));
+    EXPECT_TRUE(MSSA.isLiveOnEntryDef(
+        MSSA.getMemoryAccess(StoreP)->getDefiningAccess()));
+
+    // The stores to %q don't alias %p, so the store to %p is the only
+    // clobber on both paths. %q has a different clobber on each path.
+    EXPECT_EQ(MSSA.getMemoryAccess(StoreP),
+              MSSA.getClobberingMemoryAccess(LoadP));
+    EXPECT_EQ(Phi, MSSA.getClobberingMemoryAccess(LoadQ));
+
+    // Removing a def rewires its users to its definition.
+    MSSA.removeMemoryAccess(StoreLeft);
+    MSSA.verifyMemorySSA();
+    EXPECT_EQ(nullptr, MSSA.getMemoryAccess(StoreLeft));
+    EXPECT_EQ(nullptr, MSSA.getBlockAccesses(StoreLeft->getParent()));
+    bool FoundStoreP = false;
+    for (unsigned I = 0; I != Phi->getNumIncomingValues(); ++I)
+      FoundStoreP |= Phi->getIncomingValue(I) == MSSA.getMemoryAccess(StoreP);
+    EXPECT_TRUE(FoundStoreP);
+    EXPECT_EQ(Phi, MSSA.getClobberingMemoryAccess(LoadQ));
+  });
+}
+
+// A loop which doesn't write %p does not hide the store before it.
+const char *LoopIR =
+    "define i32 @g(i32* noalias %p, i32* noalias %q, i32 %n) {\n"
+    "entry:\n"
+    "  store i32 1, i32* %p\n"
+    "  br label %loop\n"
+    "loop:\n"
+    "  %i = phi i32 [ 0, %entry ], [ %i.next, %loop ]\n"
+    "  store i32 %i, i32* %q\n"
+    "  %i.next = add i32 %i, 1\n"
+    "  %cmp = icmp slt i32 %i.next, %n\n"
+    "  br i1 %cmp, label %loop, label %exit\n"
+    "exit:\n"
+    "  %v = load i32, i32* %p\n"
+    "  %w = load i32, i32* %q\n"
+    "  ret i32 %v\n"
+    "}\n";
+
+TEST(MemorySSATest, LoopWithoutClobber) {
+  runWithMemorySSA(LoopIR, [](Function &F, MemorySSA &MSSA) {
+    Instruction *StoreP = getInstruction(F, "entry", 0);
+    Instruction *StoreQ = getInstruction(F, "loop", 1);
+    LoadInst *LoadP = cast<LoadInst>(getInstruction(F, "exit", 0));
+    LoadInst *LoadQ = cast<LoadInst>(getInstruction(F, "exit", 1));
+
+    MemoryPhi *Phi = MSSA.getMemoryPhi(StoreQ->getParent());
+    ASSERT_TRUE(Phi != nullptr);
+    EXPECT_EQ(nullptr, MSSA.getMemoryPhi(LoadP->getParent()));
+
+    EXPECT_EQ(MSSA.getMemoryAccess(StoreP),
+              MSSA.getClobberingMemoryAccess(LoadP));
+    EXPECT_EQ(MSSA.getMemoryAccess(StoreQ),
+              MSSA.getClobberingMemoryAccess(LoadQ));
+  });
+}
+
+// %p is computed in the loop. The store to %q in one iteration writes %p of
+// the next, so the walk from the load must stop at the loop's MemoryPhi.
+const char *LoopVariantIR =
+    "define i32 @f(i64 %n) {\n"
+    "entry:\n"
+    "  %a = alloca [16 x i32]\n"
+    "  br label %loop\n"
+    "loop:\n"
+    "  %i = phi i64 [ 0, %entry ], [ %i.next, %loop ]\n"
+    "  %p = getelementptr [16 x i32], [16 x i32]* %a, i64 0, i64 %i\n"
+    "  %v = load i32, i32* %p\n"
+    "  %i.next = add i64 %i, 1\n"
+    "  %q = getelementptr [16 x i32], [16 x i32]* %a, i64 0, i64 %i.next\n"
+    "  store i32 %v, i32* %q\n"
+    "  %cmp = icmp slt i64 %i.next, %n\n"
+    "  br i1 %cmp, label %loop, label %exit\n"
+    "exit:\n"
+    "  ret i32 %v\n"
+    "}\n";
+
+TEST(MemorySSATest, LoopVariantPointer) {
+  runWithMemorySSA(LoopVariantIR, [](Function &F, MemorySSA &MSSA) {
+    LoadInst *Load = cast<LoadInst>(getInstruction(F, "loop", 2));
+    MemoryPhi *Phi = MSSA.getMemoryPhi(Load->getParent());
+    ASSERT_TRUE(Phi != nullptr);
+    EXPECT_EQ(Phi, MSSA.getClobberingMemoryAccess(Load));
+  });
+}
+
+// Cached clobber queries don't survive the pointer they were made for. A new
+// pointer allocated at the same address must not hit its entries.
+const char *TwoObjectsIR =
+    "define i32 @h(i32* noalias %p, i32* noalias %q) {\n"
+    "entry:\n"
+    "  store i32 1, i32* %p\n"
+    "  store i32 2, i32* %q\n"
+    "  %v = load i32, i32* %p\n"
+    "  ret i32 %v\n"
+    "}\n";
+
+TEST(MemorySSATest, ErasedQueryPointer) {
+  runWithMemorySSA(TwoObjectsIR, [](Function &F, MemorySSA &MSSA) {
+    Argument *P = F.arg_begin();
+    Argument *Q = std::next(F.arg_begin());
+    Instruction *StoreP = getInstruction(F, "entry", 0);
+    Instruction *StoreQ = getInstruction(F, "entry", 1);
+    Instruction *Load = getInstruction(F, "entry", 2);
+    MemoryAccess *Start = MSSA.getMemoryAccess(StoreQ);
+
+    Instruction *CastQ = new BitCastInst(Q, Q->getType(), "", Load);
+    EXPECT_EQ(Start, MSSA.getClobberingMemoryAccess(
+                         Start, MemoryLocation(CastQ, 4)));
+    CastQ->eraseFromParent();
+
+    Instruction *CastP = new BitCastInst(P, P->getType(), "", Load);
+    EXPECT_EQ(MSSA.getMemoryAccess(StoreP),
+              MSSA.getClobberingMemoryAccess(Start,
+                                             MemoryLocation(CastP, 4)));
+    CastP->eraseFromParent();
+  });
+}
+
+} // end anonymous namespace
@@ -0,0 +1,54 @@
+#!/usr/bin/env python
+"""A global optimization stress test creation program.
+
+This is a python program that creates an LLVM IR module with many globals,
+for testing the compile time of the interprocedural global passes
+(-globalopt, -globaldce) on very large, LTO-sized modules.
+
+The module contains a chain of internal functions and function pointers,
+where deleting each dead link makes the next one dead:
+
+  @v0 -> @f0 -> uses @v1 -> @f1 -> uses @v2 -> ...
+
+and a number of live internal globals which are read and written from a
+single function, and which every pass over the globals has to look at.
+Revisiting all the live globals for each link of the chain takes time
+proportional to their product, so the time taken should stay linear as
+either number grows.
+"""
+
+import argparse
+def main():
+  parser = argparse.ArgumentParser(description=__doc__)
+  parser.add_argument('globals', type=int,
+                      help="Number of live internal globals")
+  parser.add_argument('--chain', type=int, default=100,
+                      help="Length of the chain of dead globals")
+  args = parser.parse_args()
+
+  for i in range(args.globals):
+    print("@g%d = internal global i32 %d" % (i, i))
+  for i in range(args.chain):
+    print("@v%d = internal global void ()* @f%d" % (i, i))
+  print("")
+
+  print("declare void @sink(void ()**)")
+  for i in range(args.chain):
+    print("define internal void @f%d() {" % i)
+    if i + 1 != args.chain:
+      print("  call void @sink(void ()** @v%d)" % (i + 1))
+    print("  ret void")
+    print("}")
+  print("")
+
+  # Stores of an argument keep the live globals from being optimized away.
+  print("define void @use(i32 %x) {")
+  for i in range(args.globals):
+    print("  %%l%d = load i32, i32* @g%d" % (i, i))
+    print("  %%a%d = add i32 %%l%d, %%x" % (i, i))
+    print("  store i32 %%a%d, i32* @g%d" % (i, i))
+  print("  ret void")
+  print("}")
+
+if __name__ == '__main__':
+  main()